@@ -0,0 +1,161 @@
+/****************************************************************************
+ * apps/builtin/builtin_find.c
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "builtin/builtin.h"
+
+#ifdef CONFIG_BUILTIN_HASH
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+extern const struct builtin_s g_builtins[];
+extern const int g_builtin_count;
+extern uint16_t g_builtin_hash[];
+extern const int g_builtin_hashsize;
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static volatile bool g_builtin_indexed;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/* FNV-1a hash of a NUL-terminated name */
+
+static uint32_t builtin_hash(FAR const char *name)
+{
+  uint32_t hash = 2166136261u;
+
+  while (*name != '\0')
+    {
+      hash ^= (uint8_t)*name++;
+      hash *= 16777619u;
+    }
+
+  return hash;
+}
+
+/* Fill in the open-addressed index.  Slots hold the table index plus one
+ * so that zero marks an empty slot; the index always has more slots than
+ * there are builtins so every probe sequence ends.  Two callers may race
+ * here on first use; an entry that is already present is not inserted
+ * again, so both produce the same index.
+ */
+
+static void builtin_index(void)
+{
+  uint16_t slot;
+  int i;
+
+  for (i = 0; i < g_builtin_count && g_builtins[i].name != NULL; i++)
+    {
+      slot = builtin_hash(g_builtins[i].name) % g_builtin_hashsize;
+      while (g_builtin_hash[slot] != 0 && g_builtin_hash[slot] != i + 1)
+        {
+          if (++slot >= g_builtin_hashsize)
+            {
+              slot = 0;
+            }
+        }
+
+      g_builtin_hash[slot] = i + 1;
+    }
+
+  g_builtin_indexed = true;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: builtin_find
+ *
+ * Description:
+ *   Return the index of the builtin application with the given name.  This
+ *   is equivalent to builtin_isavail() but uses a hash index over the
+ *   builtin table instead of comparing against every name.  The index is
+ *   built on the first call.
+ *
+ * Input Parameter:
+ *   appname - Name of the builtin application.
+ *
+ * Returned Value:
+ *   The index of the application in the builtin table or -ENOENT if there
+ *   is no application of that name.
+ *
+ ****************************************************************************/
+
+int builtin_find(FAR const char *appname)
+{
+  uint16_t slot;
+  int index;
+
+  if (!g_builtin_indexed)
+    {
+      builtin_index();
+    }
+
+  slot = builtin_hash(appname) % g_builtin_hashsize;
+  while (g_builtin_hash[slot] != 0)
+    {
+      index = g_builtin_hash[slot] - 1;
+      if (strcmp(g_builtins[index].name, appname) == 0)
+        {
+          return index;
+        }
+
+      if (++slot >= g_builtin_hashsize)
+        {
+          slot = 0;
+        }
+    }
+
+  return -ENOENT;
+}
+
+#endif /* CONFIG_BUILTIN_HASH */
@@ -41,6 +41,8 @@
 
 #include <nuttx/config.h>
 
+#include <stdint.h>
+
 #include <nuttx/binfmt/builtin.h>
 
 /****************************************************************************
@@ -65,6 +67,16 @@ const struct builtin_s g_builtins[] =
 
 const int g_builtin_count = sizeof(g_builtins) / sizeof(g_builtins[0]);
 
+#ifdef CONFIG_BUILTIN_HASH
+/* Name index used by builtin_find().  It has nearly twice as many slots as
+ * there are builtins so that probe sequences stay short.
+ */
+
+uint16_t g_builtin_hash[2 * (sizeof(g_builtins) / sizeof(g_builtins[0])) - 1];
+const int g_builtin_hashsize =
+  sizeof(g_builtin_hash) / sizeof(g_builtin_hash[0]);
+#endif
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -93,7 +93,11 @@ int exec_builtin(FAR const char *appname, FAR char * const *argv,
 
   /* Verify that an application with this name exists */
 
+#ifdef CONFIG_BUILTIN_HASH
+  index = builtin_find(appname);
+#else
   index = builtin_isavail(appname);
+#endif
   if (index < 0)
     {
       ret = ENOENT;
@@ -43,6 +43,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <nuttx/can/can.h>
@@ -79,6 +80,9 @@ struct obd_dev_s *obd_init(char *devfile, int baudate, int mode)
       return NULL;
     }
 
+  memset(dev, 0, sizeof(struct obd_dev_s));
+  memset(dev->reqhash, OBD_REQ_NONE, sizeof(dev->reqhash));
+
   /* Open the CAN device for reading/writing */
 
   dev->can_fd = open(devfile, O_RDWR);
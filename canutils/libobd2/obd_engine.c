@@ -0,0 +1,608 @@
+/****************************************************************************
+ * canutils/libobd2/obd_engine.c
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <nuttx/can/can.h>
+
+#include "canutils/obd.h"
+#include "canutils/obd_pid.h"
+#include "canutils/obd_frame.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Number of CAN messages fetched with a single read() */
+
+#define OBD_RX_BATCH       4
+
+#define OBD_REQ_HASH(m,p)  (((p) ^ ((m) << 3)) & (OBD_REQ_HASH_SIZE - 1))
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: obd_now
+ *
+ * Description:
+ *   Return a millisecond timestamp for request deadlines.
+ *
+ ****************************************************************************/
+
+static uint32_t obd_now(void)
+{
+  struct timespec ts;
+
+#ifdef CONFIG_CLOCK_MONOTONIC
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+  clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+
+  return (uint32_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/****************************************************************************
+ * Name: obd_find_request
+ *
+ * Description:
+ *   Look up the outstanding request for (opmode, pid) and return its slot
+ *   or OBD_REQ_NONE.
+ *
+ ****************************************************************************/
+
+static uint8_t obd_find_request(FAR struct obd_dev_s *dev, uint8_t opmode,
+                                uint8_t pid)
+{
+  uint8_t i;
+
+  for (i = dev->reqhash[OBD_REQ_HASH(opmode, pid)];
+       i != OBD_REQ_NONE;
+       i = dev->reqs[i].next)
+    {
+      if (dev->reqs[i].opmode == opmode && dev->reqs[i].pid == pid)
+        {
+          break;
+        }
+    }
+
+  return i;
+}
+
+/****************************************************************************
+ * Name: obd_release_request
+ *
+ * Description:
+ *   Unlink a request from its hash chain and free its slot.
+ *
+ ****************************************************************************/
+
+static void obd_release_request(FAR struct obd_dev_s *dev, uint8_t slot)
+{
+  FAR struct obd_req_s *req = &dev->reqs[slot];
+  FAR uint8_t *link = &dev->reqhash[OBD_REQ_HASH(req->opmode, req->pid)];
+
+  while (*link != slot)
+    {
+      link = &dev->reqs[*link].next;
+    }
+
+  *link = req->next;
+  req->inuse = false;
+  dev->nreqs--;
+
+#ifdef CONFIG_LIBOBD2_MULTIFRAME
+  /* A multi-frame response for an expired or cancelled request is no
+   * longer wanted.  Drop it so that Single Frames update dev->data again.
+   */
+
+  if (dev->isotp_busy && dev->isotp_req == slot)
+    {
+      dev->isotp_busy = false;
+      dev->isotp_id   = 0;
+    }
+#endif
+}
+
+/****************************************************************************
+ * Name: obd_complete_request
+ *
+ * Description:
+ *   Hand a response payload (starting with the response mode byte) to the
+ *   request waiting for it.
+ *
+ ****************************************************************************/
+
+static void obd_complete_request(FAR struct obd_dev_s *dev,
+                                 FAR const uint8_t *data, size_t len)
+{
+  FAR struct obd_req_s *req;
+  obd_callback_t callback;
+  FAR void *arg;
+  uint8_t opmode;
+  uint8_t slot;
+
+  if (len < 2 || data[0] < OBD_RESP_BASE)
+    {
+      return;
+    }
+
+  opmode = data[0] - OBD_RESP_BASE;
+  slot = obd_find_request(dev, opmode, data[1]);
+  if (slot == OBD_REQ_NONE)
+    {
+      return;
+    }
+
+  req = &dev->reqs[slot];
+  callback = req->callback;
+  arg = req->arg;
+  obd_release_request(dev, slot);
+
+  callback(dev, opmode, data[1], OK, data, len, arg);
+}
+
+/****************************************************************************
+ * Name: obd_is_response
+ *
+ * Description:
+ *   Check if a CAN message was sent by an ECU in response to a request:
+ *   IDs 0x7e8-0x7ef in standard mode or 0x18daf1xx in extended mode.
+ *
+ ****************************************************************************/
+
+static bool obd_is_response(FAR struct obd_dev_s *dev,
+                            FAR const struct can_msg_s *msg)
+{
+#ifdef CONFIG_CAN_EXTID
+  if (dev->can_mode == CAN_EXT)
+    {
+      return msg->cm_hdr.ch_extid &&
+             (msg->cm_hdr.ch_id & 0xffffff00) ==
+             (OBD_PID_EXT_RESPONSE & 0xffffff00);
+    }
+
+  if (msg->cm_hdr.ch_extid)
+    {
+      return false;
+    }
+#endif
+
+  return (msg->cm_hdr.ch_id & ~7) == OBD_PID_STD_RESPONSE;
+}
+
+#ifdef CONFIG_LIBOBD2_MULTIFRAME
+/****************************************************************************
+ * Name: obd_send_flowcontrol
+ *
+ * Description:
+ *   Tell the ECU that sent a First Frame to send all Consecutive Frames
+ *   without further flow control and without separation time.
+ *
+ ****************************************************************************/
+
+static void obd_send_flowcontrol(FAR struct obd_dev_s *dev, uint32_t ecuid)
+{
+  FAR struct can_msg_s *msg = &dev->can_txmsg;
+  int msgsize;
+
+  /* The physical request ID of an ECU is derived from its response ID */
+
+  memset(msg, 0, sizeof(struct can_msg_s));
+  if (dev->can_mode == CAN_EXT)
+    {
+      msg->cm_hdr.ch_id = 0x18da00f1 | ((ecuid & 0xff) << 8);
+#ifdef CONFIG_CAN_EXTID
+      msg->cm_hdr.ch_extid = 1;
+#endif
+    }
+  else
+    {
+      msg->cm_hdr.ch_id = ecuid - 8;
+    }
+
+  msg->cm_hdr.ch_dlc = 8;
+  msg->cm_data[0] = OBD_FLWCTRL_FRAME; /* Clear to send */
+  msg->cm_data[1] = 0;                 /* Block size: send everything */
+  msg->cm_data[2] = 0;                 /* Separation time: none */
+
+  msgsize = CAN_MSGLEN(8);
+  if (write(dev->can_fd, msg, msgsize) != msgsize)
+    {
+      printf("ERROR: Failed to send flow control: %d\n", errno);
+    }
+}
+#endif
+
+/****************************************************************************
+ * Name: obd_receive_frame
+ *
+ * Description:
+ *   Process one received CAN message: complete a request from a Single
+ *   Frame or feed the ISO-TP reassembly of a multi-frame response.
+ *
+ ****************************************************************************/
+
+static void obd_receive_frame(FAR struct obd_dev_s *dev,
+                              FAR const struct can_msg_s *msg)
+{
+  FAR const uint8_t *frame = msg->cm_data;
+  int msgdlc = msg->cm_hdr.ch_dlc;
+  int len;
+#ifdef CONFIG_LIBOBD2_MULTIFRAME
+  uint8_t slot;
+#endif
+
+  if (!obd_is_response(dev, msg) || msgdlc < 1)
+    {
+      return;
+    }
+
+  switch (OBD_FRAME_TYPE(frame[0]))
+    {
+      case OBD_SINGLE_FRAME:
+        len = OBD_SF_DATA_LEN(frame[0]);
+        if (len == 0 || len >= msgdlc)
+          {
+            return;
+          }
+
+        /* Keep obd_decode_pid() working unless dev->data holds a
+         * multi-frame response being reassembled.
+         */
+
+#ifdef CONFIG_LIBOBD2_MULTIFRAME
+        if (!dev->isotp_busy)
+#endif
+          {
+            memcpy(dev->data, frame, len + 1);
+          }
+
+        obd_complete_request(dev, &frame[1], len);
+        break;
+
+#ifdef CONFIG_LIBOBD2_MULTIFRAME
+      case OBD_FIRST_FRAME:
+        len = OBD_FF_DATA_LEN_D0(frame[0]) | OBD_FF_DATA_LEN_D1(frame[1]);
+        if (msgdlc < 8 || len < 7 || len > sizeof(dev->data) - 1 ||
+            frame[2] < OBD_RESP_BASE)
+          {
+            return;
+          }
+
+        slot = obd_find_request(dev, frame[2] - OBD_RESP_BASE, frame[3]);
+        if (slot == OBD_REQ_NONE)
+          {
+            return;
+          }
+
+        /* Reassemble into dev->data[1..] so the layout matches a Single
+         * Frame and obd_decode_pid() can be used on the result.
+         */
+
+        dev->data[0]    = OBD_FIRST_FRAME;
+        memcpy(&dev->data[1], &frame[2], 6);
+        dev->isotp_id   = msg->cm_hdr.ch_id;
+        dev->isotp_req  = slot;
+        dev->isotp_len  = len;
+        dev->isotp_pos  = 6;
+        dev->isotp_seq  = 1;
+        dev->isotp_busy = true;
+
+        obd_send_flowcontrol(dev, msg->cm_hdr.ch_id);
+        break;
+
+      case OBD_CONSEC_FRAME:
+        if (!dev->isotp_busy || msg->cm_hdr.ch_id != dev->isotp_id)
+          {
+            return;
+          }
+
+        if (OBD_CF_SEQ_NUM(frame[0]) != dev->isotp_seq)
+          {
+            /* Lost a frame; the request will time out */
+
+            dev->isotp_busy = false;
+            return;
+          }
+
+        len = dev->isotp_len - dev->isotp_pos;
+        if (len > msgdlc - 1)
+          {
+            len = msgdlc - 1;
+          }
+
+        memcpy(&dev->data[1 + dev->isotp_pos], &frame[1], len);
+        dev->isotp_pos += len;
+        dev->isotp_seq  = (dev->isotp_seq + 1) & 0xf;
+
+        if (dev->isotp_pos >= dev->isotp_len)
+          {
+            dev->isotp_busy = false;
+            obd_complete_request(dev, &dev->data[1], dev->isotp_len);
+          }
+        break;
+#endif
+
+      default:
+        break;
+    }
+}
+
+/****************************************************************************
+ * Name: obd_expire_requests
+ *
+ * Description:
+ *   Fail all requests whose deadline has passed.
+ *
+ ****************************************************************************/
+
+static void obd_expire_requests(FAR struct obd_dev_s *dev)
+{
+  FAR struct obd_req_s *req;
+  obd_callback_t callback;
+  FAR void *arg;
+  uint32_t now = obd_now();
+  uint8_t opmode;
+  uint8_t pid;
+  int i;
+
+  for (i = 0; i < CONFIG_LIBOBD2_MAX_REQUESTS && dev->nreqs > 0; i++)
+    {
+      req = &dev->reqs[i];
+      if (req->inuse && (int32_t)(req->deadline - now) <= 0)
+        {
+          callback = req->callback;
+          arg      = req->arg;
+          opmode   = req->opmode;
+          pid      = req->pid;
+          obd_release_request(dev, i);
+
+          callback(dev, opmode, pid, -ETIMEDOUT, NULL, 0, arg);
+        }
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: obd_expect_response
+ *
+ * Description:
+ *   Like obd_submit_request() but for a request that was already sent with
+ *   obd_send_request().
+ *
+ ****************************************************************************/
+
+int obd_expect_response(FAR struct obd_dev_s *dev, uint8_t opmode,
+                        uint8_t pid, int timeout, obd_callback_t callback,
+                        FAR void *arg)
+{
+  FAR struct obd_req_s *req;
+  FAR uint8_t *head;
+  int i;
+
+  if (callback == NULL)
+    {
+      return -EINVAL;
+    }
+
+  if (obd_find_request(dev, opmode, pid) != OBD_REQ_NONE)
+    {
+      return -EBUSY;
+    }
+
+  for (i = 0; i < CONFIG_LIBOBD2_MAX_REQUESTS; i++)
+    {
+      if (!dev->reqs[i].inuse)
+        {
+          break;
+        }
+    }
+
+  if (i >= CONFIG_LIBOBD2_MAX_REQUESTS)
+    {
+      return -ENOMEM;
+    }
+
+  head          = &dev->reqhash[OBD_REQ_HASH(opmode, pid)];
+  req           = &dev->reqs[i];
+  req->callback = callback;
+  req->arg      = arg;
+  req->deadline = obd_now() + timeout;
+  req->opmode   = opmode;
+  req->pid      = pid;
+  req->next     = *head;
+  req->inuse    = true;
+  *head         = i;
+  dev->nreqs++;
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: obd_submit_request
+ *
+ * Description:
+ *   Send a "Request Message" for the PID and return without waiting for
+ *   the response.
+ *
+ ****************************************************************************/
+
+int obd_submit_request(FAR struct obd_dev_s *dev, uint8_t opmode,
+                       uint8_t pid, int timeout, obd_callback_t callback,
+                       FAR void *arg)
+{
+  int ret;
+
+  ret = obd_expect_response(dev, opmode, pid, timeout, callback, arg);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = obd_send_request(dev, opmode, pid);
+  if (ret < 0)
+    {
+      obd_cancel_request(dev, opmode, pid);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: obd_cancel_request
+ *
+ * Description:
+ *   Forget an outstanding request without calling its callback.
+ *
+ ****************************************************************************/
+
+int obd_cancel_request(FAR struct obd_dev_s *dev, uint8_t opmode,
+                       uint8_t pid)
+{
+  uint8_t slot = obd_find_request(dev, opmode, pid);
+
+  if (slot == OBD_REQ_NONE)
+    {
+      return -ENOENT;
+    }
+
+  obd_release_request(dev, slot);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: obd_process
+ *
+ * Description:
+ *   Wait for CAN traffic, dispatch the responses and expire the requests
+ *   that timed out.
+ *
+ ****************************************************************************/
+
+int obd_process(FAR struct obd_dev_s *dev, int timeout)
+{
+  uint8_t rxbuf[OBD_RX_BATCH * sizeof(struct can_msg_s)];
+  struct can_msg_s msg;
+  struct pollfd fds;
+  uint32_t now;
+  int32_t left;
+  ssize_t nbytes;
+  size_t msglen;
+  size_t offset;
+  int ret;
+  int i;
+
+  /* Never sleep past the next deadline */
+
+  now = obd_now();
+  for (i = 0; i < CONFIG_LIBOBD2_MAX_REQUESTS; i++)
+    {
+      if (dev->reqs[i].inuse)
+        {
+          left = (int32_t)(dev->reqs[i].deadline - now);
+          if (left < 0)
+            {
+              left = 0;
+            }
+
+          if (timeout < 0 || left < timeout)
+            {
+              timeout = left;
+            }
+        }
+    }
+
+  if (timeout < 0)
+    {
+      return 0;
+    }
+
+  fds.fd      = dev->can_fd;
+  fds.events  = POLLIN;
+  fds.revents = 0;
+
+  ret = poll(&fds, 1, timeout);
+  if (ret < 0)
+    {
+      return -errno;
+    }
+
+  if (ret > 0 && (fds.revents & POLLIN) != 0)
+    {
+      /* The driver returns as many whole messages as fit in the buffer */
+
+      nbytes = read(dev->can_fd, rxbuf, sizeof(rxbuf));
+      if (nbytes < 0)
+        {
+          return -errno;
+        }
+
+      for (offset = 0; offset + CAN_MSGLEN(0) <= nbytes; offset += msglen)
+        {
+          memcpy(&msg, &rxbuf[offset], CAN_MSGLEN(0));
+          msglen = CAN_MSGLEN(msg.cm_hdr.ch_dlc);
+          if (msg.cm_hdr.ch_dlc > CAN_MAXDATALEN || offset + msglen > nbytes)
+            {
+              break;
+            }
+
+          memcpy(msg.cm_data, &rxbuf[offset + CAN_MSGLEN(0)],
+                 msg.cm_hdr.ch_dlc);
+
+#ifdef CONFIG_DEBUG_INFO
+          printf("  ID: %4u DLC: %u\n", msg.cm_hdr.ch_id, msg.cm_hdr.ch_dlc);
+#endif
+
+          obd_receive_frame(dev, &msg);
+        }
+    }
+
+  obd_expire_requests(dev);
+  return dev->nreqs;
+}
@@ -52,6 +52,42 @@
 #include "canutils/obd_pid.h"
 #include "canutils/obd_frame.h"
 
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: obd_wait_callback
+ *
+ * Description:
+ *   Record the outcome of the request obd_wait_response() is waiting for.
+ *
+ ****************************************************************************/
+
+static void obd_wait_callback(FAR struct obd_dev_s *dev, uint8_t opmode,
+                              uint8_t pid, int result,
+                              FAR const uint8_t *data, size_t len,
+                              FAR void *arg)
+{
+  /* Single frame responses may have been dispatched from the CAN message;
+   * callers of obd_wait_response() expect the frame in dev->data.  As in
+   * the engine, leave dev->data alone while it holds a multi-frame response
+   * being reassembled.
+   */
+
+  if (result == OK && data != &dev->data[1]
+#ifdef CONFIG_LIBOBD2_MULTIFRAME
+      && !dev->isotp_busy
+#endif
+     )
+    {
+      dev->data[0] = OBD_SINGLE_FRAME | OBD_SF_DATA_LEN(len);
+      memcpy(&dev->data[1], data, len);
+    }
+
+  *(FAR int *)arg = result;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -64,97 +100,47 @@
  *   obd_send_request().
  *
  *   It will return an error case it doesn't receive the msg after the elapsed
- *   "timeout" time.
+ *   "timeout" time, in units of 10ms.  Responses to requests submitted with
+ *   obd_submit_request() keep being dispatched while waiting.
  *
  ****************************************************************************/
 
 int obd_wait_response(FAR struct obd_dev_s *dev, uint8_t opmode, uint8_t pid,
                       int timeout)
 {
-  int i;
-  int nbytes;
-  int msgdlc;
-  int msgsize;
-  uint8_t extended;
+  int result = -EINPROGRESS;
+  int ret;
 
 #ifdef CONFIG_DEBUG_INFO
   printf("Waiting Response for pid=%d\n", pid);
 #endif
 
-  /* Verify what is the current mode */
-
-  if (dev->can_mode == CAN_EXT)
+  ret = obd_expect_response(dev, opmode, pid, timeout * 10,
+                            obd_wait_callback, &result);
+  if (ret < 0)
     {
-      extended = 1;
+      return ret;
     }
-  else
-    {
-      extended = 0;
-    }
-
-  for (; ; )
-    {
-      /* Read the RX message */
-
-      msgsize = sizeof(struct can_msg_s);
-      nbytes = read(dev->can_fd, &dev->can_rxmsg, msgsize);
-      if (nbytes < CAN_MSGLEN(0) || nbytes > msgsize)
-        {
-          printf("ERROR: read(%ld) returned %ld\n",
-                 (long)msgsize, (long)nbytes);
-          return -EAGAIN;
-        }
-
-      #ifdef CONFIG_DEBUG_INFO
-        printf("  ID: %4u DLC: %u\n",
-               dev->can_rxmsg.cm_hdr.ch_id, dev->can_rxmsg.cm_hdr.ch_dlc);
-      #endif
-
-      msgdlc = dev->can_rxmsg.cm_hdr.ch_dlc;
-
-#ifdef CONFIG_DEBUG_INFO
-      printf("Data received:\n");
-      for (i = 0; i < msgdlc; i++)
-        {
-          printf("  %d: 0x%02x\n", i, dev->can_rxmsg.cm_data[i]);
-        }
-
-      fflush(stdout);
-#endif
-
-      /* Check if we received a Response Message */
 
-      if ((extended && dev->can_rxmsg.cm_hdr.ch_id == OBD_PID_EXT_RESPONSE) || \
-          (!extended && dev->can_rxmsg.cm_hdr.ch_id == OBD_PID_STD_RESPONSE))
-        {
-
-          /* Check if the Response if for the PID we are interested! */
-
-          if (dev->can_rxmsg.cm_data[1] == (opmode + OBD_RESP_BASE) && \
-              dev->can_rxmsg.cm_data[2] == pid)
-            {
-              /* Save received data (important for multi-frame mode) */
-
-              memcpy(dev->data, dev->can_rxmsg.cm_data, msgdlc);
-              return OK;
-            }
-        }
-
-      /* Verify if we timed out */
+  /* obd_process() sleeps in poll() until a frame arrives or the earliest
+   * outstanding request expires, which is at the latest our own deadline.
+   */
 
-      timeout--;
-      if (timeout < 0)
+  while (result == -EINPROGRESS)
+    {
+      ret = obd_process(dev, -1);
+      if (ret < 0 && ret != -EINTR)
         {
-          printf("Timeout trying to receive PID %d\n", pid);
-          return -ETIMEDOUT;
+          printf("ERROR: Failed to receive PID %d: %d\n", pid, ret);
+          obd_cancel_request(dev, opmode, pid);
+          return ret;
         }
-
-      /* Wait 10ms */
-
-      usleep(10000);
     }
 
-  /* Never should come here */
+  if (result == -ETIMEDOUT)
+    {
+      printf("Timeout trying to receive PID %d\n", pid);
+    }
 
-  return OK;
+  return result;
 }
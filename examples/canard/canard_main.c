@@ -45,12 +45,20 @@
 #include <sys/ioctl.h>
 #include <sched.h>
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#ifdef CONFIG_EXAMPLES_LIBCANARD_BENCH
+#  include "canutils/canlib.h"
+#endif
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -86,6 +94,19 @@
 
 #define UNIQUE_ID_LENGTH_BYTES                   16
 
+/* Number of CAN messages moved per read() or write() */
+
+#ifndef CONFIG_EXAMPLES_LIBCANARD_BATCH_FRAMES
+#  define CONFIG_EXAMPLES_LIBCANARD_BATCH_FRAMES 8
+#endif
+
+#ifndef CONFIG_EXAMPLES_LIBCANARD_BENCH_FRAMES
+#  define CONFIG_EXAMPLES_LIBCANARD_BENCH_FRAMES 10000
+#endif
+
+#define CANARD_BATCH_FRAMES   CONFIG_EXAMPLES_LIBCANARD_BATCH_FRAMES
+#define CANARD_BATCH_BUFSIZE  (CANARD_BATCH_FRAMES * sizeof(struct can_msg_s))
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -114,6 +135,97 @@ static uint8_t node_health = UAVCAN_NODE_HEALTH_OK;
 static uint8_t node_mode = UAVCAN_NODE_MODE_INITIALIZATION;
 static bool g_canard_daemon_started;
 
+/* Packed CAN messages as read() and write() exchange them with the driver.
+ * Frames the TX FIFO did not accept yet stay in g_txbuf for the next pass.
+ */
+
+static uint8_t g_txbuf[CANARD_BATCH_BUFSIZE];
+static size_t g_txlen;
+static uint8_t g_rxbuf[CANARD_BATCH_BUFSIZE];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: canardFrameToMsg
+ *
+ * Description:
+ *   Append a libcanard frame to a buffer of packed CAN messages and return
+ *   the number of bytes used.
+ *
+ ****************************************************************************/
+
+static size_t canardFrameToMsg(const CanardCANFrame *frame, uint8_t *buffer)
+{
+  struct can_msg_s msg;
+
+  memset(&msg.cm_hdr, 0, sizeof(msg.cm_hdr));
+  msg.cm_hdr.ch_id  = frame->id & CANARD_CAN_EXT_ID_MASK;
+  msg.cm_hdr.ch_dlc = frame->data_len;
+  msg.cm_hdr.ch_rtr = (frame->id & CANARD_CAN_FRAME_RTR) != 0;
+#ifdef CONFIG_CAN_EXTID
+  msg.cm_hdr.ch_extid = (frame->id & CANARD_CAN_FRAME_EFF) != 0;
+#endif
+  memcpy(msg.cm_data, frame->data, frame->data_len);
+
+  memcpy(buffer, &msg, CAN_MSGLEN(frame->data_len));
+  return CAN_MSGLEN(frame->data_len);
+}
+
+/****************************************************************************
+ * Name: canardMsgFromBuffer
+ *
+ * Description:
+ *   Extract the next CAN message from the packed messages returned by
+ *   read().  Messages are variable length and may not be aligned, so they
+ *   are copied out.  Returns the number of bytes consumed, or zero if no
+ *   complete message is left.
+ *
+ ****************************************************************************/
+
+static size_t canardMsgFromBuffer(struct can_msg_s *msg,
+                                  const uint8_t *buffer, size_t buflen)
+{
+  size_t msglen;
+
+  if (buflen < CAN_MSGLEN(0))
+    {
+      return 0;
+    }
+
+  memcpy(&msg->cm_hdr, buffer, CAN_MSGLEN(0));
+  msglen = CAN_MSGLEN(msg->cm_hdr.ch_dlc);
+  if (msg->cm_hdr.ch_dlc > CAN_MAXDATALEN || msglen > buflen)
+    {
+      return 0;
+    }
+
+  memcpy(msg->cm_data, buffer + CAN_MSGLEN(0), msg->cm_hdr.ch_dlc);
+  return msglen;
+}
+
+/****************************************************************************
+ * Name: canardMsgTimestamp
+ *
+ * Description:
+ *   Return the receive time of a message in microseconds.  The driver's
+ *   own timestamp is used when it provides one; otherwise the time read()
+ *   returned, which is still taken before any of the batch is processed.
+ *
+ ****************************************************************************/
+
+static uint64_t canardMsgTimestamp(const struct can_msg_s *msg,
+                                   uint64_t read_usec)
+{
+#ifdef CONFIG_CAN_TIMESTAMP
+  return (uint64_t)msg->cm_hdr.ch_ts.tv_sec * 1000000ULL +
+         msg->cm_hdr.ch_ts.tv_usec;
+#else
+  return read_usec;
+#endif
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -364,56 +476,320 @@ void process1HzTasks(uint64_t timestamp_usec)
  * Name: processTxRxOnce
  *
  * Description:
- *   Transmits all frames from the TX queue, receives up to one frame.
+ *   Transmits as many frames from the TX queue as the driver accepts and
+ *   receives all frames that are pending, waiting up to timeout_msec for
+ *   the first one.  Each direction needs one syscall per batch of frames
+ *   rather than one per frame.
  *
  ****************************************************************************/
 
 void processTxRxOnce(CanardNuttXInstance * nuttxcan, int timeout_msec)
 {
+  const int fd = canardNuttXGetDeviceFileDescriptor(nuttxcan);
   const CanardCANFrame *txf;
+  CanardCANFrame rx_frame;
+  struct can_msg_s msg;
+  struct pollfd fds;
+  uint64_t timestamp;
+  ssize_t nbytes;
+  size_t msglen;
+  size_t offset;
+  int ret;
 
   /* Transmitting */
 
-  for (txf = NULL; (txf = canardPeekTxQueue(&canard)) != NULL;)
+  while (g_txlen + CAN_MSGLEN(CANARD_CAN_FRAME_MAX_DATA_LEN) <=
+         sizeof(g_txbuf) && (txf = canardPeekTxQueue(&canard)) != NULL)
     {
-      const int tx_res = canardNuttXTransmit(nuttxcan, txf, 0);
-      if (tx_res < 0)           /* Failure - drop the frame and report */
+      g_txlen += canardFrameToMsg(txf, &g_txbuf[g_txlen]);
+      canardPopTxQueue(&canard);
+    }
+
+  if (g_txlen > 0)
+    {
+      fds.fd      = fd;
+      fds.events  = POLLOUT;
+      fds.revents = 0;
+
+      ret = poll(&fds, 1, 0);
+      if (ret > 0 && (fds.revents & POLLOUT) != 0)
         {
-          canardPopTxQueue(&canard);
-          (void)fprintf(stderr,
-                        "Transmit error %d, frame dropped, errno '%s'\n",
-                        tx_res, strerror(errno));
+          nbytes = write(fd, g_txbuf, g_txlen);
+          if (nbytes > 0)
+            {
+              /* Success - keep what the driver did not take yet */
+
+              g_txlen -= nbytes;
+              memmove(g_txbuf, &g_txbuf[nbytes], g_txlen);
+            }
+          else if (nbytes < 0 && errno != EAGAIN)
+            {
+              /* Failure - drop the frames and report */
+
+              g_txlen = 0;
+              (void)fprintf(stderr,
+                            "Transmit error %ld, frames dropped, errno '%s'\n",
+                            (long)nbytes, strerror(errno));
+            }
         }
-      else if (tx_res > 0)      /* Success - just drop the frame */
+      else if (ret < 0)
         {
-          canardPopTxQueue(&canard);
+          (void)fprintf(stderr, "Transmit poll error, errno '%s'\n",
+                        strerror(errno));
         }
-      else                      /* Timeout - just exit and try again later */
+
+      /* Timeout - just try again later */
+    }
+
+  /* Receiving */
+
+  fds.fd      = fd;
+  fds.events  = POLLIN;
+  fds.revents = 0;
+
+  ret = poll(&fds, 1, timeout_msec);
+  if (ret <= 0 || (fds.revents & POLLIN) == 0)
+    {
+      if (ret < 0)              /* Failure - report */
         {
-          break;
+          (void)fprintf(stderr, "Receive poll error, errno '%s'\n",
+                        strerror(errno));
         }
+
+      return;                   /* Timeout - nothing to do */
     }
 
-  /* Receiving */
+  nbytes = read(fd, g_rxbuf, sizeof(g_rxbuf));
+  timestamp = getMonotonicTimestampUSec();
+  if (nbytes < 0)
+    {
+      if (errno != EAGAIN)
+        {
+          (void)fprintf(stderr, "Receive error %ld, errno '%s'\n",
+                        (long)nbytes, strerror(errno));
+        }
 
-  CanardCANFrame rx_frame;
-  const uint64_t timestamp = getMonotonicTimestampUSec();
-  const int rx_res = canardNuttXReceive(nuttxcan, &rx_frame, timeout_msec);
+      return;
+    }
+
+  for (offset = 0;
+       (msglen = canardMsgFromBuffer(&msg, &g_rxbuf[offset],
+                                     nbytes - offset)) > 0;
+       offset += msglen)
+    {
+#ifdef CONFIG_CAN_ERRORS
+      if (msg.cm_hdr.ch_error != 0)
+        {
+          continue;
+        }
+#endif
+
+      if (msg.cm_hdr.ch_dlc > CANARD_CAN_FRAME_MAX_DATA_LEN)
+        {
+          continue;
+        }
+
+      memset(&rx_frame, 0, sizeof(rx_frame));
+      rx_frame.id = msg.cm_hdr.ch_id;
+#ifdef CONFIG_CAN_EXTID
+      if (msg.cm_hdr.ch_extid)
+        {
+          rx_frame.id |= CANARD_CAN_FRAME_EFF;
+        }
+#endif
+
+      if (msg.cm_hdr.ch_rtr)
+        {
+          rx_frame.id |= CANARD_CAN_FRAME_RTR;
+        }
+
+      rx_frame.data_len = msg.cm_hdr.ch_dlc;
+      memcpy(rx_frame.data, msg.cm_data, msg.cm_hdr.ch_dlc);
+
+      canardHandleRxFrame(&canard, &rx_frame,
+                          canardMsgTimestamp(&msg, timestamp));
+    }
+}
+
+#ifdef CONFIG_EXAMPLES_LIBCANARD_BENCH
+/****************************************************************************
+ * Name: canard_bench_pass
+ *
+ * Description:
+ *   Send nframes frames through the loopback, batch frames per write(),
+ *   and read them back with reads of up to batch frames.  At most one
+ *   batch is in flight so the RX FIFO cannot overrun.  Each frame carries
+ *   its sequence number and the time it was written.
+ *
+ ****************************************************************************/
+
+static int canard_bench_pass(int fd, int nframes, int batch)
+{
+  struct can_msg_s msg;
+  struct pollfd fds;
+  uint64_t start;
+  uint64_t now;
+  uint64_t latsum = 0;
+  uint32_t latmin = UINT32_MAX;
+  uint32_t latmax = 0;
+  uint32_t txtime;
+  uint32_t lat;
+  uint32_t seq;
+  unsigned long nwrites = 0;
+  unsigned long nreads = 0;
+  ssize_t nbytes;
+  size_t txlen;
+  size_t msglen;
+  size_t offset;
+  int received = 0;
+  int sent = 0;
+  int errors = 0;
+  int count;
+  int ret;
+  int i;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.cm_hdr.ch_id  = 0x123;
+  msg.cm_hdr.ch_dlc = 8;
+
+  start = getMonotonicTimestampUSec();
+  while (received < nframes)
+    {
+      if (sent == received)
+        {
+          count = nframes - sent < batch ? nframes - sent : batch;
+          txtime = (uint32_t)getMonotonicTimestampUSec();
+
+          for (i = 0, txlen = 0; i < count; i++)
+            {
+              seq = sent + i;
+              memcpy(&msg.cm_data[0], &seq, sizeof(seq));
+              memcpy(&msg.cm_data[4], &txtime, sizeof(txtime));
+              memcpy(&g_txbuf[txlen], &msg, CAN_MSGLEN(8));
+              txlen += CAN_MSGLEN(8);
+            }
+
+          nbytes = write(fd, g_txbuf, txlen);
+          nwrites++;
+          if (nbytes != (ssize_t)txlen)
+            {
+              printf("canard_bench: ERROR: write(%lu) returned %ld: %d\n",
+                     (unsigned long)txlen, (long)nbytes, errno);
+              return -1;
+            }
+
+          sent += count;
+        }
+
+      fds.fd      = fd;
+      fds.events  = POLLIN;
+      fds.revents = 0;
+
+      ret = poll(&fds, 1, 1000);
+      if (ret <= 0)
+        {
+          printf("canard_bench: ERROR: %d of %d frames not looped back\n",
+                 sent - received, nframes);
+          return -1;
+        }
+
+      nbytes = read(fd, g_rxbuf, (size_t)batch * sizeof(struct can_msg_s));
+      now = getMonotonicTimestampUSec();
+      nreads++;
+      if (nbytes < 0)
+        {
+          printf("canard_bench: ERROR: read failed: %d\n", errno);
+          return -1;
+        }
+
+      for (offset = 0;
+           (msglen = canardMsgFromBuffer(&msg, &g_rxbuf[offset],
+                                         nbytes - offset)) > 0;
+           offset += msglen)
+        {
+          memcpy(&seq, &msg.cm_data[0], sizeof(seq));
+          memcpy(&txtime, &msg.cm_data[4], sizeof(txtime));
+          if (msg.cm_hdr.ch_dlc != 8 || seq != (uint32_t)received)
+            {
+              errors++;
+            }
+
+          lat = (uint32_t)canardMsgTimestamp(&msg, now) - txtime;
+          latsum += lat;
+          latmin = lat < latmin ? lat : latmin;
+          latmax = lat > latmax ? lat : latmax;
+          received++;
+        }
+    }
 
-  if (rx_res < 0)               /* Failure - report */
+  now -= start;
+  printf("batch %2d: %d frames in %lu us, %lu frames/s, "
+         "%lu writes, %lu reads\n",
+         batch, nframes, (unsigned long)now,
+         now > 0 ? (unsigned long)(nframes * 1000000ULL / now) : 0ul,
+         nwrites, nreads);
+  printf("          latency min/avg/max %lu/%lu/%lu us, %d errors\n",
+         (unsigned long)latmin, (unsigned long)(latsum / nframes),
+         (unsigned long)latmax, errors);
+
+  return errors > 0 ? -1 : 0;
+}
+
+/****************************************************************************
+ * Name: canard_bench
+ *
+ * Description:
+ *   Put the CAN controller into loopback mode and compare one frame per
+ *   syscall with batched reads and writes.
+ *
+ ****************************************************************************/
+
+static int canard_bench(int nframes)
+{
+  int ret;
+  int fd;
+
+  if (nframes <= 0)
     {
-      (void)fprintf(stderr, "Receive error %d, errno '%s'\n", rx_res,
-                    strerror(errno));
+      nframes = CONFIG_EXAMPLES_LIBCANARD_BENCH_FRAMES;
     }
-  else if (rx_res > 0)          /* Success - process the frame */
+
+  if (g_canard_daemon_started)
     {
-      canardHandleRxFrame(&canard, &rx_frame, timestamp);
+      printf("canard_bench: ERROR: canard_daemon is using %s\n",
+             CONFIG_EXAMPLES_LIBCANARD_DEVPATH);
+      return -1;
     }
-  else
+
+  fd = open(CONFIG_EXAMPLES_LIBCANARD_DEVPATH, O_RDWR);
+  if (fd < 0)
+    {
+      printf("canard_bench: ERROR: open %s failed: %d\n",
+             CONFIG_EXAMPLES_LIBCANARD_DEVPATH, errno);
+      return -1;
+    }
+
+  ret = canlib_setloopback(fd, true);
+  if (ret < 0)
+    {
+      printf("canard_bench: ERROR: loopback mode not supported: %d\n",
+             errno);
+      goto errout_with_dev;
+    }
+
+  ret = canard_bench_pass(fd, nframes, 1);
+  if (ret == 0 && CANARD_BATCH_FRAMES > 1)
     {
-      ;                         /* Timeout - nothing to do */
+      ret = canard_bench_pass(fd, nframes, CANARD_BATCH_FRAMES);
     }
+
+  canlib_setloopback(fd, false);
+
+errout_with_dev:
+  close(fd);
+  return ret;
 }
+#endif
 
 /****************************************************************************
  * Name: canard_daemon
@@ -516,6 +892,15 @@ int canard_main(int argc, FAR char *argv[])
 {
   int ret;
 
+#ifdef CONFIG_EXAMPLES_LIBCANARD_BENCH
+  if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+      ret = canard_bench(argc > 2 ? atoi(argv[2]) :
+                         CONFIG_EXAMPLES_LIBCANARD_BENCH_FRAMES);
+      return ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+#endif
+
   printf("canard_main: Starting canard_daemon\n");
   if (g_canard_daemon_started)
     {
@@ -44,6 +44,10 @@
 #include <string.h>
 #include <sys/stat.h>
 
+#ifdef CONFIG_EMBEDLOG_ASYNC
+#  include "system/elasync.h"
+#endif
+
 /****************************************************************************
  * Preprocessor macros
  ****************************************************************************/
@@ -309,6 +313,79 @@ static void el_print_file(const char *workdir)
   el_oprint(OELI, "run this program multiple times and see how it works");
 }
 
+/****************************************************************************
+ * Name: el_print_async
+ *
+ * Description:
+ *   Presents how to log from a time critical thread without waiting for the
+ *   output.  Messages go into a ring owned by the thread and a low priority
+ *   writer prints them later through the embedlog object.
+ *
+ * Input Parameters:
+ *   None.
+ *
+ * Returned Value:
+ *   None.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_EMBEDLOG_ASYNC
+static void el_print_async(void)
+{
+  FAR struct elasync_s *log;
+  FAR struct elasync_ring_s *ring;
+  int i;
+
+  el_ooption(&g_el, EL_OUT, EL_OUT_STDERR);
+
+  /* From now on only the writer may use g_el */
+
+  log = elasync_start(&g_el, EL_INFO);
+  if (log == NULL)
+    {
+      fprintf(stderr, "elasync_start failed: %s\n", strerror(errno));
+      return;
+    }
+
+  /* Every thread that logs needs its own ring, allocated up front */
+
+  ring = elasync_ring(log, 1024);
+  if (ring == NULL)
+    {
+      fprintf(stderr, "elasync_ring failed: %s\n", strerror(errno));
+      elasync_stop(log);
+      return;
+    }
+
+  elasync_print(ring, EL_INFO, "asynchronous messages are formatted by %s",
+                "the caller");
+  elasync_print(ring, EL_DBG, "and filtered before they are queued");
+
+#ifdef CONFIG_EMBEDLOG_ASYNC_DEFERRED
+  /* Deferred messages only copy the format pointer and the arguments */
+
+  for (i = 0; i < 4; i++)
+    {
+      elasync_bprint(ring, EL_NOTICE, "control loop %d, error %d", i,
+                     i * 3, 0, 0);
+    }
+#endif
+
+  /* A full ring drops messages instead of waiting.  The writer reports how
+   * many were lost.
+   */
+
+  for (i = 0; i < 100; i++)
+    {
+      elasync_print(ring, EL_INFO, "burst message %d", i);
+    }
+
+  /* Write what is left and give g_el back */
+
+  elasync_stop(log);
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -339,6 +416,10 @@ int embedlog_main(int argc, FAR char *argv[])
   el_print_options();
   el_print_memory();
 
+#ifdef CONFIG_EMBEDLOG_ASYNC
+  el_print_async();
+#endif
+
   if (argc == 2)
     {
       el_print_file(argv[1]);
@@ -40,118 +40,428 @@
 #include <nuttx/config.h>
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
+#include <unistd.h>
 #include <wchar.h>
+#include <errno.h>
 #include <syslog.h>
 
 #include "gpsutils/minmea.h"
 
 /****************************************************************************
- * Public Functions
+ * Pre-processor Definitions
  ****************************************************************************/
 
+#ifndef CONFIG_EXAMPLES_GPS_BENCH_ITERATIONS
+#  define CONFIG_EXAMPLES_GPS_BENCH_ITERATIONS 1000
+#endif
+
+/* Bytes passed to the NMEA parser at a time, about what a UART delivers
+ * per read() at 9600 baud.
+ */
+
+#define GPS_CHUNK_SIZE 64
+
 /****************************************************************************
- * gps_main
+ * Private Data
  ****************************************************************************/
 
-#ifdef BUILD_MODULE
-int main(int argc, FAR char *argv[])
+#ifdef CONFIG_EXAMPLES_GPS_BENCH
+/* One epoch of a 10 Hz GPS/GLONASS/Galileo/BeiDou receiver */
+
+static const char g_epoch[] =
+  "$GNRMC,000000.00,A,4807.17611,N,01131.74606,E,54.821,32.32,130998,,,A*7A\r\n"
+  "$GNGGA,000000.00,4807.17611,N,01131.74606,E,1,07,0.8,879.7,M,46.9,M,,*7D\r\n"
+  "$GNGSA,A,3,61,84,49,27,13,,,,,,,,1.7,0.0,1.6,1*31\r\n"
+  "$GNGSA,A,3,56,78,98,99,01,,,,,,,,1.7,0.4,1.3,2*3E\r\n"
+  "$GNGSA,A,3,76,14,41,04,03,,,,,,,,1.0,0.8,1.0,3*3D\r\n"
+  "$GNGSA,A,3,49,88,28,55,93,,,,,,,,1.0,0.8,1.3,4*32\r\n"
+  "$GPGSV,3,1,12,64,70,119,,87,28,235,,54,71,328,,81,37,061,31*73\r\n"
+  "$GPGSV,3,2,12,65,85,097,29,76,63,258,,62,31,206,,47,70,359,*72\r\n"
+  "$GPGSV,3,3,12,57,84,260,,67,50,189,,61,05,157,49,83,21,086,*7E\r\n"
+  "$GLGSV,2,1,05,99,25,276,,52,65,176,46,59,34,337,,50,65,066,*6B\r\n"
+  "$GLGSV,2,2,05,55,07,246,*57\r\n"
+  "$GAGSV,3,1,11,63,45,212,,69,69,319,49,59,76,014,,71,74,092,15*6B\r\n"
+  "$GAGSV,3,2,11,05,86,036,,58,01,143,25,15,79,094,32,09,21,081,*6F\r\n"
+  "$GAGSV,3,3,11,85,34,331,28,90,41,254,,04,39,197,31*55\r\n"
+  "$GBGSV,2,1,08,34,13,129,,78,55,010,,51,18,018,20,91,64,347,*6D\r\n"
+  "$GBGSV,2,2,08,81,88,264,,68,83,015,35,85,80,218,13,17,27,024,*64\r\n"
+  "$GNGLL,4807.17611,N,01131.74606,E,000000.00,A,A*7D\r\n"
+  "$GNGST,000000.00,3.2,6.6,4.7,47.3,5.8,5.6,22.0*45\r\n"
+  "$GNVTG,39.0,T,,M,0.4,N,0.4,K,A*29\r\n";
+#endif
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: gps_sentence
+ *
+ * Description:
+ *   Print the position from RMC and the fix from GGA sentences.
+ *
+ ****************************************************************************/
+
+static void gps_sentence(FAR const struct minmea_tokens *tokens,
+                         FAR void *arg)
+{
+  switch (tokens->id)
+    {
+      case MINMEA_SENTENCE_RMC:
+        {
+          struct minmea_sentence_rmc frame;
+
+          if (minmea_decode_rmc(&frame, tokens))
+            {
+              printf("Fixed-point Latitude...........: %d\n",
+                     minmea_rescale(&frame.latitude, 1000));
+              printf("Fixed-point Longitude..........: %d\n",
+                     minmea_rescale(&frame.longitude, 1000));
+              printf("Fixed-point Speed..............: %d\n",
+                     minmea_rescale(&frame.speed, 1000));
+              printf("Floating point degree latitude.: %2.6f\n",
+                     minmea_tocoord(&frame.latitude));
+              printf("Floating point degree longitute: %2.6f\n",
+                     minmea_tocoord(&frame.longitude));
+              printf("Floating point speed...........: %2.6f\n",
+                     minmea_tocoord(&frame.speed));
+            }
+          else
+            {
+                printf("$xxRMC sentence is not parsed\n");
+            }
+        }
+        break;
+
+      case MINMEA_SENTENCE_GGA:
+        {
+          struct minmea_sentence_gga frame;
+
+          if (minmea_decode_gga(&frame, tokens))
+            {
+              printf("Fix quality....................: %d\n",
+                     frame.fix_quality);
+              printf("Altitude.......................: %d\n",
+                     frame.altitude.value);
+              printf("Tracked satellites.............: %d\n",
+                     frame.satellites_tracked);
+            }
+          else
+            {
+              printf("$xxGGA sentence is not parsed\n");
+            }
+        }
+        break;
+
+      default:
+        break;
+    }
+}
+
+#ifdef CONFIG_EXAMPLES_GPS_BENCH
+/****************************************************************************
+ * Name: gps_usec
+ ****************************************************************************/
+
+static unsigned long gps_usec(void)
+{
+  struct timespec ts;
+
+#ifdef CONFIG_CLOCK_MONOTONIC
+  clock_gettime(CLOCK_MONOTONIC, &ts);
 #else
-int gps_main(int argc, char *argv[])
+  clock_gettime(CLOCK_REALTIME, &ts);
 #endif
+
+  return ts.tv_sec * 1000000ul + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: gps_bench_decode
+ *
+ * Description:
+ *   Decode a tokenized sentence and count it if it is valid.
+ *
+ ****************************************************************************/
+
+static void gps_bench_decode(FAR const struct minmea_tokens *tokens,
+                             FAR void *arg)
 {
-  int fd;
-  int cnt;
-  char ch;
-  char line[MINMEA_MAX_LENGTH];
+  union
+  {
+    struct minmea_sentence_rmc rmc;
+    struct minmea_sentence_gga gga;
+    struct minmea_sentence_gsa gsa;
+    struct minmea_sentence_gll gll;
+    struct minmea_sentence_gst gst;
+    struct minmea_sentence_gsv gsv;
+  } frame;
+  bool ok;
 
-  /* Open the GPS serial port */
+  switch (tokens->id)
+    {
+      case MINMEA_SENTENCE_RMC:
+        ok = minmea_decode_rmc(&frame.rmc, tokens);
+        break;
 
-  fd = open("/dev/ttyS1", O_RDONLY);
-  if (fd < 0)
+      case MINMEA_SENTENCE_GGA:
+        ok = minmea_decode_gga(&frame.gga, tokens);
+        break;
+
+      case MINMEA_SENTENCE_GSA:
+        ok = minmea_decode_gsa(&frame.gsa, tokens);
+        break;
+
+      case MINMEA_SENTENCE_GLL:
+        ok = minmea_decode_gll(&frame.gll, tokens);
+        break;
+
+      case MINMEA_SENTENCE_GST:
+        ok = minmea_decode_gst(&frame.gst, tokens);
+        break;
+
+      case MINMEA_SENTENCE_GSV:
+        ok = minmea_decode_gsv(&frame.gsv, tokens);
+        break;
+
+      default:
+        ok = true;
+        break;
+    }
+
+  if (ok)
     {
-      printf("Unable to open file /dev/ttyS1\n");
+      (*(FAR unsigned long *)arg)++;
     }
+}
 
-  /* Run forever */
+/****************************************************************************
+ * Name: gps_bench_legacy
+ *
+ * Description:
+ *   Split the log into lines and run each through minmea_sentence_id() and
+ *   minmea_parse_*(), the way this example used to.
+ *
+ ****************************************************************************/
 
-  for (; ; )
-    {
-      /* Read until we complete a line */
+static unsigned long gps_bench_legacy(FAR const char *buf, size_t len)
+{
+  union
+  {
+    struct minmea_sentence_rmc rmc;
+    struct minmea_sentence_gga gga;
+    struct minmea_sentence_gsa gsa;
+    struct minmea_sentence_gll gll;
+    struct minmea_sentence_gst gst;
+    struct minmea_sentence_gsv gsv;
+  } frame;
+  char line[MINMEA_MAX_LENGTH + 4];
+  unsigned long count = 0;
+  size_t cnt = 0;
+  bool ok;
 
-      cnt = 0;
-      do
+  for (; len > 0; buf++, len--)
+    {
+      if (*buf != '\r' && *buf != '\n')
         {
-          read(fd, &ch, 1);
-          if (ch != '\r' && ch != '\n')
+          if (cnt < sizeof(line) - 1)
             {
-              line[cnt++] = ch;
+              line[cnt++] = *buf;
             }
+
+          continue;
         }
-      while (ch != '\r' && ch != '\n');
 
       line[cnt] = '\0';
+      cnt = 0;
 
       switch (minmea_sentence_id(line, false))
         {
           case MINMEA_SENTENCE_RMC:
-            {
-              struct minmea_sentence_rmc frame;
-
-              if (minmea_parse_rmc(&frame, line))
-                {
-                  printf("Fixed-point Latitude...........: %d\n",
-                         minmea_rescale(&frame.latitude, 1000));
-                  printf("Fixed-point Longitude..........: %d\n",
-                         minmea_rescale(&frame.longitude, 1000));
-                  printf("Fixed-point Speed..............: %d\n",
-                         minmea_rescale(&frame.speed, 1000));
-                  printf("Floating point degree latitude.: %2.6f\n",
-                         minmea_tocoord(&frame.latitude));
-                  printf("Floating point degree longitute: %2.6f\n",
-                         minmea_tocoord(&frame.longitude));
-                  printf("Floating point speed...........: %2.6f\n",
-                         minmea_tocoord(&frame.speed));
-                }
-              else
-                {
-                    printf("$xxRMC sentence is not parsed\n");
-                }
-            }
+            ok = minmea_parse_rmc(&frame.rmc, line);
             break;
 
           case MINMEA_SENTENCE_GGA:
-            {
-              struct minmea_sentence_gga frame;
-
-              if (minmea_parse_gga(&frame, line))
-                {
-                  printf("Fix quality....................: %d\n",
-                         frame.fix_quality);
-                  printf("Altitude.......................: %d\n",
-                         frame.altitude.value);
-                  printf("Tracked satellites.............: %d\n",
-                         frame.satellites_tracked);
-                }
-              else
-                {
-                  printf("$xxGGA sentence is not parsed\n");
-                }
-            }
+            ok = minmea_parse_gga(&frame.gga, line);
             break;
 
-          case MINMEA_INVALID:
-          case MINMEA_UNKNOWN:
           case MINMEA_SENTENCE_GSA:
+            ok = minmea_parse_gsa(&frame.gsa, line);
+            break;
+
           case MINMEA_SENTENCE_GLL:
+            ok = minmea_parse_gll(&frame.gll, line);
+            break;
+
           case MINMEA_SENTENCE_GST:
+            ok = minmea_parse_gst(&frame.gst, line);
+            break;
+
           case MINMEA_SENTENCE_GSV:
-            {
-            }
+            ok = minmea_parse_gsv(&frame.gsv, line);
+            break;
+
+          case MINMEA_UNKNOWN:
+            ok = true;
+            break;
+
+          default:
+            ok = false;
             break;
         }
+
+      if (ok)
+        {
+          count++;
+        }
     }
 
-  return 0;
+  return count;
 }
 
+/****************************************************************************
+ * Name: gps_bench
+ *
+ * Description:
+ *   Parse a recorded NMEA log, or the built-in epoch, with the line based
+ *   API and with the streaming tokenizer and report sentences/s for each.
+ *
+ ****************************************************************************/
+
+static int gps_bench(FAR const char *path)
+{
+  struct minmea_stream stream;
+  FAR const char *buf = g_epoch;
+  FAR char *logbuf = NULL;
+  unsigned long start;
+  unsigned long elapsed;
+  unsigned long count;
+  size_t len = sizeof(g_epoch) - 1;
+  size_t offset;
+  size_t chunk;
+  off_t size;
+  int fd;
+  int i;
+
+  if (path != NULL)
+    {
+      fd = open(path, O_RDONLY);
+      if (fd < 0)
+        {
+          printf("Unable to open file %s\n", path);
+          return EXIT_FAILURE;
+        }
+
+      size = lseek(fd, 0, SEEK_END);
+      logbuf = malloc(size > 0 ? size : 1);
+      if (size <= 0 || logbuf == NULL ||
+          lseek(fd, 0, SEEK_SET) != 0 || read(fd, logbuf, size) != size)
+        {
+          printf("Unable to read file %s\n", path);
+          free(logbuf);
+          close(fd);
+          return EXIT_FAILURE;
+        }
+
+      close(fd);
+      buf = logbuf;
+      len = size;
+    }
+
+  count = 0;
+  start = gps_usec();
+  for (i = 0; i < CONFIG_EXAMPLES_GPS_BENCH_ITERATIONS; i++)
+    {
+      count += gps_bench_legacy(buf, len);
+    }
+
+  elapsed = gps_usec() - start;
+  printf("minmea_parse: %lu sentences in %lu us, %lu sentences/s\n",
+         count, elapsed,
+         elapsed > 0 ? (unsigned long)(count * 1000000ull / elapsed) : 0);
+
+  count = 0;
+  minmea_stream_init(&stream, false);
+  start = gps_usec();
+  for (i = 0; i < CONFIG_EXAMPLES_GPS_BENCH_ITERATIONS; i++)
+    {
+      for (offset = 0; offset < len; offset += chunk)
+        {
+          chunk = len - offset < GPS_CHUNK_SIZE ? len - offset :
+                  GPS_CHUNK_SIZE;
+          minmea_stream_feed(&stream, &buf[offset], chunk,
+                             gps_bench_decode, &count);
+        }
+    }
+
+  elapsed = gps_usec() - start;
+  printf("minmea_stream: %lu sentences in %lu us, %lu sentences/s\n",
+         count, elapsed,
+         elapsed > 0 ? (unsigned long)(count * 1000000ull / elapsed) : 0);
+
+  free(logbuf);
+  return EXIT_SUCCESS;
+}
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * gps_main
+ ****************************************************************************/
+
+#ifdef BUILD_MODULE
+int main(int argc, FAR char *argv[])
+#else
+int gps_main(int argc, char *argv[])
+#endif
+{
+  struct minmea_stream stream;
+  char buffer[GPS_CHUNK_SIZE];
+  ssize_t nread;
+  int fd;
+
+#ifdef CONFIG_EXAMPLES_GPS_BENCH
+  if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+      return gps_bench(argc > 2 ? argv[2] : NULL);
+    }
+#endif
+
+  /* Open the GPS serial port */
+
+  fd = open("/dev/ttyS1", O_RDONLY);
+  if (fd < 0)
+    {
+      printf("Unable to open file /dev/ttyS1\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Run forever, feeding whatever the serial driver has to the parser */
+
+  minmea_stream_init(&stream, false);
+  for (; ; )
+    {
+      nread = read(fd, buffer, sizeof(buffer));
+      if (nread < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          printf("Read from /dev/ttyS1 failed: %d\n", errno);
+          break;
+        }
+
+      minmea_stream_feed(&stream, buffer, nread, gps_sentence, NULL);
+    }
+
+  close(fd);
+  return EXIT_FAILURE;
+}
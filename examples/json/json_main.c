@@ -34,11 +34,28 @@
  * Included Files
  ****************************************************************************/
 
+#include <nuttx/config.h>
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <time.h>
 
 #include "netutils/cJSON.h"
+#include "netutils/json_writer.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_EXAMPLES_JSON_BENCH_ITERATIONS
+#  define CONFIG_EXAMPLES_JSON_BENCH_ITERATIONS 200
+#endif
+
+#ifndef CONFIG_EXAMPLES_JSON_BENCH_POOLSIZE
+#  define CONFIG_EXAMPLES_JSON_BENCH_POOLSIZE 8192
+#endif
 
 /****************************************************************************
  * Private Types
@@ -58,6 +75,61 @@ struct record
   const char *country;
 };
 
+#ifdef CONFIG_EXAMPLES_JSON_BENCHMARK
+/* Allocation header used to track the heap usage of the malloc mode */
+
+union bench_hdr_u
+{
+  size_t size;
+  double align;
+};
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+#ifdef CONFIG_EXAMPLES_JSON_BENCHMARK
+/* A typical node configuration file */
+
+static const char g_bench_config[] =
+  "{\n"
+  "  \"node\": {\"name\": \"base_controller\", \"namespace\": \"/robot\",\n"
+  "           \"domain_id\": 0, \"agent\": \"udp://192.168.1.10:8888\"},\n"
+  "  \"timers\": {\"control_hz\": 100, \"telemetry_hz\": 10,\n"
+  "             \"watchdog_ms\": 250},\n"
+  "  \"motors\": [\n"
+  "    {\"id\": 1, \"name\": \"left\", \"inverted\": false, \"kp\": 0.85,\n"
+  "     \"ki\": 0.12, \"kd\": 0.004, \"max_rpm\": 330, \"ticks\": 2048},\n"
+  "    {\"id\": 2, \"name\": \"right\", \"inverted\": true, \"kp\": 0.85,\n"
+  "     \"ki\": 0.12, \"kd\": 0.004, \"max_rpm\": 330, \"ticks\": 2048}\n"
+  "  ],\n"
+  "  \"imu\": {\"device\": \"/dev/imu0\", \"rate\": 200,\n"
+  "          \"gyro_bias\": [0.0012, -0.0031, 0.0004],\n"
+  "          \"accel_bias\": [0.021, -0.013, 0.094]},\n"
+  "  \"topics\": [\"cmd_vel\", \"odom\", \"imu\", \"battery\", \"diagnostics\"],\n"
+  "  \"logging\": {\"enabled\": true, \"path\": \"/mnt/sd/log\",\n"
+  "              \"level\": \"info\", \"max_size_kb\": 4096}\n"
+  "}";
+
+/* A typical robot state telemetry message */
+
+static const char g_bench_telemetry[] =
+  "{\"stamp\": 1571234567.125, \"seq\": 48213,"
+  " \"pose\": {\"x\": 1.2345, \"y\": -0.5432, \"theta\": 0.7854},"
+  " \"twist\": {\"v\": 0.25, \"w\": -0.1},"
+  " \"wheels\": [{\"rpm\": 120.5, \"current\": 0.82},"
+  " {\"rpm\": 119.8, \"current\": 0.79}],"
+  " \"imu\": {\"ax\": 0.01, \"ay\": -0.02, \"az\": 9.81,"
+  " \"gx\": 0.001, \"gy\": 0.0, \"gz\": -0.1},"
+  " \"battery\": {\"voltage\": 11.92, \"percent\": 87, \"charging\": false},"
+  " \"status\": \"ok\"}";
+
+static size_t g_bench_heapcur;
+static size_t g_bench_heappeak;
+static unsigned long g_bench_nallocs;
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -225,6 +297,308 @@ static void create_objects(void)
   free(out);
 }
 
+/****************************************************************************
+ * Name: stream_telemetry
+ *
+ * Description:
+ *   Emit a telemetry message with the streaming writer, without building a
+ *   cJSON tree.  With fd >= 0, the small buffer is drained to fd as it
+ *   fills.
+ *
+ ****************************************************************************/
+
+static ssize_t stream_telemetry(FAR char *buffer, size_t size, int fd,
+                                long seq)
+{
+  struct json_writer_s writer;
+
+  json_writer_init(&writer, buffer, size, fd);
+
+  json_writer_begin_object(&writer, NULL);
+  json_writer_int(&writer, "seq", seq);
+
+  json_writer_begin_object(&writer, "pose");
+  json_writer_fixed(&writer, "x", 1.2345, 4);
+  json_writer_fixed(&writer, "y", -0.5432, 4);
+  json_writer_fixed(&writer, "theta", 0.7854, 4);
+  json_writer_end_object(&writer);
+
+  json_writer_begin_array(&writer, "wheels");
+  json_writer_fixed(&writer, NULL, 120.5, 1);
+  json_writer_fixed(&writer, NULL, 119.8, 1);
+  json_writer_end_array(&writer);
+
+  json_writer_begin_object(&writer, "battery");
+  json_writer_fixed(&writer, "voltage", 11.92, 2);
+  json_writer_int(&writer, "percent", 87);
+  json_writer_bool(&writer, "charging", false);
+  json_writer_end_object(&writer);
+
+  json_writer_string(&writer, "status", "ok");
+  json_writer_end_object(&writer);
+
+  return json_writer_finish(&writer);
+}
+
+/****************************************************************************
+ * Name: stream_objects
+ ****************************************************************************/
+
+static void stream_objects(void)
+{
+  char buffer[32];
+  ssize_t ret;
+
+  fflush(stdout);
+  ret = stream_telemetry(buffer, sizeof(buffer), STDOUT_FILENO, 1);
+  printf("\n");
+
+  if (ret < 0)
+    {
+      printf("Streaming writer failed: %d\n", (int)ret);
+    }
+}
+
+/****************************************************************************
+ * Name: bench_malloc, bench_free
+ *
+ * Description:
+ *   cJSON allocation hooks that track the current and peak heap usage.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_EXAMPLES_JSON_BENCHMARK
+static void *bench_malloc(size_t size)
+{
+  union bench_hdr_u *hdr;
+
+  hdr = (union bench_hdr_u *)malloc(sizeof(union bench_hdr_u) + size);
+  if (!hdr)
+    {
+      return NULL;
+    }
+
+  hdr->size = size;
+  g_bench_heapcur += size;
+  g_bench_nallocs++;
+
+  if (g_bench_heapcur > g_bench_heappeak)
+    {
+      g_bench_heappeak = g_bench_heapcur;
+    }
+
+  return hdr + 1;
+}
+
+static void bench_free(void *ptr)
+{
+  union bench_hdr_u *hdr = (union bench_hdr_u *)ptr - 1;
+
+  g_bench_heapcur -= hdr->size;
+  free(hdr);
+}
+
+/****************************************************************************
+ * Name: bench_usec
+ ****************************************************************************/
+
+static unsigned long bench_usec(void)
+{
+  struct timespec ts;
+
+#ifdef CONFIG_CLOCK_MONOTONIC
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+  (void)clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+  return (unsigned long)ts.tv_sec * 1000000ul +
+         (unsigned long)ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: bench_payload
+ *
+ * Description:
+ *   Parse one payload repeatedly in each parse mode and report the time per
+ *   parse, the heap allocations per parse and the peak heap (or pool) usage.
+ *
+ ****************************************************************************/
+
+static void bench_payload(const char *name, const char *text, char *pool,
+                          char *work)
+{
+  const int niter = CONFIG_EXAMPLES_JSON_BENCH_ITERATIONS;
+  size_t len = strlen(text) + 1;
+  unsigned long start;
+  unsigned long elapsed;
+  size_t used = 0;
+  cJSON *root;
+  int mode;
+  int i;
+
+  printf("%s (%lu bytes):\n", name, (unsigned long)len - 1);
+
+  for (mode = 0; mode < 3; mode++)
+    {
+      g_bench_heapcur  = 0;
+      g_bench_heappeak = 0;
+      g_bench_nallocs  = 0;
+
+      start = bench_usec();
+      for (i = 0; i < niter; i++)
+        {
+          switch (mode)
+            {
+              case 0:
+                root = cJSON_Parse(text);
+                break;
+
+              case 1:
+                root = cJSON_ParseWithPool(text, pool,
+                                           CONFIG_EXAMPLES_JSON_BENCH_POOLSIZE,
+                                           &used);
+                break;
+
+              default:
+
+                /* In-situ parsing consumes the input, so each pass parses a
+                 * fresh copy.  The copy is included in the time.
+                 */
+
+                memcpy(work, text, len);
+                root = cJSON_ParseInSitu(work, pool,
+                                         CONFIG_EXAMPLES_JSON_BENCH_POOLSIZE,
+                                         &used);
+                break;
+            }
+
+          if (!root)
+            {
+              printf("  Parse failed (pool %lu bytes)\n", (unsigned long)used);
+              return;
+            }
+
+          cJSON_Delete(root);
+        }
+
+      elapsed = bench_usec() - start;
+
+      printf("  %-8s %6lu usec/parse  %4lu mallocs/parse  "
+             "peak heap %5lu  pool %5lu\n",
+             mode == 0 ? "malloc" : mode == 1 ? "pool" : "in-situ",
+             elapsed / niter, g_bench_nallocs / niter,
+             (unsigned long)g_bench_heappeak,
+             mode == 0 ? 0ul : (unsigned long)used);
+    }
+}
+
+/****************************************************************************
+ * Name: bench_print
+ *
+ * Description:
+ *   Compare building a telemetry message as a cJSON tree and printing it
+ *   with emitting it with the streaming writer.
+ *
+ ****************************************************************************/
+
+static void bench_print(void)
+{
+  const int niter = CONFIG_EXAMPLES_JSON_BENCH_ITERATIONS;
+  unsigned long start;
+  unsigned long elapsed;
+  char buffer[256];
+  cJSON *root;
+  cJSON *obj;
+  cJSON *arr;
+  char *out;
+  int i;
+
+  printf("telemetry output:\n");
+
+  g_bench_heappeak = 0;
+  g_bench_nallocs  = 0;
+
+  start = bench_usec();
+  for (i = 0; i < niter; i++)
+    {
+      root = cJSON_CreateObject();
+      cJSON_AddNumberToObject(root, "seq", i);
+      cJSON_AddItemToObject(root, "pose", obj = cJSON_CreateObject());
+      cJSON_AddNumberToObject(obj, "x", 1.2345);
+      cJSON_AddNumberToObject(obj, "y", -0.5432);
+      cJSON_AddNumberToObject(obj, "theta", 0.7854);
+      cJSON_AddItemToObject(root, "wheels", arr = cJSON_CreateArray());
+      cJSON_AddItemToArray(arr, cJSON_CreateNumber(120.5));
+      cJSON_AddItemToArray(arr, cJSON_CreateNumber(119.8));
+      cJSON_AddItemToObject(root, "battery", obj = cJSON_CreateObject());
+      cJSON_AddNumberToObject(obj, "voltage", 11.92);
+      cJSON_AddNumberToObject(obj, "percent", 87);
+      cJSON_AddFalseToObject(obj, "charging");
+      cJSON_AddStringToObject(root, "status", "ok");
+
+      out = cJSON_PrintUnformatted(root);
+      cJSON_Delete(root);
+      bench_free(out);
+    }
+
+  elapsed = bench_usec() - start;
+  printf("  %-8s %6lu usec/msg    %4lu mallocs/msg    peak heap %5lu\n",
+         "cJSON", elapsed / niter, g_bench_nallocs / niter,
+         (unsigned long)g_bench_heappeak);
+
+  start = bench_usec();
+  for (i = 0; i < niter; i++)
+    {
+      if (stream_telemetry(buffer, sizeof(buffer), -1, i) < 0)
+        {
+          printf("  Streaming writer failed\n");
+          return;
+        }
+    }
+
+  elapsed = bench_usec() - start;
+  printf("  %-8s %6lu usec/msg    %4lu mallocs/msg    peak heap %5lu\n",
+         "writer", elapsed / niter, 0ul, 0ul);
+}
+
+/****************************************************************************
+ * Name: benchmark
+ ****************************************************************************/
+
+static void benchmark(void)
+{
+  cJSON_Hooks hooks;
+  char *pool;
+  char *work;
+
+  pool = (char *)malloc(CONFIG_EXAMPLES_JSON_BENCH_POOLSIZE);
+  work = (char *)malloc(sizeof(g_bench_config) > sizeof(g_bench_telemetry) ?
+                        sizeof(g_bench_config) : sizeof(g_bench_telemetry));
+  if (!pool || !work)
+    {
+      printf("Failed to allocate benchmark buffers\n");
+      goto errout;
+    }
+
+  hooks.malloc_fn = bench_malloc;
+  hooks.free_fn   = bench_free;
+  cJSON_InitHooks(&hooks);
+
+  printf("\ncJSON parse benchmark, %d iterations\n",
+         CONFIG_EXAMPLES_JSON_BENCH_ITERATIONS);
+
+  bench_payload("config", g_bench_config, pool, work);
+  bench_payload("telemetry", g_bench_telemetry, pool, work);
+  bench_print();
+
+  cJSON_InitHooks(NULL);
+
+errout:
+  free(work);
+  free(pool);
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -326,5 +700,16 @@ int json_main(int argc, const char *argv[])
   /* Now some samplecode for building objects concisely: */
 
   create_objects();
+
+  /* And the same without a tree, using the streaming writer */
+
+  stream_objects();
+
+#ifdef CONFIG_EXAMPLES_JSON_BENCHMARK
+  /* And measure the parse modes */
+
+  benchmark();
+#endif
+
   return 0;
 }
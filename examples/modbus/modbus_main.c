@@ -68,6 +68,13 @@
 #include <signal.h>
 #include <errno.h>
 
+#ifdef CONFIG_EXAMPLES_MODBUS_BENCH
+#  include <fcntl.h>
+#  include <limits.h>
+#  include <poll.h>
+#  include <time.h>
+#endif
+
 #include "modbus/mb.h"
 #include "modbus/mbport.h"
 
@@ -104,6 +111,15 @@
 #  define CONFIG_EXAMPLES_MODBUS_REG_HOLDING_NREGS 130
 #endif
 
+#ifndef CONFIG_EXAMPLES_MODBUS_BENCH_TRANSACTIONS
+#  define CONFIG_EXAMPLES_MODBUS_BENCH_TRANSACTIONS 1000
+#endif
+
+/* The benchmark reads this many holding registers per transaction */
+
+#define BENCH_NREGS   16
+#define BENCH_RSPLEN  (5 + 2 * BENCH_NREGS)
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -123,6 +139,8 @@ struct modbus_state_s
   pthread_t threadid;
   pthread_mutex_t lock;
   volatile bool quit;
+  uint8_t port;
+  speed_t baud;
 };
 
 /****************************************************************************
@@ -133,6 +151,9 @@ static inline int modbus_initialize(void);
 static void *modbus_pollthread(void *pvarg);
 static inline int modbus_create_pollthread(void);
 static void modbus_showusage(FAR const char *progname, int exitcode);
+#ifdef CONFIG_EXAMPLES_MODBUS_BENCH
+static int modbus_benchmark(void);
+#endif
 
 /****************************************************************************
  * Private Data
@@ -141,6 +162,13 @@ static void modbus_showusage(FAR const char *progname, int exitcode);
 static struct modbus_state_s g_modbus;
 static const uint8_t g_slaveid[] = { 0xaa, 0xbb, 0xcc };
 
+#ifdef CONFIG_EXAMPLES_MODBUS_BENCH
+static const speed_t g_benchbaud[] =
+{
+  115200, 230400, 460800, 921600
+};
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -184,13 +212,13 @@ static inline int modbus_initialize(void)
    *
    * MB_RTU                        = RTU mode
    * 0x0a                          = Slave address
-   * CONFIG_EXAMPLES_MODBUS_PORT   = port, default=0 (i.e., /dev/ttyS0)
-   * CONFIG_EXAMPLES_MODBUS_BAUD   = baud, default=B38400
+   * g_modbus.port                 = port, default=0 (i.e., /dev/ttyS0)
+   * g_modbus.baud                 = baud, default=B38400
    * CONFIG_EXAMPLES_MODBUS_PARITY = parity, default=MB_PAR_EVEN
    */
 
-  mberr = eMBInit(MB_RTU, 0x0a, CONFIG_EXAMPLES_MODBUS_PORT,
-                  CONFIG_EXAMPLES_MODBUS_BAUD, CONFIG_EXAMPLES_MODBUS_PARITY);
+  mberr = eMBInit(MB_RTU, 0x0a, g_modbus.port, g_modbus.baud,
+                  CONFIG_EXAMPLES_MODBUS_PARITY);
   if (mberr != MB_ENOERR)
     {
       fprintf(stderr, "modbus_main: "
@@ -336,17 +364,261 @@ static inline int modbus_create_pollthread(void)
 
 static void modbus_showusage(FAR const char *progname, int exitcode)
 {
-  printf("USAGE: %s [-d|e|s|q|h]\n\n", progname);
+  printf("USAGE: %s [-d|e|s|q|b|h]\n\n", progname);
   printf("Where:\n");
   printf("  -d : Disable protocol stack\n");
   printf("  -e : Enable the protocol stack\n");
   printf("  -s : Show current status\n");
   printf("  -q : Quit application\n");
+#ifdef CONFIG_EXAMPLES_MODBUS_BENCH
+  printf("  -b : Benchmark RTU transactions over a pseudo-terminal\n");
+#endif
   printf("  -h : Show this information\n");
   printf("\n");
   exit(exitcode);
 }
 
+#ifdef CONFIG_EXAMPLES_MODBUS_BENCH
+/****************************************************************************
+ * Name: modbus_benchcrc
+ *
+ * Description:
+ *   Modbus RTU CRC-16 (polynomial 0xa001, initial value 0xffff)
+ *
+ ****************************************************************************/
+
+static uint16_t modbus_benchcrc(FAR const uint8_t *buffer, size_t len)
+{
+  uint16_t crc = 0xffff;
+  int bit;
+
+  while (len-- > 0)
+    {
+      crc ^= *buffer++;
+      for (bit = 0; bit < 8; bit++)
+        {
+          crc = (crc & 1) ? (crc >> 1) ^ 0xa001 : crc >> 1;
+        }
+    }
+
+  return crc;
+}
+
+/****************************************************************************
+ * Name: modbus_benchusec
+ ****************************************************************************/
+
+static unsigned long modbus_benchusec(FAR const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * 1000000 +
+         (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+/****************************************************************************
+ * Name: modbus_benchrun
+ *
+ * Description:
+ *   Act as the master on the pseudo-terminal master side: issue Read
+ *   Holding Registers requests back to back, wait for each response and
+ *   report the transaction rate and the request-to-response turnaround.
+ *
+ ****************************************************************************/
+
+static int modbus_benchrun(int fd, speed_t baud)
+{
+  struct timespec start;
+  struct timespec sent;
+  struct pollfd pfd;
+  uint8_t request[8];
+  uint8_t response[BENCH_RSPLEN];
+  uint16_t address = CONFIG_EXAMPLES_MODBUS_REG_HOLDING_START - 1;
+  uint16_t crc;
+  unsigned long usec;
+  unsigned long wireusec;
+  unsigned long turnaround;
+  unsigned long tamin = ULONG_MAX;
+  unsigned long tamax = 0;
+  unsigned long long tasum = 0;
+  unsigned int nok = 0;
+  unsigned int nbad = 0;
+  unsigned int bits;
+  size_t nread;
+  ssize_t ret;
+  int i;
+
+  request[0] = 0x0a;
+  request[1] = 0x03;
+  request[2] = address >> 8;
+  request[3] = address & 0xff;
+  request[4] = 0;
+  request[5] = BENCH_NREGS;
+  crc = modbus_benchcrc(request, 6);
+  request[6] = crc & 0xff;
+  request[7] = crc >> 8;
+
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  for (i = 0; i < CONFIG_EXAMPLES_MODBUS_BENCH_TRANSACTIONS; i++)
+    {
+      clock_gettime(CLOCK_MONOTONIC, &sent);
+      if (write(fd, request, sizeof(request)) != sizeof(request))
+        {
+          return errno;
+        }
+
+      for (nread = 0; nread < BENCH_RSPLEN; nread += ret)
+        {
+          if (poll(&pfd, 1, 1000) <= 0)
+            {
+              break;
+            }
+
+          ret = read(fd, &response[nread], BENCH_RSPLEN - nread);
+          if (ret <= 0)
+            {
+              break;
+            }
+        }
+
+      if (nread == BENCH_RSPLEN && response[1] == 0x03 &&
+          modbus_benchcrc(response, BENCH_RSPLEN) == 0)
+        {
+          turnaround = modbus_benchusec(&sent);
+          tamin = turnaround < tamin ? turnaround : tamin;
+          tamax = turnaround > tamax ? turnaround : tamax;
+          tasum += turnaround;
+          nok++;
+        }
+      else
+        {
+          nbad++;
+        }
+    }
+
+  usec = modbus_benchusec(&start);
+  if (usec == 0)
+    {
+      usec = 1;
+    }
+
+  /* What the same exchange would take on a real line: both frames plus a
+   * t3.5 gap after each (fixed at 1750us above 19200 baud).
+   */
+
+  bits = CONFIG_EXAMPLES_MODBUS_PARITY == MB_PAR_NONE ? 10 : 11;
+  wireusec = (unsigned long)(sizeof(request) + BENCH_RSPLEN) * bits *
+             1000000 / baud + 2 * 1750;
+
+  printf("%7lu baud: %u ok, %u failed, %lu transactions/sec "
+         "(line limit %lu/sec)\n",
+         (unsigned long)baud, nok, nbad,
+         (unsigned long)nok * 1000000 / usec, 1000000 / wireusec);
+
+  if (nok > 0)
+    {
+      printf("             turnaround min %lu avg %lu max %lu usec\n",
+             tamin, (unsigned long)(tasum / nok), tamax);
+    }
+
+  return nbad == 0 ? OK : EIO;
+}
+
+/****************************************************************************
+ * Name: modbus_benchmark
+ *
+ * Description:
+ *   Run the slave on the slave side of a pseudo-terminal (this needs
+ *   CONFIG_MB_SERIAL_DEVNAME="/dev/pts/%d") and benchmark it from the
+ *   master side at each rate in g_benchbaud.  A pseudo-terminal does not
+ *   pace characters, so the baud rate only changes the stack's timers; the
+ *   line limit printed next to each result shows what a real line allows.
+ *
+ ****************************************************************************/
+
+static int modbus_benchmark(void)
+{
+  FAR char *ptsname_;
+  int ret = OK;
+  int fd;
+  int i;
+  int n;
+
+  if (g_modbus.threadstate != STOPPED)
+    {
+      return EBUSY;
+    }
+
+  fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (fd < 0)
+    {
+      return errno;
+    }
+
+  if (grantpt(fd) < 0 || unlockpt(fd) < 0 ||
+      (ptsname_ = ptsname(fd)) == NULL)
+    {
+      ret = errno;
+      goto errout;
+    }
+
+  g_modbus.port = (uint8_t)atoi(strrchr(ptsname_, '/') + 1);
+
+  printf("modbus_main: benchmarking %d transactions on %s\n",
+         CONFIG_EXAMPLES_MODBUS_BENCH_TRANSACTIONS, ptsname_);
+
+  for (i = 0; i < sizeof(g_benchbaud) / sizeof(g_benchbaud[0]); i++)
+    {
+      g_modbus.baud = g_benchbaud[i];
+
+      ret = modbus_create_pollthread();
+      if (ret != OK)
+        {
+          break;
+        }
+
+      /* Wait for the stack to come up */
+
+      for (n = 0; n < 100 && g_modbus.threadstate != RUNNING; n++)
+        {
+          usleep(10000);
+        }
+
+      if (g_modbus.threadstate == RUNNING)
+        {
+          /* Requests sent before the stack has seen t3.5 of silence are
+           * dropped, so give it time to leave its init state.
+           */
+
+          usleep(100000);
+          ret = modbus_benchrun(fd, g_benchbaud[i]);
+          g_modbus.threadstate = SHUTDOWN;
+        }
+      else
+        {
+          ret = ENODEV;
+        }
+
+      (void)pthread_join(g_modbus.threadid, NULL);
+      if (ret != OK)
+        {
+          break;
+        }
+    }
+
+errout:
+  close(fd);
+  g_modbus.port = CONFIG_EXAMPLES_MODBUS_PORT;
+  g_modbus.baud = CONFIG_EXAMPLES_MODBUS_BAUD;
+  return ret;
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -371,8 +643,10 @@ int modbus_main(int argc, char *argv[])
   /* Handle command line arguments */
 
   g_modbus.quit = false;
+  g_modbus.port = CONFIG_EXAMPLES_MODBUS_PORT;
+  g_modbus.baud = CONFIG_EXAMPLES_MODBUS_BAUD;
 
-  while ((option = getopt(argc, argv, "desqh")) != ERROR)
+  while ((option = getopt(argc, argv, "desqbh")) != ERROR)
     {
       switch (option)
         {
@@ -422,6 +696,18 @@ int modbus_main(int argc, char *argv[])
             pthread_kill(g_modbus.threadid, 9);
             break;
 
+#ifdef CONFIG_EXAMPLES_MODBUS_BENCH
+          case 'b': /* Benchmark over a pseudo-terminal */
+            ret = modbus_benchmark();
+            if (ret != OK)
+              {
+                fprintf(stderr, "modbus_main: "
+                        "ERROR: modbus_benchmark failed: %d\n", ret);
+                exit(EXIT_FAILURE);
+              }
+            break;
+#endif
+
           case 'h': /* Show help info */
             modbus_showusage(argv[0], EXIT_SUCCESS);
             break;
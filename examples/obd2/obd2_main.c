@@ -44,6 +44,39 @@
 #include "canutils/obd_pid.h"
 #include "canutils/obd_frame.h"
 
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const uint8_t g_pids[] =
+{
+  OBD_PID_RPM,
+  OBD_PID_SPEED,
+  OBD_PID_ENGINE_TEMPERATURE,
+  OBD_PID_THROTTLE_POSITION,
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: obd2_response
+ ****************************************************************************/
+
+static void obd2_response(FAR struct obd_dev_s *dev, uint8_t opmode,
+                          uint8_t pid, int result, FAR const uint8_t *data,
+                          size_t len, FAR void *arg)
+{
+  if (result < 0)
+    {
+      printf("PID %02x: no response\n", pid);
+      return;
+    }
+
+  printf("PID %02x = %s\n", pid, obd_decode_pid(dev, pid));
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -60,6 +93,7 @@ int obd2_main(int argc, char *argv[])
 {
   struct obd_dev_s *dev;
   int ret;
+  int i;
 
   dev = obd_init("/dev/can0", 0, 0);
   if (!dev)
@@ -68,27 +102,31 @@ int obd2_main(int argc, char *argv[])
       return -1;
     }
 
-  /* Request the RPM */
+  /* Request all PIDs at once; the ECU answers them back to back */
 
-  ret = obd_send_request(dev, OBD_SHOW_DATA, OBD_PID_RPM);
-  if (ret < 0)
+  for (i = 0; i < sizeof(g_pids); i++)
     {
-      printf("Failed to request RPM!\n");
-      return -1;
+      ret = obd_submit_request(dev, OBD_SHOW_DATA, g_pids[i], 1000,
+                               obd2_response, NULL);
+      if (ret < 0)
+        {
+          printf("Failed to request PID %02x: %d\n", g_pids[i], ret);
+        }
     }
 
-  /* Wait for response */
+  /* Dispatch the responses as they arrive */
+
+  do
+    {
+      ret = obd_process(dev, -1);
+    }
+  while (ret > 0);
 
-  ret = obd_wait_response(dev, OBD_SHOW_DATA, OBD_PID_RPM, 100);
   if (ret < 0)
     {
-      printf("Failed to receive the response!\n");
+      printf("Failed to receive the responses: %d\n", ret);
       return -1;
     }
 
-  /* Decode the received PID */
-
-  printf("RPM = %s\n", obd_decode_pid(dev, OBD_PID_RPM));
-
   return 0;
 }
@@ -39,6 +39,8 @@
 
 #include <nuttx/config.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "netutils/pppd.h"
 
@@ -83,5 +85,12 @@ int pppd_main(int argc, char *argv[])
 #endif
   };
 
+#ifdef CONFIG_NETUTILS_PPPD_AHDLC_BENCH
+  if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+      return ahdlc_benchmark(argc > 2 ? atoi(argv[2]) : 0);
+    }
+#endif
+
   return pppd(&pppd_settings);
 }
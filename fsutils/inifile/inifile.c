@@ -39,9 +39,13 @@
 
 #include <nuttx/config.h>
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h>
+#include <ctype.h>
+#include <errno.h>
 #include <debug.h>
 
 #include "fsutils/inifile.h"
@@ -60,6 +64,23 @@
 #  define CONFIG_FSUTILS_INIFILE_DEBUGLEVEL 0
 #endif
 
+/* Larger INI files are not cached */
+
+#ifndef CONFIG_FSUTILS_INIFILE_CACHE_MAXSIZE
+#  define CONFIG_FSUTILS_INIFILE_CACHE_MAXSIZE 16384
+#endif
+
+/* Initial number of slots in the hash table of a cached INI file.  The
+ * table doubles whenever it becomes half full.
+ */
+
+#define INIFILE_HASH_INITSIZE 32
+
+/* FNV-1a hash */
+
+#define INIFILE_FNV_BASIS     2166136261u
+#define INIFILE_FNV_PRIME     16777619u
+
 #ifdef CONFIG_CPP_HAVE_VARARGS
 #  if CONFIG_FSUTILS_INIFILE_DEBUGLEVEL > 0
 #    define inidbg(format, ...) \
@@ -100,12 +121,37 @@ struct inifile_var_s
   FAR char *value;
 };
 
+#ifdef CONFIG_FSUTILS_INIFILE_CACHE
+/* One slot of the hash table of a cached INI file.  The strings are offsets
+ * into the string pool.  A slot with a section offset of zero is free.  A
+ * variable offset of zero marks the slot that records the first header of
+ * a section; only the variables that follow that header can be found by
+ * the stream parser, so later headers of the same section are ignored.
+ */
+
+struct inifile_slot_s
+{
+  uint32_t hash;
+  uint32_t section;
+  uint32_t variable;
+  uint32_t value;
+};
+#endif
+
 /* This structure describes the state of one instance of the INI file parser */
 
 struct inifile_state_s
 {
   FILE *instream;
   int   nextch;
+#ifdef CONFIG_FSUTILS_INIFILE_CACHE
+  FAR char *pool;                   /* Interned strings */
+  FAR struct inifile_slot_s *slots; /* Hash table, NULL if not cached */
+  uint32_t poolsize;                /* Allocated size of the pool */
+  uint32_t poolused;                /* Bytes used in the pool */
+  uint32_t nslots;                  /* Size of the hash table */
+  uint32_t nused;                   /* Slots in use */
+#endif
   char  line[CONFIG_FSUTILS_INIFILE_MAXLINE+1];
 };
 
@@ -127,6 +173,20 @@ static bool inifile_read_variable(FAR struct inifile_state_s *priv,
 static FAR char *
             inifile_find_section_variable(FAR struct inifile_state_s *priv,
               FAR const char *variable);
+#ifdef CONFIG_FSUTILS_INIFILE_CACHE
+static uint32_t inifile_hash(uint32_t hash, FAR const char *str);
+static uint32_t inifile_intern(FAR struct inifile_state_s *priv,
+              FAR const char *str);
+static FAR struct inifile_slot_s *
+            inifile_cache_find(FAR struct inifile_state_s *priv,
+              uint32_t hash, FAR const char *section,
+              FAR const char *variable);
+static int  inifile_cache_insert(FAR struct inifile_state_s *priv,
+              uint32_t hash, uint32_t section, uint32_t variable,
+              uint32_t value);
+static void inifile_cache_free(FAR struct inifile_state_s *priv);
+static int  inifile_cache_load(FAR struct inifile_state_s *priv);
+#endif
 static FAR char *
             inifile_find_variable(FAR struct inifile_state_s *priv,
               FAR const char *section, FAR const char *variable);
@@ -447,6 +507,338 @@ static FAR char *
     }
 }
 
+#ifdef CONFIG_FSUTILS_INIFILE_CACHE
+/****************************************************************************
+ * Name:  inifile_hash
+ *
+ * Description:
+ *   Fold the lower case characters of 'str' into the FNV-1a hash 'hash'.
+ *   Section and variable names are case insensitive, so the hash must be
+ *   too.
+ *
+ ****************************************************************************/
+
+static uint32_t inifile_hash(uint32_t hash, FAR const char *str)
+{
+  while (*str != '\0')
+    {
+      hash ^= (uint8_t)tolower((uint8_t)*str++);
+      hash *= INIFILE_FNV_PRIME;
+    }
+
+  return hash;
+}
+
+/****************************************************************************
+ * Name:  inifile_intern
+ *
+ * Description:
+ *   Copy 'str' into the string pool and return its offset, or zero if the
+ *   pool could not be extended.  Offset zero holds an empty string and is
+ *   never returned.
+ *
+ ****************************************************************************/
+
+static uint32_t inifile_intern(FAR struct inifile_state_s *priv,
+                               FAR const char *str)
+{
+  size_t len = strlen(str) + 1;
+  uint32_t offset;
+
+  if (priv->poolused + len > priv->poolsize)
+    {
+      FAR char *pool;
+      size_t size = 2 * priv->poolsize;
+
+      if (size < priv->poolused + len)
+        {
+          size = priv->poolused + len;
+        }
+
+      pool = (FAR char *)realloc(priv->pool, size);
+      if (!pool)
+        {
+          return 0;
+        }
+
+      priv->pool     = pool;
+      priv->poolsize = size;
+    }
+
+  offset = priv->poolused;
+  memcpy(&priv->pool[offset], str, len);
+  priv->poolused += len;
+  return offset;
+}
+
+/****************************************************************************
+ * Name:  inifile_cache_find
+ *
+ * Description:
+ *   Look up a variable in the hash table, or the header of a section if
+ *   'variable' is NULL.  Returns NULL if there is no such entry.
+ *
+ ****************************************************************************/
+
+static FAR struct inifile_slot_s *
+  inifile_cache_find(FAR struct inifile_state_s *priv, uint32_t hash,
+                     FAR const char *section, FAR const char *variable)
+{
+  FAR struct inifile_slot_s *slot;
+  uint32_t mask = priv->nslots - 1;
+  uint32_t index;
+
+  for (index = hash & mask; priv->slots[index].section != 0;
+       index = (index + 1) & mask)
+    {
+      slot = &priv->slots[index];
+      if (slot->hash != hash)
+        {
+          continue;
+        }
+
+      if (variable == NULL)
+        {
+          if (slot->variable != 0)
+            {
+              continue;
+            }
+        }
+      else if (slot->variable == 0 ||
+               strcasecmp(&priv->pool[slot->variable], variable) != 0)
+        {
+          continue;
+        }
+
+      if (strcasecmp(&priv->pool[slot->section], section) == 0)
+        {
+          return slot;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name:  inifile_cache_insert
+ *
+ * Description:
+ *   Add an entry to the hash table, doubling the table if it is half full.
+ *   The caller has checked that the entry is not in the table yet.
+ *
+ ****************************************************************************/
+
+static int inifile_cache_insert(FAR struct inifile_state_s *priv,
+                                uint32_t hash, uint32_t section,
+                                uint32_t variable, uint32_t value)
+{
+  FAR struct inifile_slot_s *slot;
+  uint32_t mask;
+  uint32_t index;
+
+  if (2 * (priv->nused + 1) > priv->nslots)
+    {
+      FAR struct inifile_slot_s *slots = priv->slots;
+      uint32_t nslots = priv->nslots;
+      uint32_t i;
+
+      priv->slots = (FAR struct inifile_slot_s *)
+        calloc(2 * nslots, sizeof(struct inifile_slot_s));
+      if (!priv->slots)
+        {
+          priv->slots = slots;
+          return -ENOMEM;
+        }
+
+      priv->nslots = 2 * nslots;
+      mask         = priv->nslots - 1;
+
+      for (i = 0; i < nslots; i++)
+        {
+          if (slots[i].section != 0)
+            {
+              index = slots[i].hash & mask;
+              while (priv->slots[index].section != 0)
+                {
+                  index = (index + 1) & mask;
+                }
+
+              priv->slots[index] = slots[i];
+            }
+        }
+
+      free(slots);
+    }
+
+  mask = priv->nslots - 1;
+  for (index = hash & mask; priv->slots[index].section != 0;
+       index = (index + 1) & mask)
+    {
+    }
+
+  slot           = &priv->slots[index];
+  slot->hash     = hash;
+  slot->section  = section;
+  slot->variable = variable;
+  slot->value    = value;
+  priv->nused++;
+  return OK;
+}
+
+/****************************************************************************
+ * Name:  inifile_cache_free
+ *
+ * Description:
+ *   Release the string pool and the hash table.
+ *
+ ****************************************************************************/
+
+static void inifile_cache_free(FAR struct inifile_state_s *priv)
+{
+  free(priv->pool);
+  free(priv->slots);
+  priv->pool  = NULL;
+  priv->slots = NULL;
+}
+
+/****************************************************************************
+ * Name:  inifile_cache_load
+ *
+ * Description:
+ *   Parse the whole INI file once into the string pool and the hash table
+ *   and close the stream.  The file is read with the same line reader as
+ *   the stream parser and only the entries that the stream parser would
+ *   find are kept:  the first header of each section, the variables up to
+ *   the next blank line or header and the first assignment of each
+ *   variable.  On failure the stream is left open and the stream parser is
+ *   used.
+ *
+ ****************************************************************************/
+
+static int inifile_cache_load(FAR struct inifile_state_s *priv)
+{
+  FAR char *ptr;
+  uint32_t sechash = 0;
+  uint32_t section = 0;
+  uint32_t variable;
+  uint32_t value;
+  uint32_t hash;
+  long size;
+  int nbytes;
+
+  /* The interned strings are never longer than the lines they come from,
+   * so the size of the file is a good first guess for the pool.
+   */
+
+  if (fseek(priv->instream, 0, SEEK_END) < 0 ||
+      (size = ftell(priv->instream)) < 0)
+    {
+      size = CONFIG_FSUTILS_INIFILE_MAXLINE;
+    }
+
+  if (size > CONFIG_FSUTILS_INIFILE_CACHE_MAXSIZE)
+    {
+      inidbg("ERROR: %ld bytes are too many to cache\n", size);
+      return -EFBIG;
+    }
+
+  priv->poolsize = size + 2;
+  priv->poolused = 1;
+  priv->pool     = (FAR char *)malloc(priv->poolsize);
+  priv->nslots   = INIFILE_HASH_INITSIZE;
+  priv->nused    = 0;
+  priv->slots    = (FAR struct inifile_slot_s *)
+    calloc(INIFILE_HASH_INITSIZE, sizeof(struct inifile_slot_s));
+
+  if (!priv->pool || !priv->slots)
+    {
+      goto errout;
+    }
+
+  priv->pool[0] = '\0';
+
+  rewind(priv->instream);
+  priv->nextch = getc(priv->instream);
+
+  do
+    {
+      nbytes = inifile_read_noncomment_line(priv);
+
+      if (nbytes == 0 || priv->line[0] == '[')
+        {
+          /* A blank line or a header ends the variables of a section */
+
+          section = 0;
+
+          if (nbytes >= 3)
+            {
+              ptr = strchr(&priv->line[1], ']');
+              if (ptr)
+                {
+                  *ptr = '\0';
+                }
+
+              hash = inifile_hash(INIFILE_FNV_BASIS, &priv->line[1]);
+              if (!inifile_cache_find(priv, hash, &priv->line[1], NULL))
+                {
+                  section = inifile_intern(priv, &priv->line[1]);
+                  if (section == 0 ||
+                      inifile_cache_insert(priv, hash, section, 0, 0) < 0)
+                    {
+                      goto errout;
+                    }
+
+                  sechash = hash;
+                }
+            }
+        }
+      else if (section != 0 &&
+               (ptr = strchr(&priv->line[1], '=')) != NULL)
+        {
+          *ptr++ = '\0';
+
+          hash = inifile_hash(sechash * INIFILE_FNV_PRIME, priv->line);
+          if (!inifile_cache_find(priv, hash, &priv->pool[section],
+                                  priv->line))
+            {
+              variable = inifile_intern(priv, priv->line);
+              value    = inifile_intern(priv, ptr);
+              if (variable == 0 || value == 0 ||
+                  inifile_cache_insert(priv, hash, section, variable,
+                                       value) < 0)
+                {
+                  goto errout;
+                }
+            }
+        }
+    }
+  while (priv->nextch != EOF);
+
+  /* Give back what the pool does not need */
+
+  ptr = (FAR char *)realloc(priv->pool, priv->poolused);
+  if (ptr)
+    {
+      priv->pool     = ptr;
+      priv->poolsize = priv->poolused;
+    }
+
+  iniinfo("Cached %lu entries in %lu bytes\n",
+          (unsigned long)priv->nused,
+          (unsigned long)(priv->poolused +
+                          priv->nslots * sizeof(struct inifile_slot_s)));
+
+  fclose(priv->instream);
+  priv->instream = NULL;
+  return OK;
+
+errout:
+  inidbg("ERROR: Failed to allocate the cache\n");
+  inifile_cache_free(priv);
+  return -ENOMEM;
+}
+#endif
+
 /****************************************************************************
  * Name:  inifile_find_variable
  *
@@ -460,10 +852,30 @@ static FAR char *inifile_find_variable(FAR struct inifile_state_s *priv,
                                        FAR const char *section,
                                        FAR const char *variable)
 {
+  FAR char *value = NULL;
   FAR char *ret = NULL;
 
   iniinfo("section=\"%s\" variable=\"%s\"\n", section, variable);
 
+#ifdef CONFIG_FSUTILS_INIFILE_CACHE
+  /* If the INI file is cached, look the variable up in the hash table */
+
+  if (priv->slots)
+    {
+      FAR struct inifile_slot_s *slot;
+      uint32_t hash;
+
+      hash = inifile_hash(INIFILE_FNV_BASIS, section);
+      hash = inifile_hash(hash * INIFILE_FNV_PRIME, variable);
+      slot = inifile_cache_find(priv, hash, section, variable);
+      if (slot)
+        {
+          value = &priv->pool[slot->value];
+        }
+    }
+  else
+#endif
+
   /* Seek to the first variable in the specified section of the INI file */
 
   if (priv->instream && inifile_seek_to_section(priv, section))
@@ -472,14 +884,15 @@ static FAR char *inifile_find_variable(FAR struct inifile_state_s *priv,
        * the section
        */
 
-      FAR char *value = inifile_find_section_variable(priv, variable);
-      iniinfo("variable_value=0x%p\n", value);
+      value = inifile_find_section_variable(priv, variable);
+    }
+
+  iniinfo("variable_value=0x%p\n", value);
 
-      if (value && *value)
-        {
-          iniinfo("variable_value=\"%s\"\n", value);
-          ret = value;
-        }
+  if (value && *value)
+    {
+      iniinfo("variable_value=\"%s\"\n", value);
+      ret = value;
     }
 
   /* Return the string that we found. */
@@ -522,11 +935,22 @@ INIHANDLE inifile_initialize(FAR const char *inifile_name)
   if (priv->instream)
     {
       priv->nextch = getc(priv->instream);
+
+#ifdef CONFIG_FSUTILS_INIFILE_CACHE
+      /* Parse the file once and serve all look-ups from memory.  If that
+       * fails, fall back to the stream.
+       */
+
+      priv->pool  = NULL;
+      priv->slots = NULL;
+      (void)inifile_cache_load(priv);
+#endif
       return (INIHANDLE)priv;
     }
   else
     {
       inidbg("ERROR: Could not open \"%s\"\n", inifile_name);
+      free(priv);
       return (INIHANDLE)NULL;
     }
 }
@@ -552,6 +976,12 @@ void inifile_uninitialize(INIHANDLE handle)
           fclose(priv->instream);
         }
 
+#ifdef CONFIG_FSUTILS_INIFILE_CACHE
+      /* Release the cache */
+
+      inifile_cache_free(priv);
+#endif
+
       /* Release the state structure */
 
       free(priv);
@@ -356,9 +356,40 @@ int mkfatfs(FAR const char *pathname, FAR struct fat_format_s *fmt)
   if (!var.fv_sect)
     {
       ferr("ERROR: Failed to allocate working buffers\n");
+      ret = -ENOMEM;
       goto errout_with_driver;
     }
 
+  /* Allocate a buffer of zeroed sectors so that the FATs and the root
+   * directory can be cleared with multi-sector writes.  Settle for a
+   * smaller buffer if memory is tight.
+   */
+
+  var.fv_nzerosects = CONFIG_FSUTILS_MKFATFS_BUFFER >> var.fv_sectshift;
+  if (var.fv_nzerosects == 0)
+    {
+      var.fv_nzerosects = 1;
+    }
+
+  for (; ; )
+    {
+      var.fv_zeros = (FAR uint8_t *)calloc(var.fv_nzerosects,
+                                           var.fv_sectorsize);
+      if (var.fv_zeros != NULL)
+        {
+          break;
+        }
+
+      if (var.fv_nzerosects == 1)
+        {
+          ferr("ERROR: Failed to allocate working buffers\n");
+          ret = -ENOMEM;
+          goto errout_with_driver;
+        }
+
+      var.fv_nzerosects >>= 1;
+    }
+
   /* Write the filesystem to media */
 
   ret = mkfatfs_writefatfs(fmt, &var);
@@ -376,6 +407,11 @@ errout:
       free(var.fv_sect);
     }
 
+  if (var.fv_zeros)
+    {
+      free(var.fv_zeros);
+    }
+
   /* Return any reported errors */
 
   if (ret < 0)
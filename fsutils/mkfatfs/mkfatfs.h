@@ -64,6 +64,12 @@
 
 #define FAT32_DEFAULT_ROOT_CLUSTER     2
 
+/* Size of the buffer used to write runs of zeroed sectors */
+
+#ifndef CONFIG_FSUTILS_MKFATFS_BUFFER
+#  define CONFIG_FSUTILS_MKFATFS_BUFFER 16384
+#endif
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -88,6 +94,10 @@ struct fat_var_s
   uint32_t       fv_nclusters;      /* Number of clusters */
   uint8_t       *fv_sect;           /* Allocated working sector buffer */
   const uint8_t *fv_bootcode;       /* Points to boot code to put into MBR */
+  uint8_t       *fv_zeros;          /* Allocated buffer of zeroed sectors */
+  uint32_t       fv_nzerosects;     /* Number of sectors at fv_zeros */
+  uint32_t       fv_nwrites;        /* Statistics: Number of write() calls */
+  uint32_t       fv_nskipped;       /* Statistics: Zero sectors not written */
 };
 
 /****************************************************************************
@@ -42,7 +42,9 @@
 
 #include <sys/types.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
+#include <unistd.h>
 #include <errno.h>
 #include <debug.h>
 
@@ -57,31 +59,34 @@
  ****************************************************************************/
 
 /****************************************************************************
- * Name: mkfatfs_devwrite
+ * Name: mkfatfs_devseek
  *
  * Description:
- *   Write the content of the dedicate sector buffer beginning to the specified sector
+ *   Seek to the specified sector and check that 'nsectors' sectors starting
+ *   there are within the volume
  *
  * Input:
  *    fmt  - User specified format parameters
  *    var  - Other format parameters that are not user specifiable
+ *    sector - First sector to be accessed
+ *    nsectors - Number of sectors to be accessed
  *
  * Return:
- *    None; caller is responsible for providing valid parameters.
+ *    Zero on success; negated errno on failure
  *
  ****************************************************************************/
 
-static int mkfatfs_devwrite(FAR const struct fat_format_s *fmt,
-                            FAR const struct fat_var_s *var, off_t sector)
+static int mkfatfs_devseek(FAR const struct fat_format_s *fmt,
+                           FAR const struct fat_var_s *var, off_t sector,
+                           size_t nsectors)
 {
-  ssize_t nwritten;
   off_t seekpos;
   off_t fpos;
   int ret;
 
   /* Convert the sector number to a byte offset */
 
-  if (sector < 0 || sector >= fmt->ff_nsectors)
+  if (sector < 0 || sector + nsectors > fmt->ff_nsectors)
     {
       ferr("sector out of range: %lu\n", (unsigned long)sector);
       return -ESPIPE;
@@ -105,26 +110,196 @@ static int mkfatfs_devwrite(FAR const struct fat_format_s *fmt,
       return -EINVAL;
     }
 
-  /* Write the sector to that offset.  Partial writes are not expected. */
+  return OK;
+}
+
+/****************************************************************************
+ * Name: mkfatfs_devwritev
+ *
+ * Description:
+ *   Write 'nsectors' sectors from 'buffer' beginning at the specified
+ *   sector.  The block driver passes multi-sector writes to the device in
+ *   a single transfer.
+ *
+ * Input:
+ *    fmt  - User specified format parameters
+ *    var  - Other format parameters that are not user specifiable
+ *    sector - First sector to write
+ *    buffer - The data to write
+ *    nsectors - Number of sectors to write
+ *
+ * Return:
+ *    Zero on success; negated errno on failure
+ *
+ ****************************************************************************/
+
+static int mkfatfs_devwritev(FAR const struct fat_format_s *fmt,
+                             FAR struct fat_var_s *var, off_t sector,
+                             FAR const uint8_t *buffer, size_t nsectors)
+{
+  ssize_t nwritten;
+  size_t nbytes;
+  int ret;
+
+  ret = mkfatfs_devseek(fmt, var, sector, nsectors);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Write the sectors to that offset.  Partial writes are not expected. */
+
+  nbytes   = nsectors << var->fv_sectshift;
+  nwritten = write(var->fv_fd, buffer, nbytes);
+  var->fv_nwrites++;
 
-  nwritten = write(var->fv_fd, var->fv_sect, var->fv_sectorsize);
   if (nwritten < 0)
     {
       ret = -errno;
       ferr("ERROR:  write failed: size=%lu pos=%lu error=%d\n",
-           (unsigned)var->fv_sectorsize, (unsigned long)fpos, ret);
+           (unsigned long)nbytes, (unsigned long)sector, ret);
       return ret;
     }
-  else if (nwritten != (ssize_t)var->fv_sectorsize)
+  else if (nwritten != (ssize_t)nbytes)
     {
       ferr("ERROR:  Partial write: size=%lu written=%lu\n",
-           (unsigned)var->fv_sectorsize, (unsigned long)nwritten);
+           (unsigned long)nbytes, (unsigned long)nwritten);
       return -ENODATA;
     }
 
   return OK;
 }
 
+/****************************************************************************
+ * Name: mkfatfs_devwrite
+ *
+ * Description:
+ *   Write the content of the dedicate sector buffer beginning to the specified sector
+ *
+ * Input:
+ *    fmt  - User specified format parameters
+ *    var  - Other format parameters that are not user specifiable
+ *
+ * Return:
+ *    Zero on success; negated errno on failure
+ *
+ ****************************************************************************/
+
+static int mkfatfs_devwrite(FAR const struct fat_format_s *fmt,
+                            FAR struct fat_var_s *var, off_t sector)
+{
+  return mkfatfs_devwritev(fmt, var, sector, var->fv_sect, 1);
+}
+
+/****************************************************************************
+ * Name: mkfatfs_iszero
+ *
+ * Description:
+ *   Read 'nsectors' sectors beginning at the specified sector into the
+ *   zero buffer and check if they are all zero.  The zero buffer is cleared
+ *   again if they are not.
+ *
+ * Input:
+ *    fmt  - User specified format parameters
+ *    var  - Other format parameters that are not user specifiable
+ *    sector - First sector to check
+ *    nsectors - Number of sectors to check (at most fv_nzerosects)
+ *
+ * Return:
+ *    True if the sectors could be read and contain only zeros
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FSUTILS_MKFATFS_ZEROCHECK
+static bool mkfatfs_iszero(FAR const struct fat_format_s *fmt,
+                           FAR struct fat_var_s *var, off_t sector,
+                           size_t nsectors)
+{
+  FAR const uint32_t *ptr;
+  ssize_t nread;
+  size_t nbytes;
+  size_t i;
+
+  if (mkfatfs_devseek(fmt, var, sector, nsectors) < 0)
+    {
+      return false;
+    }
+
+  nbytes = nsectors << var->fv_sectshift;
+  nread  = read(var->fv_fd, var->fv_zeros, nbytes);
+  if (nread == (ssize_t)nbytes)
+    {
+      ptr = (FAR const uint32_t *)var->fv_zeros;
+      for (i = 0; i < (nbytes >> 2) && ptr[i] == 0; i++)
+        {
+        }
+
+      if (i == (nbytes >> 2))
+        {
+          return true;
+        }
+    }
+
+  memset(var->fv_zeros, 0, nbytes);
+  return false;
+}
+#endif
+
+/****************************************************************************
+ * Name: mkfatfs_devzero
+ *
+ * Description:
+ *   Clear 'nsectors' sectors beginning at the specified sector, using as
+ *   few write requests as the size of the zero buffer permits.
+ *
+ * Input:
+ *    fmt  - User specified format parameters
+ *    var  - Other format parameters that are not user specifiable
+ *    sector - First sector to clear
+ *    nsectors - Number of sectors to clear
+ *
+ * Return:
+ *    Zero on success; negated errno on failure
+ *
+ ****************************************************************************/
+
+static int mkfatfs_devzero(FAR const struct fat_format_s *fmt,
+                           FAR struct fat_var_s *var, off_t sector,
+                           size_t nsectors)
+{
+  size_t nxfr;
+  int ret;
+
+  while (nsectors > 0)
+    {
+      nxfr = nsectors;
+      if (nxfr > var->fv_nzerosects)
+        {
+          nxfr = var->fv_nzerosects;
+        }
+
+#ifdef CONFIG_FSUTILS_MKFATFS_ZEROCHECK
+      if (mkfatfs_iszero(fmt, var, sector, nxfr))
+        {
+          var->fv_nskipped += nxfr;
+        }
+      else
+#endif
+        {
+          ret = mkfatfs_devwritev(fmt, var, sector, var->fv_zeros, nxfr);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+
+      sector   += nxfr;
+      nsectors -= nxfr;
+    }
+
+  return OK;
+}
+
 /****************************************************************************
  * Name: mkfatfs_initmbr
  *
@@ -391,7 +566,6 @@ static inline void mkfatfs_initrootdir(FAR struct fat_format_s *fmt,
 static inline int mkfatfs_writembr(FAR struct fat_format_s *fmt,
                                    FAR struct fat_var_s *var)
 {
-  int sectno;
   int ret;
 
   /* Create an image of the configured master boot record */
@@ -402,12 +576,11 @@ static inline int mkfatfs_writembr(FAR struct fat_format_s *fmt,
 
   ret = mkfatfs_devwrite(fmt, var, 0);
 
-  /* Write all of the reserved sectors */
+  /* Clear all of the reserved sectors */
 
-  memset(var->fv_sect, 0, var->fv_sectorsize);
-  for (sectno = 1; sectno < fmt->ff_rsvdseccount && ret >= 0; sectno++)
+  if (ret >= 0 && fmt->ff_rsvdseccount > 1)
     {
-      ret = mkfatfs_devwrite(fmt, var, sectno);
+      ret = mkfatfs_devzero(fmt, var, 1, fmt->ff_rsvdseccount - 1);
     }
 
   /* Write FAT32-specific sectors */
@@ -466,69 +639,66 @@ static inline int mkfatfs_writefat(FAR struct fat_format_s *fmt,
 {
   off_t offset = fmt->ff_rsvdseccount;
   int fatno;
-  int sectno;
   int ret;
 
-  /* Loop for each FAT copy */
+  /* Only the first sector of each FAT holds anything but zeroes.  Mark the
+   * cluster allocations in it.
+   */
 
-  for (fatno = 0; fatno < fmt->ff_nfats; fatno++)
+  memset(var->fv_sect, 0, var->fv_sectorsize);
+  switch (fmt->ff_fattype)
     {
-      /* Loop for each sector in the FAT */
-
-       for (sectno = 0; sectno < var->fv_nfatsects; sectno++)
-         {
-           memset(var->fv_sect, 0, var->fv_sectorsize);
+      case 12:
+        /* Mark the first two full FAT entries -- 24 bits, 3 bytes total */
 
-          /* Mark cluster allocations in sector one of each FAT */
+        memset(var->fv_sect, 0xff, 3);
+        break;
 
-           if (sectno == 0)
-             {
-               memset(var->fv_sect, 0, var->fv_sectorsize);
-               switch (fmt->ff_fattype)
-                 {
-                   case 12:
-                     /* Mark the first two full FAT entries -- 24 bits, 3 bytes total */
+      case 16:
+        /* Mark the first two full FAT entries -- 32 bits, 4 bytes total */
 
-                     memset(var->fv_sect, 0xff, 3);
-                     break;
+        memset(var->fv_sect, 0xff, 4);
+        break;
 
-                   case 16:
-                     /* Mark the first two full FAT entries -- 32 bits, 4 bytes total */
+      case 32:
+      default: /* Shouldn't happen */
+        /* Mark the first two full FAT entries -- 64 bits, 8 bytes total */
 
-                     memset(var->fv_sect, 0xff, 4);
-                     break;
+        memset(var->fv_sect, 0xff, 8);
 
-                   case 32:
-                   default: /* Shouldn't happen */
-                     /* Mark the first two full FAT entries -- 64 bits, 8 bytes total */
+        /* Cluster 2 is used as the root directory.  Mark as EOF */
 
-                     memset(var->fv_sect, 0xff, 8);
+        var->fv_sect[8] =  0xf8;
+        memset(&var->fv_sect[9], 0xff, 3);
+        break;
+    }
 
-                     /* Cluster 2 is used as the root directory.  Mark as EOF */
+  /* Save the media type in the first byte of the FAT */
 
-                     var->fv_sect[8] =  0xf8;
-                     memset(&var->fv_sect[9], 0xff, 3);
-                     break;
-                 }
+  var->fv_sect[0] = FAT_DEFAULT_MEDIA_TYPE;
 
-               /* Save the media type in the first byte of the FAT */
+  /* Loop for each FAT copy */
 
-               var->fv_sect[0] = FAT_DEFAULT_MEDIA_TYPE;
-            }
+  for (fatno = 0; fatno < fmt->ff_nfats; fatno++)
+    {
+      /* Write the first FAT sector, then clear the rest of the FAT */
 
-           /* Write the FAT sector */
+      ret = mkfatfs_devwrite(fmt, var, offset);
+      if (ret >= 0 && var->fv_nfatsects > 1)
+        {
+          ret = mkfatfs_devzero(fmt, var, offset + 1,
+                                var->fv_nfatsects - 1);
+        }
 
-           ret = mkfatfs_devwrite(fmt, var, offset);
-           if (ret < 0)
-             {
-               return ret;
-             }
+      if (ret < 0)
+        {
+          return ret;
+        }
 
-           offset++;
-         }
-     }
+      offset += var->fv_nfatsects;
+    }
 
-   return OK;
+  return OK;
 }
 
 /****************************************************************************
@@ -551,30 +721,22 @@ static inline int mkfatfs_writerootdir(FAR struct fat_format_s *fmt,
 {
   off_t offset = fmt->ff_rsvdseccount + fmt->ff_nfats * var->fv_nfatsects;
   int ret;
-  int i;
 
   /* Write the root directory after the last FAT. This is the root directory
-   * area for FAT12/16, and the first cluster on FAT32.
+   * area for FAT12/16, and the first cluster on FAT32.  Only the first
+   * sector holds any data.
    */
 
-  for (i = 0; i < var->fv_nrootdirsects; i++)
-    {
-      /* Format the next sector of the root directory */
-
-      mkfatfs_initrootdir(fmt, var, i);
-
-      /* Write the next sector of the root directory */
+  mkfatfs_initrootdir(fmt, var, 0);
 
-      ret = mkfatfs_devwrite(fmt, var, offset);
-      if (ret < 0)
-        {
-          return ret;
-        }
-
-      offset++;
+  ret = mkfatfs_devwrite(fmt, var, offset);
+  if (ret >= 0 && var->fv_nrootdirsects > 1)
+    {
+      ret = mkfatfs_devzero(fmt, var, offset + 1,
+                            var->fv_nrootdirsects - 1);
     }
 
-  return 0;
+  return ret;
 }
 
 /****************************************************************************
@@ -620,6 +782,8 @@ int mkfatfs_writefatfs(FAR struct fat_format_s *fmt,
       ret = mkfatfs_writerootdir(fmt, var);
     }
 
+  finfo("%lu write requests, %lu zero sectors skipped\n",
+        (unsigned long)var->fv_nwrites, (unsigned long)var->fv_nskipped);
   return ret;
 }
 
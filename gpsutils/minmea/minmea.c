@@ -81,108 +81,456 @@ static inline bool minmea_isfield(char c)
   return isprint((unsigned char) c) && c != ',' && c != '*';
 }
 
-/****************************************************************************
- * Public Functions
- ****************************************************************************/
-
-uint8_t minmea_checksum(FAR const char *sentence)
+/* Single pass over a sentence: compute the checksum, record the field
+ * offsets and, if check is set, verify the checksum and the trailer as
+ * minmea_check() does.  A sentence without a proper "$xxXXX" field is
+ * still well formed but gets the id MINMEA_INVALID.
+ */
+
+static bool minmea_split(FAR struct minmea_tokens *tokens,
+                         FAR const char *sentence, bool check, bool strict)
 {
+  FAR const char *p;
   uint8_t checksum = 0x00;
+  int nfields = 1;
+  int upper;
+  int lower;
+  int i;
+  char c;
 
-  /* Support senteces with or without the starting dollar sign. */
+  /* A valid sentence starts with "$". */
 
-  if (*sentence == '$')
+  if (*sentence != '$')
     {
-      sentence++;
+      return false;
     }
 
-  /* The optional checksum is an XOR of all bytes between "$" and "*". */
+  tokens->sentence = sentence;
+  tokens->start[0] = 0;
 
-  while (*sentence && *sentence != '*')
+  for (p = sentence + 1;
+       (c = *p) != '\0' && c != '*' && isprint((unsigned char) c);
+       p++)
     {
-      checksum ^= *sentence++;
-    }
+      /* Sequence length is limited. */
 
-  return checksum;
-}
+      if (p - sentence > MINMEA_MAX_LENGTH + 3)
+        {
+          return false;
+        }
 
-bool minmea_check(FAR const char *sentence, bool strict)
-{
-  uint8_t checksum = 0x00;
+      checksum ^= c;
+      if (c == ',' && nfields < MINMEA_MAX_FIELDS)
+        {
+          tokens->start[nfields++] = p - sentence + 1;
+        }
+    }
 
-  /* Sequence length is limited. */
+  tokens->start[nfields] = p - sentence + 1;
+  tokens->nfields = nfields;
 
-  if (strlen(sentence) > MINMEA_MAX_LENGTH + 3)
+  if (check)
     {
-      return false;
+      if (c == '*')
+        {
+          upper = hex2int(p[1]);
+          if (upper == -1)
+            {
+              return false;
+            }
+
+          lower = hex2int(p[2]);
+          if (lower == -1)
+            {
+              return false;
+            }
+
+          if (checksum != (upper << 4 | lower))
+            {
+              return false;
+            }
+
+          p += 3;
+        }
+      else if (strict)
+        {
+          /* Discard non-checksummed frames in strict mode. */
+
+          return false;
+        }
+
+      /* The only stuff allowed at this point is a newline. */
+
+      if (*p && strcmp(p, "\n") && strcmp(p, "\r\n"))
+        {
+          return false;
+        }
+
+      if (p - sentence + strlen(p) > MINMEA_MAX_LENGTH + 3)
+        {
+          return false;
+        }
     }
 
-  /* A valid sentence starts with "$". */
+  /* The talker and sentence type are the five characters after "$". */
 
-  if (*sentence++ != '$')
+  if (tokens->start[1] < 7)
     {
-      return false;
+      tokens->id = MINMEA_INVALID;
+      return true;
     }
 
-  /* The optional checksum is an XOR of all bytes between "$" and "*". */
+  for (i = 0; i < 5; i++)
+    {
+      tokens->type[i] = sentence[i + 1];
+    }
 
-  while (*sentence && *sentence != '*' &&
-         isprint((unsigned char) *sentence))
+  tokens->type[5] = '\0';
+
+  switch (tokens->type[2])
     {
-      checksum ^= *sentence++;
+      case 'R':
+        tokens->id = strcmp(&tokens->type[2], "RMC") ? MINMEA_UNKNOWN :
+                     MINMEA_SENTENCE_RMC;
+        break;
+
+      case 'G':
+        if (!strcmp(&tokens->type[2], "GGA"))
+          {
+            tokens->id = MINMEA_SENTENCE_GGA;
+          }
+        else if (!strcmp(&tokens->type[2], "GSA"))
+          {
+            tokens->id = MINMEA_SENTENCE_GSA;
+          }
+        else if (!strcmp(&tokens->type[2], "GLL"))
+          {
+            tokens->id = MINMEA_SENTENCE_GLL;
+          }
+        else if (!strcmp(&tokens->type[2], "GST"))
+          {
+            tokens->id = MINMEA_SENTENCE_GST;
+          }
+        else if (!strcmp(&tokens->type[2], "GSV"))
+          {
+            tokens->id = MINMEA_SENTENCE_GSV;
+          }
+        else
+          {
+            tokens->id = MINMEA_UNKNOWN;
+          }
+        break;
+
+      default:
+        tokens->id = MINMEA_UNKNOWN;
+        break;
     }
 
-  /* If checksum is present... */
+  return true;
+}
+
+/* Typed field decoders.  They follow the minmea_scan() conversions of the
+ * same letter; a field beyond the end of the sentence is empty.
+ */
 
-  if (*sentence == '*')
+static int minmea_field(FAR const struct minmea_tokens *tokens, int i,
+                        FAR const char **field)
+{
+  if (i >= tokens->nfields)
     {
-      int upper;
-      int lower;
-      int expected;
+      *field = NULL;
+      return 0;
+    }
 
-      /* Extract checksum. */
+  *field = tokens->sentence + tokens->start[i];
+  return tokens->start[i + 1] - tokens->start[i] - 1;
+}
 
-      sentence++;
-      upper = hex2int(*sentence++);
+static bool minmea_get_char(FAR const struct minmea_tokens *tokens, int i,
+                            FAR char *value)
+{
+  FAR const char *field;
+
+  *value = minmea_field(tokens, i, &field) > 0 ? *field : '\0';
+  return true;
+}
 
-      if (upper == -1)
+static bool minmea_get_direction(FAR const struct minmea_tokens *tokens,
+                                 int i, FAR int *value)
+{
+  FAR const char *field;
+
+  *value = 0;
+  if (minmea_field(tokens, i, &field) > 0)
+    {
+      switch (*field)
         {
-          return false;
+          case 'N':
+          case 'E':
+            *value = 1;
+            break;
+
+          case 'S':
+          case 'W':
+            *value = -1;
+            break;
+
+          default:
+            return false;
         }
+    }
+
+  return true;
+}
 
-      lower = hex2int(*sentence++);
-      if (lower == -1)
+static bool minmea_get_float(FAR const struct minmea_tokens *tokens, int i,
+                             FAR struct minmea_float *f)
+{
+  FAR const char *field;
+  int_least32_t value = -1;
+  int_least32_t scale = 0;
+  int sign = 0;
+  int digit;
+  int len;
+
+  for (len = minmea_field(tokens, i, &field); len > 0; len--, field++)
+    {
+      if (*field == '+' && !sign && value == -1)
         {
-          return false;
+          sign = 1;
         }
+      else if (*field == '-' && !sign && value == -1)
+        {
+          sign = -1;
+        }
+      else if (isdigit((unsigned char) *field))
+        {
+          digit = *field - '0';
+          if (value == -1)
+            {
+              value = 0;
+            }
 
-      expected = upper << 4 | lower;
+          if (value > (INT_LEAST32_MAX - digit) / 10)
+            {
+              /* Truncate extra precision, fail on integer overflow */
 
-      /* Check for checksum mismatch. */
+              if (scale)
+                {
+                  break;
+                }
 
-      if (checksum != expected)
+              return false;
+            }
+
+          value = (10 * value) + digit;
+          if (scale)
+            {
+              scale *= 10;
+            }
+        }
+      else if (*field == '.' && scale == 0)
         {
+          scale = 1;
+        }
+      else if (*field != ' ' || sign != 0 || value != -1 || scale != 0)
+        {
+          /* Spaces are only allowed at the start of the field */
+
           return false;
         }
     }
-  else if (strict)
+
+  if ((sign || scale) && value == -1)
+    {
+      return false;
+    }
+
+  if (value == -1)
+    {
+      /* No digits were scanned. */
+
+      value = 0;
+      scale = 0;
+    }
+  else if (scale == 0)
+    {
+      /* No decimal point. */
+
+      scale = 1;
+    }
+
+  if (sign)
+    {
+      value *= sign;
+    }
+
+  f->value = value;
+  f->scale = scale;
+  return true;
+}
+
+static bool minmea_get_int(FAR const struct minmea_tokens *tokens, int i,
+                           FAR int *value)
+{
+  FAR const char *field;
+  bool negative = false;
+  bool digits = false;
+  int len;
+
+  *value = 0;
+  len = minmea_field(tokens, i, &field);
+  if (len == 0)
+    {
+      return true;
+    }
+
+  /* Same syntax as strtol(): leading spaces, an optional sign, digits */
+
+  for (; len > 0 && *field == ' '; len--, field++)
+    {
+    }
+
+  if (len > 0 && (*field == '+' || *field == '-'))
     {
-      /* Discard non-checksummed frames in strict mode. */
+      negative = *field == '-';
+      len--;
+      field++;
+    }
+
+  for (; len > 0 && isdigit((unsigned char) *field); len--, field++)
+    {
+      *value = *value * 10 + (*field - '0');
+      digits = true;
+    }
+
+  if (negative)
+    {
+      *value = -*value;
+    }
 
+  return digits && len == 0;
+}
+
+static bool minmea_get_digits2(FAR const char *field, FAR int *value)
+{
+  if (!isdigit((unsigned char) field[0]) ||
+      !isdigit((unsigned char) field[1]))
+    {
       return false;
     }
 
-  /* The only stuff allowed at this point is a newline. */
+  *value = (field[0] - '0') * 10 + (field[1] - '0');
+  return true;
+}
+
+static bool minmea_get_date(FAR const struct minmea_tokens *tokens, int i,
+                            FAR struct minmea_date *date)
+{
+  FAR const char *field;
+  int len;
 
-  if (*sentence && strcmp(sentence, "\n") &&
-      strcmp(sentence, "\r\n"))
+  date->day   = -1;
+  date->month = -1;
+  date->year  = -1;
+
+  len = minmea_field(tokens, i, &field);
+  if (len == 0)
+    {
+      return true;
+    }
+
+  /* Always six digits. */
+
+  return len >= 6 &&
+         minmea_get_digits2(&field[0], &date->day) &&
+         minmea_get_digits2(&field[2], &date->month) &&
+         minmea_get_digits2(&field[4], &date->year);
+}
+
+static bool minmea_get_time(FAR const struct minmea_tokens *tokens, int i,
+                            FAR struct minmea_time *time_)
+{
+  FAR const char *field;
+  int value = 0;
+  int scale = 1000000;
+  int len;
+
+  time_->hours        = -1;
+  time_->minutes      = -1;
+  time_->seconds      = -1;
+  time_->microseconds = -1;
+
+  len = minmea_field(tokens, i, &field);
+  if (len == 0)
+    {
+      return true;
+    }
+
+  /* Minimum required: integer time. */
+
+  if (len < 6 ||
+      !minmea_get_digits2(&field[0], &time_->hours) ||
+      !minmea_get_digits2(&field[2], &time_->minutes) ||
+      !minmea_get_digits2(&field[4], &time_->seconds))
     {
       return false;
     }
 
+  /* Extra: fractional time. Saved as microseconds. */
+
+  if (len > 6 && field[6] == '.')
+    {
+      for (field += 7, len -= 7;
+           len > 0 && isdigit((unsigned char) *field) && scale > 1;
+           field++, len--)
+        {
+          value = (value * 10) + (*field - '0');
+          scale /= 10;
+        }
+
+      time_->microseconds = value * scale;
+    }
+  else
+    {
+      time_->microseconds = 0;
+    }
+
   return true;
 }
 
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+uint8_t minmea_checksum(FAR const char *sentence)
+{
+  uint8_t checksum = 0x00;
+
+  /* Support senteces with or without the starting dollar sign. */
+
+  if (*sentence == '$')
+    {
+      sentence++;
+    }
+
+  /* The optional checksum is an XOR of all bytes between "$" and "*". */
+
+  while (*sentence && *sentence != '*')
+    {
+      checksum ^= *sentence++;
+    }
+
+  return checksum;
+}
+
+bool minmea_check(FAR const char *sentence, bool strict)
+{
+  struct minmea_tokens tokens;
+
+  return minmea_split(&tokens, sentence, true, strict);
+}
+
 bool minmea_scan(FAR const char *sentence, FAR const char *format, ...)
 {
   bool result = false;
@@ -570,15 +918,16 @@ parse_error:
 
 bool minmea_talker_id(char talker[3], FAR const char *sentence)
 {
-  char type[6];
+  struct minmea_tokens tokens;
 
-  if (!minmea_scan(sentence, "t", type))
+  if (!minmea_split(&tokens, sentence, false, false) ||
+      tokens.id == MINMEA_INVALID)
     {
       return false;
     }
 
-  talker[0] = type[0];
-  talker[1] = type[1];
+  talker[0] = tokens.type[0];
+  talker[1] = tokens.type[1];
   talker[2] = '\0';
 
   return true;
@@ -587,74 +936,45 @@ bool minmea_talker_id(char talker[3], FAR const char *sentence)
 enum minmea_sentence_id minmea_sentence_id(FAR const char *sentence,
                                            bool strict)
 {
-  if (!minmea_check(sentence, strict))
-    return MINMEA_INVALID;
+  struct minmea_tokens tokens;
 
-  char type[6];
-  if (!minmea_scan(sentence, "t", type))
+  if (!minmea_split(&tokens, sentence, true, strict))
     {
       return MINMEA_INVALID;
     }
 
-  if (!strcmp(type+2, "RMC"))
-    {
-      return MINMEA_SENTENCE_RMC;
-    }
-
-  if (!strcmp(type+2, "GGA"))
-    {
-      return MINMEA_SENTENCE_GGA;
-    }
-
-  if (!strcmp(type+2, "GSA"))
-    {
-      return MINMEA_SENTENCE_GSA;
-    }
-
-  if (!strcmp(type+2, "GLL"))
-    {
-      return MINMEA_SENTENCE_GLL;
-    }
-
-  if (!strcmp(type+2, "GST"))
-    {
-      return MINMEA_SENTENCE_GST;
-    }
-
-  if (!strcmp(type+2, "GSV"))
-    {
-      return MINMEA_SENTENCE_GSV;
-    }
+  return tokens.id;
+}
 
-  return MINMEA_UNKNOWN;
+bool minmea_tokenize(FAR struct minmea_tokens *tokens,
+                     FAR const char *sentence, bool strict)
+{
+  return minmea_split(tokens, sentence, true, strict) &&
+         tokens->id != MINMEA_INVALID;
 }
 
-bool minmea_parse_rmc(FAR struct minmea_sentence_rmc *frame,
-                      FAR const char *sentence)
+bool minmea_decode_rmc(FAR struct minmea_sentence_rmc *frame,
+                       FAR const struct minmea_tokens *tokens)
 {
   /* $GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62 */
 
-  char type[6];
   char validity;
   int latitude_direction;
   int longitude_direction;
   int variation_direction;
 
-  if (!minmea_scan(sentence, "tTcfdfdffDfd",
-                   type,
-                   &frame->time,
-                   &validity,
-                   &frame->latitude, &latitude_direction,
-                   &frame->longitude, &longitude_direction,
-                   &frame->speed,
-                   &frame->course,
-                   &frame->date,
-                   &frame->variation, &variation_direction))
-    {
-      return false;
-    }
-
-  if (strcmp(type+2, "RMC"))
+  if (tokens->id != MINMEA_SENTENCE_RMC || tokens->nfields < 12 ||
+      !minmea_get_time(tokens, 1, &frame->time) ||
+      !minmea_get_char(tokens, 2, &validity) ||
+      !minmea_get_float(tokens, 3, &frame->latitude) ||
+      !minmea_get_direction(tokens, 4, &latitude_direction) ||
+      !minmea_get_float(tokens, 5, &frame->longitude) ||
+      !minmea_get_direction(tokens, 6, &longitude_direction) ||
+      !minmea_get_float(tokens, 7, &frame->speed) ||
+      !minmea_get_float(tokens, 8, &frame->course) ||
+      !minmea_get_date(tokens, 9, &frame->date) ||
+      !minmea_get_float(tokens, 10, &frame->variation) ||
+      !minmea_get_direction(tokens, 11, &variation_direction))
     {
       return false;
     }
@@ -667,31 +987,28 @@ bool minmea_parse_rmc(FAR struct minmea_sentence_rmc *frame,
   return true;
 }
 
-bool minmea_parse_gga(FAR struct minmea_sentence_gga *frame,
-                      FAR const char *sentence)
+bool minmea_decode_gga(FAR struct minmea_sentence_gga *frame,
+                       FAR const struct minmea_tokens *tokens)
 {
   /* $GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47 */
 
-  char type[6];
   int latitude_direction;
   int longitude_direction;
 
-  if (!minmea_scan(sentence, "tTfdfdiiffcfci_",
-                   type,
-                   &frame->time,
-                   &frame->latitude, &latitude_direction,
-                   &frame->longitude, &longitude_direction,
-                   &frame->fix_quality,
-                   &frame->satellites_tracked,
-                   &frame->hdop,
-                   &frame->altitude, &frame->altitude_units,
-                   &frame->height, &frame->height_units,
-                   &frame->dgps_age))
-    {
-      return false;
-    }
-
-  if (strcmp(type+2, "GGA"))
+  if (tokens->id != MINMEA_SENTENCE_GGA || tokens->nfields < 15 ||
+      !minmea_get_time(tokens, 1, &frame->time) ||
+      !minmea_get_float(tokens, 2, &frame->latitude) ||
+      !minmea_get_direction(tokens, 3, &latitude_direction) ||
+      !minmea_get_float(tokens, 4, &frame->longitude) ||
+      !minmea_get_direction(tokens, 5, &longitude_direction) ||
+      !minmea_get_int(tokens, 6, &frame->fix_quality) ||
+      !minmea_get_int(tokens, 7, &frame->satellites_tracked) ||
+      !minmea_get_float(tokens, 8, &frame->hdop) ||
+      !minmea_get_float(tokens, 9, &frame->altitude) ||
+      !minmea_get_char(tokens, 10, &frame->altitude_units) ||
+      !minmea_get_float(tokens, 11, &frame->height) ||
+      !minmea_get_char(tokens, 12, &frame->height_units) ||
+      !minmea_get_int(tokens, 13, &frame->dgps_age))
     {
       return false;
     }
@@ -702,65 +1019,49 @@ bool minmea_parse_gga(FAR struct minmea_sentence_gga *frame,
   return true;
 }
 
-bool minmea_parse_gsa(FAR struct minmea_sentence_gsa *frame,
-                      FAR const char *sentence)
+bool minmea_decode_gsa(FAR struct minmea_sentence_gsa *frame,
+                       FAR const struct minmea_tokens *tokens)
 {
   /* $GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39 */
 
-  char type[6];
-
-  if (!minmea_scan(sentence, "tciiiiiiiiiiiiifff",
-                   type,
-                   &frame->mode,
-                   &frame->fix_type,
-                   &frame->sats[0],
-                   &frame->sats[1],
-                   &frame->sats[2],
-                   &frame->sats[3],
-                   &frame->sats[4],
-                   &frame->sats[5],
-                   &frame->sats[6],
-                   &frame->sats[7],
-                   &frame->sats[8],
-                   &frame->sats[9],
-                   &frame->sats[10],
-                   &frame->sats[11],
-                   &frame->pdop,
-                   &frame->hdop,
-                   &frame->vdop))
+  int i;
+
+  if (tokens->id != MINMEA_SENTENCE_GSA || tokens->nfields < 18 ||
+      !minmea_get_char(tokens, 1, &frame->mode) ||
+      !minmea_get_int(tokens, 2, &frame->fix_type))
     {
       return false;
     }
 
-  if (strcmp(type+2, "GSA"))
+  for (i = 0; i < 12; i++)
     {
-      return false;
+      if (!minmea_get_int(tokens, 3 + i, &frame->sats[i]))
+        {
+          return false;
+        }
     }
 
-  return true;
+  return minmea_get_float(tokens, 15, &frame->pdop) &&
+         minmea_get_float(tokens, 16, &frame->hdop) &&
+         minmea_get_float(tokens, 17, &frame->vdop);
 }
 
-bool minmea_parse_gll(FAR struct minmea_sentence_gll *frame,
-                      FAR const char *sentence)
+bool minmea_decode_gll(FAR struct minmea_sentence_gll *frame,
+                       FAR const struct minmea_tokens *tokens)
 {
   /* $GPGLL,3723.2475,N,12158.3416,W,161229.487,A,A*41$; */
 
-  char type[6];
   int latitude_direction;
   int longitude_direction;
 
-  if (!minmea_scan(sentence, "tfdfdTc;c",
-                   type,
-                   &frame->latitude, &latitude_direction,
-                   &frame->longitude, &longitude_direction,
-                   &frame->time,
-                   &frame->status,
-                   &frame->mode))
-    {
-      return false;
-    }
-
-  if (strcmp(type+2, "GLL"))
+  if (tokens->id != MINMEA_SENTENCE_GLL || tokens->nfields < 7 ||
+      !minmea_get_float(tokens, 1, &frame->latitude) ||
+      !minmea_get_direction(tokens, 2, &latitude_direction) ||
+      !minmea_get_float(tokens, 3, &frame->longitude) ||
+      !minmea_get_direction(tokens, 4, &longitude_direction) ||
+      !minmea_get_time(tokens, 5, &frame->time) ||
+      !minmea_get_char(tokens, 6, &frame->status) ||
+      !minmea_get_char(tokens, 7, &frame->mode))
     {
       return false;
     }
@@ -771,77 +1072,195 @@ bool minmea_parse_gll(FAR struct minmea_sentence_gll *frame,
   return true;
 }
 
-bool minmea_parse_gst(FAR struct minmea_sentence_gst *frame,
-                      FAR const char *sentence)
+bool minmea_decode_gst(FAR struct minmea_sentence_gst *frame,
+                       FAR const struct minmea_tokens *tokens)
 {
   /* $GPGST,024603.00,3.2,6.6,4.7,47.3,5.8,5.6,22.0*58 */
 
-  char type[6];
+  return tokens->id == MINMEA_SENTENCE_GST && tokens->nfields >= 9 &&
+         minmea_get_time(tokens, 1, &frame->time) &&
+         minmea_get_float(tokens, 2, &frame->rms_deviation) &&
+         minmea_get_float(tokens, 3, &frame->semi_major_deviation) &&
+         minmea_get_float(tokens, 4, &frame->semi_minor_deviation) &&
+         minmea_get_float(tokens, 5, &frame->semi_major_orientation) &&
+         minmea_get_float(tokens, 6, &frame->latitude_error_deviation) &&
+         minmea_get_float(tokens, 7, &frame->longitude_error_deviation) &&
+         minmea_get_float(tokens, 8, &frame->altitude_error_deviation);
+}
+
+bool minmea_decode_gsv(FAR struct minmea_sentence_gsv *frame,
+                       FAR const struct minmea_tokens *tokens)
+{
+  /* $GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74
+   * $GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,*4D
+   * $GPGSV,4,2,11,08,51,203,30,09,45,215,28*75
+   * $GPGSV,4,4,13,39,31,170,27*40
+   * $GPGSV,4,4,13*7B */
+
+  int i;
 
-  if (!minmea_scan(sentence, "tTfffffff",
-                   type,
-                   &frame->time,
-                   &frame->rms_deviation,
-                   &frame->semi_major_deviation,
-                   &frame->semi_minor_deviation,
-                   &frame->semi_major_orientation,
-                   &frame->latitude_error_deviation,
-                   &frame->longitude_error_deviation,
-                   &frame->altitude_error_deviation))
+  if (tokens->id != MINMEA_SENTENCE_GSV || tokens->nfields < 4 ||
+      !minmea_get_int(tokens, 1, &frame->total_msgs) ||
+      !minmea_get_int(tokens, 2, &frame->msg_nr) ||
+      !minmea_get_int(tokens, 3, &frame->total_sats))
     {
       return false;
     }
 
-  if (strcmp(type+2, "GST"))
+  /* Up to four satellites, missing ones read as zero */
+
+  for (i = 0; i < 4; i++)
     {
-      return false;
+      if (!minmea_get_int(tokens, 4 + 4 * i, &frame->sats[i].nr) ||
+          !minmea_get_int(tokens, 5 + 4 * i, &frame->sats[i].elevation) ||
+          !minmea_get_int(tokens, 6 + 4 * i, &frame->sats[i].azimuth) ||
+          !minmea_get_int(tokens, 7 + 4 * i, &frame->sats[i].snr))
+        {
+          return false;
+        }
     }
 
   return true;
 }
 
+/* The minmea_parse_*() functions do not verify the checksum, as before;
+ * use minmea_tokenize() and minmea_decode_*() to do both in one pass.
+ */
+
+bool minmea_parse_rmc(FAR struct minmea_sentence_rmc *frame,
+                      FAR const char *sentence)
+{
+  struct minmea_tokens tokens;
+
+  return minmea_split(&tokens, sentence, false, false) &&
+         minmea_decode_rmc(frame, &tokens);
+}
+
+bool minmea_parse_gga(FAR struct minmea_sentence_gga *frame,
+                      FAR const char *sentence)
+{
+  struct minmea_tokens tokens;
+
+  return minmea_split(&tokens, sentence, false, false) &&
+         minmea_decode_gga(frame, &tokens);
+}
+
+bool minmea_parse_gsa(FAR struct minmea_sentence_gsa *frame,
+                      FAR const char *sentence)
+{
+  struct minmea_tokens tokens;
+
+  return minmea_split(&tokens, sentence, false, false) &&
+         minmea_decode_gsa(frame, &tokens);
+}
+
+bool minmea_parse_gll(FAR struct minmea_sentence_gll *frame,
+                      FAR const char *sentence)
+{
+  struct minmea_tokens tokens;
+
+  return minmea_split(&tokens, sentence, false, false) &&
+         minmea_decode_gll(frame, &tokens);
+}
+
+bool minmea_parse_gst(FAR struct minmea_sentence_gst *frame,
+                      FAR const char *sentence)
+{
+  struct minmea_tokens tokens;
+
+  return minmea_split(&tokens, sentence, false, false) &&
+         minmea_decode_gst(frame, &tokens);
+}
+
 bool minmea_parse_gsv(FAR struct minmea_sentence_gsv *frame,
                       FAR const char *sentence)
 {
-  /* $GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74
-   * $GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,*4D
-   * $GPGSV,4,2,11,08,51,203,30,09,45,215,28*75
-   * $GPGSV,4,4,13,39,31,170,27*40
-   * $GPGSV,4,4,13*7B */
+  struct minmea_tokens tokens;
 
-  char type[6];
-
-  if (!minmea_scan(sentence, "tiii;iiiiiiiiiiiiiiii",
-                   type,
-                   &frame->total_msgs,
-                   &frame->msg_nr,
-                   &frame->total_sats,
-                   &frame->sats[0].nr,
-                   &frame->sats[0].elevation,
-                   &frame->sats[0].azimuth,
-                   &frame->sats[0].snr,
-                   &frame->sats[1].nr,
-                   &frame->sats[1].elevation,
-                   &frame->sats[1].azimuth,
-                   &frame->sats[1].snr,
-                   &frame->sats[2].nr,
-                   &frame->sats[2].elevation,
-                   &frame->sats[2].azimuth,
-                   &frame->sats[2].snr,
-                   &frame->sats[3].nr,
-                   &frame->sats[3].elevation,
-                   &frame->sats[3].azimuth,
-                   &frame->sats[3].snr))
-    {
-      return false;
-    }
+  return minmea_split(&tokens, sentence, false, false) &&
+         minmea_decode_gsv(frame, &tokens);
+}
+
+void minmea_stream_init(FAR struct minmea_stream *stream, bool strict)
+{
+  memset(stream, 0, sizeof(struct minmea_stream));
+  stream->strict = strict;
+}
 
-  if (strcmp(type+2, "GSV"))
+int minmea_stream_feed(FAR struct minmea_stream *stream,
+                       FAR const char *buf, size_t len,
+                       minmea_callback_t callback, FAR void *arg)
+{
+  struct minmea_tokens tokens;
+  FAR const char *end = buf + len;
+  FAR const char *eol;
+  FAR char *start;
+  size_t n;
+  int count = 0;
+
+  while (buf < end)
     {
-      return false;
+      /* Copy up to the end of the line in one go */
+
+      eol = memchr(buf, '\n', end - buf);
+      n = (eol != NULL ? eol : end) - buf;
+
+      if (!stream->overflow)
+        {
+          if (stream->len + n < sizeof(stream->line))
+            {
+              memcpy(&stream->line[stream->len], buf, n);
+              stream->len += n;
+            }
+          else
+            {
+              stream->overflow = true;
+            }
+        }
+
+      if (eol == NULL)
+        {
+          break;
+        }
+
+      buf = eol + 1;
+
+      /* A complete line.  Resynchronize on the last "$" so that garbage
+       * from a partial line at start-up does not spoil the sentence.
+       */
+
+      if (stream->overflow)
+        {
+          stream->errors++;
+        }
+      else if (stream->len > 0)
+        {
+          if (stream->line[stream->len - 1] == '\r')
+            {
+              stream->len--;
+            }
+
+          stream->line[stream->len] = '\0';
+          start = strrchr(stream->line, '$');
+
+          if (start != NULL &&
+              minmea_tokenize(&tokens, start, stream->strict))
+            {
+              stream->sentences++;
+              count++;
+              callback(&tokens, arg);
+            }
+          else
+            {
+              stream->errors++;
+            }
+        }
+
+      stream->len = 0;
+      stream->overflow = false;
     }
 
-  return true;
+  return count;
 }
 
 int minmea_gettime(FAR struct timespec *ts,
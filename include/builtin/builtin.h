@@ -104,6 +104,27 @@ extern "C"
 int exec_builtin(FAR const char *appname, FAR char * const *argv,
                  FAR const char *redirfile, int oflags);
 
+/****************************************************************************
+ * Name: builtin_find
+ *
+ * Description:
+ *   Return the index of the builtin application with the given name.  This
+ *   is equivalent to builtin_isavail() but uses a hash index over the
+ *   builtin table.
+ *
+ * Input Parameter:
+ *   appname - Name of the builtin application.
+ *
+ * Returned Value:
+ *   The index of the application in the builtin table or -ENOENT if there
+ *   is no application of that name.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_BUILTIN_HASH
+int builtin_find(FAR const char *appname);
+#endif
+
 #undef EXTERN
 #if defined(__cplusplus)
 }
@@ -48,12 +48,63 @@
 #include <fcntl.h>
 #include <errno.h>
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include <nuttx/can/can.h>
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Number of requests that can be outstanding at the same time */
+
+#ifndef CONFIG_LIBOBD2_MAX_REQUESTS
+#  define CONFIG_LIBOBD2_MAX_REQUESTS 8
+#endif
+
+/* Size of the (mode, PID) lookup table, must be a power of two */
+
+#define OBD_REQ_HASH_SIZE  16
+
+/* Marks the end of a hash chain */
+
+#define OBD_REQ_NONE       0xff
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
 
+struct obd_dev_s;
+
+/* Called by obd_process() when the response to a request has arrived or
+ * the request timed out.  On success result is OK and data/len describe
+ * the response payload, starting with the response mode byte
+ * (opmode + OBD_RESP_BASE).  The response is also laid out in dev->data
+ * as obd_decode_pid() expects it, unless a multi-frame response from
+ * another ECU is being reassembled there at the time.  On timeout result
+ * is -ETIMEDOUT and data is NULL.  The request is already released when
+ * the callback runs, so it may submit the same PID again.
+ */
+
+typedef CODE void (*obd_callback_t)(FAR struct obd_dev_s *dev,
+                                    uint8_t opmode, uint8_t pid, int result,
+                                    FAR const uint8_t *data, size_t len,
+                                    FAR void *arg);
+
+/* An outstanding request */
+
+struct obd_req_s
+{
+  obd_callback_t callback;           /* Completion callback                 */
+  FAR void *arg;                     /* Argument passed to the callback     */
+  uint32_t deadline;                 /* Expiry time (ms, monotonic)         */
+  uint8_t  opmode;                   /* Requested mode                      */
+  uint8_t  pid;                      /* Requested PID                       */
+  uint8_t  next;                     /* Next request in the same hash chain */
+  bool     inuse;                    /* Slot holds a request                */
+};
+
 /* CAN Modes */
 
 enum
@@ -71,11 +122,28 @@ struct obd_dev_s
   struct  canioc_bittiming_s can_bt; /* Current bitrate                     */
   uint8_t can_mode;                  /* Current mode (Standard or Extended) */
   int     can_fd;                    /* File Descriptor of CAN Device       */
-#ifdef CONFIG_MULTIFRAME_SUPPORT
+#ifdef CONFIG_LIBOBD2_MULTIFRAME
   uint8_t data[4096];                /* Up to 4096 bytes                    */
 #else
   uint8_t data[8];                   /* Single Frame = 8 bytes              */
 #endif
+
+  /* Outstanding requests, looked up by (mode, PID) */
+
+  struct obd_req_s reqs[CONFIG_LIBOBD2_MAX_REQUESTS];
+  uint8_t reqhash[OBD_REQ_HASH_SIZE]; /* First request of each chain        */
+  uint8_t nreqs;                     /* Number of outstanding requests      */
+
+#ifdef CONFIG_LIBOBD2_MULTIFRAME
+  /* ISO-TP reassembly of a multi-frame response into data[1..] */
+
+  uint32_t isotp_id;                 /* CAN ID of the sending ECU           */
+  uint16_t isotp_len;                /* Total payload length                */
+  uint16_t isotp_pos;                /* Payload bytes received so far       */
+  uint8_t  isotp_req;                /* Request slot the response is for    */
+  uint8_t  isotp_seq;                /* Next expected sequence number       */
+  bool     isotp_busy;               /* Reassembly in progress              */
+#endif
 };
 
 /****************************************************************************
@@ -112,6 +180,11 @@ int obd_send_request(FAR struct obd_dev_s *dev, uint8_t opmode, uint8_t pid);
  *   It will return an error case it doesn't receive the msg after the elapsed
  *   "timeout" time.
  *
+ *   On success the response is in dev->data.  With
+ *   CONFIG_LIBOBD2_MULTIFRAME, dev->data is not updated for a single frame
+ *   response that arrives while a multi-frame response is being
+ *   reassembled; use obd_expect_response() to receive such responses.
+ *
  ****************************************************************************/
 
 int obd_wait_response(FAR struct obd_dev_s *dev, uint8_t opmode, uint8_t pid,
@@ -129,4 +202,69 @@ int obd_wait_response(FAR struct obd_dev_s *dev, uint8_t opmode, uint8_t pid,
 
 FAR char *obd_decode_pid(FAR struct obd_dev_s *dev, uint8_t pid);
 
+/****************************************************************************
+ * Name: obd_submit_request
+ *
+ * Description:
+ *   Send a "Request Message" for the PID and return without waiting.
+ *   callback is invoked from obd_process() when the response arrives or
+ *   after timeout milliseconds.  Several requests for different PIDs can
+ *   be outstanding at once; responses are matched on mode and PID, so only
+ *   modes that echo the PID (e.g. OBD_SHOW_DATA, OBD_RQST_VEHICLE_INFO)
+ *   can be used.
+ *
+ *   Returns OK, -EBUSY if the same mode and PID is already outstanding,
+ *   -ENOMEM if CONFIG_LIBOBD2_MAX_REQUESTS requests are outstanding, or
+ *   the error from obd_send_request().
+ *
+ ****************************************************************************/
+
+int obd_submit_request(FAR struct obd_dev_s *dev, uint8_t opmode,
+                       uint8_t pid, int timeout, obd_callback_t callback,
+                       FAR void *arg);
+
+/****************************************************************************
+ * Name: obd_expect_response
+ *
+ * Description:
+ *   Like obd_submit_request() but for a request that was already sent with
+ *   obd_send_request().
+ *
+ ****************************************************************************/
+
+int obd_expect_response(FAR struct obd_dev_s *dev, uint8_t opmode,
+                        uint8_t pid, int timeout, obd_callback_t callback,
+                        FAR void *arg);
+
+/****************************************************************************
+ * Name: obd_cancel_request
+ *
+ * Description:
+ *   Forget an outstanding request without calling its callback.
+ *
+ *   Returns OK or -ENOENT if no request for the mode and PID is
+ *   outstanding.
+ *
+ ****************************************************************************/
+
+int obd_cancel_request(FAR struct obd_dev_s *dev, uint8_t opmode,
+                       uint8_t pid);
+
+/****************************************************************************
+ * Name: obd_process
+ *
+ * Description:
+ *   Wait up to timeout milliseconds for CAN traffic with poll(), dispatch
+ *   all received responses to their requests and expire the requests that
+ *   timed out.  A negative timeout waits until the next request expires.
+ *   The wait never outlasts the next expiry, and returns as soon as
+ *   any frame has been received.
+ *
+ *   Returns the number of requests still outstanding or a negated errno
+ *   value.
+ *
+ ****************************************************************************/
+
+int obd_process(FAR struct obd_dev_s *dev, int timeout);
+
 #endif /*__APPS_INCLUDE_CANUTILS_OBD_H */
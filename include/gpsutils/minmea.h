@@ -54,6 +54,12 @@
 
 #define MINMEA_MAX_LENGTH 80
 
+/* Fields recorded by minmea_tokenize(), including the "$xxXXX" field.
+ * GSV, the widest supported sentence, has 20.
+ */
+
+#define MINMEA_MAX_FIELDS 32
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -191,6 +197,41 @@ struct minmea_sentence_gsv
   struct minmea_sat_info  sats[4];
 };
 
+/* A sentence split into fields by minmea_tokenize().  Field i spans
+ * sentence[start[i]] up to the delimiter at sentence[start[i + 1] - 1].
+ * Field 0 is the "$" followed by the talker and sentence type.  If a
+ * sentence has more than MINMEA_MAX_FIELDS fields, the last field runs
+ * to the end of the sentence.
+ */
+
+struct minmea_tokens
+{
+  FAR const char          *sentence;
+  enum minmea_sentence_id  id;
+  char                     type[6];  /* Talker and type, e.g. "GPRMC" */
+  uint8_t                  nfields;
+  uint8_t                  start[MINMEA_MAX_FIELDS + 1];
+};
+
+/* Receives each valid sentence assembled by minmea_stream_feed().  The
+ * tokens and the sentence they refer to are only valid during the call.
+ */
+
+typedef CODE void (*minmea_callback_t)(FAR const struct minmea_tokens *tokens,
+                                       FAR void *arg);
+
+/* Line assembly state for minmea_stream_feed() */
+
+struct minmea_stream
+{
+  char      line[MINMEA_MAX_LENGTH + 4];
+  uint8_t   len;                     /* Characters in line */
+  bool      overflow;                /* Line too long, skip to newline */
+  bool      strict;                  /* Require checksums */
+  uint32_t  sentences;               /* Valid sentences delivered */
+  uint32_t  errors;                  /* Lines rejected */
+};
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -239,6 +280,39 @@ bool minmea_parse_gll(struct minmea_sentence_gll *frame, const char *sentence);
 bool minmea_parse_gst(struct minmea_sentence_gst *frame, const char *sentence);
 bool minmea_parse_gsv(struct minmea_sentence_gsv *frame, const char *sentence);
 
+/* Validate, checksum and split a sentence into fields in a single pass and
+ * identify its type.  Returns true for valid sentences; unsupported types
+ * are valid with id MINMEA_UNKNOWN.
+ */
+
+bool minmea_tokenize(FAR struct minmea_tokens *tokens,
+                     FAR const char *sentence, bool strict);
+
+/* Decode a tokenized sentence of a specific type. Return true on success. */
+
+bool minmea_decode_rmc(FAR struct minmea_sentence_rmc *frame,
+                       FAR const struct minmea_tokens *tokens);
+bool minmea_decode_gga(FAR struct minmea_sentence_gga *frame,
+                       FAR const struct minmea_tokens *tokens);
+bool minmea_decode_gsa(FAR struct minmea_sentence_gsa *frame,
+                       FAR const struct minmea_tokens *tokens);
+bool minmea_decode_gll(FAR struct minmea_sentence_gll *frame,
+                       FAR const struct minmea_tokens *tokens);
+bool minmea_decode_gst(FAR struct minmea_sentence_gst *frame,
+                       FAR const struct minmea_tokens *tokens);
+bool minmea_decode_gsv(FAR struct minmea_sentence_gsv *frame,
+                       FAR const struct minmea_tokens *tokens);
+
+/* Assemble sentences from raw serial data.  buf may hold any part of the
+ * stream; every complete and valid sentence is tokenized and passed to
+ * callback.  Returns the number of sentences delivered.
+ */
+
+void minmea_stream_init(FAR struct minmea_stream *stream, bool strict);
+int minmea_stream_feed(FAR struct minmea_stream *stream,
+                       FAR const char *buf, size_t len,
+                       minmea_callback_t callback, FAR void *arg);
+
 /* Convert GPS UTC date/time representation to a UNIX timestamp. */
 
 int minmea_gettime(FAR struct timespec *ts,
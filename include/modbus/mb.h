@@ -130,6 +130,56 @@ typedef enum
   MB_ETIMEDOUT                /* timeout error occurred. */
 } eMBErrorCode;
 
+/* A Modbus slave instance.
+ *
+ * Every instance has its own serial port, frame state machine, function
+ * handler table, register callbacks and statistics, so several buses can be
+ * served from one task with eMBPollInstances().  The eMB*() functions
+ * without an instance argument operate on a built-in default instance, see
+ * pxMBGetDefaultInstance().
+ */
+
+typedef struct mb_instance_s xMBInstance;
+
+/* Function handler that is told which instance received the request. */
+
+typedef eMBException (*pxMBInstFunctionHandler)(xMBInstance *pxInst,
+                                                uint8_t *pucFrame,
+                                                uint16_t *pusLength);
+
+/* Per-instance register callbacks.
+ *
+ * They have the semantics of eMBRegInputCB(), eMBRegHoldingCB(),
+ * eMBRegCoilsCB() and eMBRegDiscreteCB() and additionally receive the
+ * argument given to eMBInstanceSetRegCB().  A NULL callback makes the
+ * corresponding requests fail with ILLEGAL DATA ADDRESS.
+ */
+
+typedef struct
+{
+  eMBErrorCode (*peInput)(void *pvArg, uint8_t *pucRegBuffer,
+                          uint16_t usAddress, uint16_t usNRegs);
+  eMBErrorCode (*peHolding)(void *pvArg, uint8_t *pucRegBuffer,
+                            uint16_t usAddress, uint16_t usNRegs,
+                            eMBRegisterMode eMode);
+  eMBErrorCode (*peCoils)(void *pvArg, uint8_t *pucRegBuffer,
+                          uint16_t usAddress, uint16_t usNCoils,
+                          eMBRegisterMode eMode);
+  eMBErrorCode (*peDiscrete)(void *pvArg, uint8_t *pucRegBuffer,
+                             uint16_t usAddress, uint16_t usNDiscrete);
+} xMBRegCallbacks;
+
+/* Per-instance bus statistics, see eMBInstanceGetStatistics(). */
+
+typedef struct
+{
+  uint32_t ulFramesReceived;  /* Valid frames for this slave or broadcast */
+  uint32_t ulFramesIgnored;   /* Valid frames for other slaves */
+  uint32_t ulFrameErrors;     /* Frames with bad length or CRC/LRC */
+  uint32_t ulExceptions;      /* Exception responses sent */
+  uint32_t ulFramesSent;      /* Responses passed to the transmitter */
+} xMBStatistics;
+
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
@@ -438,6 +488,161 @@ eMBErrorCode eMBRegCoilsCB(uint8_t *pucRegBuffer, uint16_t usAddress,
 eMBErrorCode eMBRegDiscreteCB(uint8_t *pucRegBuffer, uint16_t usAddress,
                               uint16_t usNDiscrete);
 
+/* Multi-instance interface.
+ *
+ * The following functions take the instance they operate on.  They behave
+ * like their counterparts without an instance argument, which are
+ * equivalent to calling them with pxMBGetDefaultInstance().  Modbus TCP
+ * is only available on the default instance (eMBTCPInit()) because the TCP
+ * port layer provides a single server.
+ *
+ *   xMBInstance *apxBus[2];
+ *
+ *   eMBInstanceInit(&apxBus[0], MB_RTU, 0x0A, 1, 38400, MB_PAR_EVEN);
+ *   eMBInstanceInit(&apxBus[1], MB_RTU, 0x0B, 2, 19200, MB_PAR_NONE);
+ *   eMBInstanceSetRegCB(apxBus[0], &xBus0Callbacks, &xBus0Data);
+ *   eMBInstanceSetRegCB(apxBus[1], &xBus1Callbacks, &xBus1Data);
+ *   eMBInstanceEnable(apxBus[0]);
+ *   eMBInstanceEnable(apxBus[1]);
+ *   for(;;)
+ *     {
+ *       eMBPollInstances(apxBus, 2);
+ *     }
+ */
+
+/* Return the instance used by eMBInit(), eMBPoll() etc. */
+
+xMBInstance *pxMBGetDefaultInstance(void);
+
+/* Allocate and initialize a new serial (RTU or ASCII) instance.
+ *
+ * Input Parameters:
+ *   ppxInst Location that receives the new instance.
+ *   Others as eMBInit().
+ *
+ * Returned Value:
+ *   As eMBInit().  Additionally eMBErrorCode::MB_ENORES if no memory is
+ *   available and eMBErrorCode::MB_EINVAL for MB_TCP.  Nothing is
+ *   allocated on error.
+ */
+
+eMBErrorCode eMBInstanceInit(xMBInstance **ppxInst, eMBMode eMode,
+                             uint8_t ucSlaveAddress, uint8_t ucPort,
+                             speed_t ulBaudRate, eMBParity eParity);
+
+/* Close the port of a disabled instance and free it.  The default instance
+ * is only closed, never freed.
+ */
+
+eMBErrorCode eMBInstanceClose(xMBInstance *pxInst);
+eMBErrorCode eMBInstanceEnable(xMBInstance *pxInst);
+eMBErrorCode eMBInstanceDisable(xMBInstance *pxInst);
+eMBErrorCode eMBInstancePoll(xMBInstance *pxInst);
+
+/* Poll several instances from one task.
+ *
+ * Waits until one of the enabled instances has input, a timer expiring or
+ * an event queued, then lets every enabled instance process one event.
+ * Instances that are not enabled are skipped.
+ *
+ * Returned Value:
+ *   eMBErrorCode::MB_ENOERR, or eMBErrorCode::MB_EPORTERR if waiting for
+ *   the ports failed.
+ */
+
+eMBErrorCode eMBPollInstances(xMBInstance *const *ppxInst, int iCount);
+
+eMBErrorCode eMBInstanceSetSlaveID(xMBInstance *pxInst, uint8_t ucSlaveID,
+                                   bool xIsRunning,
+                                   uint8_t const *pucAdditional,
+                                   uint16_t usAdditionalLen);
+
+/* Register a function handler for one instance only.  Handlers added with
+ * eMBRegisterCB() belong to the default instance.
+ */
+
+eMBErrorCode eMBInstanceRegisterCB(xMBInstance *pxInst,
+                                   uint8_t ucFunctionCode,
+                                   pxMBInstFunctionHandler pxHandler);
+
+/* Set the register callbacks of an instance and the argument passed to
+ * them.  New instances use the global eMBReg*CB() functions until this is
+ * called.
+ */
+
+eMBErrorCode eMBInstanceSetRegCB(xMBInstance *pxInst,
+                                 const xMBRegCallbacks *pxCallbacks,
+                                 void *pvArg);
+
+/* Return the argument set with eMBInstanceSetRegCB(), e.g. for use in a
+ * pxMBInstFunctionHandler.
+ */
+
+void *pvMBInstanceGetArg(xMBInstance *pxInst);
+
+/* Copy the statistics of an instance, optionally clearing them. */
+
+eMBErrorCode eMBInstanceGetStatistics(xMBInstance *pxInst,
+                                      xMBStatistics *pxStats, bool bClear);
+
+#ifdef CONFIG_MB_REGMAP
+/* Register map.
+ *
+ * A register map binds ranges of holding or input registers to application
+ * memory.  Requests that fall entirely inside mapped ranges are served by
+ * the function handlers with a bulk copy and the register callbacks are not
+ * called; any other request still goes to the callbacks.  The map and the
+ * memory it points to are used in place, not copied, and must stay valid
+ * while they are installed.
+ *
+ *   static uint16_t ausMeasurements[125];
+ *   static const xMBRegMapEntry axInputMap[] =
+ *   {
+ *     { 1, 125, ausMeasurements, MB_REGMAP_READ_ONLY }
+ *   };
+ *
+ *   eMBSetRegMap(MB_REGMAP_INPUT, axInputMap, 1);
+ */
+
+#define MB_REGMAP_READ_ONLY  0x01 /* Writes are answered with ILLEGAL DATA ADDRESS */
+#define MB_REGMAP_BIG_ENDIAN 0x02 /* Data is in wire (big-endian) byte order */
+
+typedef enum
+{
+  MB_REGMAP_HOLDING,
+  MB_REGMAP_INPUT,
+  MB_REGMAP_NTYPES
+} eMBRegMapType;
+
+typedef struct
+{
+  uint16_t usAddress;         /* First register, numbered as in eMBReg*CB() */
+  uint16_t usNRegs;           /* Number of registers */
+  void *pvData;               /* usNRegs 16 bit words */
+  uint8_t ucFlags;            /* MB_REGMAP_* */
+} xMBRegMapEntry;
+
+/* Install a register map for holding or input registers.
+ *
+ * Input Parameters:
+ *   pxInst The instance.
+ *   eType Which register table the map covers.
+ *   pxMap Entries sorted by address and not overlapping, or NULL to remove
+ *     the map.
+ *   usEntries Number of entries.
+ *
+ * Returned Value:
+ *   eMBErrorCode::MB_ENOERR or eMBErrorCode::MB_EINVAL if the entries are
+ *   not sorted, overlap or wrap around the register address space.
+ */
+
+eMBErrorCode eMBInstanceSetRegMap(xMBInstance *pxInst, eMBRegMapType eType,
+                                  const xMBRegMapEntry *pxMap,
+                                  uint16_t usEntries);
+eMBErrorCode eMBSetRegMap(eMBRegMapType eType, const xMBRegMapEntry *pxMap,
+                          uint16_t usEntries);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
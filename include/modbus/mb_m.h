@@ -459,6 +459,147 @@ bool xMBMasterRequestIsBroadcast(void);
 eMBMasterErrorEventType eMBMasterGetErrorType(void);
 void vMBMasterSetErrorType(eMBMasterErrorEventType errorType);
 eMBMasterReqErrCode eMBMasterWaitRequestFinish(void);
+void vMBMasterPolledRequest(void);
+bool xMBMasterRequestFinished(eMBMasterReqErrCode *peErrStatus);
+
+#ifdef CONFIG_MB_MASTER_SCHEDULER
+
+/****************************************************************************
+ * Master request scheduler
+ *
+ * The scheduler keeps a table of periodic polls and a queue of one-shot
+ * requests and issues them back to back from the master poll task, so the
+ * application never blocks on a single request.  Responses are still
+ * delivered through eMBMasterReg*CB(); the completion callback only
+ * reports the outcome.
+ *
+ *   eMBMasterInit(MB_RTU, 1, 19200, MB_PAR_EVEN);
+ *   eMBMasterSchedInit();
+ *   eMBMasterSchedAddPoll(5, MB_FUNC_READ_HOLDING_REGISTER, 0, 10, 100,
+ *                         NULL, NULL, NULL);
+ *   eMBMasterEnable();
+ *   for (;;)
+ *     {
+ *       eMBMasterSchedPoll();
+ *     }
+ *
+ ****************************************************************************/
+
+/* Called on the master poll task when a request or poll has finished.
+ * Polls of a slave that is backing off are reported as MB_MRE_TIMEDOUT
+ * without being sent.
+ */
+
+typedef void (*pvMBMasterSchedCB)(void *pvArg, uint8_t ucSlave,
+                                  eMBMasterReqErrCode eErrStatus);
+
+typedef struct
+{
+  uint32_t ulRequests;    /* Frames sent on the bus */
+  uint32_t ulCompleted;   /* Requests answered without error */
+  uint32_t ulErrors;      /* Exception responses and corrupted frames */
+  uint32_t ulTimeouts;    /* Requests without response */
+  uint32_t ulCoalesced;   /* Polls merged into another poll's request */
+  uint32_t ulSkipped;     /* Requests not sent to a backing off slave */
+  uint32_t ulBusyMs;      /* Time with a request in flight */
+  uint32_t ulElapsedMs;   /* Time covered by these statistics */
+} xMBMasterSchedStats;
+
+/****************************************************************************
+ * Description:
+ *   Initialize the request scheduler.  Must be called after
+ *   eMBMasterInit() and before any other eMBMasterSched*() function.
+ *
+ ****************************************************************************/
+
+eMBErrorCode eMBMasterSchedInit(void);
+
+/****************************************************************************
+ * Description:
+ *   Register a periodic read.  Due polls of the same slave and function
+ *   whose register ranges touch (or are at most
+ *   CONFIG_MB_MASTER_SCHED_COALESCE_GAP apart) are merged into a single
+ *   request.
+ *
+ * Input Parameters:
+ *   ucSlave Slave address, 1 - CONFIG_MB_MASTER_TOTAL_SLAVE_NUM.
+ *   ucFunction MB_FUNC_READ_COILS, MB_FUNC_READ_DISCRETE_INPUTS,
+ *     MB_FUNC_READ_HOLDING_REGISTER or MB_FUNC_READ_INPUT_REGISTER.
+ *   usRegAddr First register (protocol address, starting at 0).
+ *   usNRegs Number of registers or bits.
+ *   ulPeriodMs Poll period.
+ *   pvCB Completion callback, may be NULL.
+ *   pvArg Argument passed to pvCB.
+ *   piHandle Returns the handle for eMBMasterSchedRemovePoll(), may be
+ *     NULL.
+ *
+ * Returned Value:
+ *   MB_ENOERR, MB_EINVAL for a bad argument or MB_ENORES if the poll table
+ *   is full.
+ *
+ ****************************************************************************/
+
+eMBErrorCode eMBMasterSchedAddPoll(uint8_t ucSlave, uint8_t ucFunction,
+                                   uint16_t usRegAddr, uint16_t usNRegs,
+                                   uint32_t ulPeriodMs,
+                                   pvMBMasterSchedCB pvCB, void *pvArg,
+                                   int *piHandle);
+
+eMBErrorCode eMBMasterSchedRemovePoll(int iHandle);
+
+/****************************************************************************
+ * Description:
+ *   Queue a one-shot request.  Queued requests are sent before due polls.
+ *   Supported functions are the four reads, MB_FUNC_WRITE_SINGLE_COIL,
+ *   MB_FUNC_WRITE_REGISTER and MB_FUNC_WRITE_MULTIPLE_REGISTERS with up to
+ *   CONFIG_MB_MASTER_SCHED_WRITE_REGS_MAX registers.  Write requests may
+ *   use slave address 0 (broadcast).
+ *
+ * Input Parameters:
+ *   pusData Values to write, unused for reads.  For a single coil any
+ *     non-zero value switches the coil on.
+ *
+ * Returned Value:
+ *   MB_ENOERR, MB_EINVAL for a bad argument or MB_ENORES if the queue is
+ *   full.
+ *
+ ****************************************************************************/
+
+eMBErrorCode eMBMasterSchedSubmit(uint8_t ucSlave, uint8_t ucFunction,
+                                  uint16_t usRegAddr, uint16_t usNRegs,
+                                  const uint16_t *pusData,
+                                  pvMBMasterSchedCB pvCB, void *pvArg);
+
+/****************************************************************************
+ * Description:
+ *   Run the master stack and the scheduler.  Call this from the master
+ *   task in place of eMBMasterPoll().
+ *
+ ****************************************************************************/
+
+eMBErrorCode eMBMasterSchedPoll(void);
+
+/****************************************************************************
+ * Description:
+ *   Return the bus statistics.  ulBusyMs / ulElapsedMs is the bus
+ *   utilisation.  If bClear is true the counters are reset.
+ *
+ ****************************************************************************/
+
+eMBErrorCode eMBMasterSchedGetStats(xMBMasterSchedStats *pxStats,
+                                    bool bClear);
+
+/****************************************************************************
+ * Description:
+ *   Return the smoothed round trip time of a slave (0 if not measured yet)
+ *   and whether it is currently backing off after repeated timeouts.
+ *
+ ****************************************************************************/
+
+eMBErrorCode eMBMasterSchedGetSlaveInfo(uint8_t ucSlave, uint32_t *pulRttUs,
+                                        bool *pbDead);
+
+#endif /* CONFIG_MB_MASTER_SCHEDULER */
 
 #ifdef __cplusplus
 }
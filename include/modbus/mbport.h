@@ -94,21 +94,11 @@ typedef enum
  * Public Data
  ****************************************************************************/
 
-/* Callback function for the porting layer when a new byte is available.
- *
- * Depending upon the mode this callback function is used by the RTU or
- * ASCII transmission layers. In any case a call to xMBPortSerialGetByte()
- * must immediately return a new character.
- *
- * Return true if a event was posted to the queue because a new byte was
- * received. The port implementation should wake up the tasks which are
- * currently blocked on the eventqueue.
+/* The slave callbacks for the porting layer (byte received, transmitter
+ * empty, timer expired and their block variants) are kept per instance,
+ * see modbus/nuttx/mbinstance.h.
  */
 
-extern bool(*pxMBFrameCBByteReceived)(void);
-extern bool(*pxMBFrameCBTransmitterEmpty)(void);
-extern bool(*pxMBPortCBTimerExpired)(void);
-
 extern bool(*pxMBMasterFrameCBByteReceived)(void);
 extern bool(*pxMBMasterFrameCBTransmitterEmpty)(void);
 extern bool(*pxMBMasterPortCBTimerExpired)(void);
@@ -117,7 +107,9 @@ extern bool(*pxMBMasterPortCBTimerExpired)(void);
  * Public Function Prototypes
  ****************************************************************************/
 
-/* Supporting functions */
+/* Supporting functions.  The slave (non-master) functions below operate on
+ * the default instance, see pxMBGetDefaultInstance().
+ */
 
 bool xMBPortEventInit(void);
 bool xMBPortEventPost(eMBEventType eEvent);
@@ -161,6 +153,7 @@ void xMBMasterPortTimersClose(void);
 void vMBMasterPortTimersT35Enable(void);
 void vMBMasterPortTimersConvertDelayEnable(void);
 void vMBMasterPortTimersRespondTimeoutEnable(void);
+void vMBMasterPortTimersSetRespondTimeout(uint32_t ulTimeOutMs);
 void vMBMasterPortTimersDisable(void);
 
 /* Callback for the master error process */
@@ -104,6 +104,20 @@ void xMBUtilSetBits(uint8_t *ucByteBuf, uint16_t usBitOffset,
 
 uint8_t xMBUtilGetBits(uint8_t *ucByteBuf, uint16_t usBitOffset, uint8_t ucNBits);
 
+/* Copy 16 bit registers between host byte order and the big-endian byte
+ * order used in Modbus frames.
+ *
+ * Input Parameters:
+ *  pucDst/pusDst Destination, need not be aligned for the frame side.
+ *  pusSrc/pucSrc Source.
+ *  usNRegs Number of registers to copy.
+ */
+
+void vMBUtilRegsToFrame(uint8_t *pucDst, const uint16_t *pusSrc,
+                        uint16_t usNRegs);
+void vMBUtilRegsFromFrame(uint16_t *pusDst, const uint8_t *pucSrc,
+                          uint16_t usNRegs);
+
 #ifdef __cplusplus
 }
 #endif
@@ -55,6 +55,9 @@ extern "C"
 #define cJSON_Object 6
 
 #define cJSON_IsReference 256
+#define cJSON_IsInSitu    512   /* Strings point into the parsed text */
+#define cJSON_IsPooled    1024  /* Node and strings live in a parse pool */
+#define cJSON_KeyIsOwned  2048  /* Pooled or in-situ node with a heap key */
 
 #define cJSON_AddNullToObject(object,name) \
   cJSON_AddItemToObject(object, name, cJSON_CreateNull())
@@ -119,6 +122,28 @@ void cJSON_InitHooks(cJSON_Hooks* hooks);
 
 cJSON *cJSON_Parse(const char *value);
 
+/* Parse with every node and string allocated from the caller-provided
+ * memory "pool" of "size" bytes instead of the malloc hook.  The whole
+ * tree is released at once by discarding the pool; cJSON_Delete() is not
+ * needed (but is harmless), except that pooled items given a new key with
+ * cJSON_AddItemToObject() or cJSON_ReplaceItemInObject() hold a heap copy
+ * of it that only cJSON_Delete() frees.  Returns NULL on a syntax error or
+ * if the pool is too small.  If "used" is not NULL, the number of pool
+ * bytes consumed is returned there, also on failure.
+ */
+
+cJSON *cJSON_ParseWithPool(const char *value, void *pool, size_t size,
+                           size_t *used);
+
+/* Parse in-situ:  Strings are unescaped in place in "value", which is
+ * modified and must remain valid for the lifetime of the tree.  Nodes are
+ * allocated from "pool" as with cJSON_ParseWithPool() or, if "pool" is
+ * NULL, with the malloc hook (then release the tree with cJSON_Delete()).
+ */
+
+cJSON *cJSON_ParseInSitu(char *value, void *pool, size_t size,
+                         size_t *used);
+
 /* Render a cJSON entity to text for transfer/storage. Free the char* when
  * finished.
  */
@@ -66,6 +66,15 @@
  *     transfers.  Default: 512 bytes.
  *   CONFIG_FTPD_WORKERSTACKSIZE - The stacksize to allocate for each
  *     FTP daemon worker thread.  Default:  2048 bytes.
+ *   CONFIG_FTPD_SENDFILE - Use sendfile() for binary RETR transfers.
+ *   CONFIG_FTPD_SENDFILE_CHUNKSIZE - The maximum size of one sendfile()
+ *     call.  Default: 16384 bytes.
+ *   CONFIG_FTPD_STORTHREAD - Double-buffer binary STOR/APPE transfers and
+ *     write the file from a helper thread.
+ *   CONFIG_FTPD_WRITERSTACKSIZE - The stacksize of the STOR writer thread.
+ *     Default: 1024 bytes.
+ *   CONFIG_FTPD_XFERREPORT - Report the size, time and throughput of each
+ *     transfer in the 226 reply.
  */
 
 #ifdef CONFIG_DISABLE_PTHREAD
@@ -0,0 +1,184 @@
+/****************************************************************************
+ * apps/include/netutils/json_writer.h
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_INCLUDE_NETUTILS_JSON_WRITER_H
+#define __APPS_INCLUDE_NETUTILS_JSON_WRITER_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+/* Configuration ************************************************************/
+/* CONFIG_NETUTILS_JSON_WRITER_MAXDEPTH - The maximum nesting depth of
+ *   objects and arrays.  The nesting state is kept in two 32-bit masks, so
+ *   the maximum is 32.
+ */
+
+#ifndef CONFIG_NETUTILS_JSON_WRITER_MAXDEPTH
+#  define CONFIG_NETUTILS_JSON_WRITER_MAXDEPTH 16
+#endif
+
+#if CONFIG_NETUTILS_JSON_WRITER_MAXDEPTH > 32
+#  error CONFIG_NETUTILS_JSON_WRITER_MAXDEPTH may not exceed 32
+#endif
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* The state of one streaming JSON writer.  The output is emitted directly
+ * into 'buffer'.  If 'fd' is a valid descriptor (a file or a socket), the
+ * buffer is written to it whenever it fills up and by json_writer_finish();
+ * otherwise the whole document must fit into the buffer.
+ *
+ * No memory is allocated.  The nesting state is one bit per level.
+ */
+
+struct json_writer_s
+{
+  FAR char *buffer;      /* Output buffer */
+  size_t    size;        /* Size of the output buffer */
+  size_t    len;         /* Number of bytes in the output buffer */
+  size_t    total;       /* Total number of bytes emitted */
+  int       fd;          /* Output descriptor, or -1 for buffer only */
+  int       error;       /* First error (negated errno), sticky */
+  uint32_t  isarray;     /* Bit n set: level n is an array */
+  uint32_t  hasitems;    /* Bit n set: level n already has a member */
+  uint8_t   depth;       /* Current nesting depth */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: json_writer_init
+ *
+ * Description:
+ *   Initialize a writer that emits into 'buffer' and, if 'fd' >= 0,
+ *   drains the buffer to 'fd'.
+ *
+ ****************************************************************************/
+
+void json_writer_init(FAR struct json_writer_s *writer, FAR char *buffer,
+                      size_t size, int fd);
+
+/****************************************************************************
+ * Name: json_writer_begin_object, json_writer_begin_array,
+ *      json_writer_end_object, json_writer_end_array
+ *
+ * Description:
+ *   Open or close an object or array.  'name' is the member name if the
+ *   enclosing level is an object and must be NULL otherwise.
+ *
+ ****************************************************************************/
+
+int json_writer_begin_object(FAR struct json_writer_s *writer,
+                             FAR const char *name);
+int json_writer_end_object(FAR struct json_writer_s *writer);
+int json_writer_begin_array(FAR struct json_writer_s *writer,
+                            FAR const char *name);
+int json_writer_end_array(FAR struct json_writer_s *writer);
+
+/****************************************************************************
+ * Name: json_writer_string, json_writer_int, json_writer_fixed,
+ *       json_writer_bool, json_writer_null
+ *
+ * Description:
+ *   Emit one value.  json_writer_fixed() emits 'value' with 'decimals'
+ *   (0-9) fractional digits without using the floating point printf
+ *   support; NaN and infinity are emitted as null.
+ *
+ ****************************************************************************/
+
+int json_writer_string(FAR struct json_writer_s *writer,
+                       FAR const char *name, FAR const char *value);
+int json_writer_int(FAR struct json_writer_s *writer, FAR const char *name,
+                    long value);
+int json_writer_fixed(FAR struct json_writer_s *writer,
+                      FAR const char *name, double value, int decimals);
+int json_writer_bool(FAR struct json_writer_s *writer, FAR const char *name,
+                     bool value);
+int json_writer_null(FAR struct json_writer_s *writer, FAR const char *name);
+
+/****************************************************************************
+ * Name: json_writer_flush
+ *
+ * Description:
+ *   Write any buffered output to the descriptor.  Does nothing for a
+ *   buffer-only writer.
+ *
+ ****************************************************************************/
+
+int json_writer_flush(FAR struct json_writer_s *writer);
+
+/****************************************************************************
+ * Name: json_writer_finish
+ *
+ * Description:
+ *   Complete the document.  All objects and arrays must have been closed.
+ *   A buffer-only writer NUL-terminates the buffer; a descriptor writer
+ *   flushes it.
+ *
+ * Returned Value:
+ *   The total length of the document on success; a negated errno value on
+ *   any error during the whole document (-ENOSPC: buffer too small,
+ *   -EINVAL: unbalanced nesting or misplaced member name, -E2BIG: nesting
+ *   too deep, or the error from write()).
+ *
+ ****************************************************************************/
+
+ssize_t json_writer_finish(FAR struct json_writer_s *writer);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __APPS_INCLUDE_NETUTILS_JSON_WRITER_H */
@@ -51,6 +51,10 @@
  *
  *   CONFIG_NETUTILS_PPPD_PAP - PPPD PAP authentication support
  *     Default: n
+ *   CONFIG_NETUTILS_PPPD_AHDLC_CRCTABLE - Table-driven AHDLC FCS
+ *     Default: y
+ *   CONFIG_NETUTILS_PPPD_AHDLC_BENCH - Build ahdlc_benchmark()
+ *     Default: n
  */
 
 #define TTYNAMSIZ               16
@@ -112,6 +116,27 @@ extern "C"
 
 int pppd(const struct pppd_settings_s *ppp_settings);
 
+#ifdef CONFIG_NETUTILS_PPPD_AHDLC_BENCH
+/****************************************************************************
+ * Name: ahdlc_benchmark
+ *
+ * Description:
+ *   Measure the AHDLC FCS, receive and transmit paths on synthetic IPv4
+ *   frames and print the throughput of each.  Transmitted frames are
+ *   written to /dev/null.
+ *
+ * Input Parameters:
+ *    iterations, number of frames per test (<= 0 selects a default)
+ *
+ * Returned Value:
+ *   OK on success, a negated errno value if a decoded frame does not match
+ *   the payload or resources could not be allocated
+ *
+ ****************************************************************************/
+
+int ahdlc_benchmark(int iterations);
+#endif
+
 #undef EXTERN
 #ifdef __cplusplus
 }
@@ -0,0 +1,191 @@
+/****************************************************************************
+ * apps/include/system/elasync.h
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_INCLUDE_SYSTEM_ELASYNC_H
+#define __APPS_INCLUDE_SYSTEM_ELASYNC_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+
+#include <embedlog.h>
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* The asynchronous sink.  Log calls go into per-thread rings without
+ * blocking and a low priority writer thread passes them on to an embedlog
+ * object, which does the (slow) output to files, a tty or stderr.
+ */
+
+struct elasync_s;
+
+/* A ring that belongs to one thread.  Only that thread may log into it. */
+
+struct elasync_ring_s;
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: elasync_start
+ *
+ * Description:
+ *   Start the writer thread.  Messages are written with el_oputs(), so the
+ *   outputs of 'el' must be set up by the caller, and 'el' must not be used
+ *   by anybody else until elasync_stop() returns.
+ *
+ * Input Parameters:
+ *   el    - The embedlog object that does the output
+ *   level - Messages with a higher (less important) level are discarded
+ *           before they are queued
+ *
+ * Returned Value:
+ *   The sink on success; NULL on failure with errno set.
+ *
+ ****************************************************************************/
+
+FAR struct elasync_s *elasync_start(FAR struct el_options *el,
+                                    enum el_level level);
+
+/****************************************************************************
+ * Name: elasync_stop
+ *
+ * Description:
+ *   Write all queued messages, stop the writer thread and free the sink and
+ *   all of its rings.  No thread may log while or after this runs.
+ *
+ * Returned Value:
+ *   OK on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int elasync_stop(FAR struct elasync_s *log);
+
+/****************************************************************************
+ * Name: elasync_ring
+ *
+ * Description:
+ *   Allocate a ring for the calling thread.  This takes a lock and
+ *   allocates memory, so do it before entering a time critical loop.
+ *
+ * Input Parameters:
+ *   log  - The sink
+ *   size - Size of the ring in bytes, rounded up to a power of two.  Each
+ *          message takes its length plus about 20 bytes.
+ *
+ * Returned Value:
+ *   The ring on success; NULL on failure with errno set.
+ *
+ ****************************************************************************/
+
+FAR struct elasync_ring_s *elasync_ring(FAR struct elasync_s *log,
+                                        size_t size);
+
+/****************************************************************************
+ * Name: elasync_release
+ *
+ * Description:
+ *   Give up a ring.  The writer frees it after it has written the messages
+ *   that are still in it.  The ring must not be used afterwards.
+ *
+ ****************************************************************************/
+
+void elasync_release(FAR struct elasync_ring_s *ring);
+
+/****************************************************************************
+ * Name: elasync_print
+ *
+ * Description:
+ *   Format a message and queue it with the current time.  This never
+ *   blocks:  if the ring is full, the message is dropped and counted, and
+ *   the writer reports the number of lost messages.
+ *
+ * Returned Value:
+ *   OK if the message was queued or filtered out by its level; -ENOSPC if
+ *   it was dropped.
+ *
+ ****************************************************************************/
+
+int elasync_print(FAR struct elasync_ring_s *ring, enum el_level level,
+                  FAR const char *fmt, ...);
+
+#ifdef CONFIG_EMBEDLOG_ASYNC_DEFERRED
+/****************************************************************************
+ * Name: elasync_bprint
+ *
+ * Description:
+ *   Queue a message without formatting it.  Only the format pointer and
+ *   the arguments are copied; the writer formats the message later.  This
+ *   is much cheaper than elasync_print(), but:
+ *
+ *   - 'fmt' must stay valid until the message is written.  Use a string
+ *     literal.
+ *   - Only conversions of values no wider than a pointer are possible
+ *     (%d, %u, %x, %c, %p, %ld, ...).  No strings or floating point.
+ *   - Unused arguments are ignored; pass 0.
+ *
+ * Returned Value:
+ *   As for elasync_print().
+ *
+ ****************************************************************************/
+
+int elasync_bprint(FAR struct elasync_ring_s *ring, enum el_level level,
+                   FAR const char *fmt, uintptr_t arg0, uintptr_t arg1,
+                   uintptr_t arg2, uintptr_t arg3);
+#endif
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __APPS_INCLUDE_SYSTEM_ELASYNC_H */
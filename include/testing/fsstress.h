@@ -0,0 +1,111 @@
+/****************************************************************************
+ * apps/include/testing/fsstress.h
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_INCLUDE_TESTING_FSSTRESS_H
+#define __APPS_INCLUDE_TESTING_FSSTRESS_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stddef.h>
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: fsstress_options
+ *
+ * Description:
+ *   Parse the stress test options of a file system test:
+ *
+ *     -t <nthreads>  Number of threads; 0 selects the single-threaded
+ *                    test of the caller
+ *     -n <nops>      Operations per thread
+ *
+ *   The defaults come from CONFIG_TESTING_FSSTRESS_NTHREADS and
+ *   CONFIG_TESTING_FSSTRESS_NOPS.
+ *
+ * Returned Value:
+ *   OK on success; ERROR after printing the usage if the options are bad.
+ *
+ ****************************************************************************/
+
+int fsstress_options(int argc, FAR char *argv[], FAR int *nthreads,
+                     FAR int *nops);
+
+/****************************************************************************
+ * Name: fsstress_run
+ *
+ * Description:
+ *   Run 'nthreads' threads concurrently, each performing 'nops' random
+ *   reads, rewrites and deletes on its own set of files in the mounted
+ *   volume 'mountpt', then report the aggregate throughput and the latency
+ *   distribution of each operation in each thread.  The threads remove
+ *   their files when they are done.
+ *
+ * Input Parameters:
+ *   mountpt  - Directory to create the files in, without a trailing '/'
+ *   maxfile  - Maximum size of a file
+ *   nthreads - Number of threads, 1 to 99
+ *   nops     - Operations per thread
+ *
+ * Returned Value:
+ *   OK if no operation failed other than for lack of space; ERROR
+ *   otherwise.
+ *
+ ****************************************************************************/
+
+int fsstress_run(FAR const char *mountpt, size_t maxfile, int nthreads,
+                 int nops);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __APPS_INCLUDE_TESTING_FSSTRESS_H */
@@ -0,0 +1,133 @@
+/****************************************************************************
+ * apps/include/testing/latency.h
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_INCLUDE_TESTING_LATENCY_H
+#define __APPS_INCLUDE_TESTING_LATENCY_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Four histogram buckets per power of two cover the whole uint32_t range */
+
+#define LATENCY_NBUCKETS 128
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* Statistics of a series of samples.  The unit (microseconds, nanoseconds,
+ * ...) is up to the caller.  Clear the structure before the first sample.
+ */
+
+struct latency_s
+{
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t total;
+  uint32_t hist[LATENCY_NBUCKETS];
+};
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: latency_account
+ *
+ * Description:
+ *   Add one sample to the statistics.
+ *
+ ****************************************************************************/
+
+void latency_account(FAR struct latency_s *lat, uint32_t value);
+
+/****************************************************************************
+ * Name: latency_average
+ *
+ * Returned Value:
+ *   The average of all samples, or 0 if there are none.
+ *
+ ****************************************************************************/
+
+uint32_t latency_average(FAR const struct latency_s *lat);
+
+/****************************************************************************
+ * Name: latency_percentile
+ *
+ * Description:
+ *   Return the value that 'pct' percent of the samples do not exceed.  It
+ *   is the upper bound of a histogram bucket, which is at most 25% above
+ *   the exact percentile, but never above the largest sample.
+ *
+ ****************************************************************************/
+
+uint32_t latency_percentile(FAR const struct latency_s *lat, int pct);
+
+/****************************************************************************
+ * Name: latency_bucketmax
+ *
+ * Description:
+ *   Return the largest value counted in histogram bucket 'bucket', for
+ *   printing the histogram.
+ *
+ ****************************************************************************/
+
+uint32_t latency_bucketmax(int bucket);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __APPS_INCLUDE_TESTING_LATENCY_H */
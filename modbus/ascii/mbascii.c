@@ -44,6 +44,7 @@
 #include "modbus/mbframe.h"
 #include "modbus/mbport.h"
 
+#include "mbinstance.h"
 #include "mbascii.h"
 #include "mbcrc.h"
 
@@ -94,29 +95,7 @@ typedef enum
 static uint8_t prvucMBint8_t2BIN(uint8_t ucCharacter);
 static uint8_t prvucMBBIN2int8_t(uint8_t ucByte);
 static uint8_t prvucMBLRC(uint8_t *pucFrame, uint16_t usLen);
-
-/****************************************************************************
- * Private Data
- ****************************************************************************/
-
-static volatile eMBSndState eSndState;
-static volatile eMBRcvState eRcvState;
-
-/* We reuse the Modbus RTU buffer because only one buffer is needed and the
- * RTU buffer is bigger.
- */
-
-extern volatile uint8_t ucRTUBuf[];
-static volatile uint8_t *ucASCIIBuf = ucRTUBuf;
-
-static volatile uint16_t usRcvBufferPos;
-static volatile eMBBytePos eBytePos;
-
-static volatile uint8_t *pucSndBufferCur;
-static volatile uint16_t usSndBufferCount;
-
-static volatile uint8_t ucLRC;
-static volatile uint8_t ucMBLFCharacter;
+static bool prvxMBASCIIReceiveChar(xMBInstance *pxInst, uint8_t ucByte);
 
 /****************************************************************************
  * Private Functions
@@ -173,24 +152,154 @@ static uint8_t prvucMBLRC(uint8_t * pucFrame, uint16_t usLen)
   return ucLocalLRC;
 }
 
+static bool prvxMBASCIIReceiveChar(xMBInstance *pxInst, uint8_t ucByte)
+{
+  bool xNeedPoll = false;
+  uint8_t ucResult;
+
+  DEBUGASSERT(pxInst->eSndState == STATE_TX_IDLE);
+
+  switch (pxInst->eRcvState)
+    {
+    /* A new character is received. If the character is a ':' the input
+     * buffer is cleared. A CR-character signals the end of the data
+     * block. Other characters are part of the data block and their
+     * ASCII value is converted back to a binary representation.
+     */
+
+    case STATE_RX_RCV:
+      /* Enable timer for character timeout. */
+
+      vMBInstPortTimersEnable(pxInst);
+      if (ucByte == ':')
+        {
+          /* Empty receive buffer. */
+
+          pxInst->eBytePos = BYTE_HIGH_NIBBLE;
+          pxInst->usRcvBufferPos = 0;
+        }
+      else if (ucByte == MB_ASCII_DEFAULT_CR)
+        {
+          pxInst->eRcvState = STATE_RX_WAIT_EOF;
+        }
+      else
+        {
+          ucResult = prvucMBint8_t2BIN(ucByte);
+          switch (pxInst->eBytePos)
+          {
+          /* High nibble of the byte comes first. We check for
+           * a buffer overflow here.
+           */
+
+          case BYTE_HIGH_NIBBLE:
+            if (pxInst->usRcvBufferPos < MB_SER_PDU_SIZE_MAX)
+              {
+                pxInst->ucFrameBuf[pxInst->usRcvBufferPos] =
+                  (uint8_t)(ucResult << 4);
+                pxInst->eBytePos = BYTE_LOW_NIBBLE;
+                break;
+              }
+            else
+              {
+                /* not handled in Modbus specification but seems
+                 * a resonable implementation.
+                 */
+
+                pxInst->eRcvState = STATE_RX_IDLE;
+
+                /* Disable previously activated timer because of error state. */
+
+                vMBInstPortTimersDisable(pxInst);
+              }
+            break;
+
+          case BYTE_LOW_NIBBLE:
+            pxInst->ucFrameBuf[pxInst->usRcvBufferPos] |= ucResult;
+            pxInst->usRcvBufferPos++;
+            pxInst->eBytePos = BYTE_HIGH_NIBBLE;
+            break;
+          }
+        }
+        break;
+
+    case STATE_RX_WAIT_EOF:
+      if (ucByte == pxInst->ucMBLFCharacter)
+        {
+          /* Disable character timeout timer because all characters are
+           * received.
+           */
+
+          vMBInstPortTimersDisable(pxInst);
+
+           /* Receiver is again in idle state. */
+
+           pxInst->eRcvState = STATE_RX_IDLE;
+
+          /* Notify the caller of eMBASCIIReceive that a new frame
+           * was received.
+           */
+
+          xNeedPoll = xMBInstPortEventPost(pxInst, EV_FRAME_RECEIVED);
+        }
+      else if (ucByte == ':')
+        {
+          /* Empty receive buffer and back to receive state. */
+
+          pxInst->eBytePos = BYTE_HIGH_NIBBLE;
+          pxInst->usRcvBufferPos = 0;
+          pxInst->eRcvState = STATE_RX_RCV;
+
+          /* Enable timer for character timeout. */
+
+          vMBInstPortTimersEnable(pxInst);
+        }
+      else
+        {
+          /* Frame is not okay. Delete entire frame. */
+
+          pxInst->eRcvState = STATE_RX_IDLE;
+        }
+        break;
+
+    case STATE_RX_IDLE:
+      if (ucByte == ':')
+        {
+          /* Enable timer for character timeout. */
+
+          vMBInstPortTimersEnable(pxInst);
+
+          /* Reset the input buffers to store the frame. */
+
+          pxInst->usRcvBufferPos = 0;
+          pxInst->eBytePos = BYTE_HIGH_NIBBLE;
+          pxInst->eRcvState = STATE_RX_RCV;
+        }
+        break;
+    }
+
+  return xNeedPoll;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
-eMBErrorCode eMBASCIIInit(uint8_t ucSlaveAddress, uint8_t ucPort,
-                          speed_t ulBaudRate, eMBParity eParity)
+eMBErrorCode eMBASCIIInit(xMBInstance *pxInst, uint8_t ucSlaveAddress,
+                          uint8_t ucPort, speed_t ulBaudRate,
+                          eMBParity eParity)
 {
   eMBErrorCode eStatus = MB_ENOERR;
   (void)ucSlaveAddress;
 
   ENTER_CRITICAL_SECTION();
-  ucMBLFCharacter = MB_ASCII_DEFAULT_LF;
+  pxInst->ucMBLFCharacter = MB_ASCII_DEFAULT_LF;
 
-  if (xMBPortSerialInit(ucPort, ulBaudRate, 7, eParity) != true)
+  if (xMBInstPortSerialInit(pxInst, ucPort, ulBaudRate, 7, eParity) != true)
     {
       eStatus = MB_EPORTERR;
     }
-  else if (xMBPortTimersInit(CONFIG_MB_ASCII_TIMEOUT_SEC * 20000UL) != true)
+  else if (xMBInstPortTimersInit(pxInst,
+                                 CONFIG_MB_ASCII_TIMEOUT_SEC * 20000UL) != true)
     {
       eStatus = MB_EPORTERR;
     }
@@ -199,54 +308,55 @@ eMBErrorCode eMBASCIIInit(uint8_t ucSlaveAddress, uint8_t ucPort,
   return eStatus;
 }
 
-void eMBASCIIStart(void)
+void eMBASCIIStart(xMBInstance *pxInst)
 {
   ENTER_CRITICAL_SECTION();
-  vMBPortSerialEnable(true, false);
-  eRcvState = STATE_RX_IDLE;
+  vMBInstPortSerialEnable(pxInst, true, false);
+  pxInst->eRcvState = STATE_RX_IDLE;
   EXIT_CRITICAL_SECTION();
 
   /* No special startup required for ASCII. */
 
-  (void)xMBPortEventPost(EV_READY);
+  (void)xMBInstPortEventPost(pxInst, EV_READY);
 }
 
-void eMBASCIIStop(void)
+void eMBASCIIStop(xMBInstance *pxInst)
 {
   ENTER_CRITICAL_SECTION();
-  vMBPortSerialEnable(false, false);
-  vMBPortTimersDisable();
+  vMBInstPortSerialEnable(pxInst, false, false);
+  vMBInstPortTimersDisable(pxInst);
   EXIT_CRITICAL_SECTION();
 }
 
-eMBErrorCode eMBASCIIReceive(uint8_t *pucRcvAddress, uint8_t **pucFrame,
-                             uint16_t *pusLength)
+eMBErrorCode eMBASCIIReceive(xMBInstance *pxInst, uint8_t *pucRcvAddress,
+                             uint8_t **pucFrame, uint16_t *pusLength)
 {
   eMBErrorCode eStatus = MB_ENOERR;
 
   ENTER_CRITICAL_SECTION();
-  DEBUGASSERT(usRcvBufferPos < MB_SER_PDU_SIZE_MAX);
+  DEBUGASSERT(pxInst->usRcvBufferPos < MB_SER_PDU_SIZE_MAX);
 
   /* Length and CRC check */
 
-  if ((usRcvBufferPos >= MB_SER_PDU_SIZE_MIN) &&
-      (prvucMBLRC((uint8_t *) ucASCIIBuf, usRcvBufferPos) == 0))
+  if ((pxInst->usRcvBufferPos >= MB_SER_PDU_SIZE_MIN) &&
+      (prvucMBLRC((uint8_t *) pxInst->ucFrameBuf, pxInst->usRcvBufferPos) == 0))
     {
       /* Save the address field. All frames are passed to the upper layed
        * and the decision if a frame is used is done there.
        */
 
-      *pucRcvAddress = ucASCIIBuf[MB_SER_PDU_ADDR_OFF];
+      *pucRcvAddress = pxInst->ucFrameBuf[MB_SER_PDU_ADDR_OFF];
 
       /* Total length of Modbus-PDU is Modbus-Serial-Line-PDU minus
        * size of address field and CRC checksum.
        */
 
-      *pusLength = (uint16_t)(usRcvBufferPos - MB_SER_PDU_PDU_OFF - MB_SER_PDU_SIZE_LRC);
+      *pusLength = (uint16_t)(pxInst->usRcvBufferPos - MB_SER_PDU_PDU_OFF -
+                              MB_SER_PDU_SIZE_LRC);
 
       /* Return the start of the Modbus PDU to the caller. */
 
-      *pucFrame = (uint8_t *) & ucASCIIBuf[MB_SER_PDU_PDU_OFF];
+      *pucFrame = (uint8_t *) & pxInst->ucFrameBuf[MB_SER_PDU_PDU_OFF];
     }
   else
     {
@@ -257,8 +367,8 @@ eMBErrorCode eMBASCIIReceive(uint8_t *pucRcvAddress, uint8_t **pucFrame,
   return eStatus;
 }
 
-eMBErrorCode eMBASCIISend(uint8_t ucSlaveAddress, const uint8_t *pucFrame,
-                          uint16_t usLength)
+eMBErrorCode eMBASCIISend(xMBInstance *pxInst, uint8_t ucSlaveAddress,
+                          const uint8_t *pucFrame, uint16_t usLength)
 {
   eMBErrorCode eStatus = MB_ENOERR;
   uint8_t usLRC;
@@ -270,27 +380,28 @@ eMBErrorCode eMBASCIISend(uint8_t ucSlaveAddress, const uint8_t *pucFrame,
    * frame on the network. We have to abort sending the frame.
    */
 
-  if (eRcvState == STATE_RX_IDLE)
+  if (pxInst->eRcvState == STATE_RX_IDLE)
     {
       /* First byte before the Modbus-PDU is the slave address. */
 
-      pucSndBufferCur = (uint8_t *) pucFrame - 1;
-      usSndBufferCount = 1;
+      pxInst->pucSndBufferCur = (uint8_t *) pucFrame - 1;
+      pxInst->usSndBufferCount = 1;
 
       /* Now copy the Modbus-PDU into the Modbus-Serial-Line-PDU. */
 
-      pucSndBufferCur[MB_SER_PDU_ADDR_OFF] = ucSlaveAddress;
-      usSndBufferCount += usLength;
+      pxInst->pucSndBufferCur[MB_SER_PDU_ADDR_OFF] = ucSlaveAddress;
+      pxInst->usSndBufferCount += usLength;
 
       /* Calculate LRC checksum for Modbus-Serial-Line-PDU. */
 
-      usLRC = prvucMBLRC((uint8_t *) pucSndBufferCur, usSndBufferCount);
-      ucASCIIBuf[usSndBufferCount++] = usLRC;
+      usLRC = prvucMBLRC((uint8_t *)pxInst->pucSndBufferCur,
+                         pxInst->usSndBufferCount);
+      pxInst->ucFrameBuf[pxInst->usSndBufferCount++] = usLRC;
 
       /* Activate the transmitter. */
 
-      eSndState = STATE_TX_START;
-      vMBPortSerialEnable(false, true);
+      pxInst->eSndState = STATE_TX_START;
+      vMBInstPortSerialEnable(pxInst, false, true);
     }
   else
     {
@@ -301,142 +412,34 @@ eMBErrorCode eMBASCIISend(uint8_t ucSlaveAddress, const uint8_t *pucFrame,
   return eStatus;
 }
 
-bool xMBASCIIReceiveFSM(void)
+bool xMBASCIIReceiveFSM(xMBInstance *pxInst)
 {
-  bool xNeedPoll = false;
   uint8_t ucByte;
-  uint8_t ucResult;
-
-  DEBUGASSERT(eSndState == STATE_TX_IDLE);
-
-  (void)xMBPortSerialGetByte((int8_t *) & ucByte);
-  switch (eRcvState)
-    {
-    /* A new character is received. If the character is a ':' the input
-     * buffer is cleared. A CR-character signals the end of the data
-     * block. Other characters are part of the data block and their
-     * ASCII value is converted back to a binary representation.
-     */
-
-    case STATE_RX_RCV:
-      /* Enable timer for character timeout. */
 
-      vMBPortTimersEnable();
-      if (ucByte == ':')
-        {
-          /* Empty receive buffer. */
-
-          eBytePos = BYTE_HIGH_NIBBLE;
-          usRcvBufferPos = 0;
-        }
-      else if (ucByte == MB_ASCII_DEFAULT_CR)
-        {
-          eRcvState = STATE_RX_WAIT_EOF;
-        }
-      else
-        {
-          ucResult = prvucMBint8_t2BIN(ucByte);
-          switch (eBytePos)
-          {
-          /* High nibble of the byte comes first. We check for
-           * a buffer overflow here.
-           */
-
-          case BYTE_HIGH_NIBBLE:
-            if (usRcvBufferPos < MB_SER_PDU_SIZE_MAX)
-              {
-                ucASCIIBuf[usRcvBufferPos] = (uint8_t)(ucResult << 4);
-                eBytePos = BYTE_LOW_NIBBLE;
-                break;
-              }
-            else
-              {
-                /* not handled in Modbus specification but seems
-                 * a resonable implementation.
-                 */
-
-                eRcvState = STATE_RX_IDLE;
-
-                /* Disable previously activated timer because of error state. */
-
-                vMBPortTimersDisable();
-              }
-            break;
-
-          case BYTE_LOW_NIBBLE:
-            ucASCIIBuf[usRcvBufferPos] |= ucResult;
-            usRcvBufferPos++;
-            eBytePos = BYTE_HIGH_NIBBLE;
-            break;
-          }
-        }
-        break;
-
-    case STATE_RX_WAIT_EOF:
-      if (ucByte == ucMBLFCharacter)
-        {
-          /* Disable character timeout timer because all characters are
-           * received.
-           */
-
-          vMBPortTimersDisable();
-
-           /* Receiver is again in idle state. */
-
-           eRcvState = STATE_RX_IDLE;
-
-          /* Notify the caller of eMBASCIIReceive that a new frame
-           * was received.
-           */
-
-          xNeedPoll = xMBPortEventPost(EV_FRAME_RECEIVED);
-        }
-      else if (ucByte == ':')
-        {
-          /* Empty receive buffer and back to receive state. */
-
-          eBytePos = BYTE_HIGH_NIBBLE;
-          usRcvBufferPos = 0;
-          eRcvState = STATE_RX_RCV;
-
-          /* Enable timer for character timeout. */
-
-          vMBPortTimersEnable();
-        }
-      else
-        {
-          /* Frame is not okay. Delete entire frame. */
-
-          eRcvState = STATE_RX_IDLE;
-        }
-        break;
-
-    case STATE_RX_IDLE:
-      if (ucByte == ':')
-        {
-          /* Enable timer for character timeout. */
-
-          vMBPortTimersEnable();
+  (void)xMBInstPortSerialGetByte(pxInst, (int8_t *) & ucByte);
+  return prvxMBASCIIReceiveChar(pxInst, ucByte);
+}
 
-          /* Reset the input buffers to store the frame. */
+bool xMBASCIIReceiveBlock(xMBInstance *pxInst, const uint8_t *pucData,
+                          uint16_t usLength)
+{
+  bool xNeedPoll = false;
 
-          usRcvBufferPos = 0;
-          eBytePos = BYTE_HIGH_NIBBLE;
-          eRcvState = STATE_RX_RCV;
-        }
-        break;
+  while (usLength-- > 0)
+    {
+      xNeedPoll |= prvxMBASCIIReceiveChar(pxInst, *pucData++);
     }
 
   return xNeedPoll;
 }
 
-bool xMBASCIITransmitFSM(void)
+bool xMBASCIITransmitFSM(xMBInstance *pxInst)
 {
   bool xNeedPoll = false;
   uint8_t ucByte;
 
-  DEBUGASSERT(eRcvState == STATE_RX_IDLE);
-  switch (eSndState)
+  DEBUGASSERT(pxInst->eRcvState == STATE_RX_IDLE);
+  switch (pxInst->eSndState)
   {
   /* Start of transmission. The start of a frame is defined by sending
    * the character ':'.
@@ -444,9 +447,9 @@ bool xMBASCIITransmitFSM(void)
 
   case STATE_TX_START:
     ucByte = ':';
-    xMBPortSerialPutByte((int8_t)ucByte);
-    eSndState = STATE_TX_DATA;
-    eBytePos = BYTE_HIGH_NIBBLE;
+    xMBInstPortSerialPutByte(pxInst, (int8_t)ucByte);
+    pxInst->eSndState = STATE_TX_DATA;
+    pxInst->eBytePos = BYTE_HIGH_NIBBLE;
     break;
 
   /* Send the data block. Each data byte is encoded as a character hex
@@ -456,42 +459,43 @@ bool xMBASCIITransmitFSM(void)
    */
 
   case STATE_TX_DATA:
-    if (usSndBufferCount > 0)
+    if (pxInst->usSndBufferCount > 0)
       {
-        switch (eBytePos)
+        switch (pxInst->eBytePos)
         {
         case BYTE_HIGH_NIBBLE:
-          ucByte = prvucMBBIN2int8_t((uint8_t)(*pucSndBufferCur >> 4));
-          xMBPortSerialPutByte((int8_t) ucByte);
-          eBytePos = BYTE_LOW_NIBBLE;
+          ucByte = prvucMBBIN2int8_t((uint8_t)(*pxInst->pucSndBufferCur >> 4));
+          xMBInstPortSerialPutByte(pxInst, (int8_t) ucByte);
+          pxInst->eBytePos = BYTE_LOW_NIBBLE;
           break;
 
         case BYTE_LOW_NIBBLE:
-          ucByte = prvucMBBIN2int8_t((uint8_t)(*pucSndBufferCur & 0x0F));
-          xMBPortSerialPutByte((int8_t)ucByte);
-          pucSndBufferCur++;
-          eBytePos = BYTE_HIGH_NIBBLE;
-          usSndBufferCount--;
+          ucByte =
+            prvucMBBIN2int8_t((uint8_t)(*pxInst->pucSndBufferCur & 0x0F));
+          xMBInstPortSerialPutByte(pxInst, (int8_t)ucByte);
+          pxInst->pucSndBufferCur++;
+          pxInst->eBytePos = BYTE_HIGH_NIBBLE;
+          pxInst->usSndBufferCount--;
           break;
         }
       }
     else
       {
-        xMBPortSerialPutByte(MB_ASCII_DEFAULT_CR);
-        eSndState = STATE_TX_END;
+        xMBInstPortSerialPutByte(pxInst, MB_ASCII_DEFAULT_CR);
+        pxInst->eSndState = STATE_TX_END;
       }
     break;
 
     /* Finish the frame by sending a LF character. */
 
     case STATE_TX_END:
-      xMBPortSerialPutByte((int8_t)ucMBLFCharacter);
+      xMBInstPortSerialPutByte(pxInst, (int8_t)pxInst->ucMBLFCharacter);
 
       /* We need another state to make sure that the CR character has
        * been sent.
        */
 
-      eSndState = STATE_TX_NOTIFY;
+      pxInst->eSndState = STATE_TX_NOTIFY;
       break;
 
     /* Notify the task which called eMBASCIISend that the frame has
@@ -499,15 +503,15 @@ bool xMBASCIITransmitFSM(void)
      */
 
     case STATE_TX_NOTIFY:
-      eSndState = STATE_TX_IDLE;
-      xNeedPoll = xMBPortEventPost(EV_FRAME_SENT);
+      pxInst->eSndState = STATE_TX_IDLE;
+      xNeedPoll = xMBInstPortEventPost(pxInst, EV_FRAME_SENT);
 
       /* Disable transmitter. This prevents another transmit buffer
        * empty interrupt.
        */
 
-      vMBPortSerialEnable(true, false);
-      eSndState = STATE_TX_IDLE;
+      vMBInstPortSerialEnable(pxInst, true, false);
+      pxInst->eSndState = STATE_TX_IDLE;
       break;
 
     /* We should not get a transmitter event if the transmitter is in
@@ -517,31 +521,32 @@ bool xMBASCIITransmitFSM(void)
     case STATE_TX_IDLE:
       /* enable receiver/disable transmitter. */
 
-      vMBPortSerialEnable(true, false);
+      vMBInstPortSerialEnable(pxInst, true, false);
       break;
     }
 
   return xNeedPoll;
 }
 
-bool xMBASCIITimerT1SExpired(void)
+bool xMBASCIITimerT1SExpired(xMBInstance *pxInst)
 {
-  switch (eRcvState)
+  switch (pxInst->eRcvState)
   {
   /* If we have a timeout we go back to the idle state and wait for
    * the next frame.
    */
   case STATE_RX_RCV:
   case STATE_RX_WAIT_EOF:
-    eRcvState = STATE_RX_IDLE;
+    pxInst->eRcvState = STATE_RX_IDLE;
     break;
 
   default:
-    DEBUGASSERT((eRcvState == STATE_RX_RCV) || (eRcvState == STATE_RX_WAIT_EOF));
+    DEBUGASSERT((pxInst->eRcvState == STATE_RX_RCV) ||
+                (pxInst->eRcvState == STATE_RX_WAIT_EOF));
     break;
   }
 
-  vMBPortTimersDisable();
+  vMBInstPortTimersDisable(pxInst);
 
   /* no context switch required. */
 
@@ -42,6 +42,8 @@
 #include "modbus/mb.h"
 #include "modbus/mbframe.h"
 #include "modbus/mbproto.h"
+
+#include "mbinstance.h"
 #include "modbus/mbport.h"
 
 /****************************************************************************
@@ -76,7 +78,8 @@ eMBException prveMBError2Exception(eMBErrorCode eErrorCode);
 
 #ifdef CONFIG_MB_FUNC_READ_COILS_ENABLED
 
-eMBException eMBFuncReadCoils(uint8_t *pucFrame, uint16_t *usLen)
+eMBException eMBFuncReadCoils(xMBInstance *pxInst, uint8_t *pucFrame,
+                              uint16_t *usLen)
 {
   uint16_t usRegAddress;
   uint16_t usCoilCount;
@@ -128,8 +131,9 @@ eMBException eMBFuncReadCoils(uint8_t *pucFrame, uint16_t *usLen)
           *pucFrameCur++ = ucNBytes;
           *usLen += 1;
 
-          eRegStatus = eMBRegCoilsCB(pucFrameCur, usRegAddress, usCoilCount,
-                                     MB_REG_READ);
+          eRegStatus = pxInst->xRegCB.peCoils(pxInst->pvArg, pucFrameCur,
+                                              usRegAddress, usCoilCount,
+                                              MB_REG_READ);
 
           /* If an error occured convert it into a Modbus exception. */
 
@@ -165,7 +169,8 @@ eMBException eMBFuncReadCoils(uint8_t *pucFrame, uint16_t *usLen)
 }
 
 #ifdef CONFIG_MB_FUNC_WRITE_COIL_ENABLED
-eMBException eMBFuncWriteCoil(uint8_t *pucFrame, uint16_t *usLen)
+eMBException eMBFuncWriteCoil(xMBInstance *pxInst, uint8_t *pucFrame,
+                              uint16_t *usLen)
 {
   uint16_t usRegAddress;
   uint8_t ucBuf[2];
@@ -193,8 +198,8 @@ eMBException eMBFuncWriteCoil(uint8_t *pucFrame, uint16_t *usLen)
               ucBuf[0] = 0;
             }
 
-          eRegStatus = eMBRegCoilsCB(&ucBuf[0], usRegAddress, 1,
-                                     MB_REG_WRITE);
+          eRegStatus = pxInst->xRegCB.peCoils(pxInst->pvArg, &ucBuf[0],
+                                              usRegAddress, 1, MB_REG_WRITE);
 
           /* If an error occured convert it into a Modbus exception. */
 
@@ -223,7 +228,8 @@ eMBException eMBFuncWriteCoil(uint8_t *pucFrame, uint16_t *usLen)
 #endif
 
 #ifdef CONFIG_MB_FUNC_WRITE_MULTIPLE_COILS_ENABLED
-eMBException eMBFuncWriteMultipleCoils(uint8_t *pucFrame, uint16_t *usLen)
+eMBException eMBFuncWriteMultipleCoils(xMBInstance *pxInst, uint8_t *pucFrame,
+                                       uint16_t *usLen)
 {
   uint16_t usRegAddress;
   uint16_t usCoilCnt;
@@ -260,8 +266,9 @@ eMBException eMBFuncWriteMultipleCoils(uint8_t *pucFrame, uint16_t *usLen)
           (ucByteCountVerify == ucByteCount))
         {
           eRegStatus =
-            eMBRegCoilsCB(&pucFrame[MB_PDU_FUNC_WRITE_MUL_VALUES_OFF],
-                          usRegAddress, usCoilCnt, MB_REG_WRITE);
+            pxInst->xRegCB.peCoils(pxInst->pvArg,
+                                   &pucFrame[MB_PDU_FUNC_WRITE_MUL_VALUES_OFF],
+                                   usRegAddress, usCoilCnt, MB_REG_WRITE);
 
           /* If an error occured convert it into a Modbus exception. */
 
@@ -43,6 +43,8 @@
 #include "modbus/mbframe.h"
 #include "modbus/mbproto.h"
 
+#include "mbinstance.h"
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -77,12 +79,40 @@
 
 eMBException prveMBError2Exception(eMBErrorCode eErrorCode);
 
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/* Access holding registers through the register map if they are mapped and
+ * through the register callback otherwise.
+ */
+
+static eMBErrorCode prveMBRegHolding(xMBInstance *pxInst,
+                                     uint8_t *pucRegBuffer,
+                                     uint16_t usAddress, uint16_t usNRegs,
+                                     eMBRegisterMode eMode)
+{
+#ifdef CONFIG_MB_REGMAP
+  eMBErrorCode eStatus;
+
+  if (xMBRegMapAccess(pxInst, MB_REGMAP_HOLDING, pucRegBuffer, usAddress,
+                      usNRegs, eMode, &eStatus))
+    {
+      return eStatus;
+    }
+#endif
+
+  return pxInst->xRegCB.peHolding(pxInst->pvArg, pucRegBuffer, usAddress,
+                                  usNRegs, eMode);
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
 #ifdef CONFIG_MB_FUNC_WRITE_HOLDING_ENABLED
-eMBException eMBFuncWriteHoldingRegister(uint8_t *pucFrame, uint16_t *usLen)
+eMBException eMBFuncWriteHoldingRegister(xMBInstance *pxInst, uint8_t *pucFrame,
+                                         uint16_t *usLen)
 {
   uint16_t usRegAddress;
   eMBException eStatus = MB_EX_NONE;
@@ -96,8 +126,9 @@ eMBException eMBFuncWriteHoldingRegister(uint8_t *pucFrame, uint16_t *usLen)
 
       /* Make callback to update the value. */
 
-      eRegStatus = eMBRegHoldingCB(&pucFrame[MB_PDU_FUNC_WRITE_VALUE_OFF],
-                                   usRegAddress, 1, MB_REG_WRITE);
+      eRegStatus =
+        prveMBRegHolding(pxInst, &pucFrame[MB_PDU_FUNC_WRITE_VALUE_OFF],
+                         usRegAddress, 1, MB_REG_WRITE);
 
       /* If an error occured convert it into a Modbus exception. */
 
@@ -118,7 +149,9 @@ eMBException eMBFuncWriteHoldingRegister(uint8_t *pucFrame, uint16_t *usLen)
 #endif
 
 #ifdef CONFIG_MB_FUNC_WRITE_MULTIPLE_HOLDING_ENABLED
-eMBException eMBFuncWriteMultipleHoldingRegister(uint8_t *pucFrame, uint16_t *usLen)
+eMBException eMBFuncWriteMultipleHoldingRegister(xMBInstance *pxInst,
+                                                 uint8_t *pucFrame,
+                                                 uint16_t *usLen)
 {
   uint16_t usRegAddress;
   uint16_t usRegCount;
@@ -145,8 +178,9 @@ eMBException eMBFuncWriteMultipleHoldingRegister(uint8_t *pucFrame, uint16_t *us
           /* Make callback to update the register values. */
 
           eRegStatus =
-            eMBRegHoldingCB(&pucFrame[MB_PDU_FUNC_WRITE_MUL_VALUES_OFF],
-                            usRegAddress, usRegCount, MB_REG_WRITE);
+            prveMBRegHolding(pxInst,
+                             &pucFrame[MB_PDU_FUNC_WRITE_MUL_VALUES_OFF],
+                             usRegAddress, usRegCount, MB_REG_WRITE);
 
           /* If an error occurred convert it into a Modbus exception. */
 
@@ -181,7 +215,8 @@ eMBException eMBFuncWriteMultipleHoldingRegister(uint8_t *pucFrame, uint16_t *us
 #endif
 
 #ifdef CONFIG_MB_FUNC_READ_HOLDING_ENABLED
-eMBException eMBFuncReadHoldingRegister(uint8_t * pucFrame, uint16_t * usLen)
+eMBException eMBFuncReadHoldingRegister(xMBInstance *pxInst, uint8_t *pucFrame,
+                                        uint16_t *usLen)
 {
   uint16_t usRegAddress;
   uint16_t usRegCount;
@@ -222,7 +257,8 @@ eMBException eMBFuncReadHoldingRegister(uint8_t * pucFrame, uint16_t * usLen)
 
           /* Make callback to fill the buffer. */
 
-          eRegStatus = eMBRegHoldingCB(pucFrameCur, usRegAddress, usRegCount, MB_REG_READ);
+          eRegStatus = prveMBRegHolding(pxInst, pucFrameCur, usRegAddress,
+                                        usRegCount, MB_REG_READ);
 
           /* If an error occured convert it into a Modbus exception. */
 
@@ -253,7 +289,9 @@ eMBException eMBFuncReadHoldingRegister(uint8_t * pucFrame, uint16_t * usLen)
 #endif
 
 #ifdef CONFIG_MB_FUNC_READWRITE_HOLDING_ENABLED
-eMBException eMBFuncReadWriteMultipleHoldingRegister(uint8_t *pucFrame, uint16_t *usLen)
+eMBException eMBFuncReadWriteMultipleHoldingRegister(xMBInstance *pxInst,
+                                                     uint8_t *pucFrame,
+                                                     uint16_t *usLen)
 {
   uint16_t usRegReadAddress;
   uint16_t usRegReadCount;
@@ -289,8 +327,11 @@ eMBException eMBFuncReadWriteMultipleHoldingRegister(uint8_t *pucFrame, uint16_t
         {
           /* Make callback to update the register values. */
 
-          eRegStatus = eMBRegHoldingCB(&pucFrame[MB_PDU_FUNC_READWRITE_WRITE_VALUES_OFF],
-                                       usRegWriteAddress, usRegWriteCount, MB_REG_WRITE);
+          eRegStatus =
+            prveMBRegHolding(pxInst,
+                             &pucFrame[MB_PDU_FUNC_READWRITE_WRITE_VALUES_OFF],
+                             usRegWriteAddress, usRegWriteCount,
+                             MB_REG_WRITE);
 
           if (eRegStatus == MB_ENOERR)
             {
@@ -311,8 +352,9 @@ eMBException eMBFuncReadWriteMultipleHoldingRegister(uint8_t *pucFrame, uint16_t
 
               /* Make the read callback. */
 
-              eRegStatus = eMBRegHoldingCB(pucFrameCur, usRegReadAddress,
-                                           usRegReadCount, MB_REG_READ);
+              eRegStatus = prveMBRegHolding(pxInst, pucFrameCur,
+                                            usRegReadAddress,
+                                            usRegReadCount, MB_REG_READ);
               if (eRegStatus == MB_ENOERR)
                 {
                   *usLen += 2 * usRegReadCount;
@@ -43,6 +43,8 @@
 #include "modbus/mbframe.h"
 #include "modbus/mbproto.h"
 
+#include "mbinstance.h"
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -60,12 +62,39 @@
 
 eMBException prveMBError2Exception(eMBErrorCode eErrorCode);
 
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/* Read input registers through the register map if they are mapped and
+ * through the register callback otherwise.
+ */
+
+static eMBErrorCode prveMBRegInput(xMBInstance *pxInst,
+                                   uint8_t *pucRegBuffer,
+                                   uint16_t usAddress, uint16_t usNRegs)
+{
+#ifdef CONFIG_MB_REGMAP
+  eMBErrorCode eStatus;
+
+  if (xMBRegMapAccess(pxInst, MB_REGMAP_INPUT, pucRegBuffer, usAddress,
+                      usNRegs, MB_REG_READ, &eStatus))
+    {
+      return eStatus;
+    }
+#endif
+
+  return pxInst->xRegCB.peInput(pxInst->pvArg, pucRegBuffer, usAddress,
+                                usNRegs);
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
 #ifdef CONFIG_MB_FUNC_READ_INPUT_ENABLED
-eMBException eMBFuncReadInputRegister(uint8_t *pucFrame, uint16_t *usLen)
+eMBException eMBFuncReadInputRegister(xMBInstance *pxInst, uint8_t *pucFrame,
+                                      uint16_t *usLen)
 {
   uint16_t usRegAddress;
   uint16_t usRegCount;
@@ -105,7 +134,8 @@ eMBException eMBFuncReadInputRegister(uint8_t *pucFrame, uint16_t *usLen)
           *pucFrameCur++ = (uint8_t)(usRegCount * 2);
           *usLen += 1;
 
-          eRegStatus = eMBRegInputCB(pucFrameCur, usRegAddress, usRegCount);
+          eRegStatus = prveMBRegInput(pxInst, pucFrameCur, usRegAddress,
+                                      usRegCount);
 
           /* If an error occured convert it into a Modbus exception. */
 
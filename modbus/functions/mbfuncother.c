@@ -43,24 +43,21 @@
 #include "modbus/mbframe.h"
 #include "modbus/mbproto.h"
 
-#ifdef CONFIG_MB_FUNC_OTHER_REP_SLAVEID_ENABLED
-
-/****************************************************************************
- * Private Data
- ****************************************************************************/
+#include "mbinstance.h"
 
-static uint8_t  ucMBSlaveID[CONFIG_MB_FUNC_OTHER_REP_SLAVEID_BUF];
-static uint16_t usMBSlaveIDLen;
+#ifdef CONFIG_MB_FUNC_OTHER_REP_SLAVEID_ENABLED
 
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
-eMBErrorCode eMBSetSlaveID(uint8_t ucSlaveID, bool xIsRunning,
-                           uint8_t const *pucAdditional,
-                           uint16_t usAdditionalLen)
+eMBErrorCode eMBInstanceSetSlaveID(xMBInstance *pxInst, uint8_t ucSlaveID,
+                                   bool xIsRunning,
+                                   uint8_t const *pucAdditional,
+                                   uint16_t usAdditionalLen)
 {
   eMBErrorCode eStatus = MB_ENOERR;
+  uint16_t usLen;
 
   /* the first byte and second byte in the buffer is reserved for
    * the parameter ucSlaveID and the running flag. The rest of
@@ -69,16 +66,18 @@ eMBErrorCode eMBSetSlaveID(uint8_t ucSlaveID, bool xIsRunning,
 
   if (usAdditionalLen + 2 < CONFIG_MB_FUNC_OTHER_REP_SLAVEID_BUF)
     {
-      usMBSlaveIDLen = 0;
-      ucMBSlaveID[usMBSlaveIDLen++] = ucSlaveID;
-      ucMBSlaveID[usMBSlaveIDLen++] = (uint8_t)(xIsRunning ? 0xFF : 0x00);
+      usLen = 0;
+      pxInst->ucMBSlaveID[usLen++] = ucSlaveID;
+      pxInst->ucMBSlaveID[usLen++] = (uint8_t)(xIsRunning ? 0xFF : 0x00);
 
       if (usAdditionalLen > 0)
         {
-          memcpy(&ucMBSlaveID[usMBSlaveIDLen], pucAdditional,
+          memcpy(&pxInst->ucMBSlaveID[usLen], pucAdditional,
                   (size_t)usAdditionalLen);
-          usMBSlaveIDLen += usAdditionalLen;
+          usLen += usAdditionalLen;
         }
+
+      pxInst->usMBSlaveIDLen = usLen;
     }
   else
     {
@@ -88,10 +87,20 @@ eMBErrorCode eMBSetSlaveID(uint8_t ucSlaveID, bool xIsRunning,
   return eStatus;
 }
 
-eMBException eMBFuncReportSlaveID(uint8_t *pucFrame, uint16_t *usLen)
+eMBErrorCode eMBSetSlaveID(uint8_t ucSlaveID, bool xIsRunning,
+                           uint8_t const *pucAdditional,
+                           uint16_t usAdditionalLen)
+{
+  return eMBInstanceSetSlaveID(pxMBGetDefaultInstance(), ucSlaveID,
+                               xIsRunning, pucAdditional, usAdditionalLen);
+}
+
+eMBException eMBFuncReportSlaveID(xMBInstance *pxInst, uint8_t *pucFrame,
+                                  uint16_t *usLen)
 {
-  memcpy(&pucFrame[MB_PDU_DATA_OFF], &ucMBSlaveID[0], (size_t)usMBSlaveIDLen);
-  *usLen = (uint16_t)(MB_PDU_DATA_OFF + usMBSlaveIDLen);
+  memcpy(&pucFrame[MB_PDU_DATA_OFF], &pxInst->ucMBSlaveID[0],
+         (size_t)pxInst->usMBSlaveIDLen);
+  *usLen = (uint16_t)(MB_PDU_DATA_OFF + pxInst->usMBSlaveIDLen);
   return MB_EX_NONE;
 }
 
@@ -0,0 +1,222 @@
+/****************************************************************************
+ * apps/functions/mbregmap.c
+ *
+ * FreeModbus Library: Register map for holding and input registers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "port.h"
+
+#include "modbus/mb.h"
+#include "modbus/mbutils.h"
+
+#include "mbinstance.h"
+
+#ifdef CONFIG_MB_REGMAP
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/* Find the entry that contains usAddress with a binary search over the
+ * sorted map.
+ */
+
+static const xMBRegMapEntry *prvpxMBRegMapFind(const xMBRegMapEntry *pxMap,
+                                               uint16_t usEntries,
+                                               uint16_t usAddress)
+{
+  uint16_t usLo = 0;
+  uint16_t usHi = usEntries;
+  uint16_t usMid;
+
+  while (usLo < usHi)
+    {
+      usMid = usLo + (usHi - usLo) / 2;
+      if (usAddress < pxMap[usMid].usAddress)
+        {
+          usHi = usMid;
+        }
+      else if (usAddress - pxMap[usMid].usAddress >= pxMap[usMid].usNRegs)
+        {
+          usLo = usMid + 1;
+        }
+      else
+        {
+          return &pxMap[usMid];
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+bool xMBRegMapAccess(xMBInstance *pxInst, eMBRegMapType eType,
+                     uint8_t *pucRegBuffer, uint16_t usAddress,
+                     uint16_t usNRegs, eMBRegisterMode eMode,
+                     eMBErrorCode *peStatus)
+{
+  const xMBRegMapEntry *pxMap = pxInst->pxRegMap[eType];
+  const xMBRegMapEntry *pxEntry;
+  const xMBRegMapEntry *pxEnd;
+  uint32_t ulAddress = usAddress;
+  uint32_t ulEnd = ulAddress + usNRegs;
+  uint16_t usOffset;
+  uint16_t usCount;
+
+  if (pxMap == NULL)
+    {
+      return false;
+    }
+
+  pxEntry = prvpxMBRegMapFind(pxMap, pxInst->usRegMapLen[eType], usAddress);
+  if (pxEntry == NULL)
+    {
+      return false;
+    }
+
+  /* The request may span adjacent entries; make sure it is covered
+   * completely before touching anything so a write is all or nothing.
+   */
+
+  pxEnd = &pxMap[pxInst->usRegMapLen[eType]];
+  for (pxMap = pxEntry; ; )
+    {
+      if (eMode == MB_REG_WRITE && (pxMap->ucFlags & MB_REGMAP_READ_ONLY))
+        {
+          *peStatus = MB_ENOREG;
+          return true;
+        }
+
+      ulAddress = (uint32_t)pxMap->usAddress + pxMap->usNRegs;
+      if (ulAddress >= ulEnd)
+        {
+          break;
+        }
+
+      pxMap++;
+      if (pxMap == pxEnd || pxMap->usAddress != ulAddress)
+        {
+          return false;
+        }
+    }
+
+  ulAddress = usAddress;
+  for (pxMap = pxEntry; ulAddress < ulEnd; pxMap++)
+    {
+      usOffset = (uint16_t)(ulAddress - pxMap->usAddress);
+      usCount = pxMap->usNRegs - usOffset;
+      if (ulAddress + usCount > ulEnd)
+        {
+          usCount = (uint16_t)(ulEnd - ulAddress);
+        }
+
+      if (pxMap->ucFlags & MB_REGMAP_BIG_ENDIAN)
+        {
+          uint8_t *pucData = (uint8_t *)pxMap->pvData + 2 * usOffset;
+
+          if (eMode == MB_REG_READ)
+            {
+              memcpy(pucRegBuffer, pucData, (size_t)usCount * 2);
+            }
+          else
+            {
+              memcpy(pucData, pucRegBuffer, (size_t)usCount * 2);
+            }
+        }
+      else
+        {
+          uint16_t *pusData = (uint16_t *)pxMap->pvData + usOffset;
+
+          if (eMode == MB_REG_READ)
+            {
+              vMBUtilRegsToFrame(pucRegBuffer, pusData, usCount);
+            }
+          else
+            {
+              vMBUtilRegsFromFrame(pusData, pucRegBuffer, usCount);
+            }
+        }
+
+      pucRegBuffer += 2 * usCount;
+      ulAddress += usCount;
+    }
+
+  *peStatus = MB_ENOERR;
+  return true;
+}
+
+eMBErrorCode eMBInstanceSetRegMap(xMBInstance *pxInst, eMBRegMapType eType,
+                                  const xMBRegMapEntry *pxMap,
+                                  uint16_t usEntries)
+{
+  uint32_t ulNext = 0;
+  uint16_t i;
+
+  if (pxInst == NULL || eType >= MB_REGMAP_NTYPES ||
+      (pxMap == NULL && usEntries != 0))
+    {
+      return MB_EINVAL;
+    }
+
+  for (i = 0; i < usEntries; i++)
+    {
+      if (pxMap[i].usNRegs == 0 || pxMap[i].pvData == NULL ||
+          pxMap[i].usAddress < ulNext ||
+          (uint32_t)pxMap[i].usAddress + pxMap[i].usNRegs > 0x10000)
+        {
+          return MB_EINVAL;
+        }
+
+      ulNext = (uint32_t)pxMap[i].usAddress + pxMap[i].usNRegs;
+    }
+
+  ENTER_CRITICAL_SECTION();
+  pxInst->pxRegMap[eType] = usEntries > 0 ? pxMap : NULL;
+  pxInst->usRegMapLen[eType] = usEntries;
+  EXIT_CRITICAL_SECTION();
+
+  return MB_ENOERR;
+}
+
+eMBErrorCode eMBSetRegMap(eMBRegMapType eType, const xMBRegMapEntry *pxMap,
+                          uint16_t usEntries)
+{
+  return eMBInstanceSetRegMap(pxMBGetDefaultInstance(), eType, pxMap,
+                              usEntries);
+}
+
+#endif /* CONFIG_MB_REGMAP */
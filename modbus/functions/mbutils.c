@@ -135,6 +135,37 @@ uint8_t xMBUtilGetBits(uint8_t *ucByteBuf, uint16_t usBitOffset, uint8_t ucNBits
   return (uint8_t) usWordBuf;
 }
 
+void vMBUtilRegsToFrame(uint8_t *pucDst, const uint16_t *pusSrc,
+                        uint16_t usNRegs)
+{
+#ifdef CONFIG_ENDIAN_BIG
+  memcpy(pucDst, pusSrc, (size_t)usNRegs * 2);
+#else
+  uint16_t i;
+
+  for (i = 0; i < usNRegs; i++)
+    {
+      pucDst[2 * i] = (uint8_t)(pusSrc[i] >> 8);
+      pucDst[2 * i + 1] = (uint8_t)pusSrc[i];
+    }
+#endif
+}
+
+void vMBUtilRegsFromFrame(uint16_t *pusDst, const uint8_t *pucSrc,
+                          uint16_t usNRegs)
+{
+#ifdef CONFIG_ENDIAN_BIG
+  memcpy(pusDst, pucSrc, (size_t)usNRegs * 2);
+#else
+  uint16_t i;
+
+  for (i = 0; i < usNRegs; i++)
+    {
+      pusDst[i] = (uint16_t)(pucSrc[2 * i] << 8 | pucSrc[2 * i + 1]);
+    }
+#endif
+}
+
 eMBException prveMBError2Exception(eMBErrorCode eErrorCode)
 {
   eMBException eStatus;
@@ -46,6 +46,8 @@
 
 #include "modbus/mbport.h"
 
+#include "mbinstance.h"
+
 #ifdef CONFIG_MB_RTU_ENABLED
 #  include "mbrtu.h"
 #endif
@@ -59,85 +61,256 @@
 #endif
 
 /****************************************************************************
- * Private Data
+ * Private Types
  ****************************************************************************/
 
-static uint8_t  ucMBAddress;
-static eMBMode  eMBCurrentMode;
+/* eMBState of an instance.  A zeroed instance is not initialized. */
 
-static enum
+enum
 {
+  STATE_NOT_INITIALIZED,
   STATE_ENABLED,
-  STATE_DISABLED,
-  STATE_NOT_INITIALIZED
-} eMBState = STATE_NOT_INITIALIZED;
+  STATE_DISABLED
+};
 
-/* Functions pointer which are initialized in eMBInit(). Depending on the
- * mode (RTU or ASCII) the are set to the correct implementations.
- */
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
 
-static peMBFrameSend peMBFrameSendCur;
-static pvMBFrameStart pvMBFrameStartCur;
-static pvMBFrameStop pvMBFrameStopCur;
-static peMBFrameReceive peMBFrameReceiveCur;
-static pvMBFrameClose pvMBFrameCloseCur;
+static eMBErrorCode prveMBNoRegInput(void *pvArg, uint8_t *pucRegBuffer,
+                                     uint16_t usAddress, uint16_t usNRegs);
+static eMBErrorCode prveMBNoRegHolding(void *pvArg, uint8_t *pucRegBuffer,
+                                       uint16_t usAddress, uint16_t usNRegs,
+                                       eMBRegisterMode eMode);
+static eMBErrorCode prveMBNoRegDiscrete(void *pvArg, uint8_t *pucRegBuffer,
+                                        uint16_t usAddress,
+                                        uint16_t usNDiscrete);
 
-/* Callback functions required by the porting layer. They are called when
- * an external event has happened which includes a timeout or the reception
- * or transmission of a character.
- */
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
 
-bool(*pxMBFrameCBByteReceived)(void);
-bool(*pxMBFrameCBTransmitterEmpty)(void);
-bool(*pxMBPortCBTimerExpired)(void);
+/* The instance behind eMBInit(), eMBPoll() etc. and the legacy port
+ * functions in modbus/mbport.h.
+ */
 
-bool(*pxMBFrameCBReceiveFSMCur)(void);
-bool(*pxMBFrameCBTransmitFSMCur)(void);
+static xMBInstance xMBDefaultInstance;
 
-/* An array of Modbus functions handlers which associates Modbus function
- * codes with implementing functions.
+/* The function handlers every instance starts with.  They associate Modbus
+ * function codes with implementing functions.
  */
 
-static xMBFunctionHandler xFuncHandlers[CONFIG_MB_FUNC_HANDLERS_MAX] =
+static const xMBInstanceHandler
+  xMBDefaultHandlers[CONFIG_MB_FUNC_HANDLERS_MAX] =
 {
 #ifdef CONFIG_MB_FUNC_OTHER_REP_SLAVEID_ENABLED
-  {MB_FUNC_OTHER_REPORT_SLAVEID, eMBFuncReportSlaveID},
+  {MB_FUNC_OTHER_REPORT_SLAVEID, NULL, eMBFuncReportSlaveID},
 #endif
 #ifdef CONFIG_MB_FUNC_READ_INPUT_ENABLED
-  {MB_FUNC_READ_INPUT_REGISTER, eMBFuncReadInputRegister},
+  {MB_FUNC_READ_INPUT_REGISTER, NULL, eMBFuncReadInputRegister},
 #endif
 #ifdef CONFIG_MB_FUNC_READ_HOLDING_ENABLED
-  {MB_FUNC_READ_HOLDING_REGISTER, eMBFuncReadHoldingRegister},
+  {MB_FUNC_READ_HOLDING_REGISTER, NULL, eMBFuncReadHoldingRegister},
 #endif
 #ifdef CONFIG_MB_FUNC_WRITE_MULTIPLE_HOLDING_ENABLED
-  {MB_FUNC_WRITE_MULTIPLE_REGISTERS, eMBFuncWriteMultipleHoldingRegister},
+  {MB_FUNC_WRITE_MULTIPLE_REGISTERS, NULL, eMBFuncWriteMultipleHoldingRegister},
 #endif
 #ifdef CONFIG_MB_FUNC_WRITE_HOLDING_ENABLED
-  {MB_FUNC_WRITE_REGISTER, eMBFuncWriteHoldingRegister},
+  {MB_FUNC_WRITE_REGISTER, NULL, eMBFuncWriteHoldingRegister},
 #endif
 #ifdef CONFIG_MB_FUNC_READWRITE_HOLDING_ENABLED
-  {MB_FUNC_READWRITE_MULTIPLE_REGISTERS, eMBFuncReadWriteMultipleHoldingRegister},
+  {MB_FUNC_READWRITE_MULTIPLE_REGISTERS, NULL, eMBFuncReadWriteMultipleHoldingRegister},
 #endif
 #ifdef CONFIG_MB_FUNC_READ_COILS_ENABLED
-  {MB_FUNC_READ_COILS, eMBFuncReadCoils},
+  {MB_FUNC_READ_COILS, NULL, eMBFuncReadCoils},
 #endif
 #ifdef CONFIG_MB_FUNC_WRITE_COIL_ENABLED
-  {MB_FUNC_WRITE_SINGLE_COIL, eMBFuncWriteCoil},
+  {MB_FUNC_WRITE_SINGLE_COIL, NULL, eMBFuncWriteCoil},
 #endif
 #ifdef CONFIG_MB_FUNC_WRITE_MULTIPLE_COILS_ENABLED
-  {MB_FUNC_WRITE_MULTIPLE_COILS, eMBFuncWriteMultipleCoils},
+  {MB_FUNC_WRITE_MULTIPLE_COILS, NULL, eMBFuncWriteMultipleCoils},
 #endif
 #ifdef CONFIG_MB_FUNC_READ_DISCRETE_INPUTS_ENABLED
-  {MB_FUNC_READ_DISCRETE_INPUTS, eMBFuncReadDiscreteInputs},
+  {MB_FUNC_READ_DISCRETE_INPUTS, NULL, eMBFuncReadDiscreteInputs},
+#endif
+};
+
+/* Until eMBInstanceSetRegCB() is called an instance uses the application's
+ * global eMBReg*CB() functions.  Only those needed by the enabled function
+ * codes are referenced.
+ */
+
+#ifdef CONFIG_MB_FUNC_READ_INPUT_ENABLED
+#  define MB_HAVE_REG_INPUT
+#endif
+
+#if defined(CONFIG_MB_FUNC_READ_HOLDING_ENABLED) || \
+    defined(CONFIG_MB_FUNC_WRITE_HOLDING_ENABLED) || \
+    defined(CONFIG_MB_FUNC_WRITE_MULTIPLE_HOLDING_ENABLED) || \
+    defined(CONFIG_MB_FUNC_READWRITE_HOLDING_ENABLED)
+#  define MB_HAVE_REG_HOLDING
+#endif
+
+#if defined(CONFIG_MB_FUNC_READ_COILS_ENABLED) || \
+    defined(CONFIG_MB_FUNC_WRITE_COIL_ENABLED) || \
+    defined(CONFIG_MB_FUNC_WRITE_MULTIPLE_COILS_ENABLED)
+#  define MB_HAVE_REG_COILS
+#endif
+
+#ifdef CONFIG_MB_FUNC_READ_DISCRETE_INPUTS_ENABLED
+#  define MB_HAVE_REG_DISCRETE
+#endif
+
+#ifdef MB_HAVE_REG_INPUT
+static eMBErrorCode prveMBGlobalRegInput(void *pvArg, uint8_t *pucRegBuffer,
+                                         uint16_t usAddress,
+                                         uint16_t usNRegs)
+{
+  return eMBRegInputCB(pucRegBuffer, usAddress, usNRegs);
+}
+#endif
+
+#ifdef MB_HAVE_REG_HOLDING
+static eMBErrorCode prveMBGlobalRegHolding(void *pvArg,
+                                           uint8_t *pucRegBuffer,
+                                           uint16_t usAddress,
+                                           uint16_t usNRegs,
+                                           eMBRegisterMode eMode)
+{
+  return eMBRegHoldingCB(pucRegBuffer, usAddress, usNRegs, eMode);
+}
+#endif
+
+#ifdef MB_HAVE_REG_COILS
+static eMBErrorCode prveMBGlobalRegCoils(void *pvArg, uint8_t *pucRegBuffer,
+                                         uint16_t usAddress,
+                                         uint16_t usNCoils,
+                                         eMBRegisterMode eMode)
+{
+  return eMBRegCoilsCB(pucRegBuffer, usAddress, usNCoils, eMode);
+}
+#endif
+
+#ifdef MB_HAVE_REG_DISCRETE
+static eMBErrorCode prveMBGlobalRegDiscrete(void *pvArg,
+                                            uint8_t *pucRegBuffer,
+                                            uint16_t usAddress,
+                                            uint16_t usNDiscrete)
+{
+  return eMBRegDiscreteCB(pucRegBuffer, usAddress, usNDiscrete);
+}
+#endif
+
+static const xMBRegCallbacks xMBGlobalRegCB =
+{
+#ifdef MB_HAVE_REG_INPUT
+  prveMBGlobalRegInput,
+#else
+  prveMBNoRegInput,
+#endif
+#ifdef MB_HAVE_REG_HOLDING
+  prveMBGlobalRegHolding,
+#else
+  prveMBNoRegHolding,
+#endif
+#ifdef MB_HAVE_REG_COILS
+  prveMBGlobalRegCoils,
+#else
+  prveMBNoRegHolding,
+#endif
+#ifdef MB_HAVE_REG_DISCRETE
+  prveMBGlobalRegDiscrete,
+#else
+  prveMBNoRegDiscrete,
 #endif
 };
 
 /****************************************************************************
- * Public Functions
+ * Private Functions
  ****************************************************************************/
 
-eMBErrorCode eMBInit(eMBMode eMode, uint8_t ucSlaveAddress, uint8_t ucPort,
-                     speed_t ulBaudRate, eMBParity eParity)
+/* Stand-ins for callbacks left NULL in eMBInstanceSetRegCB() */
+
+static eMBErrorCode prveMBNoRegInput(void *pvArg, uint8_t *pucRegBuffer,
+                                     uint16_t usAddress, uint16_t usNRegs)
+{
+  return MB_ENOREG;
+}
+
+static eMBErrorCode prveMBNoRegHolding(void *pvArg, uint8_t *pucRegBuffer,
+                                       uint16_t usAddress, uint16_t usNRegs,
+                                       eMBRegisterMode eMode)
+{
+  return MB_ENOREG;
+}
+
+static eMBErrorCode prveMBNoRegDiscrete(void *pvArg, uint8_t *pucRegBuffer,
+                                        uint16_t usAddress,
+                                        uint16_t usNDiscrete)
+{
+  return MB_ENOREG;
+}
+
+#ifdef CONFIG_MB_TCP_ENABLED
+/* The TCP frame layer has no instance of its own, it always belongs to the
+ * default instance.
+ */
+
+static void prvvMBTCPStart(xMBInstance *pxInst)
+{
+  eMBTCPStart();
+}
+
+static void prvvMBTCPStop(xMBInstance *pxInst)
+{
+  eMBTCPStop();
+}
+
+static eMBErrorCode prveMBTCPReceive(xMBInstance *pxInst,
+                                     uint8_t *pucRcvAddress,
+                                     uint8_t **pucFrame,
+                                     uint16_t *pusLength)
+{
+  return eMBTCPReceive(pucRcvAddress, pucFrame, pusLength);
+}
+
+static eMBErrorCode prveMBTCPSend(xMBInstance *pxInst, uint8_t ucSlaveAddress,
+                                  const uint8_t *pucFrame, uint16_t usLength)
+{
+  return eMBTCPSend(ucSlaveAddress, pucFrame, usLength);
+}
+
+#ifdef CONFIG_MB_HAVE_CLOSE
+static void prvvMBTCPClose(xMBInstance *pxInst)
+{
+  vMBTCPPortClose();
+}
+#endif
+#endif
+
+/* Give an instance its default handlers and register callbacks unless it
+ * already has them, e.g. because eMBRegisterCB() was called before
+ * eMBInit().
+ */
+
+static void prvvMBInstanceDefaults(xMBInstance *pxInst)
+{
+  if (!pxInst->bDefaultsValid)
+    {
+      memcpy(pxInst->xFuncHandlers, xMBDefaultHandlers,
+             sizeof(pxInst->xFuncHandlers));
+      pxInst->xRegCB = xMBGlobalRegCB;
+      pxInst->pvArg = NULL;
+      pxInst->bDefaultsValid = true;
+    }
+}
+
+static eMBErrorCode prveMBInstanceSerialInit(xMBInstance *pxInst,
+                                             eMBMode eMode,
+                                             uint8_t ucSlaveAddress,
+                                             uint8_t ucPort,
+                                             speed_t ulBaudRate,
+                                             eMBParity eParity)
 {
   eMBErrorCode eStatus = MB_ENOERR;
 
@@ -150,36 +323,53 @@ eMBErrorCode eMBInit(eMBMode eMode, uint8_t ucSlaveAddress, uint8_t ucPort,
     }
   else
     {
-      ucMBAddress = ucSlaveAddress;
+      prvvMBInstanceDefaults(pxInst);
+      pxInst->ucMBAddress = ucSlaveAddress;
+      pxInst->iSerialFd = -1;
 
       switch (eMode)
         {
 #ifdef CONFIG_MB_RTU_ENABLED
         case MB_RTU:
-          pvMBFrameStartCur = eMBRTUStart;
-          pvMBFrameStopCur = eMBRTUStop;
-          peMBFrameSendCur = eMBRTUSend;
-          peMBFrameReceiveCur = eMBRTUReceive;
-          pvMBFrameCloseCur = vMBPortClose;
-          pxMBFrameCBByteReceived = xMBRTUReceiveFSM;
-          pxMBFrameCBTransmitterEmpty = xMBRTUTransmitFSM;
-          pxMBPortCBTimerExpired = xMBRTUTimerT35Expired;
-
-          eStatus = eMBRTUInit(ucMBAddress, ucPort, ulBaudRate, eParity);
+          pxInst->pvMBFrameStartCur = eMBRTUStart;
+          pxInst->pvMBFrameStopCur = eMBRTUStop;
+          pxInst->peMBFrameSendCur = eMBRTUSend;
+          pxInst->peMBFrameReceiveCur = eMBRTUReceive;
+          pxInst->pvMBFrameCloseCur = vMBInstPortClose;
+          pxInst->pxMBFrameCBByteReceived = xMBRTUReceiveFSM;
+          pxInst->pxMBFrameCBTransmitterEmpty = xMBRTUTransmitFSM;
+          pxInst->pxMBPortCBTimerExpired = xMBRTUTimerT35Expired;
+#ifdef CONFIG_MB_SERIAL_BLOCKIO
+          pxInst->pxMBFrameCBBlockReceived = xMBRTUReceiveBlock;
+          pxInst->pxMBFrameCBTransmitBlock = xMBRTUTransmitBlock;
+#else
+          pxInst->pxMBFrameCBBlockReceived = NULL;
+          pxInst->pxMBFrameCBTransmitBlock = NULL;
+#endif
+
+          eStatus = eMBRTUInit(pxInst, ucSlaveAddress, ucPort, ulBaudRate,
+                               eParity);
           break;
 #endif
 #ifdef CONFIG_MB_ASCII_ENABLED
         case MB_ASCII:
-          pvMBFrameStartCur = eMBASCIIStart;
-          pvMBFrameStopCur = eMBASCIIStop;
-          peMBFrameSendCur = eMBASCIISend;
-          peMBFrameReceiveCur = eMBASCIIReceive;
-          pvMBFrameCloseCur = vMBPortClose;
-          pxMBFrameCBByteReceived = xMBASCIIReceiveFSM;
-          pxMBFrameCBTransmitterEmpty = xMBASCIITransmitFSM;
-          pxMBPortCBTimerExpired = xMBASCIITimerT1SExpired;
-
-          eStatus = eMBASCIIInit(ucMBAddress, ucPort, ulBaudRate, eParity);
+          pxInst->pvMBFrameStartCur = eMBASCIIStart;
+          pxInst->pvMBFrameStopCur = eMBASCIIStop;
+          pxInst->peMBFrameSendCur = eMBASCIISend;
+          pxInst->peMBFrameReceiveCur = eMBASCIIReceive;
+          pxInst->pvMBFrameCloseCur = vMBInstPortClose;
+          pxInst->pxMBFrameCBByteReceived = xMBASCIIReceiveFSM;
+          pxInst->pxMBFrameCBTransmitterEmpty = xMBASCIITransmitFSM;
+          pxInst->pxMBPortCBTimerExpired = xMBASCIITimerT1SExpired;
+#ifdef CONFIG_MB_SERIAL_BLOCKIO
+          pxInst->pxMBFrameCBBlockReceived = xMBASCIIReceiveBlock;
+#else
+          pxInst->pxMBFrameCBBlockReceived = NULL;
+#endif
+          pxInst->pxMBFrameCBTransmitBlock = NULL;
+
+          eStatus = eMBASCIIInit(pxInst, ucSlaveAddress, ucPort, ulBaudRate,
+                                 eParity);
           break;
 #endif
         default:
@@ -188,7 +378,7 @@ eMBErrorCode eMBInit(eMBMode eMode, uint8_t ucSlaveAddress, uint8_t ucPort,
 
       if (eStatus == MB_ENOERR)
         {
-          if (!xMBPortEventInit())
+          if (!xMBInstPortEventInit(pxInst))
             {
               /* port dependent event module initialization failed. */
 
@@ -196,8 +386,8 @@ eMBErrorCode eMBInit(eMBMode eMode, uint8_t ucSlaveAddress, uint8_t ucPort,
             }
           else
             {
-              eMBCurrentMode = eMode;
-              eMBState = STATE_DISABLED;
+              pxInst->eMBCurrentMode = eMode;
+              pxInst->eMBState = STATE_DISABLED;
             }
         }
     }
@@ -205,71 +395,50 @@ eMBErrorCode eMBInit(eMBMode eMode, uint8_t ucSlaveAddress, uint8_t ucPort,
   return eStatus;
 }
 
-#ifdef CONFIG_MB_TCP_ENABLED
-eMBErrorCode eMBTCPInit(uint16_t ucTCPPort)
-{
-  eMBErrorCode eStatus = MB_ENOERR;
-
-  if ((eStatus = eMBTCPDoInit(ucTCPPort)) != MB_ENOERR)
-    {
-      eMBState = STATE_DISABLED;
-    }
-  else if (!xMBPortEventInit())
-    {
-      /* Port dependent event module initialization failed. */
-
-      eStatus = MB_EPORTERR;
-    }
-  else
-    {
-      pvMBFrameStartCur = eMBTCPStart;
-      pvMBFrameStopCur = eMBTCPStop;
-      peMBFrameReceiveCur = eMBTCPReceive;
-      peMBFrameSendCur = eMBTCPSend;
-#ifdef CONFIG_MB_HAVE_CLOSE
-      pvMBFrameCloseCur = vMBTCPPortClose;
-#else
-      pvMBFrameCloseCur = NULL;
-#endif
-      ucMBAddress = MB_TCP_PSEUDO_ADDRESS;
-      eMBCurrentMode = MB_TCP;
-      eMBState = STATE_DISABLED;
-    }
-
-  return eStatus;
-}
-#endif
-
-eMBErrorCode eMBRegisterCB(uint8_t ucFunctionCode, pxMBFunctionHandler pxHandler)
+static eMBErrorCode
+  prveMBInstanceRegister(xMBInstance *pxInst, uint8_t ucFunctionCode,
+                         pxMBFunctionHandler pxHandler,
+                         pxMBInstFunctionHandler pxInstHandler)
 {
+  xMBInstanceHandler *pxEntry;
   eMBErrorCode  eStatus;
   int           i;
 
   if ((0 < ucFunctionCode) && (ucFunctionCode <= 127))
     {
       ENTER_CRITICAL_SECTION();
-      if (pxHandler != NULL)
+      prvvMBInstanceDefaults(pxInst);
+
+      if (pxHandler != NULL || pxInstHandler != NULL)
         {
           for (i = 0; i < CONFIG_MB_FUNC_HANDLERS_MAX; i++)
             {
-              if ((xFuncHandlers[i].pxHandler == NULL) ||
-                  (xFuncHandlers[i].pxHandler == pxHandler))
+              pxEntry = &pxInst->xFuncHandlers[i];
+              if ((pxEntry->pxHandler == NULL &&
+                   pxEntry->pxInstHandler == NULL) ||
+                  (pxHandler != NULL && pxEntry->pxHandler == pxHandler) ||
+                  (pxInstHandler != NULL &&
+                   pxEntry->pxInstHandler == pxInstHandler))
                 {
-                  xFuncHandlers[i].ucFunctionCode = ucFunctionCode;
-                  xFuncHandlers[i].pxHandler = pxHandler;
+                  pxEntry->ucFunctionCode = ucFunctionCode;
+                  pxEntry->pxHandler = pxHandler;
+                  pxEntry->pxInstHandler = pxInstHandler;
                   break;
                 }
             }
+
           eStatus = (i != CONFIG_MB_FUNC_HANDLERS_MAX) ? MB_ENOERR : MB_ENORES;
         }
       else
         {
           for (i = 0; i < CONFIG_MB_FUNC_HANDLERS_MAX; i++)
             {
-              if (xFuncHandlers[i].ucFunctionCode == ucFunctionCode)
+              pxEntry = &pxInst->xFuncHandlers[i];
+              if (pxEntry->ucFunctionCode == ucFunctionCode)
                 {
-                  xFuncHandlers[i].ucFunctionCode = 0;
-                  xFuncHandlers[i].pxHandler = NULL;
+                  pxEntry->ucFunctionCode = 0;
+                  pxEntry->pxHandler = NULL;
+                  pxEntry->pxInstHandler = NULL;
                   break;
                 }
             }
@@ -289,81 +458,47 @@ eMBErrorCode eMBRegisterCB(uint8_t ucFunctionCode, pxMBFunctionHandler pxHandler
   return eStatus;
 }
 
-eMBErrorCode eMBClose(void)
-{
-  eMBErrorCode eStatus = MB_ENOERR;
-
-  if (eMBState == STATE_DISABLED)
-    {
-      if (pvMBFrameCloseCur != NULL)
-        {
-          pvMBFrameCloseCur();
-        }
-    }
-  else
-    {
-      eStatus = MB_EILLSTATE;
-    }
-
-  return eStatus;
-}
-
-eMBErrorCode eMBEnable(void)
+static eMBException prveMBInstanceExecute(xMBInstance *pxInst,
+                                          uint8_t ucFunctionCode)
 {
-  eMBErrorCode eStatus = MB_ENOERR;
+  xMBInstanceHandler *pxEntry;
+  int i;
 
-  if (eMBState == STATE_DISABLED)
+  for (i = 0; i < CONFIG_MB_FUNC_HANDLERS_MAX; i++)
     {
-      /* Activate the protocol stack. */
+      pxEntry = &pxInst->xFuncHandlers[i];
 
-      pvMBFrameStartCur();
-      eMBState = STATE_ENABLED;
-    }
-  else
-    {
-      eStatus = MB_EILLSTATE;
-    }
+      /* No more function handlers registered. Abort. */
 
-  return eStatus;
-}
-
-eMBErrorCode eMBDisable(void)
-{
-  eMBErrorCode  eStatus;
+      if (pxEntry->ucFunctionCode == 0)
+        {
+          break;
+        }
+      else if (pxEntry->ucFunctionCode == ucFunctionCode)
+        {
+          if (pxEntry->pxInstHandler != NULL)
+            {
+              return pxEntry->pxInstHandler(pxInst, pxInst->pucMBFrame,
+                                            &pxInst->usLength);
+            }
 
-  if (eMBState == STATE_ENABLED)
-    {
-      pvMBFrameStopCur();
-      eMBState = STATE_DISABLED;
-      eStatus = MB_ENOERR;
-    }
-  else if (eMBState == STATE_DISABLED)
-    {
-      eStatus = MB_ENOERR;
-    }
-  else
-    {
-      eStatus = MB_EILLSTATE;
+          return pxEntry->pxHandler(pxInst->pucMBFrame, &pxInst->usLength);
+        }
     }
 
-  return eStatus;
+  return MB_EX_ILLEGAL_FUNCTION;
 }
 
-eMBErrorCode eMBPoll(void)
+static eMBErrorCode prveMBInstancePoll(xMBInstance *pxInst, bool bWait)
 {
-  static uint8_t     *ucMBFrame;
-  static uint8_t      ucRcvAddress;
-  static uint8_t      ucFunctionCode;
-  static uint16_t     usLength;
-  static eMBException eException;
-
-  int             i;
-  eMBErrorCode    eStatus = MB_ENOERR;
+  uint8_t         ucFunctionCode;
+  eMBException    eException;
+  eMBErrorCode    eStatus;
   eMBEventType    eEvent;
 
   /* Check if the protocol stack is ready. */
 
-  if (eMBState != STATE_ENABLED)
+  if (pxInst->eMBState != STATE_ENABLED)
     {
       return MB_EILLSTATE;
     }
@@ -372,7 +507,7 @@ eMBErrorCode eMBPoll(void)
    * Otherwise we will handle the event.
    */
 
-  if (xMBPortEventGet(&eEvent) == true)
+  if (xMBInstPortEventGet(pxInst, &eEvent, bWait) == true)
     {
       switch (eEvent)
         {
@@ -380,58 +515,65 @@ eMBErrorCode eMBPoll(void)
           break;
 
         case EV_FRAME_RECEIVED:
-          eStatus = peMBFrameReceiveCur(&ucRcvAddress, &ucMBFrame, &usLength);
+          eStatus = pxInst->peMBFrameReceiveCur(pxInst, &pxInst->ucRcvAddress,
+                                                &pxInst->pucMBFrame,
+                                                &pxInst->usLength);
           if (eStatus == MB_ENOERR)
             {
               /* Check if the frame is for us. If not ignore the frame. */
 
-              if ((ucRcvAddress == ucMBAddress) || (ucRcvAddress == MB_ADDRESS_BROADCAST))
+              if ((pxInst->ucRcvAddress == pxInst->ucMBAddress) ||
+                  (pxInst->ucRcvAddress == MB_ADDRESS_BROADCAST))
                 {
-                  (void)xMBPortEventPost(EV_EXECUTE);
+                  pxInst->xStats.ulFramesReceived++;
+                  (void)xMBInstPortEventPost(pxInst, EV_EXECUTE);
                 }
+              else
+                {
+                  pxInst->xStats.ulFramesIgnored++;
+                }
+            }
+          else
+            {
+              pxInst->xStats.ulFrameErrors++;
             }
             break;
 
         case EV_EXECUTE:
-          ucFunctionCode = ucMBFrame[MB_PDU_FUNC_OFF];
-          eException = MB_EX_ILLEGAL_FUNCTION;
-          for( i = 0; i < CONFIG_MB_FUNC_HANDLERS_MAX; i++)
-            {
-              /* No more function handlers registered. Abort. */
-
-              if (xFuncHandlers[i].ucFunctionCode == 0)
-                {
-                  break;
-                }
-              else if (xFuncHandlers[i].ucFunctionCode == ucFunctionCode)
-                {
-                  eException = xFuncHandlers[i].pxHandler(ucMBFrame, &usLength);
-                  break;
-                }
-            }
+          ucFunctionCode = pxInst->pucMBFrame[MB_PDU_FUNC_OFF];
+          eException = prveMBInstanceExecute(pxInst, ucFunctionCode);
 
           /* If the request was not sent to the broadcast address we
            * return a reply.
            */
 
-          if (ucRcvAddress != MB_ADDRESS_BROADCAST)
+          if (pxInst->ucRcvAddress != MB_ADDRESS_BROADCAST)
             {
               if (eException != MB_EX_NONE)
                 {
                   /* An exception occured. Build an error frame. */
 
-                  usLength = 0;
-                  ucMBFrame[usLength++] = (uint8_t)(ucFunctionCode | MB_FUNC_ERROR);
-                  ucMBFrame[usLength++] = eException;
+                  pxInst->usLength = 0;
+                  pxInst->pucMBFrame[pxInst->usLength++] =
+                    (uint8_t)(ucFunctionCode | MB_FUNC_ERROR);
+                  pxInst->pucMBFrame[pxInst->usLength++] = eException;
+                  pxInst->xStats.ulExceptions++;
                 }
 
 #ifdef CONFIG_MB_ASCII_ENABLED
-              if ((eMBCurrentMode == MB_ASCII) && CONFIG_MB_ASCII_TIMEOUT_WAIT_BEFORE_SEND_MS)
+              if ((pxInst->eMBCurrentMode == MB_ASCII) &&
+                  CONFIG_MB_ASCII_TIMEOUT_WAIT_BEFORE_SEND_MS)
                 {
                   vMBPortTimersDelay(CONFIG_MB_ASCII_TIMEOUT_WAIT_BEFORE_SEND_MS);
                 }
 #endif
-              (void)peMBFrameSendCur(ucMBAddress, ucMBFrame, usLength);
+              eStatus = pxInst->peMBFrameSendCur(pxInst, pxInst->ucMBAddress,
+                                                 pxInst->pucMBFrame,
+                                                 pxInst->usLength);
+              if (eStatus == MB_ENOERR)
+                {
+                  pxInst->xStats.ulFramesSent++;
+                }
             }
             break;
 
@@ -442,3 +584,262 @@ eMBErrorCode eMBPoll(void)
 
   return MB_ENOERR;
 }
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+xMBInstance *pxMBGetDefaultInstance(void)
+{
+  return &xMBDefaultInstance;
+}
+
+eMBErrorCode eMBInstanceInit(xMBInstance **ppxInst, eMBMode eMode,
+                             uint8_t ucSlaveAddress, uint8_t ucPort,
+                             speed_t ulBaudRate, eMBParity eParity)
+{
+  xMBInstance *pxInst;
+  eMBErrorCode eStatus;
+
+  pxInst = (xMBInstance *)calloc(1, sizeof(xMBInstance));
+  if (pxInst == NULL)
+    {
+      return MB_ENORES;
+    }
+
+  pxInst->iSerialFd = -1;
+
+  eStatus = prveMBInstanceSerialInit(pxInst, eMode, ucSlaveAddress, ucPort,
+                                     ulBaudRate, eParity);
+  if (eStatus != MB_ENOERR)
+    {
+      vMBInstPortClose(pxInst);
+      free(pxInst);
+      return eStatus;
+    }
+
+  pxInst->bAllocated = true;
+  *ppxInst = pxInst;
+  return MB_ENOERR;
+}
+
+eMBErrorCode eMBInit(eMBMode eMode, uint8_t ucSlaveAddress, uint8_t ucPort,
+                     speed_t ulBaudRate, eMBParity eParity)
+{
+  return prveMBInstanceSerialInit(&xMBDefaultInstance, eMode, ucSlaveAddress,
+                                  ucPort, ulBaudRate, eParity);
+}
+
+#ifdef CONFIG_MB_TCP_ENABLED
+eMBErrorCode eMBTCPInit(uint16_t ucTCPPort)
+{
+  xMBInstance *pxInst = &xMBDefaultInstance;
+  eMBErrorCode eStatus = MB_ENOERR;
+
+  prvvMBInstanceDefaults(pxInst);
+  pxInst->iSerialFd = -1;
+
+  if ((eStatus = eMBTCPDoInit(ucTCPPort)) != MB_ENOERR)
+    {
+      pxInst->eMBState = STATE_DISABLED;
+    }
+  else if (!xMBInstPortEventInit(pxInst))
+    {
+      /* Port dependent event module initialization failed. */
+
+      eStatus = MB_EPORTERR;
+    }
+  else
+    {
+      pxInst->pvMBFrameStartCur = prvvMBTCPStart;
+      pxInst->pvMBFrameStopCur = prvvMBTCPStop;
+      pxInst->peMBFrameReceiveCur = prveMBTCPReceive;
+      pxInst->peMBFrameSendCur = prveMBTCPSend;
+#ifdef CONFIG_MB_HAVE_CLOSE
+      pxInst->pvMBFrameCloseCur = prvvMBTCPClose;
+#else
+      pxInst->pvMBFrameCloseCur = NULL;
+#endif
+      pxInst->ucMBAddress = MB_TCP_PSEUDO_ADDRESS;
+      pxInst->eMBCurrentMode = MB_TCP;
+      pxInst->eMBState = STATE_DISABLED;
+    }
+
+  return eStatus;
+}
+#endif
+
+eMBErrorCode eMBInstanceRegisterCB(xMBInstance *pxInst,
+                                   uint8_t ucFunctionCode,
+                                   pxMBInstFunctionHandler pxHandler)
+{
+  return prveMBInstanceRegister(pxInst, ucFunctionCode, NULL, pxHandler);
+}
+
+eMBErrorCode eMBRegisterCB(uint8_t ucFunctionCode, pxMBFunctionHandler pxHandler)
+{
+  return prveMBInstanceRegister(&xMBDefaultInstance, ucFunctionCode,
+                                pxHandler, NULL);
+}
+
+eMBErrorCode eMBInstanceSetRegCB(xMBInstance *pxInst,
+                                 const xMBRegCallbacks *pxCallbacks,
+                                 void *pvArg)
+{
+  ENTER_CRITICAL_SECTION();
+  prvvMBInstanceDefaults(pxInst);
+
+  pxInst->xRegCB.peInput = pxCallbacks->peInput != NULL ?
+                           pxCallbacks->peInput : prveMBNoRegInput;
+  pxInst->xRegCB.peHolding = pxCallbacks->peHolding != NULL ?
+                             pxCallbacks->peHolding : prveMBNoRegHolding;
+  pxInst->xRegCB.peCoils = pxCallbacks->peCoils != NULL ?
+                           pxCallbacks->peCoils : prveMBNoRegHolding;
+  pxInst->xRegCB.peDiscrete = pxCallbacks->peDiscrete != NULL ?
+                              pxCallbacks->peDiscrete : prveMBNoRegDiscrete;
+  pxInst->pvArg = pvArg;
+
+  EXIT_CRITICAL_SECTION();
+  return MB_ENOERR;
+}
+
+void *pvMBInstanceGetArg(xMBInstance *pxInst)
+{
+  return pxInst->pvArg;
+}
+
+eMBErrorCode eMBInstanceGetStatistics(xMBInstance *pxInst,
+                                      xMBStatistics *pxStats, bool bClear)
+{
+  ENTER_CRITICAL_SECTION();
+
+  *pxStats = pxInst->xStats;
+  if (bClear)
+    {
+      memset(&pxInst->xStats, 0, sizeof(pxInst->xStats));
+    }
+
+  EXIT_CRITICAL_SECTION();
+  return MB_ENOERR;
+}
+
+eMBErrorCode eMBInstanceClose(xMBInstance *pxInst)
+{
+  eMBErrorCode eStatus = MB_ENOERR;
+
+  if (pxInst->eMBState == STATE_DISABLED)
+    {
+      if (pxInst->pvMBFrameCloseCur != NULL)
+        {
+          pxInst->pvMBFrameCloseCur(pxInst);
+        }
+
+      pxInst->eMBState = STATE_NOT_INITIALIZED;
+      if (pxInst != &xMBDefaultInstance && pxInst->bAllocated)
+        {
+          free(pxInst);
+        }
+    }
+  else
+    {
+      eStatus = MB_EILLSTATE;
+    }
+
+  return eStatus;
+}
+
+eMBErrorCode eMBClose(void)
+{
+  return eMBInstanceClose(&xMBDefaultInstance);
+}
+
+eMBErrorCode eMBInstanceEnable(xMBInstance *pxInst)
+{
+  eMBErrorCode eStatus = MB_ENOERR;
+
+  if (pxInst->eMBState == STATE_DISABLED)
+    {
+      /* Activate the protocol stack. */
+
+      pxInst->pvMBFrameStartCur(pxInst);
+      pxInst->eMBState = STATE_ENABLED;
+    }
+  else
+    {
+      eStatus = MB_EILLSTATE;
+    }
+
+  return eStatus;
+}
+
+eMBErrorCode eMBEnable(void)
+{
+  return eMBInstanceEnable(&xMBDefaultInstance);
+}
+
+eMBErrorCode eMBInstanceDisable(xMBInstance *pxInst)
+{
+  eMBErrorCode  eStatus;
+
+  if (pxInst->eMBState == STATE_ENABLED)
+    {
+      pxInst->pvMBFrameStopCur(pxInst);
+      pxInst->eMBState = STATE_DISABLED;
+
+      /* Drop a pending event, it is stale once the instance is enabled
+       * again.
+       */
+
+      (void)xMBInstPortEventInit(pxInst);
+      eStatus = MB_ENOERR;
+    }
+  else if (pxInst->eMBState == STATE_DISABLED)
+    {
+      eStatus = MB_ENOERR;
+    }
+  else
+    {
+      eStatus = MB_EILLSTATE;
+    }
+
+  return eStatus;
+}
+
+eMBErrorCode eMBDisable(void)
+{
+  return eMBInstanceDisable(&xMBDefaultInstance);
+}
+
+eMBErrorCode eMBInstancePoll(xMBInstance *pxInst)
+{
+  return prveMBInstancePoll(pxInst, true);
+}
+
+eMBErrorCode eMBPoll(void)
+{
+  return prveMBInstancePoll(&xMBDefaultInstance, true);
+}
+
+eMBErrorCode eMBPollInstances(xMBInstance *const *ppxInst, int iCount)
+{
+  int i;
+
+  /* One wait for all ports, then every instance processes what is already
+   * there without blocking the others.
+   */
+
+  if (!xMBPortSerialWaitInstances(ppxInst, iCount))
+    {
+      return MB_EPORTERR;
+    }
+
+  for (i = 0; i < iCount; i++)
+    {
+      if (ppxInst[i]->eMBState == STATE_ENABLED)
+        {
+          (void)prveMBInstancePoll(ppxInst[i], false);
+        }
+    }
+
+  return MB_ENOERR;
+}
@@ -105,6 +105,19 @@ bool(*pxMBMasterPortCBTimerExpired) (void);
 bool(*pxMBMasterFrameCBReceiveFSMCur) (void);
 bool(*pxMBMasterFrameCBTransmitFSMCur) (void);
 
+#ifdef CONFIG_MB_FUNC_OTHER_REP_SLAVEID_ENABLED
+/* The slave function handlers operate on a slave instance; the master
+ * reports the slave ID of the default instance.
+ */
+
+static eMBException prveMBMasterReportSlaveID(uint8_t *pucFrame,
+                                              uint16_t *pusLength)
+{
+  return eMBFuncReportSlaveID(pxMBGetDefaultInstance(), pucFrame,
+                              pusLength);
+}
+#endif
+
 /* An array of Modbus functions handlers which associates Modbus function
  * codes with implementing functions.
  */
@@ -114,7 +127,7 @@ static xMBFunctionHandler xMasterFuncHandlers[CONFIG_MB_FUNC_HANDLERS_MAX] = {
 
   /* TODO Add Master function define */
 
-  {MB_FUNC_OTHER_REPORT_SLAVEID, eMBFuncReportSlaveID},
+  {MB_FUNC_OTHER_REPORT_SLAVEID, prveMBMasterReportSlaveID},
 #endif
 #ifdef CONFIG_MB_MASTER_FUNC_READ_INPUT_ENABLED
   {MB_FUNC_READ_INPUT_REGISTER, eMBMasterFuncReadInputRegister},
@@ -0,0 +1,981 @@
+/****************************************************************************
+ * apps/modbus/mbsched_m.c
+ *
+ * FreeModbus Library: Modbus Master request scheduler
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <semaphore.h>
+
+#include "port.h"
+
+#include "modbus/mb.h"
+#include "modbus/mb_m.h"
+#include "modbus/mbframe.h"
+#include "modbus/mbproto.h"
+#include "modbus/mbport.h"
+
+#if defined(CONFIG_MB_RTU_MASTER) || defined(CONFIG_MB_ASCII_MASTER)
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_MB_MASTER_SCHED_QUEUE_SIZE
+#  define CONFIG_MB_MASTER_SCHED_QUEUE_SIZE 8
+#endif
+
+#ifndef CONFIG_MB_MASTER_SCHED_POLLS_MAX
+#  define CONFIG_MB_MASTER_SCHED_POLLS_MAX 32
+#endif
+
+#ifndef CONFIG_MB_MASTER_SCHED_WRITE_REGS_MAX
+#  define CONFIG_MB_MASTER_SCHED_WRITE_REGS_MAX 16
+#endif
+
+#ifndef CONFIG_MB_MASTER_SCHED_COALESCE_GAP
+#  define CONFIG_MB_MASTER_SCHED_COALESCE_GAP 0
+#endif
+
+#ifndef CONFIG_MB_MASTER_SCHED_COALESCE_WINDOW_MS
+#  define CONFIG_MB_MASTER_SCHED_COALESCE_WINDOW_MS 20
+#endif
+
+#ifndef CONFIG_MB_MASTER_SCHED_TIMEOUT_MIN_MS
+#  define CONFIG_MB_MASTER_SCHED_TIMEOUT_MIN_MS 20
+#endif
+
+#ifndef CONFIG_MB_MASTER_SCHED_DEAD_FAILURES
+#  define CONFIG_MB_MASTER_SCHED_DEAD_FAILURES 3
+#endif
+
+#ifndef CONFIG_MB_MASTER_SCHED_BACKOFF_MIN_MS
+#  define CONFIG_MB_MASTER_SCHED_BACKOFF_MIN_MS 1000
+#endif
+
+#ifndef CONFIG_MB_MASTER_SCHED_BACKOFF_MAX_MS
+#  define CONFIG_MB_MASTER_SCHED_BACKOFF_MAX_MS 30000
+#endif
+
+#ifndef CONFIG_MB_MASTER_TIMEOUT_MS_RESPOND
+#  define MB_MASTER_TIMEOUT_MS_RESPOND 1000
+#else
+#  define MB_MASTER_TIMEOUT_MS_RESPOND CONFIG_MB_MASTER_TIMEOUT_MS_RESPOND
+#endif
+
+#define MB_SCHED_READ_REGS_MAX  125     /* Registers in one read request */
+#define MB_SCHED_READ_BITS_MAX  2000    /* Coils/inputs in one read request */
+
+#define MB_PDU_REQ_ADDR_OFF     (MB_PDU_DATA_OFF + 0)
+#define MB_PDU_REQ_CNT_OFF      (MB_PDU_DATA_OFF + 2)
+#define MB_PDU_REQ_BYTECNT_OFF  (MB_PDU_DATA_OFF + 4)
+#define MB_PDU_REQ_VALUES_OFF   (MB_PDU_DATA_OFF + 5)
+
+/* Wrap-safe "a is not later than b" for millisecond timestamps */
+
+#define MB_SCHED_TIME_AFTER_EQ(a, b) ((int32_t)((a) - (b)) >= 0)
+
+/****************************************************************************
+ * Private Type Definitions
+ ****************************************************************************/
+
+typedef struct
+{
+  uint8_t ucSlave;
+  uint8_t ucFunction;
+  uint16_t usRegAddr;
+  uint16_t usNRegs;
+  uint16_t usData[CONFIG_MB_MASTER_SCHED_WRITE_REGS_MAX];
+  pvMBMasterSchedCB pvCB;
+  void *pvArg;
+} xMBSchedRequest;
+
+typedef struct
+{
+  bool bUsed;
+  bool bBatched;              /* Part of the request in flight */
+  bool bNotify;               /* Completion callback pending */
+  uint8_t ucSlave;
+  uint8_t ucFunction;
+  uint16_t usRegAddr;
+  uint16_t usNRegs;
+  uint32_t ulPeriodMs;
+  uint32_t ulNextMs;
+  eMBMasterReqErrCode eResult;
+  pvMBMasterSchedCB pvCB;
+  void *pvArg;
+} xMBSchedPoll;
+
+typedef struct
+{
+  uint32_t ulRttUs;           /* Smoothed round trip time, 0 if unknown */
+  uint32_t ulRttVarUs;        /* Round trip time variation */
+  uint32_t ulBackoffMs;       /* Current backoff while dead */
+  uint32_t ulRetryMs;         /* Next probe time while dead */
+  uint8_t ucFailures;         /* Consecutive timeouts */
+  bool bDead;
+} xMBSchedSlave;
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static sem_t xSchedLock;
+static bool bSchedInitialized;
+
+static xMBSchedRequest xQueue[CONFIG_MB_MASTER_SCHED_QUEUE_SIZE];
+static uint8_t ucQueueHead;
+static uint8_t ucQueueCount;
+
+static xMBSchedPoll xPolls[CONFIG_MB_MASTER_SCHED_POLLS_MAX];
+static xMBSchedSlave xSlaves[CONFIG_MB_MASTER_TOTAL_SLAVE_NUM + 1];
+
+/* The request on the bus.  Only the master poll task touches it. */
+
+static bool bInFlight;
+static bool bInFlightPoll;
+static xMBSchedRequest xInFlight;
+static struct timespec xInFlightStart;
+
+static xMBMasterSchedStats xStats;
+static uint32_t ulBusyUs;
+static struct timespec xStatsStart;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void prvvMBSchedLock(void)
+{
+  while (sem_wait(&xSchedLock) != OK)
+    {
+    }
+}
+
+static void prvvMBSchedUnlock(void)
+{
+  sem_post(&xSchedLock);
+}
+
+static uint32_t prvulMBSchedElapsedUs(const struct timespec *pxFrom,
+                                      const struct timespec *pxTo)
+{
+  return (uint32_t)((pxTo->tv_sec - pxFrom->tv_sec) * 1000000L +
+                    (pxTo->tv_nsec - pxFrom->tv_nsec) / 1000L);
+}
+
+static uint32_t prvulMBSchedNowMs(struct timespec *pxNow)
+{
+  clock_gettime(CLOCK_MONOTONIC, pxNow);
+  return (uint32_t)(pxNow->tv_sec * 1000 + pxNow->tv_nsec / 1000000);
+}
+
+static bool prvbMBSchedIsRead(uint8_t ucFunction)
+{
+  return ucFunction == MB_FUNC_READ_COILS ||
+         ucFunction == MB_FUNC_READ_DISCRETE_INPUTS ||
+         ucFunction == MB_FUNC_READ_HOLDING_REGISTER ||
+         ucFunction == MB_FUNC_READ_INPUT_REGISTER;
+}
+
+static uint16_t prvusMBSchedReadMax(uint8_t ucFunction)
+{
+  return ucFunction == MB_FUNC_READ_COILS ||
+         ucFunction == MB_FUNC_READ_DISCRETE_INPUTS ?
+         MB_SCHED_READ_BITS_MAX : MB_SCHED_READ_REGS_MAX;
+}
+
+/* A response can only be processed if the master has a handler for the
+ * function, so refuse requests for functions that are configured out.
+ */
+
+static bool prvbMBSchedSupported(uint8_t ucFunction)
+{
+  switch (ucFunction)
+    {
+#ifdef CONFIG_MB_MASTER_FUNC_READ_COILS_ENABLED
+    case MB_FUNC_READ_COILS:
+#endif
+#ifdef CONFIG_MB_MASTER_FUNC_READ_DISCRETE_INPUTS_ENABLED
+    case MB_FUNC_READ_DISCRETE_INPUTS:
+#endif
+#ifdef CONFIG_MB_MASTER_FUNC_READ_HOLDING_ENABLED
+    case MB_FUNC_READ_HOLDING_REGISTER:
+#endif
+#ifdef CONFIG_MB_MASTER_FUNC_READ_INPUT_ENABLED
+    case MB_FUNC_READ_INPUT_REGISTER:
+#endif
+#ifdef CONFIG_MB_MASTER_FUNC_WRITE_COIL_ENABLED
+    case MB_FUNC_WRITE_SINGLE_COIL:
+#endif
+#ifdef CONFIG_MB_MASTER_FUNC_WRITE_HOLDING_ENABLED
+    case MB_FUNC_WRITE_REGISTER:
+#endif
+#ifdef CONFIG_MB_MASTER_FUNC_WRITE_MULTIPLE_HOLDING_ENABLED
+    case MB_FUNC_WRITE_MULTIPLE_REGISTERS:
+#endif
+      return true;
+
+    default:
+      return false;
+    }
+}
+
+/* Response timeout for a slave: smoothed RTT plus four deviations, as for
+ * TCP retransmission timers, bounded by the configured respond timeout.
+ */
+
+static uint32_t prvulMBSchedTimeoutMs(uint8_t ucSlave)
+{
+  xMBSchedSlave *pxSlave;
+  uint32_t ulTimeoutMs;
+
+  if (ucSlave == 0)
+    {
+      return MB_MASTER_TIMEOUT_MS_RESPOND;
+    }
+
+  pxSlave = &xSlaves[ucSlave];
+  if (pxSlave->ulRttUs == 0)
+    {
+      return MB_MASTER_TIMEOUT_MS_RESPOND;
+    }
+
+  ulTimeoutMs = (pxSlave->ulRttUs + 4 * pxSlave->ulRttVarUs) / 1000 + 1;
+  if (ulTimeoutMs < CONFIG_MB_MASTER_SCHED_TIMEOUT_MIN_MS)
+    {
+      ulTimeoutMs = CONFIG_MB_MASTER_SCHED_TIMEOUT_MIN_MS;
+    }
+  else if (ulTimeoutMs > MB_MASTER_TIMEOUT_MS_RESPOND)
+    {
+      ulTimeoutMs = MB_MASTER_TIMEOUT_MS_RESPOND;
+    }
+
+  return ulTimeoutMs;
+}
+
+/* Check whether a slave is backing off.  Returns false once the backoff has
+ * elapsed so that the next request probes the slave.
+ */
+
+static bool prvbMBSchedBackingOff(uint8_t ucSlave, uint32_t ulNowMs)
+{
+  xMBSchedSlave *pxSlave = &xSlaves[ucSlave];
+
+  if (ucSlave == 0 || !pxSlave->bDead)
+    {
+      return false;
+    }
+
+  return !MB_SCHED_TIME_AFTER_EQ(ulNowMs, pxSlave->ulRetryMs);
+}
+
+static void prvvMBSchedUpdateSlave(uint8_t ucSlave,
+                                   eMBMasterReqErrCode eErrStatus,
+                                   uint32_t ulRttUs, uint32_t ulNowMs)
+{
+  xMBSchedSlave *pxSlave = &xSlaves[ucSlave];
+  uint32_t ulDelta;
+
+  if (ucSlave == 0)
+    {
+      return;
+    }
+
+  if (eErrStatus == MB_MRE_TIMEDOUT)
+    {
+      if (pxSlave->ucFailures < UINT8_MAX)
+        {
+          pxSlave->ucFailures++;
+        }
+
+      if (pxSlave->ucFailures >= CONFIG_MB_MASTER_SCHED_DEAD_FAILURES)
+        {
+          if (!pxSlave->bDead)
+            {
+              pxSlave->bDead = true;
+              pxSlave->ulBackoffMs = CONFIG_MB_MASTER_SCHED_BACKOFF_MIN_MS;
+            }
+          else if (pxSlave->ulBackoffMs <
+                   CONFIG_MB_MASTER_SCHED_BACKOFF_MAX_MS / 2)
+            {
+              pxSlave->ulBackoffMs *= 2;
+            }
+          else
+            {
+              pxSlave->ulBackoffMs = CONFIG_MB_MASTER_SCHED_BACKOFF_MAX_MS;
+            }
+
+          pxSlave->ulRetryMs = ulNowMs + pxSlave->ulBackoffMs;
+        }
+
+      return;
+    }
+
+  /* Any answer, even a corrupted one, means the slave is alive. */
+
+  pxSlave->ucFailures = 0;
+  pxSlave->bDead = false;
+  pxSlave->ulBackoffMs = 0;
+
+  if (eErrStatus == MB_MRE_REV_DATA)
+    {
+      return;
+    }
+
+  if (pxSlave->ulRttUs == 0)
+    {
+      pxSlave->ulRttUs = ulRttUs;
+      pxSlave->ulRttVarUs = ulRttUs / 2;
+    }
+  else
+    {
+      ulDelta = ulRttUs > pxSlave->ulRttUs ? ulRttUs - pxSlave->ulRttUs :
+                                             pxSlave->ulRttUs - ulRttUs;
+      pxSlave->ulRttVarUs = (3 * pxSlave->ulRttVarUs + ulDelta) / 4;
+      pxSlave->ulRttUs = (7 * pxSlave->ulRttUs + ulRttUs) / 8;
+    }
+}
+
+/* Mark polls of the in-flight slave/function that can share its request and
+ * widen the request to cover them.  Called with the lock held.
+ */
+
+static void prvvMBSchedCoalesce(xMBSchedRequest *pxReq, uint32_t ulNowMs)
+{
+  xMBSchedPoll *pxPoll;
+  uint32_t ulLo = pxReq->usRegAddr;
+  uint32_t ulHi = ulLo + pxReq->usNRegs;
+  uint32_t ulNewLo;
+  uint32_t ulNewHi;
+  uint16_t usMax = prvusMBSchedReadMax(pxReq->ucFunction);
+  bool bChanged;
+  int i;
+
+  do
+    {
+      bChanged = false;
+      for (i = 0; i < CONFIG_MB_MASTER_SCHED_POLLS_MAX; i++)
+        {
+          pxPoll = &xPolls[i];
+          if (!pxPoll->bUsed || pxPoll->bBatched ||
+              pxPoll->ucSlave != pxReq->ucSlave ||
+              pxPoll->ucFunction != pxReq->ucFunction ||
+              !MB_SCHED_TIME_AFTER_EQ(ulNowMs +
+                                      CONFIG_MB_MASTER_SCHED_COALESCE_WINDOW_MS,
+                                      pxPoll->ulNextMs))
+            {
+              continue;
+            }
+
+          if (pxPoll->usRegAddr > ulHi + CONFIG_MB_MASTER_SCHED_COALESCE_GAP ||
+              pxPoll->usRegAddr + pxPoll->usNRegs +
+              CONFIG_MB_MASTER_SCHED_COALESCE_GAP < ulLo)
+            {
+              continue;
+            }
+
+          ulNewLo = pxPoll->usRegAddr < ulLo ? pxPoll->usRegAddr : ulLo;
+          ulNewHi = pxPoll->usRegAddr + pxPoll->usNRegs > ulHi ?
+                    pxPoll->usRegAddr + pxPoll->usNRegs : ulHi;
+          if (ulNewHi - ulNewLo > usMax)
+            {
+              continue;
+            }
+
+          ulLo = ulNewLo;
+          ulHi = ulNewHi;
+          pxPoll->bBatched = true;
+          xStats.ulCoalesced++;
+          bChanged = true;
+        }
+    }
+  while (bChanged);
+
+  pxReq->usRegAddr = (uint16_t)ulLo;
+  pxReq->usNRegs = (uint16_t)(ulHi - ulLo);
+}
+
+static void prvvMBSchedPollDone(xMBSchedPoll *pxPoll,
+                                eMBMasterReqErrCode eErrStatus,
+                                uint32_t ulNowMs)
+{
+  pxPoll->bBatched = false;
+  pxPoll->bNotify = pxPoll->pvCB != NULL;
+  pxPoll->eResult = eErrStatus;
+
+  /* Keep the phase unless the poll fell a full period behind. */
+
+  pxPoll->ulNextMs += pxPoll->ulPeriodMs;
+  if (MB_SCHED_TIME_AFTER_EQ(ulNowMs, pxPoll->ulNextMs))
+    {
+      pxPoll->ulNextMs = ulNowMs + pxPoll->ulPeriodMs;
+    }
+}
+
+/* Pick the next request: queued requests first, then the most overdue poll.
+ * Requests for a backing off slave are completed as timed out on the spot.
+ * Called with the lock held.  Returns false if there is nothing to send.
+ */
+
+static bool prvbMBSchedNext(uint32_t ulNowMs, xMBSchedRequest *pxSkipped,
+                            bool *pbSkipped)
+{
+  xMBSchedPoll *pxPoll;
+  xMBSchedPoll *pxBest;
+  int i;
+
+  *pbSkipped = false;
+
+  if (ucQueueCount > 0)
+    {
+      xMBSchedRequest *pxReq = &xQueue[ucQueueHead];
+
+      ucQueueHead = (ucQueueHead + 1) % CONFIG_MB_MASTER_SCHED_QUEUE_SIZE;
+      ucQueueCount--;
+
+      if (prvbMBSchedBackingOff(pxReq->ucSlave, ulNowMs))
+        {
+          *pxSkipped = *pxReq;
+          *pbSkipped = true;
+          xStats.ulSkipped++;
+          return false;
+        }
+
+      xInFlight = *pxReq;
+      bInFlightPoll = false;
+      return true;
+    }
+
+  for (; ; )
+    {
+      pxBest = NULL;
+      for (i = 0; i < CONFIG_MB_MASTER_SCHED_POLLS_MAX; i++)
+        {
+          pxPoll = &xPolls[i];
+          if (pxPoll->bUsed &&
+              MB_SCHED_TIME_AFTER_EQ(ulNowMs, pxPoll->ulNextMs) &&
+              (pxBest == NULL ||
+               !MB_SCHED_TIME_AFTER_EQ(pxPoll->ulNextMs, pxBest->ulNextMs)))
+            {
+              pxBest = pxPoll;
+            }
+        }
+
+      if (pxBest == NULL)
+        {
+          return false;
+        }
+
+      if (!prvbMBSchedBackingOff(pxBest->ucSlave, ulNowMs))
+        {
+          break;
+        }
+
+      prvvMBSchedPollDone(pxBest, MB_MRE_TIMEDOUT, ulNowMs);
+      xStats.ulSkipped++;
+    }
+
+  xInFlight.ucSlave = pxBest->ucSlave;
+  xInFlight.ucFunction = pxBest->ucFunction;
+  xInFlight.usRegAddr = pxBest->usRegAddr;
+  xInFlight.usNRegs = pxBest->usNRegs;
+  xInFlight.pvCB = NULL;
+  xInFlight.pvArg = NULL;
+  pxBest->bBatched = true;
+  bInFlightPoll = true;
+
+  prvvMBSchedCoalesce(&xInFlight, ulNowMs);
+  return true;
+}
+
+/* Build the PDU of the in-flight request and hand it to the master. */
+
+static void prvvMBSchedSend(void)
+{
+  uint8_t *ucMBFrame;
+  uint16_t usLen;
+  int i;
+
+  vMBMasterGetPDUSndBuf(&ucMBFrame);
+  vMBMasterSetDestAddress(xInFlight.ucSlave);
+
+  ucMBFrame[MB_PDU_FUNC_OFF] = xInFlight.ucFunction;
+  ucMBFrame[MB_PDU_REQ_ADDR_OFF] = xInFlight.usRegAddr >> 8;
+  ucMBFrame[MB_PDU_REQ_ADDR_OFF + 1] = xInFlight.usRegAddr;
+  usLen = MB_PDU_REQ_CNT_OFF + 2;
+
+  switch (xInFlight.ucFunction)
+    {
+    case MB_FUNC_WRITE_SINGLE_COIL:
+      ucMBFrame[MB_PDU_REQ_CNT_OFF] = xInFlight.usData[0] ? 0xff : 0x00;
+      ucMBFrame[MB_PDU_REQ_CNT_OFF + 1] = 0x00;
+      break;
+
+    case MB_FUNC_WRITE_REGISTER:
+      ucMBFrame[MB_PDU_REQ_CNT_OFF] = xInFlight.usData[0] >> 8;
+      ucMBFrame[MB_PDU_REQ_CNT_OFF + 1] = xInFlight.usData[0];
+      break;
+
+    case MB_FUNC_WRITE_MULTIPLE_REGISTERS:
+      ucMBFrame[MB_PDU_REQ_CNT_OFF] = xInFlight.usNRegs >> 8;
+      ucMBFrame[MB_PDU_REQ_CNT_OFF + 1] = xInFlight.usNRegs;
+      ucMBFrame[MB_PDU_REQ_BYTECNT_OFF] = xInFlight.usNRegs * 2;
+      for (i = 0; i < xInFlight.usNRegs; i++)
+        {
+          ucMBFrame[MB_PDU_REQ_VALUES_OFF + 2 * i] = xInFlight.usData[i] >> 8;
+          ucMBFrame[MB_PDU_REQ_VALUES_OFF + 2 * i + 1] = xInFlight.usData[i];
+        }
+
+      usLen = MB_PDU_REQ_VALUES_OFF + 2 * xInFlight.usNRegs;
+      break;
+
+    default:
+      ucMBFrame[MB_PDU_REQ_CNT_OFF] = xInFlight.usNRegs >> 8;
+      ucMBFrame[MB_PDU_REQ_CNT_OFF + 1] = xInFlight.usNRegs;
+      break;
+    }
+
+  vMBMasterSetPDUSndLength(usLen);
+  vMBMasterPortTimersSetRespondTimeout(
+    prvulMBSchedTimeoutMs(xInFlight.ucSlave));
+  vMBMasterPolledRequest();
+  (void)xMBMasterPortEventPost(EV_MASTER_FRAME_SENT);
+}
+
+static void prvvMBSchedComplete(eMBMasterReqErrCode eErrStatus)
+{
+  struct timespec xNow;
+  uint32_t ulNowMs = prvulMBSchedNowMs(&xNow);
+  uint32_t ulRttUs = prvulMBSchedElapsedUs(&xInFlightStart, &xNow);
+  int i;
+
+  bInFlight = false;
+
+  /* Blocking eMBMasterReq*() calls use the configured timeout again */
+
+  vMBMasterPortTimersSetRespondTimeout(0);
+
+  prvvMBSchedLock();
+
+  ulBusyUs += ulRttUs;
+  xStats.ulBusyMs += ulBusyUs / 1000;
+  ulBusyUs %= 1000;
+
+  switch (eErrStatus)
+    {
+    case MB_MRE_NO_ERR:
+      xStats.ulCompleted++;
+      break;
+
+    case MB_MRE_TIMEDOUT:
+      xStats.ulTimeouts++;
+      break;
+
+    default:
+      xStats.ulErrors++;
+      break;
+    }
+
+  prvvMBSchedUpdateSlave(xInFlight.ucSlave, eErrStatus, ulRttUs, ulNowMs);
+
+  if (bInFlightPoll)
+    {
+      for (i = 0; i < CONFIG_MB_MASTER_SCHED_POLLS_MAX; i++)
+        {
+          if (xPolls[i].bUsed && xPolls[i].bBatched)
+            {
+              prvvMBSchedPollDone(&xPolls[i], eErrStatus, ulNowMs);
+            }
+        }
+    }
+
+  prvvMBSchedUnlock();
+
+  if (!bInFlightPoll && xInFlight.pvCB != NULL)
+    {
+      xInFlight.pvCB(xInFlight.pvArg, xInFlight.ucSlave, eErrStatus);
+    }
+}
+
+/* Run the completion callbacks of finished polls without holding the lock,
+ * so that callbacks may use the scheduler API.
+ */
+
+static void prvvMBSchedNotify(void)
+{
+  pvMBMasterSchedCB pvCB;
+  void *pvArg;
+  uint8_t ucSlave;
+  eMBMasterReqErrCode eResult;
+  int i;
+
+  for (i = 0; i < CONFIG_MB_MASTER_SCHED_POLLS_MAX; i++)
+    {
+      if (!xPolls[i].bNotify)
+        {
+          continue;
+        }
+
+      prvvMBSchedLock();
+      pvCB = NULL;
+      if (xPolls[i].bUsed && xPolls[i].bNotify)
+        {
+          pvCB = xPolls[i].pvCB;
+          pvArg = xPolls[i].pvArg;
+          ucSlave = xPolls[i].ucSlave;
+          eResult = xPolls[i].eResult;
+        }
+
+      xPolls[i].bNotify = false;
+      prvvMBSchedUnlock();
+
+      if (pvCB != NULL)
+        {
+          pvCB(pvArg, ucSlave, eResult);
+        }
+    }
+}
+
+static void prvvMBSchedDispatch(void)
+{
+  struct timespec xNow;
+  xMBSchedRequest xSkipped;
+  uint32_t ulNowMs;
+  bool bSkipped;
+  bool bSend;
+
+  /* The bus may be in use by a blocking eMBMasterReq*() call. */
+
+  if (!xMBMasterRunResTake(0))
+    {
+      return;
+    }
+
+  ulNowMs = prvulMBSchedNowMs(&xNow);
+
+  prvvMBSchedLock();
+  bSend = prvbMBSchedNext(ulNowMs, &xSkipped, &bSkipped);
+  if (bSend)
+    {
+      xStats.ulRequests++;
+    }
+
+  prvvMBSchedUnlock();
+
+  if (!bSend)
+    {
+      vMBMasterRunResRelease();
+      if (bSkipped && xSkipped.pvCB != NULL)
+        {
+          xSkipped.pvCB(xSkipped.pvArg, xSkipped.ucSlave, MB_MRE_TIMEDOUT);
+        }
+
+      return;
+    }
+
+  bInFlight = true;
+  xInFlightStart = xNow;
+  prvvMBSchedSend();
+}
+
+static eMBErrorCode prveMBSchedCheck(uint8_t ucSlave, uint8_t ucFunction,
+                                     uint16_t usRegAddr, uint16_t usNRegs)
+{
+  if (!bSchedInitialized || ucSlave > CONFIG_MB_MASTER_TOTAL_SLAVE_NUM ||
+      !prvbMBSchedSupported(ucFunction))
+    {
+      return MB_EINVAL;
+    }
+
+  if (prvbMBSchedIsRead(ucFunction))
+    {
+      if (ucSlave == 0 || usNRegs == 0 ||
+          usNRegs > prvusMBSchedReadMax(ucFunction) ||
+          (uint32_t)usRegAddr + usNRegs > 0x10000)
+        {
+          return MB_EINVAL;
+        }
+    }
+  else if (ucFunction == MB_FUNC_WRITE_MULTIPLE_REGISTERS &&
+           (usNRegs == 0 || usNRegs > CONFIG_MB_MASTER_SCHED_WRITE_REGS_MAX))
+    {
+      return MB_EINVAL;
+    }
+
+  return MB_ENOERR;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+eMBErrorCode eMBMasterSchedInit(void)
+{
+  struct timespec xNow;
+
+  if (!bSchedInitialized)
+    {
+      if (sem_init(&xSchedLock, 0, 1) != OK)
+        {
+          return MB_ENORES;
+        }
+
+      bSchedInitialized = true;
+    }
+
+  prvvMBSchedLock();
+  memset(xPolls, 0, sizeof(xPolls));
+  memset(xSlaves, 0, sizeof(xSlaves));
+  memset(&xStats, 0, sizeof(xStats));
+  ucQueueHead = 0;
+  ucQueueCount = 0;
+  ulBusyUs = 0;
+  bInFlight = false;
+  (void)prvulMBSchedNowMs(&xNow);
+  xStatsStart = xNow;
+  prvvMBSchedUnlock();
+
+  return MB_ENOERR;
+}
+
+eMBErrorCode eMBMasterSchedAddPoll(uint8_t ucSlave, uint8_t ucFunction,
+                                   uint16_t usRegAddr, uint16_t usNRegs,
+                                   uint32_t ulPeriodMs,
+                                   pvMBMasterSchedCB pvCB, void *pvArg,
+                                   int *piHandle)
+{
+  struct timespec xNow;
+  eMBErrorCode eStatus;
+  int i;
+
+  eStatus = prveMBSchedCheck(ucSlave, ucFunction, usRegAddr, usNRegs);
+  if (eStatus != MB_ENOERR || !prvbMBSchedIsRead(ucFunction) ||
+      ulPeriodMs == 0)
+    {
+      return MB_EINVAL;
+    }
+
+  eStatus = MB_ENORES;
+
+  prvvMBSchedLock();
+  for (i = 0; i < CONFIG_MB_MASTER_SCHED_POLLS_MAX; i++)
+    {
+      if (!xPolls[i].bUsed)
+        {
+          memset(&xPolls[i], 0, sizeof(xPolls[i]));
+          xPolls[i].ucSlave = ucSlave;
+          xPolls[i].ucFunction = ucFunction;
+          xPolls[i].usRegAddr = usRegAddr;
+          xPolls[i].usNRegs = usNRegs;
+          xPolls[i].ulPeriodMs = ulPeriodMs;
+          xPolls[i].ulNextMs = prvulMBSchedNowMs(&xNow);
+          xPolls[i].pvCB = pvCB;
+          xPolls[i].pvArg = pvArg;
+          xPolls[i].bUsed = true;
+
+          if (piHandle != NULL)
+            {
+              *piHandle = i;
+            }
+
+          eStatus = MB_ENOERR;
+          break;
+        }
+    }
+
+  prvvMBSchedUnlock();
+  return eStatus;
+}
+
+eMBErrorCode eMBMasterSchedRemovePoll(int iHandle)
+{
+  eMBErrorCode eStatus = MB_EINVAL;
+
+  if (!bSchedInitialized || iHandle < 0 ||
+      iHandle >= CONFIG_MB_MASTER_SCHED_POLLS_MAX)
+    {
+      return MB_EINVAL;
+    }
+
+  prvvMBSchedLock();
+  if (xPolls[iHandle].bUsed)
+    {
+      xPolls[iHandle].bUsed = false;
+      xPolls[iHandle].bBatched = false;
+      xPolls[iHandle].bNotify = false;
+      eStatus = MB_ENOERR;
+    }
+
+  prvvMBSchedUnlock();
+  return eStatus;
+}
+
+eMBErrorCode eMBMasterSchedSubmit(uint8_t ucSlave, uint8_t ucFunction,
+                                  uint16_t usRegAddr, uint16_t usNRegs,
+                                  const uint16_t *pusData,
+                                  pvMBMasterSchedCB pvCB, void *pvArg)
+{
+  xMBSchedRequest *pxReq;
+  eMBErrorCode eStatus;
+
+  eStatus = prveMBSchedCheck(ucSlave, ucFunction, usRegAddr, usNRegs);
+  if (eStatus != MB_ENOERR)
+    {
+      return eStatus;
+    }
+
+  if (!prvbMBSchedIsRead(ucFunction) && pusData == NULL)
+    {
+      return MB_EINVAL;
+    }
+
+  prvvMBSchedLock();
+  if (ucQueueCount >= CONFIG_MB_MASTER_SCHED_QUEUE_SIZE)
+    {
+      eStatus = MB_ENORES;
+    }
+  else
+    {
+      pxReq = &xQueue[(ucQueueHead + ucQueueCount) %
+                      CONFIG_MB_MASTER_SCHED_QUEUE_SIZE];
+      pxReq->ucSlave = ucSlave;
+      pxReq->ucFunction = ucFunction;
+      pxReq->usRegAddr = usRegAddr;
+      pxReq->usNRegs = usNRegs;
+      pxReq->pvCB = pvCB;
+      pxReq->pvArg = pvArg;
+
+      if (ucFunction == MB_FUNC_WRITE_MULTIPLE_REGISTERS)
+        {
+          memcpy(pxReq->usData, pusData, usNRegs * sizeof(uint16_t));
+        }
+      else if (!prvbMBSchedIsRead(ucFunction))
+        {
+          pxReq->usData[0] = pusData[0];
+          pxReq->usNRegs = 1;
+        }
+
+      ucQueueCount++;
+    }
+
+  prvvMBSchedUnlock();
+  return eStatus;
+}
+
+eMBErrorCode eMBMasterSchedPoll(void)
+{
+  eMBMasterReqErrCode eErrStatus;
+  eMBErrorCode eStatus;
+
+  if (!bSchedInitialized)
+    {
+      return MB_EILLSTATE;
+    }
+
+  eStatus = eMBMasterPoll();
+  if (eStatus != MB_ENOERR)
+    {
+      return eStatus;
+    }
+
+  /* The master posts the result and releases the bus in the same poll, so
+   * the next request can go out without another pass through the task.
+   */
+
+  if (bInFlight && xMBMasterRequestFinished(&eErrStatus))
+    {
+      prvvMBSchedComplete(eErrStatus);
+    }
+
+  if (!bInFlight)
+    {
+      prvvMBSchedDispatch();
+    }
+
+  prvvMBSchedNotify();
+  return MB_ENOERR;
+}
+
+eMBErrorCode eMBMasterSchedGetStats(xMBMasterSchedStats *pxStats,
+                                    bool bClear)
+{
+  struct timespec xNow;
+
+  if (!bSchedInitialized || pxStats == NULL)
+    {
+      return MB_EINVAL;
+    }
+
+  prvulMBSchedNowMs(&xNow);
+
+  prvvMBSchedLock();
+  xStats.ulElapsedMs = (uint32_t)((xNow.tv_sec - xStatsStart.tv_sec) * 1000 +
+                       (xNow.tv_nsec - xStatsStart.tv_nsec) / 1000000);
+  *pxStats = xStats;
+  if (bClear)
+    {
+      memset(&xStats, 0, sizeof(xStats));
+      ulBusyUs = 0;
+      xStatsStart = xNow;
+    }
+
+  prvvMBSchedUnlock();
+  return MB_ENOERR;
+}
+
+eMBErrorCode eMBMasterSchedGetSlaveInfo(uint8_t ucSlave, uint32_t *pulRttUs,
+                                        bool *pbDead)
+{
+  if (!bSchedInitialized || ucSlave == 0 ||
+      ucSlave > CONFIG_MB_MASTER_TOTAL_SLAVE_NUM)
+    {
+      return MB_EINVAL;
+    }
+
+  prvvMBSchedLock();
+  if (pulRttUs != NULL)
+    {
+      *pulRttUs = xSlaves[ucSlave].ulRttUs;
+    }
+
+  if (pbDead != NULL)
+    {
+      *pbDead = xSlaves[ucSlave].bDead;
+    }
+
+  prvvMBSchedUnlock();
+  return MB_ENOERR;
+}
+
+#endif /* defined(CONFIG_MB_RTU_MASTER) || defined(CONFIG_MB_ASCII_MASTER) */
@@ -0,0 +1,239 @@
+/****************************************************************************
+ * apps/modbus/nuttx/mbinstance.h
+ *
+ * FreeModbus Library: NuttX Port
+ * Copyright (c) 2006 Christian Walter <wolti@sil.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_MODBUS_NUTTX_MBINSTANCE_H
+#define __APPS_MODBUS_NUTTX_MBINSTANCE_H
+
+/* Private definition of a Modbus slave instance.  Everything the protocol,
+ * frame and port layers used to keep in file scope lives here, so that
+ * any number of instances can be served by one task.  Applications only
+ * see the opaque xMBInstance type declared in modbus/mb.h.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef CONFIG_SERIAL_TERMIOS
+#  include <termios.h>
+#endif
+
+#include "modbus/mb.h"
+#include "modbus/mbport.h"
+#include "modbus/mbproto.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define MB_INST_FRAME_SIZE        256   /* Largest RTU/ASCII frame */
+
+#ifdef CONFIG_MB_ASCII_ENABLED
+#  define MB_INST_SERIAL_BUF_SIZE 513   /* Must hold a complete ASCII frame */
+#else
+#  define MB_INST_SERIAL_BUF_SIZE 256   /* Must hold a complete RTU frame */
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* Frame layer entry points, bound in eMBInit() depending on the mode */
+
+typedef void (*pvMBInstFrameStart)(xMBInstance *pxInst);
+typedef void (*pvMBInstFrameStop)(xMBInstance *pxInst);
+typedef eMBErrorCode (*peMBInstFrameReceive)(xMBInstance *pxInst,
+                                             uint8_t *pucRcvAddress,
+                                             uint8_t **pucFrame,
+                                             uint16_t *pusLength);
+typedef eMBErrorCode (*peMBInstFrameSend)(xMBInstance *pxInst,
+                                          uint8_t slaveAddress,
+                                          const uint8_t *pucFrame,
+                                          uint16_t usLength);
+typedef void (*pvMBInstFrameClose)(xMBInstance *pxInst);
+
+/* A function handler registered either through the legacy eMBRegisterCB()
+ * or through eMBInstanceRegisterCB().  Only one of the pointers is set.
+ */
+
+typedef struct
+{
+  uint8_t                 ucFunctionCode;
+  pxMBFunctionHandler     pxHandler;
+  pxMBInstFunctionHandler pxInstHandler;
+} xMBInstanceHandler;
+
+struct mb_instance_s
+{
+  /* Protocol stack (mb.c) */
+
+  uint8_t               ucMBAddress;
+  eMBMode               eMBCurrentMode;
+  uint8_t               eMBState;
+  bool                  bDefaultsValid;   /* Handlers/callbacks set up */
+  bool                  bAllocated;       /* Freed by eMBInstanceClose() */
+
+  peMBInstFrameSend     peMBFrameSendCur;
+  pvMBInstFrameStart    pvMBFrameStartCur;
+  pvMBInstFrameStop     pvMBFrameStopCur;
+  peMBInstFrameReceive  peMBFrameReceiveCur;
+  pvMBInstFrameClose    pvMBFrameCloseCur;
+
+  /* Callbacks from the port layer into the frame layer.  The block
+   * variants are NULL if the mode only supports the byte callbacks.
+   */
+
+  bool (*pxMBFrameCBByteReceived)(xMBInstance *pxInst);
+  bool (*pxMBFrameCBTransmitterEmpty)(xMBInstance *pxInst);
+  bool (*pxMBPortCBTimerExpired)(xMBInstance *pxInst);
+  bool (*pxMBFrameCBBlockReceived)(xMBInstance *pxInst,
+                                   const uint8_t *pucData,
+                                   uint16_t usLength);
+  bool (*pxMBFrameCBTransmitBlock)(xMBInstance *pxInst,
+                                   const uint8_t **ppucData,
+                                   uint16_t *pusLength);
+
+  /* Request between EV_FRAME_RECEIVED and EV_EXECUTE */
+
+  uint8_t              *pucMBFrame;
+  uint8_t               ucRcvAddress;
+  uint16_t              usLength;
+
+  xMBInstanceHandler    xFuncHandlers[CONFIG_MB_FUNC_HANDLERS_MAX];
+  xMBRegCallbacks       xRegCB;
+  void                 *pvArg;
+  xMBStatistics         xStats;
+
+#ifdef CONFIG_MB_REGMAP
+  const xMBRegMapEntry *pxRegMap[MB_REGMAP_NTYPES];
+  uint16_t              usRegMapLen[MB_REGMAP_NTYPES];
+#endif
+
+#ifdef CONFIG_MB_FUNC_OTHER_REP_SLAVEID_ENABLED
+  uint8_t               ucMBSlaveID[CONFIG_MB_FUNC_OTHER_REP_SLAVEID_BUF];
+  uint16_t              usMBSlaveIDLen;
+#endif
+
+  /* Serial frame layer (rtu/mbrtu.c or ascii/mbascii.c).  The states are
+   * the private eMBRcvState/eMBSndState enums of the active layer.
+   */
+
+  volatile uint8_t      eSndState;
+  volatile uint8_t      eRcvState;
+  volatile uint8_t      ucFrameBuf[MB_INST_FRAME_SIZE];
+  volatile uint8_t     *pucSndBufferCur;
+  volatile uint16_t     usSndBufferCount;
+  volatile uint16_t     usRcvBufferPos;
+#ifdef CONFIG_MB_ASCII_ENABLED
+  volatile uint8_t      eBytePos;
+  volatile uint8_t      ucMBLFCharacter;
+#endif
+
+  /* Port layer (nuttx/port*.c) */
+
+  int                   iSerialFd;
+  bool                  bRxEnabled;
+  bool                  bTxEnabled;
+  uint8_t               ucBuffer[MB_INST_SERIAL_BUF_SIZE];
+  int                   uiRxBufferPos;
+  int                   uiTxBufferPos;
+#ifdef CONFIG_SERIAL_TERMIOS
+  struct termios        xOldTIO;
+#endif
+
+  uint32_t              ulTimeoutUs;      /* t3.5 (RTU) or character timeout */
+  uint32_t              ulTimeoutT15Us;   /* t1.5 (RTU) */
+  bool                  bTimeoutEnable;
+  struct timespec       xTimeLast;        /* When the timer was (re)started */
+
+  eMBEventType          eQueuedEvent;
+  bool                  xEventInQueue;
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/* Port layer, one set of functions per instance.  The legacy functions in
+ * modbus/mbport.h operate on pxMBGetDefaultInstance().
+ */
+
+bool xMBInstPortEventInit(xMBInstance *pxInst);
+bool xMBInstPortEventPost(xMBInstance *pxInst, eMBEventType eEvent);
+bool xMBInstPortEventGet(xMBInstance *pxInst, eMBEventType *peEvent,
+                         bool bWait);
+
+bool xMBInstPortSerialInit(xMBInstance *pxInst, uint8_t ucPort,
+                           speed_t ulBaudRate, uint8_t ucDataBits,
+                           eMBParity eParity);
+void vMBInstPortClose(xMBInstance *pxInst);
+void vMBInstPortSerialEnable(xMBInstance *pxInst, bool bEnableRx,
+                             bool bEnableTx);
+bool xMBInstPortSerialGetByte(xMBInstance *pxInst, int8_t *pucByte);
+bool xMBInstPortSerialPutByte(xMBInstance *pxInst, int8_t ucByte);
+bool xMBInstPortSerialPoll(xMBInstance *pxInst, bool bWait);
+bool xMBPortSerialWaitInstances(xMBInstance *const *ppxInst, int iCount);
+
+bool xMBInstPortTimersInit(xMBInstance *pxInst, uint16_t usTimeOut50us);
+void vMBInstPortTimersEnable(xMBInstance *pxInst);
+void vMBInstPortTimersDisable(xMBInstance *pxInst);
+void vMBInstPortTimerPoll(xMBInstance *pxInst);
+uint32_t ulMBInstPortTimerRemainingUs(xMBInstance *pxInst);
+bool xMBInstPortTimerT15Elapsed(xMBInstance *pxInst);
+
+#ifdef CONFIG_MB_REGMAP
+/* Serve a register access from the instance's register map.  Returns false
+ * if the range is not completely mapped and the register callback has to
+ * be used; otherwise *peStatus holds the result.
+ */
+
+bool xMBRegMapAccess(xMBInstance *pxInst, eMBRegMapType eType,
+                     uint8_t *pucRegBuffer, uint16_t usAddress,
+                     uint16_t usNRegs, eMBRegisterMode eMode,
+                     eMBErrorCode *peStatus);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __APPS_MODBUS_NUTTX_MBINSTANCE_H */
@@ -82,8 +82,6 @@ void vMBPortEnterCritical(void);
 void vMBPortExitCritical(void);
 void vMBPortLog(eMBPortLogLevel eLevel, const char *szModule,
                 const char *szFmt, ...);
-void vMBPortTimerPoll(void);
-bool xMBPortSerialPoll(void);
 bool xMBPortSerialSetTimeout(uint32_t dwTimeoutMs);
 
 #if defined(CONFIG_MB_RTU_MASTER) || defined(CONFIG_MB_ASCII_MASTER)
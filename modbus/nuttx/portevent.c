@@ -37,57 +37,68 @@
 #include "modbus/mbport.h"
 
 #include "port.h"
-
-/****************************************************************************
- * Private Data
- ****************************************************************************/
-
-static eMBEventType eQueuedEvent;
-static bool xEventInQueue;
+#include "mbinstance.h"
 
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
-bool xMBPortEventInit(void)
+bool xMBInstPortEventInit(xMBInstance *pxInst)
 {
-  xEventInQueue = false;
+  pxInst->xEventInQueue = false;
   return true;
 }
 
-bool xMBPortEventPost(eMBEventType eEvent)
+bool xMBInstPortEventPost(xMBInstance *pxInst, eMBEventType eEvent)
 {
-  xEventInQueue = true;
-  eQueuedEvent = eEvent;
+  pxInst->xEventInQueue = true;
+  pxInst->eQueuedEvent = eEvent;
   return true;
 }
 
-bool xMBPortEventGet(eMBEventType * eEvent)
+bool xMBInstPortEventGet(xMBInstance *pxInst, eMBEventType *peEvent,
+                         bool bWait)
 {
   bool xEventHappened = false;
 
-  if (xEventInQueue)
+  if (pxInst->xEventInQueue)
     {
-      *eEvent = eQueuedEvent;
-      xEventInQueue = false;
+      *peEvent = pxInst->eQueuedEvent;
+      pxInst->xEventInQueue = false;
       xEventHappened = true;
     }
   else
     {
-      /* Poll the serial device. The serial device timeouts if no
-       * characters have been received within for t3.5 during an
-       * active transmission or if nothing happens within a specified
-       * amount of time. Both timeouts are configured from the timer
-       * init functions.
+      /* Poll the serial device. If bWait is set the serial device
+       * timeouts if no characters have been received within for t3.5
+       * during an active transmission or if nothing happens within a
+       * specified amount of time. Otherwise only the input that is
+       * already pending is processed.
        */
 
-      (void)xMBPortSerialPoll();
+      (void)xMBInstPortSerialPoll(pxInst, bWait);
 
       /* Check if any of the timers have expired. */
 
-      vMBPortTimerPoll();
+      vMBInstPortTimerPoll(pxInst);
     }
 
   return xEventHappened;
 }
 
+/* Legacy interface, operating on the default instance */
+
+bool xMBPortEventInit(void)
+{
+  return xMBInstPortEventInit(pxMBGetDefaultInstance());
+}
+
+bool xMBPortEventPost(eMBEventType eEvent)
+{
+  return xMBInstPortEventPost(pxMBGetDefaultInstance(), eEvent);
+}
+
+bool xMBPortEventGet(eMBEventType *eEvent)
+{
+  return xMBInstPortEventGet(pxMBGetDefaultInstance(), eEvent, true);
+}
@@ -63,6 +63,13 @@ static sem_t bussysem;
 static sem_t waitersem;
 static eMBMasterEventType eQueuedEvent;
 
+/* The request in progress was sent by the scheduler, which polls for its
+ * result, instead of by a thread blocked on waitersem.
+ */
+
+static bool bPolledRequest;
+static bool bPolledFinished;
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -86,7 +93,14 @@ bool xMBMasterPortEventPost(eMBMasterEventType eEvent)
 
   if (eEvent & WAITER_EVENTS)
     {
-      sem_post(&waitersem);
+      if (bPolledRequest)
+        {
+          bPolledFinished = true;
+        }
+      else
+        {
+          sem_post(&waitersem);
+        }
     }
 
   eQueuedEvent |= eEvent;
@@ -274,17 +288,12 @@ void vMBMasterCBRequestSuccess(void)
   xMBMasterPortEventPost(EV_MASTER_PROCESS_SUCCESS);
 }
 
-/* This function will wait for Modbus Master request finish and return result.
- */
+/* Convert the finished request's waiter event into an error code. */
 
-eMBMasterReqErrCode eMBMasterWaitRequestFinish(void)
+static eMBMasterReqErrCode prveMBMasterRequestResult(void)
 {
   eMBMasterReqErrCode eErrStatus = MB_MRE_NO_ERR;
 
-  /* wait forever for OS event */
-
-  sem_wait(&waitersem);
-
   if (eQueuedEvent & WAITER_EVENTS)
     {
       if (eQueuedEvent & EV_MASTER_PROCESS_SUCCESS)
@@ -309,4 +318,46 @@ eMBMasterReqErrCode eMBMasterWaitRequestFinish(void)
   return eErrStatus;
 }
 
+/* This function will wait for Modbus Master request finish and return result.
+ */
+
+eMBMasterReqErrCode eMBMasterWaitRequestFinish(void)
+{
+  /* wait forever for OS event */
+
+  sem_wait(&waitersem);
+
+  return prveMBMasterRequestResult();
+}
+
+/* Mark the next request as polled:  Its result is collected with
+ * xMBMasterRequestFinished() and does not wake eMBMasterWaitRequestFinish().
+ * Call this on the master poll task before sending the request.
+ */
+
+void vMBMasterPolledRequest(void)
+{
+  bPolledRequest  = true;
+  bPolledFinished = false;
+}
+
+/* Non-blocking variant of eMBMasterWaitRequestFinish() for a request sent
+ * after vMBMasterPolledRequest().  Returns true and the result if it has
+ * finished.
+ */
+
+bool xMBMasterRequestFinished(eMBMasterReqErrCode *peErrStatus)
+{
+  if (!bPolledRequest || !bPolledFinished)
+    {
+      return false;
+    }
+
+  bPolledRequest  = false;
+  bPolledFinished = false;
+
+  *peErrStatus = prveMBMasterRequestResult();
+  return true;
+}
+
 #endif  /* defined(CONFIG_MB_RTU_MASTER) || defined(CONFIG_MB_ASCII_MASTER) */
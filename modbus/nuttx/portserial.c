@@ -55,57 +55,63 @@
 #include "modbus/mb.h"
 #include "modbus/mbport.h"
 
+#include "mbinstance.h"
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
 
-#ifdef CONFIG_MB_ASCII_ENABLED
-#define BUF_SIZE    513         /* must hold a complete ASCII frame. */
-#else
-#define BUF_SIZE    256         /* must hold a complete RTU frame. */
+#ifndef CONFIG_MB_SERIAL_DEVNAME
+#  define CONFIG_MB_SERIAL_DEVNAME "/dev/ttyS%d"
 #endif
 
-/****************************************************************************
- * Private Data
- ****************************************************************************/
-
-static int      iSerialFd = -1;
-static bool     bRxEnabled;
-static bool     bTxEnabled;
+/* Longest a poll waits for input while no timer is armed */
 
-static uint32_t ulTimeoutMs;
-static uint8_t  ucBuffer[BUF_SIZE];
-static int      uiRxBufferPos;
-static int      uiTxBufferPos;
-
-#ifdef CONFIG_SERIAL_TERMIOS
-static struct termios xOldTIO;
-#endif
+#define MB_SERIAL_IDLE_WAIT_US  50000
 
 /****************************************************************************
  * Private Function Prototypes
  ****************************************************************************/
 
-static bool prvbMBPortSerialRead(uint8_t *pucBuffer, uint16_t usNBytes,
-                                 uint16_t *usNBytesRead);
-static bool prvbMBPortSerialWrite(uint8_t *pucBuffer, uint16_t usNBytes);
+static bool prvbMBPortSerialRead(xMBInstance *pxInst, uint8_t *pucBuffer,
+                                 uint16_t usNBytes, uint16_t *usNBytesRead,
+                                 bool bWait);
+static bool prvbMBPortSerialWrite(xMBInstance *pxInst, uint8_t *pucBuffer,
+                                  uint16_t usNBytes);
 
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
-static bool prvbMBPortSerialRead(uint8_t *pucBuffer, uint16_t usNBytes,
-                                 uint16_t *usNBytesRead)
+static bool prvbMBPortSerialRead(xMBInstance *pxInst, uint8_t *pucBuffer,
+                                 uint16_t usNBytes, uint16_t *usNBytesRead,
+                                 bool bWait)
 {
   bool            bResult = true;
   ssize_t         res;
   fd_set          rfds;
   struct timeval  tv;
+  uint32_t        ulWaitUs;
+
+  /* Wait no longer than it takes the armed timer to expire, so that the
+   * end of an RTU frame is noticed as soon as the line has been quiet for
+   * t3.5.  Without bWait only input that is already pending is read.
+   */
+
+  ulWaitUs = 0;
+  if (bWait)
+    {
+      ulWaitUs = ulMBInstPortTimerRemainingUs(pxInst);
+      if (ulWaitUs > MB_SERIAL_IDLE_WAIT_US)
+        {
+          ulWaitUs = MB_SERIAL_IDLE_WAIT_US;
+        }
+    }
 
-  tv.tv_sec = 0;
-  tv.tv_usec = 50000;
+  tv.tv_sec = ulWaitUs / 1000000;
+  tv.tv_usec = ulWaitUs % 1000000;
   FD_ZERO(&rfds);
-  FD_SET(iSerialFd, &rfds);
+  FD_SET(pxInst->iSerialFd, &rfds);
 
   /* Wait until character received or timeout. Recover in case of an
    * interrupted read system call.
@@ -113,16 +119,16 @@ static bool prvbMBPortSerialRead(uint8_t *pucBuffer, uint16_t usNBytes,
 
   do
     {
-      if (select(iSerialFd + 1, &rfds, NULL, NULL, &tv) == -1)
+      if (select(pxInst->iSerialFd + 1, &rfds, NULL, NULL, &tv) == -1)
         {
           if (errno != EINTR)
             {
               bResult = false;
             }
         }
-      else if (FD_ISSET(iSerialFd, &rfds))
+      else if (FD_ISSET(pxInst->iSerialFd, &rfds))
         {
-          if ((res = read(iSerialFd, pucBuffer, usNBytes)) == -1)
+          if ((res = read(pxInst->iSerialFd, pucBuffer, usNBytes)) == -1)
             {
               bResult = false;
             }
@@ -143,7 +149,8 @@ static bool prvbMBPortSerialRead(uint8_t *pucBuffer, uint16_t usNBytes,
   return bResult;
 }
 
-static bool prvbMBPortSerialWrite(uint8_t *pucBuffer, uint16_t usNBytes)
+static bool prvbMBPortSerialWrite(xMBInstance *pxInst, uint8_t *pucBuffer,
+                                  uint16_t usNBytes)
 {
   ssize_t res;
   size_t  left = (size_t) usNBytes;
@@ -151,7 +158,7 @@ static bool prvbMBPortSerialWrite(uint8_t *pucBuffer, uint16_t usNBytes)
 
   while (left > 0)
     {
-      if ((res = write(iSerialFd, pucBuffer + done, left)) == -1)
+      if ((res = write(pxInst->iSerialFd, pucBuffer + done, left)) == -1)
         {
           if (errno != EINTR)
             {
@@ -174,7 +181,8 @@ static bool prvbMBPortSerialWrite(uint8_t *pucBuffer, uint16_t usNBytes)
  * Public Functions
  ****************************************************************************/
 
-void vMBPortSerialEnable(bool bEnableRx, bool bEnableTx)
+void vMBInstPortSerialEnable(xMBInstance *pxInst, bool bEnableRx,
+                             bool bEnableTx)
 {
   /* it is not allowed that both receiver and transmitter are enabled. */
 
@@ -183,40 +191,44 @@ void vMBPortSerialEnable(bool bEnableRx, bool bEnableTx)
   if (bEnableRx)
     {
 #ifdef CONFIG_SERIAL_TERMIOS
-      (void)tcflush(iSerialFd, TCIFLUSH);
+      (void)tcflush(pxInst->iSerialFd, TCIFLUSH);
 #endif
-      uiRxBufferPos = 0;
-      bRxEnabled = true;
+      pxInst->uiRxBufferPos = 0;
+      pxInst->bRxEnabled = true;
     }
   else
     {
-      bRxEnabled = false;
+      pxInst->bRxEnabled = false;
     }
 
   if (bEnableTx)
     {
-      bTxEnabled = true;
-      uiTxBufferPos = 0;
+      pxInst->bTxEnabled = true;
+      pxInst->uiTxBufferPos = 0;
     }
   else
     {
-      bTxEnabled = false;
+      pxInst->bTxEnabled = false;
     }
 }
 
-bool xMBPortSerialInit(uint8_t ucPort, speed_t ulBaudRate,
-                       uint8_t ucDataBits, eMBParity eParity)
+bool xMBInstPortSerialInit(xMBInstance *pxInst, uint8_t ucPort,
+                           speed_t ulBaudRate, uint8_t ucDataBits,
+                           eMBParity eParity)
 {
-  char szDevice[16];
+  char szDevice[32];
   bool bStatus = true;
 
 #ifdef CONFIG_SERIAL_TERMIOS
   struct termios xNewTIO;
 #endif
 
-  snprintf(szDevice, 16, "/dev/ttyS%d", ucPort);
+  snprintf(szDevice, sizeof(szDevice), CONFIG_MB_SERIAL_DEVNAME, ucPort);
+
+  pxInst->bRxEnabled = false;
+  pxInst->bTxEnabled = false;
 
-  if ((iSerialFd = open(szDevice, O_RDWR | O_NOCTTY)) < 0)
+  if ((pxInst->iSerialFd = open(szDevice, O_RDWR | O_NOCTTY)) < 0)
     {
       vMBPortLog(MB_LOG_ERROR, "SER-INIT", "Can't open serial port %s: %d\n",
                  szDevice, errno);
@@ -224,7 +236,7 @@ bool xMBPortSerialInit(uint8_t ucPort, speed_t ulBaudRate,
     }
 
 #ifdef CONFIG_SERIAL_TERMIOS
-  else if (tcgetattr(iSerialFd, &xOldTIO) != 0)
+  else if (tcgetattr(pxInst->iSerialFd, &pxInst->xOldTIO) != 0)
     {
       vMBPortLog(MB_LOG_ERROR, "SER-INIT", "Can't get settings from port %s: %d\n",
                  szDevice, errno);
@@ -286,14 +298,14 @@ bool xMBPortSerialInit(uint8_t ucPort, speed_t ulBaudRate,
               vMBPortLog(MB_LOG_ERROR, "SER-INIT", "Can't set baud rate %ld for port %s: %d\n",
                          ulBaudRate, szDevice, errno);
             }
-          else if (tcsetattr(iSerialFd, TCSANOW, &xNewTIO) != 0)
+          else if (tcsetattr(pxInst->iSerialFd, TCSANOW, &xNewTIO) != 0)
             {
               vMBPortLog(MB_LOG_ERROR, "SER-INIT", "Can't set settings for port %s: %d\n",
                          szDevice, errno);
             }
           else
             {
-              vMBPortSerialEnable(false, false);
+              vMBInstPortSerialEnable(pxInst, false, false);
               bStatus = true;
             }
         }
@@ -303,41 +315,33 @@ bool xMBPortSerialInit(uint8_t ucPort, speed_t ulBaudRate,
   return bStatus;
 }
 
-bool xMBPortSerialSetTimeout(uint32_t ulNewTimeoutMs)
+void vMBInstPortClose(xMBInstance *pxInst)
 {
-  if (ulNewTimeoutMs > 0)
-    {
-      ulTimeoutMs = ulNewTimeoutMs;
-    }
-  else
-    {
-      ulTimeoutMs = 1;
-    }
-
-  return true;
-}
-
-void vMBPortClose(void)
-{
-  if (iSerialFd != -1)
+  if (pxInst->iSerialFd != -1)
     {
 #ifdef CONFIG_SERIAL_TERMIOS
-      (void)tcsetattr(iSerialFd, TCSANOW, &xOldTIO);
+      (void)tcsetattr(pxInst->iSerialFd, TCSANOW, &pxInst->xOldTIO);
 #endif
-      (void)close(iSerialFd);
-      iSerialFd = -1;
+      (void)close(pxInst->iSerialFd);
+      pxInst->iSerialFd = -1;
     }
+
+  pxInst->bRxEnabled = false;
+  pxInst->bTxEnabled = false;
 }
 
-bool xMBPortSerialPoll(void)
+bool xMBInstPortSerialPoll(xMBInstance *pxInst, bool bWait)
 {
   bool     bStatus = true;
+  const uint8_t *pucTxFrame;
+  uint16_t usTxLength;
   uint16_t usBytesRead;
   int      i;
 
-  while (bRxEnabled)
+  while (pxInst->bRxEnabled)
     {
-      if (prvbMBPortSerialRead(&ucBuffer[0], BUF_SIZE, &usBytesRead))
+      if (prvbMBPortSerialRead(pxInst, &pxInst->ucBuffer[0],
+                               MB_INST_SERIAL_BUF_SIZE, &usBytesRead, bWait))
         {
           if (usBytesRead == 0)
             {
@@ -345,16 +349,29 @@ bool xMBPortSerialPoll(void)
 
               break;
             }
-          else if (usBytesRead > 0)
+          else if (pxInst->pxMBFrameCBBlockReceived != NULL)
+            {
+              /* Hand the whole span to the modbus stack.  Stop reading if
+               * it completed a frame.
+               */
+
+              if (pxInst->pxMBFrameCBBlockReceived(pxInst,
+                                                   &pxInst->ucBuffer[0],
+                                                   usBytesRead))
+                {
+                  break;
+                }
+            }
+          else
             {
               for (i = 0; i < usBytesRead; i++)
                 {
                   /* Call the modbus stack and let him fill the buffers. */
 
-                  (void)pxMBFrameCBByteReceived();
+                  (void)pxInst->pxMBFrameCBByteReceived(pxInst);
                 }
 
-              uiRxBufferPos = 0;
+              pxInst->uiRxBufferPos = 0;
             }
         }
       else
@@ -362,19 +379,40 @@ bool xMBPortSerialPoll(void)
           vMBPortLog(MB_LOG_ERROR, "SER-POLL", "read failed on serial device: %d\n",
                      errno);
           bStatus = false;
+          break;
         }
     }
 
-  if (bTxEnabled)
+  if (pxInst->bTxEnabled)
     {
-      while (bTxEnabled)
+      /* Take the whole frame if the stack can hand it over in one piece,
+       * otherwise collect it character by character in ucBuffer.
+       */
+
+      if (pxInst->pxMBFrameCBTransmitBlock == NULL ||
+          !pxInst->pxMBFrameCBTransmitBlock(pxInst, &pucTxFrame, &usTxLength))
+        {
+          pucTxFrame = &pxInst->ucBuffer[0];
+          usTxLength = 0;
+        }
+
+      while (pxInst->bTxEnabled)
         {
-          (void)pxMBFrameCBTransmitterEmpty();
+          (void)pxInst->pxMBFrameCBTransmitterEmpty(pxInst);
 
           /* Call the modbus stack to let him fill the buffer. */
         }
 
-      if (!prvbMBPortSerialWrite(&ucBuffer[0], uiTxBufferPos))
+      /* The receiver is enabled (and its input flushed) again by now, so
+       * nothing the peer sends in reply to this frame is lost.
+       */
+
+      if (usTxLength == 0)
+        {
+          usTxLength = pxInst->uiTxBufferPos;
+        }
+
+      if (!prvbMBPortSerialWrite(pxInst, (uint8_t *)pucTxFrame, usTxLength))
         {
           vMBPortLog(MB_LOG_ERROR, "SER-POLL", "write failed on serial device: %d\n",
                      errno);
@@ -385,18 +423,114 @@ bool xMBPortSerialPoll(void)
   return bStatus;
 }
 
-bool xMBPortSerialPutByte(int8_t ucByte)
+/****************************************************************************
+ * Name: xMBPortSerialWaitInstances
+ *
+ * Description:
+ *   Wait until one of the serial instances has input or one of their timers
+ *   is due, but no longer than MB_SERIAL_IDLE_WAIT_US.  Instances that are
+ *   transmitting or have an event queued end the wait immediately.
+ *
+ ****************************************************************************/
+
+bool xMBPortSerialWaitInstances(xMBInstance *const *ppxInst, int iCount)
 {
-  DEBUGASSERT(uiTxBufferPos < BUF_SIZE);
-  ucBuffer[uiTxBufferPos] = ucByte;
-  uiTxBufferPos++;
+  xMBInstance    *pxInst;
+  fd_set          rfds;
+  struct timeval  tv;
+  uint32_t        ulWaitUs = MB_SERIAL_IDLE_WAIT_US;
+  uint32_t        ulRemainingUs;
+  int             iMaxFd = -1;
+  int             i;
+
+  FD_ZERO(&rfds);
+  for (i = 0; i < iCount; i++)
+    {
+      pxInst = ppxInst[i];
+      if (pxInst->xEventInQueue || pxInst->bTxEnabled)
+        {
+          return true;
+        }
+
+      ulRemainingUs = ulMBInstPortTimerRemainingUs(pxInst);
+      if (ulRemainingUs < ulWaitUs)
+        {
+          ulWaitUs = ulRemainingUs;
+        }
+
+      if (pxInst->bRxEnabled && pxInst->iSerialFd >= 0)
+        {
+          FD_SET(pxInst->iSerialFd, &rfds);
+          if (pxInst->iSerialFd > iMaxFd)
+            {
+              iMaxFd = pxInst->iSerialFd;
+            }
+        }
+    }
+
+  tv.tv_sec = ulWaitUs / 1000000;
+  tv.tv_usec = ulWaitUs % 1000000;
+
+  if (select(iMaxFd + 1, &rfds, NULL, NULL, &tv) == -1 && errno != EINTR)
+    {
+      vMBPortLog(MB_LOG_ERROR, "SER-POLL", "select failed: %d\n", errno);
+      return false;
+    }
+
+  return true;
+}
+
+bool xMBInstPortSerialPutByte(xMBInstance *pxInst, int8_t ucByte)
+{
+  DEBUGASSERT(pxInst->uiTxBufferPos < MB_INST_SERIAL_BUF_SIZE);
+  pxInst->ucBuffer[pxInst->uiTxBufferPos] = ucByte;
+  pxInst->uiTxBufferPos++;
+  return true;
+}
+
+bool xMBInstPortSerialGetByte(xMBInstance *pxInst, int8_t *pucByte)
+{
+  DEBUGASSERT(pxInst->uiRxBufferPos < MB_INST_SERIAL_BUF_SIZE);
+  *pucByte = pxInst->ucBuffer[pxInst->uiRxBufferPos];
+  pxInst->uiRxBufferPos++;
   return true;
 }
 
+/* Legacy interface, operating on the default instance */
+
+bool xMBPortSerialInit(uint8_t ucPort, speed_t ulBaudRate,
+                       uint8_t ucDataBits, eMBParity eParity)
+{
+  return xMBInstPortSerialInit(pxMBGetDefaultInstance(), ucPort, ulBaudRate,
+                               ucDataBits, eParity);
+}
+
+void vMBPortClose(void)
+{
+  vMBInstPortClose(pxMBGetDefaultInstance());
+}
+
+void vMBPortSerialEnable(bool bEnableRx, bool bEnableTx)
+{
+  vMBInstPortSerialEnable(pxMBGetDefaultInstance(), bEnableRx, bEnableTx);
+}
+
+bool xMBPortSerialPutByte(int8_t ucByte)
+{
+  return xMBInstPortSerialPutByte(pxMBGetDefaultInstance(), ucByte);
+}
+
 bool xMBPortSerialGetByte(int8_t *pucByte)
 {
-  DEBUGASSERT(uiRxBufferPos < BUF_SIZE);
-  *pucByte = ucBuffer[uiRxBufferPos];
-  uiRxBufferPos++;
+  return xMBInstPortSerialGetByte(pxMBGetDefaultInstance(), pucByte);
+}
+
+bool xMBPortSerialSetTimeout(uint32_t ulNewTimeoutMs)
+{
+  /* Nothing to do: the read timeout of the default instance, as of every
+   * other, follows its armed timer, see prvbMBPortSerialRead().
+   */
+
+  (void)ulNewTimeoutMs;
   return true;
 }
@@ -35,8 +35,9 @@
 
 #include <nuttx/config.h>
 
-#include <sys/time.h>
 #include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
 #include <assert.h>
 
 #include "port.h"
@@ -44,72 +45,139 @@
 #include "modbus/mb.h"
 #include "modbus/mbport.h"
 
+#include "mbinstance.h"
+
 /****************************************************************************
- * Public Data
+ * Private Functions
  ****************************************************************************/
 
-uint32_t ulTimeOut;
-bool     bTimeoutEnable;
+static uint32_t prvulMBPortTimerElapsedUs(xMBInstance *pxInst)
+{
+  struct timespec xTimeCur;
+  int64_t llDeltaUs;
 
-static struct timeval xTimeLast;
+  if (clock_gettime(CLOCK_MONOTONIC, &xTimeCur) != 0)
+    {
+      return 0;
+    }
+
+  llDeltaUs = (int64_t)(xTimeCur.tv_sec - pxInst->xTimeLast.tv_sec) * 1000000 +
+              (xTimeCur.tv_nsec - pxInst->xTimeLast.tv_nsec) / 1000;
+
+  return llDeltaUs > UINT32_MAX ? UINT32_MAX : (uint32_t)llDeltaUs;
+}
 
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
-bool xMBPortTimersInit(uint16_t usTim1Timerout50us)
+bool xMBInstPortTimersInit(xMBInstance *pxInst, uint16_t usTim1Timerout50us)
 {
-  ulTimeOut = usTim1Timerout50us / 20U;
-  if (ulTimeOut == 0)
+  /* Keep the full 50us resolution the RTU layer computes.  For RTU this is
+   * t3.5; t1.5 follows from it (750us above 19200 baud).
+   */
+
+  pxInst->ulTimeoutUs = (uint32_t)usTim1Timerout50us * 50U;
+  if (pxInst->ulTimeoutUs == 0)
     {
-      ulTimeOut = 1;
+      pxInst->ulTimeoutUs = 50;
     }
 
-  return xMBPortSerialSetTimeout(ulTimeOut);
+  pxInst->ulTimeoutT15Us = pxInst->ulTimeoutUs * 3U / 7U;
+  pxInst->bTimeoutEnable = false;
+
+  return true;
 }
 
-void xMBPortTimersClose()
+void vMBInstPortTimerPoll(xMBInstance *pxInst)
 {
-  /* Does not use any hardware resources. */
+  /* Timers are polled from the serial layer, which waits no longer than
+   * ulMBInstPortTimerRemainingUs() for input, so an expiry is seen within
+   * the resolution of the serial wait.
+   */
+
+  if (pxInst->bTimeoutEnable &&
+      prvulMBPortTimerElapsedUs(pxInst) >= pxInst->ulTimeoutUs)
+    {
+      pxInst->bTimeoutEnable = false;
+      (void)pxInst->pxMBPortCBTimerExpired(pxInst);
+    }
 }
 
-void vMBPortTimerPoll()
+void vMBInstPortTimersEnable(xMBInstance *pxInst)
 {
-  uint32_t       ulDeltaMS;
-  struct timeval xTimeCur;
+  int res = clock_gettime(CLOCK_MONOTONIC, &pxInst->xTimeLast);
 
-  /* Timers are called from the serial layer because we have no high
-   * res timer in Win32.
-   */
+  DEBUGASSERT(res == 0);
+  pxInst->bTimeoutEnable = true;
+}
+
+void vMBInstPortTimersDisable(xMBInstance *pxInst)
+{
+  pxInst->bTimeoutEnable = false;
+}
+
+/****************************************************************************
+ * Name: ulMBInstPortTimerRemainingUs
+ *
+ * Description:
+ *   Return the time until the armed timer expires, zero if it already has,
+ *   or UINT32_MAX if no timer is armed.
+ *
+ ****************************************************************************/
+
+uint32_t ulMBInstPortTimerRemainingUs(xMBInstance *pxInst)
+{
+  uint32_t ulElapsedUs;
 
-  if (bTimeoutEnable)
+  if (!pxInst->bTimeoutEnable)
     {
-      if (gettimeofday(&xTimeCur, NULL) != 0)
-        {
-          /* gettimeofday failed - retry next time. */
-        }
-      else
-        {
-          ulDeltaMS = (xTimeCur.tv_sec - xTimeLast.tv_sec) * 1000L +
-                      (xTimeCur.tv_usec - xTimeLast.tv_usec) * 1000L;
-          if (ulDeltaMS > ulTimeOut)
-            {
-              bTimeoutEnable = false;
-              (void)pxMBPortCBTimerExpired();
-            }
-        }
+      return UINT32_MAX;
     }
+
+  ulElapsedUs = prvulMBPortTimerElapsedUs(pxInst);
+  return ulElapsedUs >= pxInst->ulTimeoutUs ?
+         0 : pxInst->ulTimeoutUs - ulElapsedUs;
 }
 
-void vMBPortTimersEnable()
+/****************************************************************************
+ * Name: xMBInstPortTimerT15Elapsed
+ *
+ * Description:
+ *   Return true if more than t1.5 has passed since the timer was last
+ *   (re)started, i.e. since the previous character of an RTU frame.
+ *
+ ****************************************************************************/
+
+bool xMBInstPortTimerT15Elapsed(xMBInstance *pxInst)
 {
-  int res = gettimeofday(&xTimeLast, NULL);
+  return pxInst->bTimeoutEnable &&
+         prvulMBPortTimerElapsedUs(pxInst) > pxInst->ulTimeoutT15Us;
+}
 
-  DEBUGASSERT(res == 0);
-  bTimeoutEnable = true;
+/* Legacy interface, operating on the default instance */
+
+bool xMBPortTimersInit(uint16_t usTim1Timerout50us)
+{
+  return xMBInstPortTimersInit(pxMBGetDefaultInstance(), usTim1Timerout50us);
+}
+
+void xMBPortTimersClose(void)
+{
+  /* Does not use any hardware resources. */
+}
+
+void vMBPortTimersEnable(void)
+{
+  vMBInstPortTimersEnable(pxMBGetDefaultInstance());
+}
+
+void vMBPortTimersDisable(void)
+{
+  vMBInstPortTimersDisable(pxMBGetDefaultInstance());
 }
 
-void vMBPortTimersDisable()
+void vMBPortTimersDelay(uint16_t usTimeOutMS)
 {
-  bTimeoutEnable = false;
+  usleep((useconds_t)usTimeOutMS * 1000);
 }
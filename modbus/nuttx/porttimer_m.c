@@ -68,6 +68,7 @@ uint32_t ulTimeOut;                /* current timeout duration        */
 uint32_t ulTimeoutT35;             /* 3.5 byte transmission duration  */
 uint32_t ulTimeoutConvertDelay;    /* timeout after broadcast message */
 uint32_t ulTimeoutResponse;        /* response timeout duration       */
+static uint32_t ulTimeoutOverride; /* this request only, 0: default  */
 static struct timeval xTimeLast;
 bool bTimeoutEnable;               /* timeout is active */
 
@@ -136,10 +137,19 @@ INLINE void vMBMasterPortTimersConvertDelayEnable( void )
 INLINE void vMBMasterPortTimersRespondTimeoutEnable( void )
 {
   vMBMasterPortTimersEnable();
-  ulTimeOut = ulTimeoutResponse;
+  ulTimeOut = ulTimeoutOverride > 0 ? ulTimeoutOverride : ulTimeoutResponse;
   vMBMasterSetCurTimerMode( MB_TMODE_RESPOND_TIMEOUT );
 }
 
+/* Override the response timeout for the request being sent.  0 restores
+ * the configured timeout for all later requests.
+ */
+
+void vMBMasterPortTimersSetRespondTimeout(uint32_t ulTimeOutMs)
+{
+  ulTimeoutOverride = ulTimeOutMs;
+}
+
 void vMBMasterPortTimerPoll( void )
 {
   uint32_t       ulDeltaMS;
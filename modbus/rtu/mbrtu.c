@@ -44,6 +44,7 @@
 #include "modbus/mbframe.h"
 #include "modbus/mbport.h"
 
+#include "mbinstance.h"
 #include "mbrtu.h"
 #include "mbcrc.h"
 
@@ -76,25 +77,35 @@ typedef enum
 } eMBSndState;
 
 /****************************************************************************
- * Private Data
+ * Private Functions
  ****************************************************************************/
 
-static volatile eMBSndState eSndState;
-static volatile eMBRcvState eRcvState;
-
-volatile uint8_t  ucRTUBuf[MB_SER_PDU_SIZE_MAX];
-
-static volatile uint8_t *pucSndBufferCur;
-static volatile uint16_t usSndBufferCount;
+static void prvvMBRTUStoreBlock(xMBInstance *pxInst, const uint8_t *pucData,
+                                uint16_t usLength)
+{
+  /* If more than the maximum possible number of bytes in a modbus frame
+   * is received the frame is ignored.
+   */
 
-static volatile uint16_t usRcvBufferPos;
+  if (usLength <= MB_SER_PDU_SIZE_MAX - pxInst->usRcvBufferPos)
+    {
+      memcpy((uint8_t *)&pxInst->ucFrameBuf[pxInst->usRcvBufferPos], pucData,
+             usLength);
+      pxInst->usRcvBufferPos += usLength;
+    }
+  else
+    {
+      pxInst->eRcvState = STATE_RX_ERROR;
+    }
+}
 
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
-eMBErrorCode eMBRTUInit(uint8_t ucSlaveAddress, uint8_t ucPort,
-                        speed_t ulBaudRate, eMBParity eParity)
+eMBErrorCode eMBRTUInit(xMBInstance *pxInst, uint8_t ucSlaveAddress,
+                        uint8_t ucPort, speed_t ulBaudRate,
+                        eMBParity eParity)
 {
   eMBErrorCode eStatus = MB_ENOERR;
   uint32_t usTimerT35_50us;
@@ -104,7 +115,7 @@ eMBErrorCode eMBRTUInit(uint8_t ucSlaveAddress, uint8_t ucPort,
 
   /* Modbus RTU uses 8 Databits. */
 
-  if (xMBPortSerialInit(ucPort, ulBaudRate, 8, eParity) != true)
+  if (xMBInstPortSerialInit(pxInst, ucPort, ulBaudRate, 8, eParity) != true)
     {
       eStatus = MB_EPORTERR;
     }
@@ -132,7 +143,7 @@ eMBErrorCode eMBRTUInit(uint8_t ucSlaveAddress, uint8_t ucPort,
           usTimerT35_50us = (7UL * 220000UL) / (2UL * ulBaudRate);
         }
 
-      if (xMBPortTimersInit((uint16_t) usTimerT35_50us) != true)
+      if (xMBInstPortTimersInit(pxInst, (uint16_t) usTimerT35_50us) != true)
         {
           eStatus = MB_EPORTERR;
         }
@@ -142,7 +153,7 @@ eMBErrorCode eMBRTUInit(uint8_t ucSlaveAddress, uint8_t ucPort,
   return eStatus;
 }
 
-void eMBRTUStart(void)
+void eMBRTUStart(xMBInstance *pxInst)
 {
   ENTER_CRITICAL_SECTION();
 
@@ -152,49 +163,51 @@ void eMBRTUStart(void)
    * modbus protocol stack until the bus is free.
    */
 
-  eRcvState = STATE_RX_INIT;
-  vMBPortSerialEnable(true, false);
-  vMBPortTimersEnable();
+  pxInst->eRcvState = STATE_RX_INIT;
+  vMBInstPortSerialEnable(pxInst, true, false);
+  vMBInstPortTimersEnable(pxInst);
 
   EXIT_CRITICAL_SECTION();
 }
 
-void eMBRTUStop(void)
+void eMBRTUStop(xMBInstance *pxInst)
 {
   ENTER_CRITICAL_SECTION();
-  vMBPortSerialEnable(false, false);
-  vMBPortTimersDisable();
+  vMBInstPortSerialEnable(pxInst, false, false);
+  vMBInstPortTimersDisable(pxInst);
   EXIT_CRITICAL_SECTION();
 }
 
-eMBErrorCode eMBRTUReceive(uint8_t *pucRcvAddress, uint8_t **pucFrame,
-                           uint16_t *pusLength)
+eMBErrorCode eMBRTUReceive(xMBInstance *pxInst, uint8_t *pucRcvAddress,
+                           uint8_t **pucFrame, uint16_t *pusLength)
 {
   eMBErrorCode eStatus = MB_ENOERR;
 
   ENTER_CRITICAL_SECTION();
-  DEBUGASSERT(usRcvBufferPos < MB_SER_PDU_SIZE_MAX);
+  DEBUGASSERT(pxInst->usRcvBufferPos < MB_SER_PDU_SIZE_MAX);
 
   /* Length and CRC check */
 
-  if ((usRcvBufferPos >= MB_SER_PDU_SIZE_MIN) &&
-      (usMBCRC16((uint8_t *) ucRTUBuf, usRcvBufferPos) == 0))
+  if ((pxInst->usRcvBufferPos >= MB_SER_PDU_SIZE_MIN) &&
+      (usMBCRC16((uint8_t *)pxInst->ucFrameBuf,
+                 pxInst->usRcvBufferPos) == 0))
     {
       /* Save the address field. All frames are passed to the upper layed
        * and the decision if a frame is used is done there.
        */
 
-      *pucRcvAddress = ucRTUBuf[MB_SER_PDU_ADDR_OFF];
+      *pucRcvAddress = pxInst->ucFrameBuf[MB_SER_PDU_ADDR_OFF];
 
       /* Total length of Modbus-PDU is Modbus-Serial-Line-PDU minus
        * size of address field and CRC checksum.
        */
 
-      *pusLength = (uint16_t)(usRcvBufferPos - MB_SER_PDU_PDU_OFF - MB_SER_PDU_SIZE_CRC);
+      *pusLength = (uint16_t)(pxInst->usRcvBufferPos - MB_SER_PDU_PDU_OFF -
+                              MB_SER_PDU_SIZE_CRC);
 
       /* Return the start of the Modbus PDU to the caller. */
 
-      *pucFrame = (uint8_t *) & ucRTUBuf[MB_SER_PDU_PDU_OFF];
+      *pucFrame = (uint8_t *) & pxInst->ucFrameBuf[MB_SER_PDU_PDU_OFF];
     }
   else
     {
@@ -205,7 +218,8 @@ eMBErrorCode eMBRTUReceive(uint8_t *pucRcvAddress, uint8_t **pucFrame,
   return eStatus;
 }
 
-eMBErrorCode eMBRTUSend(uint8_t ucSlaveAddress, const uint8_t *pucFrame, uint16_t usLength)
+eMBErrorCode eMBRTUSend(xMBInstance *pxInst, uint8_t ucSlaveAddress,
+                        const uint8_t *pucFrame, uint16_t usLength)
 {
   eMBErrorCode eStatus = MB_ENOERR;
   uint16_t usCRC16;
@@ -217,28 +231,30 @@ eMBErrorCode eMBRTUSend(uint8_t ucSlaveAddress, const uint8_t *pucFrame, uint16_
    * frame on the network. We have to abort sending the frame.
    */
 
-  if (eRcvState == STATE_RX_IDLE)
+  if (pxInst->eRcvState == STATE_RX_IDLE)
     {
       /* First byte before the Modbus-PDU is the slave address. */
 
-      pucSndBufferCur = (uint8_t *) pucFrame - 1;
-      usSndBufferCount = 1;
+      pxInst->pucSndBufferCur = (uint8_t *) pucFrame - 1;
+      pxInst->usSndBufferCount = 1;
 
       /* Now copy the Modbus-PDU into the Modbus-Serial-Line-PDU. */
 
-      pucSndBufferCur[MB_SER_PDU_ADDR_OFF] = ucSlaveAddress;
-      usSndBufferCount += usLength;
+      pxInst->pucSndBufferCur[MB_SER_PDU_ADDR_OFF] = ucSlaveAddress;
+      pxInst->usSndBufferCount += usLength;
 
       /* Calculate CRC16 checksum for Modbus-Serial-Line-PDU. */
 
-      usCRC16 = usMBCRC16((uint8_t *) pucSndBufferCur, usSndBufferCount);
-      ucRTUBuf[usSndBufferCount++] = (uint8_t)(usCRC16 & 0xFF);
-      ucRTUBuf[usSndBufferCount++] = (uint8_t)(usCRC16 >> 8);
+      usCRC16 = usMBCRC16((uint8_t *)pxInst->pucSndBufferCur,
+                          pxInst->usSndBufferCount);
+      pxInst->ucFrameBuf[pxInst->usSndBufferCount++] =
+        (uint8_t)(usCRC16 & 0xFF);
+      pxInst->ucFrameBuf[pxInst->usSndBufferCount++] = (uint8_t)(usCRC16 >> 8);
 
       /* Activate the transmitter. */
 
-      eSndState = STATE_TX_XMIT;
-      vMBPortSerialEnable(false, true);
+      pxInst->eSndState = STATE_TX_XMIT;
+      vMBInstPortSerialEnable(pxInst, false, true);
     }
   else
     {
@@ -249,25 +265,25 @@ eMBErrorCode eMBRTUSend(uint8_t ucSlaveAddress, const uint8_t *pucFrame, uint16_
   return eStatus;
 }
 
-bool xMBRTUReceiveFSM(void)
+bool xMBRTUReceiveFSM(xMBInstance *pxInst)
 {
   bool xTaskNeedSwitch = false;
   uint8_t ucByte;
 
-  DEBUGASSERT(eSndState == STATE_TX_IDLE);
+  DEBUGASSERT(pxInst->eSndState == STATE_TX_IDLE);
 
   /* Always read the character. */
 
-  (void)xMBPortSerialGetByte((int8_t *) & ucByte);
+  (void)xMBInstPortSerialGetByte(pxInst, (int8_t *) & ucByte);
 
-  switch (eRcvState)
+  switch (pxInst->eRcvState)
     {
       /* If we have received a character in the init state we have to
        * wait until the frame is finished.
        */
 
       case STATE_RX_INIT:
-        vMBPortTimersEnable();
+        vMBInstPortTimersEnable(pxInst);
         break;
 
       /* In the error state we wait until all characters in the
@@ -275,7 +291,7 @@ bool xMBRTUReceiveFSM(void)
        */
 
       case STATE_RX_ERROR:
-        vMBPortTimersEnable();
+        vMBInstPortTimersEnable(pxInst);
         break;
 
       /* In the idle state we wait for a new character. If a character
@@ -284,13 +300,13 @@ bool xMBRTUReceiveFSM(void)
        */
 
       case STATE_RX_IDLE:
-        usRcvBufferPos = 0;
-        ucRTUBuf[usRcvBufferPos++] = ucByte;
-        eRcvState = STATE_RX_RCV;
+        pxInst->usRcvBufferPos = 0;
+        pxInst->ucFrameBuf[pxInst->usRcvBufferPos++] = ucByte;
+        pxInst->eRcvState = STATE_RX_RCV;
 
         /* Enable t3.5 timers. */
 
-        vMBPortTimersEnable();
+        vMBInstPortTimersEnable(pxInst);
         break;
 
       /* We are currently receiving a frame. Reset the timer after
@@ -300,29 +316,103 @@ bool xMBRTUReceiveFSM(void)
        */
 
       case STATE_RX_RCV:
-        if (usRcvBufferPos < MB_SER_PDU_SIZE_MAX)
+#ifdef CONFIG_MB_RTU_T15_CHECK
+        /* A gap of more than t1.5 inside a frame makes it invalid. */
+
+        if (xMBInstPortTimerT15Elapsed(pxInst))
           {
-            ucRTUBuf[usRcvBufferPos++] = ucByte;
+            pxInst->eRcvState = STATE_RX_ERROR;
           }
         else
+#endif
+        if (pxInst->usRcvBufferPos < MB_SER_PDU_SIZE_MAX)
           {
-            eRcvState = STATE_RX_ERROR;
+            pxInst->ucFrameBuf[pxInst->usRcvBufferPos++] = ucByte;
+          }
+        else
+          {
+            pxInst->eRcvState = STATE_RX_ERROR;
           }
 
-        vMBPortTimersEnable();
+        vMBInstPortTimersEnable(pxInst);
         break;
     }
 
   return xTaskNeedSwitch;
 }
 
-bool xMBRTUTransmitFSM(void)
+bool xMBRTUReceiveBlock(xMBInstance *pxInst, const uint8_t *pucData,
+                        uint16_t usLength)
+{
+  DEBUGASSERT(pxInst->eSndState == STATE_TX_IDLE);
+
+  /* Same state machine as xMBRTUReceiveFSM() but for a whole span of
+   * characters.  The span arrived as a unit so the t3.5 timer is only
+   * restarted once at its end.
+   */
+
+  switch (pxInst->eRcvState)
+    {
+      case STATE_RX_INIT:
+      case STATE_RX_ERROR:
+        break;
+
+      case STATE_RX_IDLE:
+        pxInst->usRcvBufferPos = 0;
+        pxInst->eRcvState = STATE_RX_RCV;
+        prvvMBRTUStoreBlock(pxInst, pucData, usLength);
+        break;
+
+      case STATE_RX_RCV:
+#ifdef CONFIG_MB_RTU_T15_CHECK
+        /* A gap of more than t1.5 inside a frame makes it invalid. */
+
+        if (xMBInstPortTimerT15Elapsed(pxInst))
+          {
+            pxInst->eRcvState = STATE_RX_ERROR;
+            break;
+          }
+#endif
+
+        prvvMBRTUStoreBlock(pxInst, pucData, usLength);
+        break;
+    }
+
+  vMBInstPortTimersEnable(pxInst);
+  return false;
+}
+
+bool xMBRTUTransmitBlock(xMBInstance *pxInst, const uint8_t **ppucData,
+                         uint16_t *pusLength)
+{
+  DEBUGASSERT(pxInst->eRcvState == STATE_RX_IDLE);
+
+  if (pxInst->eSndState != STATE_TX_XMIT || pxInst->usSndBufferCount == 0)
+    {
+      return false;
+    }
+
+  /* Hand the rest of the frame to the port in one piece.  The port then
+   * calls xMBRTUTransmitFSM(), which finishes the transmission, and writes
+   * the frame.  The buffer is not touched again before the next frame is
+   * received.
+   */
+
+  *ppucData = (const uint8_t *)pxInst->pucSndBufferCur;
+  *pusLength = pxInst->usSndBufferCount;
+
+  pxInst->pucSndBufferCur += pxInst->usSndBufferCount;
+  pxInst->usSndBufferCount = 0;
+  return true;
+}
+
+bool xMBRTUTransmitFSM(xMBInstance *pxInst)
 {
   bool xNeedPoll = false;
 
-  DEBUGASSERT(eRcvState == STATE_RX_IDLE);
+  DEBUGASSERT(pxInst->eRcvState == STATE_RX_IDLE);
 
-  switch (eSndState)
+  switch (pxInst->eSndState)
     {
       /* We should not get a transmitter event if the transmitter is in
        * idle state.
@@ -331,28 +421,28 @@ bool xMBRTUTransmitFSM(void)
     case STATE_TX_IDLE:
       /* enable receiver/disable transmitter. */
 
-      vMBPortSerialEnable(true, false);
+      vMBInstPortSerialEnable(pxInst, true, false);
       break;
 
     case STATE_TX_XMIT:
       /* check if we are finished. */
 
-      if (usSndBufferCount != 0)
+      if (pxInst->usSndBufferCount != 0)
         {
-          xMBPortSerialPutByte((int8_t)*pucSndBufferCur);
-          pucSndBufferCur++;  /* next byte in sendbuffer. */
-          usSndBufferCount--;
+          xMBInstPortSerialPutByte(pxInst, (int8_t)*pxInst->pucSndBufferCur);
+          pxInst->pucSndBufferCur++;  /* next byte in sendbuffer. */
+          pxInst->usSndBufferCount--;
         }
       else
         {
-          xNeedPoll = xMBPortEventPost(EV_FRAME_SENT);
+          xNeedPoll = xMBInstPortEventPost(pxInst, EV_FRAME_SENT);
 
           /* Disable transmitter. This prevents another transmit buffer
            * empty interrupt.
            */
 
-          vMBPortSerialEnable(true, false);
-          eSndState = STATE_TX_IDLE;
+          vMBInstPortSerialEnable(pxInst, true, false);
+          pxInst->eSndState = STATE_TX_IDLE;
         }
       break;
     }
@@ -360,16 +450,16 @@ bool xMBRTUTransmitFSM(void)
   return xNeedPoll;
 }
 
-bool xMBRTUTimerT35Expired(void)
+bool xMBRTUTimerT35Expired(xMBInstance *pxInst)
 {
   bool xNeedPoll = false;
 
-  switch (eRcvState)
+  switch (pxInst->eRcvState)
     {
       /* Timer t35 expired. Start-up phase is finished. */
 
       case STATE_RX_INIT:
-        xNeedPoll = xMBPortEventPost(EV_READY);
+        xNeedPoll = xMBInstPortEventPost(pxInst, EV_READY);
         break;
 
       /* A frame was received and t35 expired. Notify the listener that
@@ -377,7 +467,7 @@ bool xMBRTUTimerT35Expired(void)
        */
 
       case STATE_RX_RCV:
-        xNeedPoll = xMBPortEventPost(EV_FRAME_RECEIVED);
+        xNeedPoll = xMBInstPortEventPost(pxInst, EV_FRAME_RECEIVED);
         break;
 
       /* An error occurred while receiving the frame. */
@@ -388,13 +478,13 @@ bool xMBRTUTimerT35Expired(void)
       /* Function called in an illegal state. */
 
       default:
-        DEBUGASSERT((eRcvState == STATE_RX_INIT) ||
-               (eRcvState == STATE_RX_RCV) ||
-               (eRcvState == STATE_RX_ERROR));
+        DEBUGASSERT((pxInst->eRcvState == STATE_RX_INIT) ||
+                    (pxInst->eRcvState == STATE_RX_RCV) ||
+                    (pxInst->eRcvState == STATE_RX_ERROR));
     }
 
-  vMBPortTimersDisable();
-  eRcvState = STATE_RX_IDLE;
+  vMBInstPortTimersDisable(pxInst);
+  pxInst->eRcvState = STATE_RX_IDLE;
 
   return xNeedPoll;
 }
@@ -41,18 +41,23 @@ extern "C"
  * Public Function Prototypes
  ****************************************************************************/
 
-eMBErrorCode eMBRTUInit(uint8_t slaveAddress, uint8_t ucPort,
-                        speed_t ulBaudRate, eMBParity eParity);
-void eMBRTUStart(void);
-void eMBRTUStop(void);
-eMBErrorCode eMBRTUReceive(uint8_t *pucRcvAddress, uint8_t **pucFrame,
-                           uint16_t *pusLength);
-eMBErrorCode eMBRTUSend(uint8_t slaveAddress, const uint8_t *pucFrame,
+eMBErrorCode eMBRTUInit(xMBInstance *pxInst, uint8_t slaveAddress,
+                        uint8_t ucPort, speed_t ulBaudRate,
+                        eMBParity eParity);
+void eMBRTUStart(xMBInstance *pxInst);
+void eMBRTUStop(xMBInstance *pxInst);
+eMBErrorCode eMBRTUReceive(xMBInstance *pxInst, uint8_t *pucRcvAddress,
+                           uint8_t **pucFrame, uint16_t *pusLength);
+eMBErrorCode eMBRTUSend(xMBInstance *pxInst, uint8_t slaveAddress,
+                        const uint8_t *pucFrame, uint16_t usLength);
+bool xMBRTUReceiveFSM(xMBInstance *pxInst);
+bool xMBRTUTransmitFSM(xMBInstance *pxInst);
+bool xMBRTUReceiveBlock(xMBInstance *pxInst, const uint8_t *pucData,
                         uint16_t usLength);
-bool xMBRTUReceiveFSM(void);
-bool xMBRTUTransmitFSM(void);
-bool xMBRTUTimerT15Expired(void);
-bool xMBRTUTimerT35Expired(void);
+bool xMBRTUTransmitBlock(xMBInstance *pxInst, const uint8_t **ppucData,
+                         uint16_t *pusLength);
+bool xMBRTUTimerT15Expired(xMBInstance *pxInst);
+bool xMBRTUTimerT35Expired(xMBInstance *pxInst);
 
 #ifdef __cplusplus
 }
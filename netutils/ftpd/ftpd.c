@@ -57,9 +57,19 @@
 #include <fcntl.h>
 #include <poll.h>
 #include <libgen.h>
+#include <time.h>
 #include <errno.h>
 #include <debug.h>
 
+#ifdef CONFIG_FTPD_STORTHREAD
+#  include <pthread.h>
+#  include <semaphore.h>
+#endif
+
+#ifdef CONFIG_FTPD_SENDFILE
+#  include <sys/sendfile.h>
+#endif
+
 #include <arpa/inet.h>
 
 #include "netutils/ftpd.h"
@@ -72,6 +82,26 @@
 
 #define __NUTTX__ 1 /* Flags some unusual NuttX dependencies */
 
+#ifndef CONFIG_FTPD_SENDFILE_CHUNKSIZE
+#  define CONFIG_FTPD_SENDFILE_CHUNKSIZE 16384
+#endif
+
+#ifndef CONFIG_FTPD_WRITERSTACKSIZE
+#  define CONFIG_FTPD_WRITERSTACKSIZE 1024
+#endif
+
+/* Command hash.  All FTP commands are at most four characters long, so a
+ * command is packed into a 32-bit key (first character in the LS byte) and
+ * hashed with a multiplicative (Fibonacci) hash.  The table must stay well
+ * larger than g_ftpdcmdtab so that the probe sequences remain short.
+ */
+
+#define FTPD_CMDHASH_BITS  7
+#define FTPD_CMDHASH_SIZE  (1 << FTPD_CMDHASH_BITS)
+#define FTPD_CMDHASH_MULT  0x9e3779b1u
+#define FTPD_CMDHASH(k)    ((uint32_t)((k) * FTPD_CMDHASH_MULT) >> \
+                            (32 - FTPD_CMDHASH_BITS))
+
 /****************************************************************************
  * Private Function Prototypes
  ****************************************************************************/
@@ -134,6 +164,22 @@ static int  ftpd_getpath(FAR struct ftpd_session_s *session,
 static int  ftpd_changedir(FAR struct ftpd_session_s *session,
               FAR const char *rempath);
 static off_t ftpd_offsatoi(FAR const char *filename, off_t offset);
+#ifdef CONFIG_FTPD_XFERREPORT
+static void ftpd_xfertime(FAR struct timespec *ts);
+static int ftpd_xferreport(FAR struct ftpd_session_s *session,
+              FAR const struct timespec *start, off_t nxfer);
+#endif
+static int ftpd_stream_buffered(FAR struct ftpd_session_s *session,
+              int cmdtype, FAR off_t *nxfer);
+#ifdef CONFIG_FTPD_SENDFILE
+static int ftpd_stream_sendfile(FAR struct ftpd_session_s *session,
+              FAR off_t *nxfer);
+#endif
+#ifdef CONFIG_FTPD_STORTHREAD
+static FAR void *ftpd_writer(FAR void *arg);
+static int ftpd_stream_writer(FAR struct ftpd_session_s *session,
+              FAR off_t *nxfer);
+#endif
 static int ftpd_stream(FAR struct ftpd_session_s *session, int cmdtype);
 static uint8_t ftpd_listoption(FAR char **param);
 static int  ftpd_listbuffer(FAR struct ftpd_session_s *session,
@@ -180,7 +226,11 @@ static int ftpd_command_opts(FAR struct ftpd_session_s *session);
 static int ftpd_command_site(FAR struct ftpd_session_s *session);
 static int ftpd_command_help(FAR struct ftpd_session_s *session);
 
+static bool ftpd_cmdkey(FAR const char *command, FAR uint32_t *key);
+static void ftpd_cmdhash_index(void);
+static FAR const struct ftpd_cmd_s *ftpd_cmdlookup(FAR const char *command);
 static int ftpd_command(FAR struct ftpd_session_s *session);
+static int ftpd_cmdline(FAR struct ftpd_session_s *session, FAR char *line);
 
 /* Worker thread */
 
@@ -245,6 +295,14 @@ static const struct ftpd_cmd_s g_ftpdcmdtab[] =
   {NULL, (ftpd_cmdhandler_t)0, 0}
 };
 
+/* Open-addressed index into g_ftpdcmdtab, filled in on the first lookup.
+ * Each slot holds the g_ftpdcmdtab index plus one; zero marks an empty
+ * slot.
+ */
+
+static uint8_t g_ftpdcmdhash[FTPD_CMDHASH_SIZE];
+static volatile bool g_ftpdcmdindexed;
+
 static const char g_cdup[]      = "..";
 static const char g_respfmt1[]  = "%03u%c%s\r\n";   /* Integer, character, string */
 static const char g_respfmt2[]  = "%03u%c%s%s\r\n"; /* Integer, character, two strings */
@@ -1717,315 +1775,700 @@ static off_t ftpd_offsatoi(FAR const char *filename, off_t offset)
 }
 
 /****************************************************************************
- * Name: ftpd_stream
+ * Name: ftpd_xfertime
  ****************************************************************************/
 
-static int ftpd_stream(FAR struct ftpd_session_s *session, int cmdtype)
+#ifdef CONFIG_FTPD_XFERREPORT
+static void ftpd_xfertime(FAR struct timespec *ts)
 {
-  FAR char *abspath;
-  FAR char *path;
-  bool isnew;
-  int oflags;
-  FAR char *buffer;
-  size_t buflen;
-  size_t wantsize;
-  ssize_t rdbytes;
-  ssize_t wrbytes;
-  off_t pos = 0;
-  int errval = 0;
-  int ret;
+#ifdef CONFIG_CLOCK_MONOTONIC
+  (void)clock_gettime(CLOCK_MONOTONIC, ts);
+#else
+  (void)clock_gettime(CLOCK_REALTIME, ts);
+#endif
+}
+#endif
 
-  ret = ftpd_getpath(session, session->param, &abspath, NULL);
-  if (ret < 0)
-    {
-      ftpd_response(session->cmd.sd, session->txtimeout,
-                    g_respfmt1, 550, ' ', "Stream error !");
-      goto errout;
-    }
-  path = abspath;
+/****************************************************************************
+ * Name: ftpd_xferreport
+ *
+ * Description:
+ *   Send the 226 completion reply, including the size of the transfer,
+ *   the elapsed time and the resulting throughput.
+ *
+ ****************************************************************************/
 
-  ret = ftpd_dataopen(session);
-  if (ret < 0)
+#ifdef CONFIG_FTPD_XFERREPORT
+static int ftpd_xferreport(FAR struct ftpd_session_s *session,
+                           FAR const struct timespec *start, off_t nxfer)
+{
+  struct timespec end;
+  unsigned long elapsed;
+  unsigned long rate;
+
+  ftpd_xfertime(&end);
+
+  elapsed = (unsigned long)(end.tv_sec - start->tv_sec) * 1000 +
+            (unsigned long)(end.tv_nsec / 1000000) -
+            (unsigned long)(start->tv_nsec / 1000000);
+  if (elapsed == 0)
     {
-      goto errout_with_path;
+      elapsed = 1;
     }
 
-  switch (cmdtype)
-    {
-      case 0: /* retr */
-        oflags = O_RDONLY;
-        break;
+  /* KiB/s = (bytes / 1024) / (msec / 1000) */
 
-      case 1: /* stor */
-        oflags = O_CREAT | O_WRONLY;
-         break;
+  rate = (unsigned long)(((uint64_t)nxfer * 1000) / ((uint64_t)elapsed * 1024));
 
-      case 2: /* appe */
-        oflags = O_CREAT | O_WRONLY | O_APPEND;
-        break;
-
-      default:
-        oflags = O_RDONLY;
-        break;
-    }
+  ninfo("%s: %lu bytes in %lu msec (%lu KiB/s)\n",
+        session->command, (unsigned long)nxfer, elapsed, rate);
 
-#if defined(O_LARGEFILE)
-  oflags |= O_LARGEFILE;
-#endif
-#if defined(O_BINARY)
-  oflags |= O_BINARY;
+  return ftpd_response(session->cmd.sd, session->txtimeout,
+                       "%03u%c%s (%lu bytes, %lu msec, %lu KiB/s)\r\n",
+                       226, ' ', "Transfer complete",
+                       (unsigned long)nxfer, elapsed, rate);
+}
 #endif
 
-  /* Are we creating the file? */
+/****************************************************************************
+ * Name: ftpd_stream_buffered
+ *
+ * Description:
+ *   Copy the data stream one session data buffer at a time.  This is the
+ *   only path that supports ASCII mode conversions.
+ *
+ * Returned Value:
+ *   Zero (OK) on success; a negated errno value on failure.  The 550 reply
+ *   has already been sent if a failure is returned.
+ *
+ ****************************************************************************/
 
-  if ((oflags & O_CREAT) != 0)
+static int ftpd_stream_buffered(FAR struct ftpd_session_s *session,
+                                int cmdtype, FAR off_t *nxfer)
+{
+  FAR char *buffer;
+  size_t buflen;
+  size_t wantsize;
+  ssize_t rdbytes;
+  ssize_t wrbytes;
+  int errval = 0;
+
+  for (;;)
     {
-      int mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH;
+      /* Read from the source (file or TCP connection) */
 
-      if (session->restartpos <= 0)
+      if (session->type == FTPD_SESSIONTYPE_A)
         {
-          oflags |= O_TRUNC;
+          buffer   = &session->data.buffer[session->data.buflen >> 2];
+          wantsize = session->data.buflen >> 2;
+        }
+      else
+        {
+          buffer   = session->data.buffer;
+          wantsize = session->data.buflen;
         }
 
-      isnew = true;
-      session->fd = open(path, oflags | O_EXCL, mode);
-      if (session->fd < 0)
+      if (cmdtype == 0)
         {
-          isnew = false;
-          session->fd = open(path, oflags, mode);
+          /* Read from the file.  Read returns the error condition via errno. */
+
+          rdbytes = read(session->fd, session->data.buffer, wantsize);
+          if (rdbytes < 0)
+            {
+              errval = errno;
+            }
         }
-    }
-  else
-    {
-      /* No.. we are opening an existing file */
+      else
+        {
+          /* Read from the TCP connection, ftpd_recve returns the negated error
+           * condition.
+           */
 
-      isnew = false;
-      session->fd = open(path, oflags);
-    }
+          rdbytes = ftpd_recv(session->data.sd, session->data.buffer,
+                              wantsize, session->rxtimeout);
+          if (rdbytes < 0)
+            {
+              errval = -rdbytes;
+            }
+        }
 
-  if (session->fd < 0)
-    {
-      ret = -errno;
-      (void)ftpd_response(session->cmd.sd, session->txtimeout,
-                          g_respfmt1, 550, ' ', "Can not open file !");
-      goto errout_with_data;
-    }
+      /* A negative vaule of rdbytes indicates a read error.  errval has the
+       * (positive) error code associated with the failure.
+       */
 
-  /* Restart position */
+      if (rdbytes < 0)
+        {
+          nerr("ERROR: Read failed: rdbytes=%d errval=%d\n", rdbytes, errval);
+          (void)ftpd_response(session->cmd.sd, session->txtimeout,
+                              g_respfmt1, 550, ' ', "Data read error !");
+          return -errval;
+        }
 
-  if (session->restartpos > 0)
-    {
-      off_t seekoffs = (off_t)-1;
-      off_t seekpos;
+      /* A value of rdbytes == 0 means that we have read the entire source
+       * stream.
+       */
 
-      /* Get the seek position */
+      if (rdbytes == 0)
+        {
+          /* End-of-file */
+
+          return OK;
+        }
+
+      /* Write to the destination (file or TCP connection) */
 
       if (session->type == FTPD_SESSIONTYPE_A)
         {
-          seekpos = ftpd_offsatoi(path, session->restartpos);
-          if (seekpos < 0)
+          /* Change to ascii */
+
+          size_t offset = 0;
+          buflen = 0;
+          while (offset < ((size_t)rdbytes))
             {
-              nerr("ERROR: ftpd_offsatoi failed: %d\n", seekpos);
-              errval = -seekpos;
+              if (session->data.buffer[offset] == '\n')
+                {
+                  buffer[buflen++] = '\r';
+                }
+              buffer[buflen++] = session->data.buffer[offset++];
             }
         }
       else
         {
-          seekpos = session->restartpos;
-          if (seekpos < 0)
+          buffer = session->data.buffer;
+          buflen = (size_t)rdbytes;
+        }
+
+      if (cmdtype == 0)
+        {
+          /* Write to the TCP connection */
+
+          wrbytes = ftpd_send(session->data.sd, buffer, buflen, session->txtimeout);
+          if (wrbytes < 0)
             {
-              nerr("ERROR: Bad restartpos: %d\n", seekpos);
-              errval = EINVAL;
+              errval = -wrbytes;
+              nerr("ERROR: ftpd_send failed: %d\n", errval);
             }
         }
+      else
+        {
+          int remaining;
+          int nwritten;
+          FAR char *next;
 
-      /* Seek to the request position */
+          remaining = buflen;
+          next = buffer;
 
-      if (seekpos >= 0)
-        {
-          seekoffs = lseek(session->fd, seekpos, SEEK_SET);
-          if (seekoffs < 0)
+          /* Write to the file */
+
+          do
             {
-              errval = errno;
-              nerr("ERROR: lseek failed: %d\n", errval);
+              nwritten = write(session->fd, next, remaining);
+              if (nwritten < 0)
+                {
+                  errval = errno;
+                  nerr("ERROR: write() failed: %d\n", errval);
+                  break;
+                }
+
+              remaining -= nwritten;
+              next += nwritten;
             }
+          while (remaining > 0);
+
+          wrbytes = next - buffer;
         }
 
-      /* Report errors.  If an error occurred, seekoffs will be negative and
-       * errval will hold the (positive) error code.
+      /* If the number of bytes returned by the write is not equal to the
+       * number that we wanted to write, then an error (or at least an
+       * unhandled condition) has occurred.  errval should should hold
+       * the (positive) error code.
        */
 
-      if (seekoffs < 0)
+      if (wrbytes != ((ssize_t)buflen))
         {
+          nerr("ERROR: Write failed: wrbytes=%d errval=%d\n", wrbytes, errval);
           (void)ftpd_response(session->cmd.sd, session->txtimeout,
-                              g_respfmt1, 550, ' ', "Can not seek file !");
-          ret = -errval;
-          goto errout_with_session;
+                              g_respfmt1, 550, ' ', "Data send error !");
+          return -errval;
         }
 
-        pos += (off_t)seekoffs;
+      /* Update the transfer count */
+
+      *nxfer += (off_t)rdbytes;
     }
+}
 
-  /* Send success message */
+/****************************************************************************
+ * Name: ftpd_stream_sendfile
+ *
+ * Description:
+ *   Send the file on the data connection with sendfile() so that the file
+ *   data does not have to be copied through the session data buffer.
+ *
+ * Returned Value:
+ *   Zero (OK) on success; a negated errno value on failure.  The value 1
+ *   is returned if sendfile() is not supported on this file or socket and
+ *   nothing was sent; the caller should then use ftpd_stream_buffered().
+ *
+ ****************************************************************************/
 
-  ret = ftpd_response(session->cmd.sd, session->txtimeout,
-                      g_respfmt1, 150, ' ', "Opening data connection");
-  if (ret < 0)
+#ifdef CONFIG_FTPD_SENDFILE
+static int ftpd_stream_sendfile(FAR struct ftpd_session_s *session,
+                                FAR off_t *nxfer)
+{
+  off_t offset;
+  ssize_t nsent;
+  int errval;
+  int ret;
+
+  /* sendfile() takes the start offset explicitly.  Start from the current
+   * file position which accounts for any restart position.
+   */
+
+  offset = lseek(session->fd, 0, SEEK_CUR);
+  if (offset < 0)
     {
-      nerr("ERROR: ftpd_response failed: %d\n", ret);
-      goto errout_with_session;
+      return 1;
     }
 
   for (;;)
     {
-      /* Read from the source (file or TCP connection) */
+      /* Honor the transmit timeout for each chunk */
 
-      if (session->type == FTPD_SESSIONTYPE_A)
+      if (session->txtimeout >= 0)
         {
-          buffer   = &session->data.buffer[session->data.buflen >> 2];
-          wantsize = session->data.buflen >> 2;
+          ret = ftpd_txpoll(session->data.sd, session->txtimeout);
+          if (ret < 0)
+            {
+              errval = -ret;
+              goto errout;
+            }
         }
-      else
+
+      nsent = sendfile(session->data.sd, session->fd, &offset,
+                       CONFIG_FTPD_SENDFILE_CHUNKSIZE);
+      if (nsent < 0)
         {
-          buffer   = session->data.buffer;
-          wantsize = session->data.buflen;
+          errval = errno;
+
+          /* If nothing has been sent yet, then let the caller fall back to
+           * the buffered copy.
+           */
+
+          if (*nxfer == 0 &&
+              (errval == ENOSYS || errval == EINVAL || errval == EOPNOTSUPP))
+            {
+              ninfo("sendfile() not supported: %d\n", errval);
+              return 1;
+            }
+
+          goto errout;
         }
 
-      if (cmdtype == 0)
+      /* Zero means that the end of the file was reached */
+
+      if (nsent == 0)
         {
-          /* Read from the file.  Read returns the error condition via errno. */
+          return OK;
+        }
 
-          rdbytes = read(session->fd, session->data.buffer, wantsize);
-          if (rdbytes < 0)
+      *nxfer += (off_t)nsent;
+    }
+
+errout:
+  nerr("ERROR: sendfile failed: %d\n", errval);
+  (void)ftpd_response(session->cmd.sd, session->txtimeout,
+                      g_respfmt1, 550, ' ', "Data send error !");
+  return -errval;
+}
+#endif
+
+/****************************************************************************
+ * Name: ftpd_writer
+ *
+ * Description:
+ *   The STOR writer thread.  Writes each buffer filled by
+ *   ftpd_stream_writer() to the file while the next buffer is being
+ *   received.  A zero length buffer terminates the thread.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTPD_STORTHREAD
+static FAR void *ftpd_writer(FAR void *arg)
+{
+  FAR struct ftpd_writer_s *writer = (FAR struct ftpd_writer_s *)arg;
+  FAR char *next;
+  ssize_t remaining;
+  ssize_t nwritten;
+  int index = 0;
+
+  for (;;)
+    {
+      /* Wait for the receiver to fill the next buffer */
+
+      while (sem_wait(&writer->full) < 0)
+        {
+          DEBUGASSERT(errno == EINTR || errno == ECANCELED);
+        }
+
+      remaining = writer->buflen[index];
+      if (remaining <= 0)
+        {
+          break;
+        }
+
+      /* Write the buffer to the file.  After a write error, buffers are
+       * still consumed (but discarded) until the receiver terminates the
+       * transfer.
+       */
+
+      next = writer->buffer[index];
+      while (remaining > 0 && writer->errval == 0)
+        {
+          nwritten = write(writer->fd, next, remaining);
+          if (nwritten < 0)
             {
-              errval = errno;
+              writer->errval = errno;
+              nerr("ERROR: write() failed: %d\n", writer->errval);
+              break;
             }
+
+          remaining -= nwritten;
+          next      += nwritten;
         }
-      else
+
+      /* Return the buffer to the receiver */
+
+      (void)sem_post(&writer->empty);
+      index ^= 1;
+    }
+
+  return NULL;
+}
+#endif
+
+/****************************************************************************
+ * Name: ftpd_stream_writer
+ *
+ * Description:
+ *   Receive a binary file into two alternating buffers, handing each
+ *   filled buffer to the writer thread so that file system writes overlap
+ *   with network reception.
+ *
+ * Returned Value:
+ *   Zero (OK) on success; a negated errno value on failure.  The value 1
+ *   is returned if the writer thread could not be started and nothing was
+ *   received; the caller should then use ftpd_stream_buffered().
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTPD_STORTHREAD
+static int ftpd_stream_writer(FAR struct ftpd_session_s *session,
+                              FAR off_t *nxfer)
+{
+  struct ftpd_writer_s writer;
+  pthread_attr_t attr;
+  pthread_t threadid;
+  ssize_t rdbytes;
+  int errval = 0;
+  int index = 0;
+  int ret;
+
+  /* The session data buffer is the first buffer; allocate the second */
+
+  writer.fd        = session->fd;
+  writer.errval    = 0;
+  writer.buffer[0] = session->data.buffer;
+  writer.buffer[1] = (FAR char *)malloc(session->data.buflen);
+  if (!writer.buffer[1])
+    {
+      nerr("ERROR: Failed to allocate the second data buffer\n");
+      return 1;
+    }
+
+  /* Both buffers are initially empty */
+
+  (void)sem_init(&writer.full, 0, 0);
+  (void)sem_init(&writer.empty, 0, 2);
+
+  /* Start the writer thread */
+
+  ret = pthread_attr_init(&attr);
+  if (ret == 0)
+    {
+      (void)pthread_attr_setstacksize(&attr, CONFIG_FTPD_WRITERSTACKSIZE);
+      ret = pthread_create(&threadid, &attr, ftpd_writer, (FAR void *)&writer);
+      pthread_attr_destroy(&attr);
+    }
+
+  if (ret != 0)
+    {
+      nerr("ERROR: Failed to start the writer thread: %d\n", ret);
+      ret = 1;
+      goto errout_with_buffer;
+    }
+
+  for (;;)
+    {
+      /* Wait for the writer to release a buffer */
+
+      while (sem_wait(&writer.empty) < 0)
         {
-          /* Read from the TCP connection, ftpd_recve returns the negated error
-           * condition.
-           */
+          DEBUGASSERT(errno == EINTR || errno == ECANCELED);
+        }
 
-          rdbytes = ftpd_recv(session->data.sd, session->data.buffer,
-                              wantsize, session->rxtimeout);
+      /* Stop receiving if the writer has failed */
+
+      if (writer.errval != 0)
+        {
+          rdbytes = 0;
+        }
+      else
+        {
+          rdbytes = ftpd_recv(session->data.sd, writer.buffer[index],
+                              session->data.buflen, session->rxtimeout);
           if (rdbytes < 0)
             {
-              errval = -rdbytes;
+              errval  = -rdbytes;
+              nerr("ERROR: ftpd_recv failed: %d\n", errval);
+              rdbytes = 0;
             }
         }
 
-      /* A negative vaule of rdbytes indicates a read error.  errval has the
-       * (positive) error code associated with the failure.
-       */
+      /* Hand the buffer to the writer.  An empty buffer terminates it. */
 
-      if (rdbytes < 0)
+      writer.buflen[index] = rdbytes;
+      (void)sem_post(&writer.full);
+
+      if (rdbytes == 0)
         {
-          nerr("ERROR: Read failed: rdbytes=%d errval=%d\n", rdbytes, errval);
-          (void)ftpd_response(session->cmd.sd, session->txtimeout,
-                              g_respfmt1, 550, ' ', "Data read error !");
-          ret = -errval;
           break;
         }
 
-      /* A value of rdbytes == 0 means that we have read the entire source
-       * stream.
-       */
+      *nxfer += (off_t)rdbytes;
+      index ^= 1;
+    }
 
-      if (rdbytes == 0)
+  /* Wait for the writer to flush the last buffer */
+
+  (void)pthread_join(threadid, NULL);
+
+  if (errval != 0)
+    {
+      (void)ftpd_response(session->cmd.sd, session->txtimeout,
+                          g_respfmt1, 550, ' ', "Data read error !");
+      ret = -errval;
+    }
+  else if (writer.errval != 0)
+    {
+      (void)ftpd_response(session->cmd.sd, session->txtimeout,
+                          g_respfmt1, 550, ' ', "Data send error !");
+      ret = -writer.errval;
+    }
+  else
+    {
+      ret = OK;
+    }
+
+errout_with_buffer:
+  (void)sem_destroy(&writer.full);
+  (void)sem_destroy(&writer.empty);
+  free(writer.buffer[1]);
+  return ret;
+}
+#endif
+
+/****************************************************************************
+ * Name: ftpd_stream
+ ****************************************************************************/
+
+static int ftpd_stream(FAR struct ftpd_session_s *session, int cmdtype)
+{
+  FAR char *abspath;
+  FAR char *path;
+  bool isnew;
+  int oflags;
+#ifdef CONFIG_FTPD_XFERREPORT
+  struct timespec start;
+#endif
+  off_t nxfer = 0;
+  int errval = 0;
+  int ret;
+
+  ret = ftpd_getpath(session, session->param, &abspath, NULL);
+  if (ret < 0)
+    {
+      ftpd_response(session->cmd.sd, session->txtimeout,
+                    g_respfmt1, 550, ' ', "Stream error !");
+      goto errout;
+    }
+  path = abspath;
+
+  ret = ftpd_dataopen(session);
+  if (ret < 0)
+    {
+      goto errout_with_path;
+    }
+
+  switch (cmdtype)
+    {
+      case 0: /* retr */
+        oflags = O_RDONLY;
+        break;
+
+      case 1: /* stor */
+        oflags = O_CREAT | O_WRONLY;
+         break;
+
+      case 2: /* appe */
+        oflags = O_CREAT | O_WRONLY | O_APPEND;
+        break;
+
+      default:
+        oflags = O_RDONLY;
+        break;
+    }
+
+#if defined(O_LARGEFILE)
+  oflags |= O_LARGEFILE;
+#endif
+#if defined(O_BINARY)
+  oflags |= O_BINARY;
+#endif
+
+  /* Are we creating the file? */
+
+  if ((oflags & O_CREAT) != 0)
+    {
+      int mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH;
+
+      if (session->restartpos <= 0)
         {
-          /* End-of-file */
+          oflags |= O_TRUNC;
+        }
+
+      isnew = true;
+      session->fd = open(path, oflags | O_EXCL, mode);
+      if (session->fd < 0)
+        {
+          isnew = false;
+          session->fd = open(path, oflags, mode);
+        }
+    }
+  else
+    {
+      /* No.. we are opening an existing file */
 
-          (void)ftpd_response(session->cmd.sd, session->txtimeout,
-                              g_respfmt1, 226, ' ', "Transfer complete");
+      isnew = false;
+      session->fd = open(path, oflags);
+    }
 
-          /* Return success */
+  if (session->fd < 0)
+    {
+      ret = -errno;
+      (void)ftpd_response(session->cmd.sd, session->txtimeout,
+                          g_respfmt1, 550, ' ', "Can not open file !");
+      goto errout_with_data;
+    }
 
-          ret = 0;
-          break;
-        }
+  /* Restart position */
 
-      /* Write to the destination (file or TCP connection) */
+  if (session->restartpos > 0)
+    {
+      off_t seekoffs = (off_t)-1;
+      off_t seekpos;
+
+      /* Get the seek position */
 
       if (session->type == FTPD_SESSIONTYPE_A)
         {
-          /* Change to ascii */
-
-          size_t offset = 0;
-          buflen = 0;
-          while (offset < ((size_t)rdbytes))
+          seekpos = ftpd_offsatoi(path, session->restartpos);
+          if (seekpos < 0)
             {
-              if (session->data.buffer[offset] == '\n')
-                {
-                  buffer[buflen++] = '\r';
-                }
-              buffer[buflen++] = session->data.buffer[offset++];
+              nerr("ERROR: ftpd_offsatoi failed: %d\n", seekpos);
+              errval = -seekpos;
             }
         }
       else
         {
-          buffer = session->data.buffer;
-          buflen = (size_t)rdbytes;
-        }
-
-      if (cmdtype == 0)
-        {
-          /* Write to the TCP connection */
-
-          wrbytes = ftpd_send(session->data.sd, buffer, buflen, session->txtimeout);
-          if (wrbytes < 0)
+          seekpos = session->restartpos;
+          if (seekpos < 0)
             {
-              errval = -wrbytes;
-              nerr("ERROR: ftpd_send failed: %d\n", errval);
+              nerr("ERROR: Bad restartpos: %d\n", seekpos);
+              errval = EINVAL;
             }
         }
-      else
-        {
-          int remaining;
-          int nwritten;
-          FAR char *next;
 
-          remaining = buflen;
-          next = buffer;
-
-          /* Write to the file */
+      /* Seek to the request position */
 
-          do
+      if (seekpos >= 0)
+        {
+          seekoffs = lseek(session->fd, seekpos, SEEK_SET);
+          if (seekoffs < 0)
             {
-              nwritten = write(session->fd, next, remaining);
-              if (nwritten < 0)
-                {
-                  errval = errno;
-                  nerr("ERROR: write() failed: %d\n", errval);
-                  break;
-                }
-
-              remaining -= nwritten;
-              next += nwritten;
+              errval = errno;
+              nerr("ERROR: lseek failed: %d\n", errval);
             }
-          while (remaining > 0);
-
-          wrbytes = next - buffer;
         }
 
-      /* If the number of bytes returned by the write is not equal to the
-       * number that we wanted to write, then an error (or at least an
-       * unhandled condition) has occurred.  errval should should hold
-       * the (positive) error code.
+      /* Report errors.  If an error occurred, seekoffs will be negative and
+       * errval will hold the (positive) error code.
        */
 
-      if (wrbytes != ((ssize_t)buflen))
+      if (seekoffs < 0)
         {
-          nerr("ERROR: Write failed: wrbytes=%d errval=%d\n", wrbytes, errval);
           (void)ftpd_response(session->cmd.sd, session->txtimeout,
-                              g_respfmt1, 550, ' ', "Data send error !");
-           ret = -errval;
-           break;
+                              g_respfmt1, 550, ' ', "Can not seek file !");
+          ret = -errval;
+          goto errout_with_session;
         }
+    }
+
+  /* Send success message */
+
+  ret = ftpd_response(session->cmd.sd, session->txtimeout,
+                      g_respfmt1, 150, ' ', "Opening data connection");
+  if (ret < 0)
+    {
+      nerr("ERROR: ftpd_response failed: %d\n", ret);
+      goto errout_with_session;
+    }
+
+#ifdef CONFIG_FTPD_XFERREPORT
+  ftpd_xfertime(&start);
+#endif
+
+  /* Select the transfer method.  Binary transfers may bypass the session
+   * data buffer; ASCII transfers always need the line ending conversion.
+   */
+
+  ret = 1;
+#ifdef CONFIG_FTPD_SENDFILE
+  if (cmdtype == 0 && session->type != FTPD_SESSIONTYPE_A)
+    {
+      ret = ftpd_stream_sendfile(session, &nxfer);
+    }
+#endif
+#ifdef CONFIG_FTPD_STORTHREAD
+  if (cmdtype != 0 && session->type != FTPD_SESSIONTYPE_A)
+    {
+      ret = ftpd_stream_writer(session, &nxfer);
+    }
+#endif
 
-      /* Get the next file offset */
+  if (ret > 0)
+    {
+      ret = ftpd_stream_buffered(session, cmdtype, &nxfer);
+    }
 
-      pos += (off_t)wrbytes;
+  if (ret == OK)
+    {
+#ifdef CONFIG_FTPD_XFERREPORT
+      (void)ftpd_xferreport(session, &start, nxfer);
+#else
+      (void)ftpd_response(session->cmd.sd, session->txtimeout,
+                          g_respfmt1, 226, ' ', "Transfer complete");
+#endif
     }
 
 errout_with_session:;
@@ -3847,50 +4290,127 @@ static int ftpd_command_help(FAR struct ftpd_session_s *session)
 }
 
 /****************************************************************************
- * Name: ftpd_command
+ * Name: ftpd_cmdkey
+ *
+ * Description:
+ *   Pack a command string into a hash key.  Returns false if the command
+ *   is too long to be in the command table.
+ *
  ****************************************************************************/
 
-static int ftpd_command(FAR struct ftpd_session_s *session)
+static bool ftpd_cmdkey(FAR const char *command, FAR uint32_t *key)
 {
-  int index = 0;
+  uint32_t value = 0;
+  int i;
 
-  /* Search the command table for a matching command */
+  for (i = 0; i < 4 && command[i] != '\0'; i++)
+    {
+      value |= (uint32_t)((uint8_t)command[i]) << (i << 3);
+    }
+
+  *key = value;
+  return command[i] == '\0';
+}
+
+/****************************************************************************
+ * Name: ftpd_cmdhash_index
+ *
+ * Description:
+ *   Fill in g_ftpdcmdhash.  Two sessions may race here on first use; an
+ *   entry that is already present is not inserted again, so both produce
+ *   the same index.
+ *
+ ****************************************************************************/
+
+static void ftpd_cmdhash_index(void)
+{
+  unsigned int slot;
+  unsigned int i;
+  uint32_t key;
 
-  for (index = 0; g_ftpdcmdtab[index].command; index++)
+  for (i = 0; g_ftpdcmdtab[i].command; i++)
     {
-      /* Does the command string match this entry? */
+      ftpd_cmdkey(g_ftpdcmdtab[i].command, &key);
 
-      if (strcmp(session->command, g_ftpdcmdtab[index].command) == 0)
+      slot = FTPD_CMDHASH(key);
+      while (g_ftpdcmdhash[slot] != 0 && g_ftpdcmdhash[slot] != i + 1)
         {
-          /* Yes.. is a login required to execute this command? */
+          slot = (slot + 1) & (FTPD_CMDHASH_SIZE - 1);
+        }
 
-          if ((g_ftpdcmdtab[index].flags & FTPD_CMDFLAG_LOGIN) != 0)
-            {
-              /* Yes... Check if the user is logged in */
+      g_ftpdcmdhash[slot] = i + 1;
+    }
 
-              if (!session->curr && session->head)
-                {
-                  return ftpd_response(session->cmd.sd, session->txtimeout,
-                                       g_respfmt1, 530, ' ',
-                                       "Please login with USER and PASS !");
-                }
-            }
+  g_ftpdcmdindexed = true;
+}
 
-          /* Check if there is a handler for the command */
+/****************************************************************************
+ * Name: ftpd_cmdlookup
+ ****************************************************************************/
 
-          if (g_ftpdcmdtab[index].handler)
-            {
-              /* Yess.. invoke the command handler. */
+static FAR const struct ftpd_cmd_s *ftpd_cmdlookup(FAR const char *command)
+{
+  FAR const struct ftpd_cmd_s *cmd;
+  unsigned int slot;
+  uint32_t key;
 
-              return g_ftpdcmdtab[index].handler(session);
-            }
+  if (!g_ftpdcmdindexed)
+    {
+      ftpd_cmdhash_index();
+    }
 
-          /* No... this command is not in the command table.  Break out of
-           * the loop and send the 500 message.
-           */
+  if (!ftpd_cmdkey(command, &key))
+    {
+      return NULL;
+    }
 
-          break;
+  /* Different strings may share a slot; confirm the match */
+
+  slot = FTPD_CMDHASH(key);
+  while (g_ftpdcmdhash[slot] != 0)
+    {
+      cmd = &g_ftpdcmdtab[g_ftpdcmdhash[slot] - 1];
+      if (strcmp(command, cmd->command) == 0)
+        {
+          return cmd;
+        }
+
+      slot = (slot + 1) & (FTPD_CMDHASH_SIZE - 1);
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: ftpd_command
+ ****************************************************************************/
+
+static int ftpd_command(FAR struct ftpd_session_s *session)
+{
+  FAR const struct ftpd_cmd_s *cmd;
+
+  /* Look up the command in the command table */
+
+  cmd = ftpd_cmdlookup(session->command);
+  if (cmd && cmd->handler)
+    {
+      /* Is a login required to execute this command? */
+
+      if ((cmd->flags & FTPD_CMDFLAG_LOGIN) != 0)
+        {
+          /* Yes... Check if the user is logged in */
+
+          if (!session->curr && session->head)
+            {
+              return ftpd_response(session->cmd.sd, session->txtimeout,
+                                   g_respfmt1, 530, ' ',
+                                   "Please login with USER and PASS !");
+            }
         }
+
+      /* Invoke the command handler. */
+
+      return cmd->handler(session);
     }
 
   /* There is nothing in the command table matching this command */
@@ -3900,6 +4420,69 @@ static int ftpd_command(FAR struct ftpd_session_s *session)
                        " not understood");
 }
 
+/****************************************************************************
+ * Name: ftpd_cmdline
+ *
+ * Description:
+ *   Parse and dispatch one complete, NUL-terminated command line (without
+ *   the CR LF).
+ *
+ ****************************************************************************/
+
+static int ftpd_cmdline(FAR struct ftpd_session_s *session, FAR char *line)
+{
+  size_t ntelnet;
+
+  /* TELNET protocol (RFC854)
+   *   IAC   255(FFH) interpret as command:
+   *   IP    244(F4H) interrupt process--permanently
+   *   DM    242(F2H) data mark--for connect. cleaning
+   *
+   * Echo any leading TELNET sequence back with a single send.
+   */
+
+  for (ntelnet = 0; ; ntelnet++)
+    {
+      uint8_t ch = (uint8_t)line[ntelnet];
+      if (ch != 0xff && ch != 0xf4 && ch != 0xf2)
+        {
+          break;
+        }
+    }
+
+  if (ntelnet > 0)
+    {
+      (void)ftpd_send(session->cmd.sd, line, ntelnet, session->txtimeout);
+      line += ntelnet;
+    }
+
+  /* Just continue if there was nothing of interest in the line */
+
+  if (*line == '\0')
+    {
+      return OK;
+    }
+
+  /* Parse command and param tokens */
+
+  session->param   = line;
+  session->command = ftpd_strtok(true, " \t", &session->param);
+
+  /* Unlike the "real" strtok, ftpd_strtok does not NUL-terminate
+   * the returned string.
+   */
+
+  if (session->param[0] != '\0')
+    {
+      session->param[0] = '\0';
+      session->param++;
+    }
+
+  /* Dispatch the FTP command */
+
+  return ftpd_command(session);
+}
+
 /****************************************************************************
  * Worker Thread
  ****************************************************************************/
@@ -4047,8 +4630,9 @@ static FAR void *ftpd_worker(FAR void *arg)
 {
   FAR struct ftpd_session_s *session = (FAR struct ftpd_session_s *)arg;
   ssize_t recvbytes;
+  size_t nbuffered;
   size_t offset;
-  uint8_t ch;
+  bool discard;
   int ret;
 
   ninfo("Worker started\n");
@@ -4069,14 +4653,20 @@ static FAR void *ftpd_worker(FAR void *arg)
       return NULL;
     }
 
-  /* Then loop processing FTP commands */
+  /* Then loop processing FTP commands.  Each recv() may return any number
+   * of complete command lines plus the beginning of the next one.
+   */
+
+  nbuffered = 0;
+  discard   = false;
 
   for (;;)
     {
-      /* Receive the next command */
+      /* Receive more command data after any partial line */
 
-      recvbytes = ftpd_recv(session->cmd.sd, session->cmd.buffer,
-                            session->cmd.buflen - 1, session->rxtimeout);
+      recvbytes = ftpd_recv(session->cmd.sd, &session->cmd.buffer[nbuffered],
+                            session->cmd.buflen - 1 - nbuffered,
+                            session->rxtimeout);
 
       /* recbytes < 0 is a receive failure (posibily a timeout);
        * recbytes == 0 indicates that we have lost the connection.
@@ -4089,77 +4679,72 @@ static FAR void *ftpd_worker(FAR void *arg)
           break;
         }
 
-      /* Make sure that the recevied string is NUL terminated */
-
-      session->cmd.buffer[recvbytes] = '\0';
+      nbuffered += recvbytes;
 
-      /* TELNET protocol (RFC854)
-       *   IAC   255(FFH) interpret as command:
-       *   IP    244(F4H) interrupt process--permanently
-       *   DM    242(F2H) data mark--for connect. cleaning
-       */
+      /* Process every complete line in the buffer */
 
       offset = 0;
-      while (recvbytes > 0)
+      for (;;)
         {
-          ch = session->cmd.buffer[offset];
-            if (ch != 0xff && ch != 0xf4 && ch != 0xf2)
-              {
-                break;
-              }
+          FAR char *line = &session->cmd.buffer[offset];
+          FAR char *eol;
 
-          (void)ftpd_send(session->cmd.sd, &session->cmd.buffer[offset], 1, session->txtimeout);
+          eol = (FAR char *)memchr(line, '\n', nbuffered - offset);
+          if (!eol)
+            {
+              break;
+            }
 
-          offset++;
-          recvbytes--;
-        }
+          /* NUL-terminate the line, removing the CR LF */
 
-      /* Just continue if there was nothing of interest in the packet */
+          *eol = '\0';
+          if (eol > line && eol[-1] == '\r')
+            {
+              eol[-1] = '\0';
+            }
 
-      if (recvbytes <= 0)
-        {
-          continue;
-        }
+          offset = eol - session->cmd.buffer + 1;
 
-      /* Make command message */
+          /* Skip the tail of a line that was too long */
 
-      session->command = &session->cmd.buffer[offset];
-      while (session->cmd.buffer[offset] != '\0')
-        {
-          if (session->cmd.buffer[offset] == '\r' &&
-              session->cmd.buffer[offset + ((ssize_t)1)] == '\n')
+          if (discard)
             {
-              session->cmd.buffer[offset] = '\0';
-              break;
+              discard = false;
+              continue;
             }
-          offset++;
-        }
 
-      /* Parse command and param tokens */
-
-      session->param   = session->command;
-      session->command = ftpd_strtok(true, " \t", &session->param);
+          ret = ftpd_cmdline(session, line);
+          if (ret < 0)
+            {
+              nerr("ERROR: Disconnected by the command handler: %d\n", ret);
+              goto errout;
+            }
+        }
 
-      /* Unlike the "real" strtok, ftpd_strtok does not NUL-terminate
-       * the returned string.
-       */
+      /* Move any partial line to the beginning of the buffer */
 
-      if (session->param[0] != '\0')
+      nbuffered -= offset;
+      if (nbuffered > 0 && offset > 0)
         {
-          session->param[0] = '\0';
-          session->param++;
+          memmove(session->cmd.buffer, &session->cmd.buffer[offset],
+                  nbuffered);
         }
 
-      /* Dispatch the FTP command */
+      /* If the buffer is full without a line terminator, then the command
+       * is too long.  Drop it and everything up to the next line end.
+       */
 
-      ret = ftpd_command(session);
-      if (ret < 0)
+      if (nbuffered >= session->cmd.buflen - 1)
         {
-          nerr("ERROR: Disconnected by the command handler: %d\n", ret);
-          break;
+          nerr("ERROR: Command line too long\n");
+          (void)ftpd_response(session->cmd.sd, session->txtimeout,
+                              g_respfmt1, 500, ' ', "Command line too long");
+          nbuffered = 0;
+          discard   = true;
         }
     }
 
+errout:
   ftpd_freesession(session);
   return NULL;
 }
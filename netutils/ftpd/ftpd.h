@@ -45,6 +45,10 @@
 #include <sys/types.h>
 #include <stdbool.h>
 
+#ifdef CONFIG_FTPD_STORTHREAD
+#  include <semaphore.h>
+#endif
+
 #include <netinet/in.h>
 
 /****************************************************************************
@@ -161,6 +165,20 @@ struct ftpd_session_s
   FAR char                  *renamefrom;
 };
 
+/* This structure is shared between the STOR receiver and writer threads */
+
+#ifdef CONFIG_FTPD_STORTHREAD
+struct ftpd_writer_s
+{
+  int                        fd;        /* File being written */
+  int                        errval;    /* Write error (positive errno) */
+  sem_t                      full;      /* Buffers filled by the receiver */
+  sem_t                      empty;     /* Buffers released by the writer */
+  FAR char                  *buffer[2]; /* The two alternating buffers */
+  ssize_t                    buflen[2]; /* Data in each buffer, 0 = done */
+};
+#endif
+
 typedef int (*ftpd_cmdhandler_t)(struct ftpd_session_s *);
 
 struct ftpd_cmd_s
@@ -35,6 +35,7 @@
  ****************************************************************************/
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
@@ -50,6 +51,32 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+/* Alignment of nodes allocated from a caller-provided pool */
+
+#define CJSON_POOL_ALIGN sizeof(double)
+
+/* Nodes with these flags do not own their strings, except for a key
+ * marked with cJSON_KeyIsOwned.
+ */
+
+#define CJSON_NOTOWNED   (cJSON_IsPooled | cJSON_IsInSitu)
+#define CJSON_OWNSKEY(c) (!((c)->type & CJSON_NOTOWNED) || \
+                          ((c)->type & cJSON_KeyIsOwned) != 0)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* The state of one parse:  Where the nodes and strings come from. */
+
+struct cjson_parse_s
+{
+  char *pool;             /* Caller-provided pool, NULL: use cJSON_malloc */
+  size_t size;            /* Size of the pool */
+  size_t used;            /* Bytes of the pool in use */
+  int flags;              /* cJSON_IsPooled and/or cJSON_IsInSitu */
+};
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -66,11 +93,14 @@ static void (*cJSON_free)(void *ptr)    = free;
  * Private Prototypes
  ****************************************************************************/
 
-static const char *parse_value(cJSON *item, const char *value);
+static const char *parse_value(struct cjson_parse_s *ctx, cJSON *item,
+                               const char *value);
 static char *print_value(cJSON *item, int depth, int fmt);
-static const char *parse_array(cJSON *item, const char *value);
+static const char *parse_array(struct cjson_parse_s *ctx, cJSON *item,
+                               const char *value);
 static char *print_array(cJSON *item, int depth, int fmt);
-static const char *parse_object(cJSON *item, const char *value);
+static const char *parse_object(struct cjson_parse_s *ctx, cJSON *item,
+                                const char *value);
 static char *print_object(cJSON *item, int depth, int fmt);
 
 /****************************************************************************
@@ -105,6 +135,51 @@ static cJSON *cJSON_New_Item(void)
   return node;
 }
 
+/* Allocate memory for the parse in progress, either from the caller's pool
+ * or with cJSON_malloc.
+ */
+
+static void *parse_alloc(struct cjson_parse_s *ctx, size_t size,
+                         size_t align)
+{
+  uintptr_t addr;
+  size_t pad;
+
+  if (!ctx->pool)
+    {
+      return cJSON_malloc(size);
+    }
+
+  addr = (uintptr_t)(ctx->pool + ctx->used);
+  pad  = (align - (addr & (align - 1))) & (align - 1);
+
+  if (ctx->used + pad + size > ctx->size)
+    {
+      /* Pool exhausted */
+
+      return 0;
+    }
+
+  ctx->used += pad + size;
+  return (void *)(addr + pad);
+}
+
+/* Parser constructor.  The node carries the ownership flags of the parse
+ * from the start so that a partially parsed tree can always be deleted.
+ */
+
+static cJSON *parse_new_item(struct cjson_parse_s *ctx)
+{
+  cJSON *node = (cJSON *)parse_alloc(ctx, sizeof(cJSON), CJSON_POOL_ALIGN);
+  if (node)
+    {
+      memset(node, 0, sizeof(cJSON));
+      node->type = ctx->flags;
+    }
+
+  return node;
+}
+
 static int cJSON_strcasecmp(const char *s1, const char *s2)
 {
   if (!s1)
@@ -130,7 +205,8 @@ static int cJSON_strcasecmp(const char *s1, const char *s2)
 
 /* Parse the input text to generate a number, and populate the result into item. */
 
-static const char *parse_number(cJSON *item, const char *num)
+static const char *parse_number(struct cjson_parse_s *ctx, cJSON *item,
+                                const char *num)
 {
   double n = 0, sign = 1, scale = 0;
   int subscale = 0, signsubscale = 1;
@@ -204,7 +280,7 @@ static const char *parse_number(cJSON *item, const char *num)
   n = sign * n * pow(10.0, (scale + subscale * signsubscale));
   item->valuedouble = n;
   item->valueint = (int)n;
-  item->type = cJSON_Number;
+  item->type = cJSON_Number | ctx->flags;
   return num;
 }
 
@@ -250,13 +326,19 @@ static char *print_number(cJSON *item)
   return str;
 }
 
-/* Parse the input text into an unescaped cstring, and populate item. */
+/* Parse the input text into an unescaped cstring, and populate item.  In
+ * in-situ mode, the string is unescaped in place in the input buffer:  The
+ * unescaped string is never longer than the escaped text, so the output
+ * never overtakes the input.
+ */
 
-static const char *parse_string(cJSON *item, const char *str)
+static const char *parse_string(struct cjson_parse_s *ctx, cJSON *item,
+                                const char *str)
 {
   const char *ptr = str + 1;
   char *ptr2;
   char *out;
+  char term;
   int len = 0;
   unsigned uc;
   unsigned uc2;
@@ -269,22 +351,29 @@ static const char *parse_string(cJSON *item, const char *str)
       return 0;
     }
 
-  while (*ptr != '\"' && *ptr && ++len)
+  if ((ctx->flags & cJSON_IsInSitu) != 0)
     {
-      /* Skip escaped quotes. */
-
-      if (*ptr++ == '\\')
+      out = (char *)ptr;
+    }
+  else
+    {
+      while (*ptr != '\"' && *ptr && ++len)
         {
-          ptr++;
+          /* Skip escaped quotes. */
+
+          if (*ptr++ == '\\')
+            {
+              ptr++;
+            }
         }
-    }
 
-  /* This is how long we need for the string, roughly. */
+      /* This is how long we need for the string, roughly. */
 
-  out = (char *)cJSON_malloc(len + 1);
-  if (!out)
-    {
-      return 0;
+      out = (char *)parse_alloc(ctx, len + 1, 1);
+      if (!out)
+        {
+          return 0;
+        }
     }
 
   ptr = str + 1;
@@ -398,14 +487,17 @@ static const char *parse_string(cJSON *item, const char *str)
         }
     }
 
+  /* In-situ, the terminator may overwrite the closing quote */
+
+  term  = *ptr;
   *ptr2 = 0;
-  if (*ptr == '\"')
+  if (term == '\"')
     {
       ptr++;
     }
 
   item->valuestring = out;
-  item->type = cJSON_String;
+  item->type = cJSON_String | ctx->flags;
   return ptr;
 }
 
@@ -523,7 +615,8 @@ static const char *skip(const char *in)
 
 /* Parser core - when encountering text, process appropriately. */
 
-static const char *parse_value(cJSON *item, const char *value)
+static const char *parse_value(struct cjson_parse_s *ctx, cJSON *item,
+                               const char *value)
 {
   if (!value)
     {
@@ -534,41 +627,41 @@ static const char *parse_value(cJSON *item, const char *value)
 
   if (!strncmp(value, "null", 4))
     {
-      item->type = cJSON_NULL;
+      item->type = cJSON_NULL | ctx->flags;
       return value + 4;
     }
 
   if (!strncmp(value, "false", 5))
     {
-      item->type = cJSON_False;
+      item->type = cJSON_False | ctx->flags;
       return value + 5;
     }
 
   if (!strncmp(value, "true", 4))
     {
-      item->type = cJSON_True;
+      item->type = cJSON_True | ctx->flags;
       item->valueint = 1;
       return value + 4;
     }
 
   if (*value == '\"')
     {
-      return parse_string(item, value);
+      return parse_string(ctx, item, value);
     }
 
   if (*value == '-' || (*value >= '0' && *value <= '9'))
     {
-      return parse_number(item, value);
+      return parse_number(ctx, item, value);
     }
 
   if (*value == '[')
     {
-      return parse_array(item, value);
+      return parse_array(ctx, item, value);
     }
 
   if (*value == '{')
     {
-      return parse_object(item, value);
+      return parse_object(ctx, item, value);
     }
 
   /* Failure. */
@@ -623,7 +716,8 @@ static char *print_value(cJSON *item, int depth, int fmt)
 
 /* Build an array from input text. */
 
-static const char *parse_array(cJSON *item, const char *value)
+static const char *parse_array(struct cjson_parse_s *ctx, cJSON *item,
+                               const char *value)
 {
   cJSON *child;
 
@@ -635,7 +729,7 @@ static const char *parse_array(cJSON *item, const char *value)
       return 0;
     }
 
-  item->type = cJSON_Array;
+  item->type = cJSON_Array | ctx->flags;
   value = skip(value + 1);
   if (*value == ']')
     {
@@ -644,7 +738,7 @@ static const char *parse_array(cJSON *item, const char *value)
       return value + 1;
     }
 
-  item->child = child = cJSON_New_Item();
+  item->child = child = parse_new_item(ctx);
   if (!item->child)
     {
       /* Memory fail */
@@ -654,7 +748,7 @@ static const char *parse_array(cJSON *item, const char *value)
 
   /* Skip any spacing, get the value. */
 
-  value = skip(parse_value(child, skip(value)));
+  value = skip(parse_value(ctx, child, skip(value)));
   if (!value)
     {
       return 0;
@@ -663,7 +757,7 @@ static const char *parse_array(cJSON *item, const char *value)
   while (*value == ',')
     {
       cJSON *new_item;
-      if (!(new_item = cJSON_New_Item()))
+      if (!(new_item = parse_new_item(ctx)))
         {
           /* <emory fail */
 
@@ -673,7 +767,7 @@ static const char *parse_array(cJSON *item, const char *value)
       child->next = new_item;
       new_item->prev = child;
       child = new_item;
-      value = skip(parse_value(child, skip(value + 1)));
+      value = skip(parse_value(ctx, child, skip(value + 1)));
       if (!value)
         {
           /* Memory fail */
@@ -819,7 +913,8 @@ static char *print_array(cJSON *item, int depth, int fmt)
 
 /* Build an object from the text. */
 
-static const char *parse_object(cJSON *item, const char *value)
+static const char *parse_object(struct cjson_parse_s *ctx, cJSON *item,
+                                const char *value)
 {
   cJSON *child;
   if (*value != '{')
@@ -830,7 +925,7 @@ static const char *parse_object(cJSON *item, const char *value)
       return 0;
     }
 
-  item->type = cJSON_Object;
+  item->type = cJSON_Object | ctx->flags;
   value = skip(value + 1);
   if (*value == '}')
     {
@@ -839,13 +934,13 @@ static const char *parse_object(cJSON *item, const char *value)
       return value + 1;
     }
 
-  item->child = child = cJSON_New_Item();
+  item->child = child = parse_new_item(ctx);
   if (!item->child)
     {
       return 0;
     }
 
-  value = skip(parse_string(child, skip(value)));
+  value = skip(parse_string(ctx, child, skip(value)));
   if (!value)
     {
       return 0;
@@ -861,7 +956,7 @@ static const char *parse_object(cJSON *item, const char *value)
 
   /* Skip any spacing, get the value. */
 
-  value = skip(parse_value(child, skip(value + 1)));
+  value = skip(parse_value(ctx, child, skip(value + 1)));
   if (!value)
     {
       return 0;
@@ -870,7 +965,7 @@ static const char *parse_object(cJSON *item, const char *value)
   while (*value == ',')
     {
       cJSON *new_item;
-      if (!(new_item = cJSON_New_Item()))
+      if (!(new_item = parse_new_item(ctx)))
         {
           /* Memory fail */
 
@@ -880,7 +975,7 @@ static const char *parse_object(cJSON *item, const char *value)
       child->next = new_item;
       new_item->prev = child;
       child = new_item;
-      value = skip(parse_string(child, skip(value + 1)));
+      value = skip(parse_string(ctx, child, skip(value + 1)));
       if (!value)
         {
           return 0;
@@ -896,7 +991,7 @@ static const char *parse_object(cJSON *item, const char *value)
 
      /* Skip any spacing, get the value. */
 
-      value = skip(parse_value(child, skip(value + 1)));
+      value = skip(parse_value(ctx, child, skip(value + 1)));
       if (!value)
         {
           return 0;
@@ -1085,6 +1180,24 @@ static void suffix_object(cJSON *prev, cJSON *item)
   item->prev = prev;
 }
 
+/* Give an item a heap copy of 'string' as its key.  Pooled and in-situ
+ * nodes remember that they own it, so that cJSON_Delete() frees it.
+ */
+
+static void set_key(cJSON *item, const char *string)
+{
+  if (item->string && CJSON_OWNSKEY(item))
+    {
+      cJSON_free(item->string);
+    }
+
+  item->string = cJSON_strdup(string);
+  if (item->type & CJSON_NOTOWNED)
+    {
+      item->type |= cJSON_KeyIsOwned;
+    }
+}
+
 /* Utility for handling references. */
 
 static cJSON *create_reference(cJSON *item)
@@ -1097,11 +1210,34 @@ static cJSON *create_reference(cJSON *item)
 
   memcpy(ref, item, sizeof(cJSON));
   ref->string = 0;
+  ref->type &= ~(CJSON_NOTOWNED | cJSON_KeyIsOwned);
   ref->type |= cJSON_IsReference;
   ref->next = ref->prev = 0;
   return ref;
 }
 
+/* Parse with the given allocation state. */
+
+static cJSON *parse_root(struct cjson_parse_s *ctx, const char *value)
+{
+  cJSON *c = parse_new_item(ctx);
+  ep = 0;
+  if (!c)
+    {
+      /* Memory fail */
+
+      return 0;
+    }
+
+  if (!parse_value(ctx, c, skip(value)))
+    {
+      cJSON_Delete(c);
+      return 0;
+    }
+
+  return c;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -1139,17 +1275,23 @@ void cJSON_Delete(cJSON *c)
           cJSON_Delete(c->child);
         }
 
-      if (!(c->type & cJSON_IsReference) && c->valuestring)
+      if (!(c->type & (cJSON_IsReference | CJSON_NOTOWNED)) && c->valuestring)
         {
           cJSON_free(c->valuestring);
         }
 
-      if (c->string)
+      if (CJSON_OWNSKEY(c) && c->string)
         {
           cJSON_free(c->string);
         }
 
-      cJSON_free(c);
+      /* Nodes from a pool are released with the pool */
+
+      if (!(c->type & cJSON_IsPooled))
+        {
+          cJSON_free(c);
+        }
+
       c = next;
     }
 }
@@ -1158,19 +1300,58 @@ void cJSON_Delete(cJSON *c)
 
 cJSON *cJSON_Parse(const char *value)
 {
-  cJSON *c = cJSON_New_Item();
-  ep = 0;
-  if (!c)
-    {
-      /* Memory fail */
+  struct cjson_parse_s ctx;
+
+  memset(&ctx, 0, sizeof(ctx));
+  return parse_root(&ctx, value);
+}
+
+/* Parse with all nodes and strings taken from a caller-provided pool. */
 
+cJSON *cJSON_ParseWithPool(const char *value, void *pool, size_t size,
+                           size_t *used)
+{
+  struct cjson_parse_s ctx;
+  cJSON *c;
+
+  if (!pool)
+    {
       return 0;
     }
 
-  if (!parse_value(c, skip(value)))
+  ctx.pool  = (char *)pool;
+  ctx.size  = size;
+  ctx.used  = 0;
+  ctx.flags = cJSON_IsPooled;
+
+  c = parse_root(&ctx, value);
+  if (used)
     {
-      cJSON_Delete(c);
-      return 0;
+      *used = ctx.used;
+    }
+
+  return c;
+}
+
+/* Parse with strings unescaped in place in the input buffer.  Nodes come
+ * from the pool, if one is provided, or from cJSON_malloc.
+ */
+
+cJSON *cJSON_ParseInSitu(char *value, void *pool, size_t size,
+                         size_t *used)
+{
+  struct cjson_parse_s ctx;
+  cJSON *c;
+
+  ctx.pool  = (char *)pool;
+  ctx.size  = pool ? size : 0;
+  ctx.used  = 0;
+  ctx.flags = pool ? (cJSON_IsInSitu | cJSON_IsPooled) : cJSON_IsInSitu;
+
+  c = parse_root(&ctx, value);
+  if (used)
+    {
+      *used = ctx.used;
     }
 
   return c;
@@ -1261,12 +1442,7 @@ void cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item)
       return;
     }
 
-  if (item->string)
-    {
-      cJSON_free(item->string);
-    }
-
-  item->string = cJSON_strdup(string);
+  set_key(item, string);
   cJSON_AddItemToArray(object, item);
 }
 
@@ -1391,7 +1567,7 @@ void cJSON_ReplaceItemInObject(cJSON *object, const char *string, cJSON *newitem
 
   if (c)
     {
-      newitem->string = cJSON_strdup(string);
+      set_key(newitem, string);
       cJSON_ReplaceItemInArray(object, i, newitem);
     }
 }
@@ -0,0 +1,602 @@
+/****************************************************************************
+ * apps/netutils/json/json_writer.c
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "netutils/json_writer.h"
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: json_error
+ *
+ * Description:
+ *   Record the first error.  All later output is suppressed.
+ *
+ ****************************************************************************/
+
+static int json_error(FAR struct json_writer_s *writer, int error)
+{
+  if (writer->error == 0)
+    {
+      writer->error = error;
+    }
+
+  return writer->error;
+}
+
+/****************************************************************************
+ * Name: json_drain
+ ****************************************************************************/
+
+static int json_drain(FAR struct json_writer_s *writer)
+{
+  FAR const char *next = writer->buffer;
+  ssize_t nwritten;
+
+  while (writer->len > 0)
+    {
+      nwritten = write(writer->fd, next, writer->len);
+      if (nwritten < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          return json_error(writer, -errno);
+        }
+
+      next        += nwritten;
+      writer->len -= nwritten;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: json_put
+ *
+ * Description:
+ *   Append 'len' bytes to the output, draining the buffer to the descriptor
+ *   as it fills.
+ *
+ ****************************************************************************/
+
+static int json_put(FAR struct json_writer_s *writer, FAR const char *data,
+                    size_t len)
+{
+  size_t ncopy;
+
+  if (writer->error != 0)
+    {
+      return writer->error;
+    }
+
+  while (len > 0)
+    {
+      if (writer->len >= writer->size)
+        {
+          if (writer->fd < 0)
+            {
+              return json_error(writer, -ENOSPC);
+            }
+
+          if (json_drain(writer) < 0)
+            {
+              return writer->error;
+            }
+        }
+
+      ncopy = writer->size - writer->len;
+      if (ncopy > len)
+        {
+          ncopy = len;
+        }
+
+      memcpy(&writer->buffer[writer->len], data, ncopy);
+      writer->len   += ncopy;
+      writer->total += ncopy;
+      data          += ncopy;
+      len           -= ncopy;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: json_putc
+ ****************************************************************************/
+
+static int json_putc(FAR struct json_writer_s *writer, char ch)
+{
+  if (writer->error == 0 && writer->len < writer->size)
+    {
+      writer->buffer[writer->len++] = ch;
+      writer->total++;
+      return OK;
+    }
+
+  return json_put(writer, &ch, 1);
+}
+
+/****************************************************************************
+ * Name: json_putstring
+ *
+ * Description:
+ *   Emit a quoted, escaped string.  Runs of characters that need no
+ *   escaping are copied in one operation.
+ *
+ ****************************************************************************/
+
+static int json_putstring(FAR struct json_writer_s *writer,
+                          FAR const char *str)
+{
+  static const char hex[] = "0123456789abcdef";
+  FAR const char *run;
+  char esc[6];
+  uint8_t ch;
+
+  json_putc(writer, '"');
+
+  for (run = str; *str != '\0'; str++)
+    {
+      ch = (uint8_t)*str;
+      if (ch >= 0x20 && ch != '"' && ch != '\\')
+        {
+          continue;
+        }
+
+      /* Flush the run of plain characters, then the escape */
+
+      json_put(writer, run, str - run);
+      run = str + 1;
+
+      esc[0] = '\\';
+      switch (ch)
+        {
+          case '"':
+          case '\\':
+            esc[1] = ch;
+            json_put(writer, esc, 2);
+            break;
+
+          case '\n':
+            esc[1] = 'n';
+            json_put(writer, esc, 2);
+            break;
+
+          case '\r':
+            esc[1] = 'r';
+            json_put(writer, esc, 2);
+            break;
+
+          case '\t':
+            esc[1] = 't';
+            json_put(writer, esc, 2);
+            break;
+
+          default:
+            esc[1] = 'u';
+            esc[2] = '0';
+            esc[3] = '0';
+            esc[4] = hex[ch >> 4];
+            esc[5] = hex[ch & 15];
+            json_put(writer, esc, 6);
+            break;
+        }
+    }
+
+  json_put(writer, run, str - run);
+  return json_putc(writer, '"');
+}
+
+/****************************************************************************
+ * Name: json_putulong
+ ****************************************************************************/
+
+static int json_putulong(FAR struct json_writer_s *writer,
+                         unsigned long value, int mindigits)
+{
+  char digits[24];
+  int ndx = sizeof(digits);
+
+  do
+    {
+      digits[--ndx] = '0' + (value % 10);
+      value /= 10;
+      mindigits--;
+    }
+  while (value != 0 || mindigits > 0);
+
+  return json_put(writer, &digits[ndx], sizeof(digits) - ndx);
+}
+
+/****************************************************************************
+ * Name: json_member
+ *
+ * Description:
+ *   Emit the separator and, inside an object, the member name that precede
+ *   a value.
+ *
+ ****************************************************************************/
+
+static int json_member(FAR struct json_writer_s *writer,
+                       FAR const char *name)
+{
+  uint32_t bit;
+  bool inobject;
+
+  if (writer->depth == 0)
+    {
+      /* Only one top-level value is allowed */
+
+      if (name != NULL || writer->total > 0)
+        {
+          return json_error(writer, -EINVAL);
+        }
+
+      return writer->error;
+    }
+
+  bit      = (uint32_t)1 << (writer->depth - 1);
+  inobject = (writer->isarray & bit) == 0;
+
+  if ((name != NULL) != inobject)
+    {
+      return json_error(writer, -EINVAL);
+    }
+
+  if ((writer->hasitems & bit) != 0)
+    {
+      json_putc(writer, ',');
+    }
+
+  writer->hasitems |= bit;
+
+  if (inobject)
+    {
+      json_putstring(writer, name);
+      json_putc(writer, ':');
+    }
+
+  return writer->error;
+}
+
+/****************************************************************************
+ * Name: json_begin
+ ****************************************************************************/
+
+static int json_begin(FAR struct json_writer_s *writer, FAR const char *name,
+                      bool isarray)
+{
+  uint32_t bit;
+
+  if (writer->depth >= CONFIG_NETUTILS_JSON_WRITER_MAXDEPTH)
+    {
+      return json_error(writer, -E2BIG);
+    }
+
+  json_member(writer, name);
+
+  bit = (uint32_t)1 << writer->depth;
+  writer->hasitems &= ~bit;
+  if (isarray)
+    {
+      writer->isarray |= bit;
+    }
+  else
+    {
+      writer->isarray &= ~bit;
+    }
+
+  writer->depth++;
+  return json_putc(writer, isarray ? '[' : '{');
+}
+
+/****************************************************************************
+ * Name: json_end
+ ****************************************************************************/
+
+static int json_end(FAR struct json_writer_s *writer, bool isarray)
+{
+  uint32_t bit;
+
+  if (writer->depth == 0)
+    {
+      return json_error(writer, -EINVAL);
+    }
+
+  bit = (uint32_t)1 << (writer->depth - 1);
+  if (((writer->isarray & bit) != 0) != isarray)
+    {
+      return json_error(writer, -EINVAL);
+    }
+
+  writer->depth--;
+  return json_putc(writer, isarray ? ']' : '}');
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: json_writer_init
+ ****************************************************************************/
+
+void json_writer_init(FAR struct json_writer_s *writer, FAR char *buffer,
+                      size_t size, int fd)
+{
+  memset(writer, 0, sizeof(struct json_writer_s));
+  writer->buffer = buffer;
+  writer->size   = size;
+  writer->fd     = fd;
+}
+
+/****************************************************************************
+ * Name: json_writer_begin_object, etc.
+ ****************************************************************************/
+
+int json_writer_begin_object(FAR struct json_writer_s *writer,
+                             FAR const char *name)
+{
+  return json_begin(writer, name, false);
+}
+
+int json_writer_end_object(FAR struct json_writer_s *writer)
+{
+  return json_end(writer, false);
+}
+
+int json_writer_begin_array(FAR struct json_writer_s *writer,
+                            FAR const char *name)
+{
+  return json_begin(writer, name, true);
+}
+
+int json_writer_end_array(FAR struct json_writer_s *writer)
+{
+  return json_end(writer, true);
+}
+
+/****************************************************************************
+ * Name: json_writer_string
+ ****************************************************************************/
+
+int json_writer_string(FAR struct json_writer_s *writer,
+                       FAR const char *name, FAR const char *value)
+{
+  if (json_member(writer, name) < 0)
+    {
+      return writer->error;
+    }
+
+  if (value == NULL)
+    {
+      return json_put(writer, "null", 4);
+    }
+
+  return json_putstring(writer, value);
+}
+
+/****************************************************************************
+ * Name: json_writer_int
+ ****************************************************************************/
+
+int json_writer_int(FAR struct json_writer_s *writer, FAR const char *name,
+                    long value)
+{
+  unsigned long magnitude;
+
+  if (json_member(writer, name) < 0)
+    {
+      return writer->error;
+    }
+
+  if (value < 0)
+    {
+      json_putc(writer, '-');
+      magnitude = 0ul - (unsigned long)value;
+    }
+  else
+    {
+      magnitude = (unsigned long)value;
+    }
+
+  return json_putulong(writer, magnitude, 1);
+}
+
+/****************************************************************************
+ * Name: json_writer_fixed
+ ****************************************************************************/
+
+int json_writer_fixed(FAR struct json_writer_s *writer,
+                      FAR const char *name, double value, int decimals)
+{
+  static const unsigned long scale[10] =
+  {
+    1ul, 10ul, 100ul, 1000ul, 10000ul, 100000ul, 1000000ul, 10000000ul,
+    100000000ul, 1000000000ul
+  };
+
+  unsigned long ipart;
+  unsigned long fpart;
+  double rounded;
+  bool negative;
+
+  if (json_member(writer, name) < 0)
+    {
+      return writer->error;
+    }
+
+  /* JSON has no representation of NaN or infinity.  Values that do not fit
+   * into an unsigned long are not expected in telemetry and are also
+   * emitted as null.
+   */
+
+  if (value != value || value > (double)ULONG_MAX ||
+      value < -(double)ULONG_MAX)
+    {
+      return json_put(writer, "null", 4);
+    }
+
+  if (decimals < 0)
+    {
+      decimals = 0;
+    }
+  else if (decimals > 9)
+    {
+      decimals = 9;
+    }
+
+  negative = value < 0;
+  if (negative)
+    {
+      value = -value;
+    }
+
+  rounded = value + 0.5 / (double)scale[decimals];
+  ipart   = (unsigned long)rounded;
+  fpart   = (unsigned long)((rounded - (double)ipart) *
+                            (double)scale[decimals]);
+
+  /* Guard against the fraction rounding up to the next integer */
+
+  if (fpart >= scale[decimals])
+    {
+      fpart = scale[decimals] - 1;
+    }
+
+  /* Don't emit -0.000 for small negative values */
+
+  if (negative && (ipart != 0 || fpart != 0))
+    {
+      json_putc(writer, '-');
+    }
+
+  json_putulong(writer, ipart, 1);
+  if (decimals > 0)
+    {
+      json_putc(writer, '.');
+      json_putulong(writer, fpart, decimals);
+    }
+
+  return writer->error;
+}
+
+/****************************************************************************
+ * Name: json_writer_bool
+ ****************************************************************************/
+
+int json_writer_bool(FAR struct json_writer_s *writer, FAR const char *name,
+                     bool value)
+{
+  if (json_member(writer, name) < 0)
+    {
+      return writer->error;
+    }
+
+  return value ? json_put(writer, "true", 4) : json_put(writer, "false", 5);
+}
+
+/****************************************************************************
+ * Name: json_writer_null
+ ****************************************************************************/
+
+int json_writer_null(FAR struct json_writer_s *writer, FAR const char *name)
+{
+  if (json_member(writer, name) < 0)
+    {
+      return writer->error;
+    }
+
+  return json_put(writer, "null", 4);
+}
+
+/****************************************************************************
+ * Name: json_writer_flush
+ ****************************************************************************/
+
+int json_writer_flush(FAR struct json_writer_s *writer)
+{
+  if (writer->error != 0 || writer->fd < 0)
+    {
+      return writer->error;
+    }
+
+  return json_drain(writer);
+}
+
+/****************************************************************************
+ * Name: json_writer_finish
+ ****************************************************************************/
+
+ssize_t json_writer_finish(FAR struct json_writer_s *writer)
+{
+  if (writer->depth != 0)
+    {
+      json_error(writer, -EINVAL);
+    }
+
+  if (writer->error == 0)
+    {
+      if (writer->fd >= 0)
+        {
+          json_drain(writer);
+        }
+      else if (writer->len < writer->size)
+        {
+          writer->buffer[writer->len] = '\0';
+        }
+      else
+        {
+          json_error(writer, -ENOSPC);
+        }
+    }
+
+  return writer->error != 0 ? (ssize_t)writer->error : (ssize_t)writer->total;
+}
@@ -42,6 +42,9 @@
  * Included Files
  ****************************************************************************/
 
+#include <stdbool.h>
+#include <string.h>
+
 #include "ppp_conf.h"
 #include "ppp.h"
 
@@ -57,10 +60,63 @@
 #  define PACKET_TX_DEBUG 0
 #endif
 
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+#ifdef CONFIG_NETUTILS_PPPD_AHDLC_CRCTABLE
+/* FCS-16 lookup table (RFC 1662, reflected polynomial 0x8408).  Costs
+ * 512 bytes of .rodata and replaces the shift/xor sequence below with one
+ * load per byte.
+ */
+
+static const uint16_t g_fcstab[256] =
+{
+  0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
+  0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
+  0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
+  0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
+  0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
+  0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
+  0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
+  0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
+  0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
+  0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
+  0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
+  0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
+  0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
+  0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
+  0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
+  0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
+  0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
+  0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
+  0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
+  0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
+  0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
+  0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
+  0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
+  0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
+  0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
+  0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
+  0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
+  0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
+  0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
+  0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
+  0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
+  0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78
+};
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
+#ifdef CONFIG_NETUTILS_PPPD_AHDLC_CRCTABLE
+static inline uint16_t crcadd(uint16_t crcvalue, uint8_t c)
+{
+  return (crcvalue >> 8) ^ g_fcstab[(crcvalue ^ c) & 0xff];
+}
+#else
 /****************************************************************************
  * Simple and fast CRC16 routine for embedded processors.
  *
@@ -75,7 +131,7 @@
  *
  ****************************************************************************/
 
-static uint16_t crcadd(uint16_t crcvalue, uint8_t c)
+static inline uint16_t crcadd(uint16_t crcvalue, uint8_t c)
 {
   uint16_t b;
 
@@ -85,11 +141,128 @@ static uint16_t crcadd(uint16_t crcvalue, uint8_t c)
 
   return ((crcvalue >> 8) ^ b);
 }
+#endif
+
+/****************************************************************************
+ * ahdlc_tx_flush() - hand the staged transmit bytes to the serial device
+ *    in a single write.
+ *
+ ****************************************************************************/
+
+static void ahdlc_tx_flush(FAR struct ppp_context_s *ctx)
+{
+  if (ctx->ahdlc_tx_len > 0)
+    {
+      ppp_arch_write(ctx, ctx->ahdlc_tx_buffer, ctx->ahdlc_tx_len);
+      ctx->ahdlc_tx_len = 0;
+    }
+}
+
+/****************************************************************************
+ * ahdlc_tx_flag() - stage a 0x7e frame delimiter.
+ *
+ ****************************************************************************/
+
+static void ahdlc_tx_flag(FAR struct ppp_context_s *ctx)
+{
+  if (ctx->ahdlc_tx_len >= AHDLC_TX_BUFFER_SIZE)
+    {
+      ahdlc_tx_flush(ctx);
+    }
+
+  ctx->ahdlc_tx_buffer[ctx->ahdlc_tx_len++] = 0x7e;
+}
+
+/****************************************************************************
+ * ahdlc_tx_block(buffer, len) - add a block to the tx CRC and stage it for
+ *    the serial device, escaping as necessary.
+ *
+ *    We always escape 0x7d and 0x7e; characters below 0x20 are escaped
+ *    only when escctl is set (LCP frames or no negotiated async map).
+ *    Runs of characters that need no escaping are copied with memcpy()
+ *    rather than one at a time.
+ *
+ ****************************************************************************/
+
+static void ahdlc_tx_block(FAR struct ppp_context_s *ctx,
+                           FAR const uint8_t *buffer, uint16_t len,
+                           bool escctl)
+{
+  uint16_t space;
+  uint16_t run;
+
+  ctx->ahdlc_tx_crc = ahdlc_crc16(ctx->ahdlc_tx_crc, buffer, len);
+
+  while (len > 0)
+    {
+      /* Measure the run of characters that go out unchanged */
+
+      for (run = 0; run < len; run++)
+        {
+          uint8_t c = buffer[run];
+
+          if (c == 0x7d || c == 0x7e || (c < 0x20 && escctl))
+            {
+              break;
+            }
+        }
+
+      len -= run;
+      while (run > 0)
+        {
+          space = AHDLC_TX_BUFFER_SIZE - ctx->ahdlc_tx_len;
+          if (space == 0)
+            {
+              ahdlc_tx_flush(ctx);
+              continue;
+            }
+
+          if (space > run)
+            {
+              space = run;
+            }
+
+          memcpy(&ctx->ahdlc_tx_buffer[ctx->ahdlc_tx_len], buffer, space);
+          ctx->ahdlc_tx_len += space;
+          buffer += space;
+          run -= space;
+        }
+
+      if (len > 0)
+        {
+          /* Send escape char and xor byte by 0x20 */
+
+          if (ctx->ahdlc_tx_len > AHDLC_TX_BUFFER_SIZE - 2)
+            {
+              ahdlc_tx_flush(ctx);
+            }
+
+          ctx->ahdlc_tx_buffer[ctx->ahdlc_tx_len++] = 0x7d;
+          ctx->ahdlc_tx_buffer[ctx->ahdlc_tx_len++] = *buffer++ ^ 0x20;
+          len--;
+        }
+    }
+}
 
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * ahdlc_crc16(crc, buffer, len) - add a block of bytes to a running FCS-16.
+ *
+ ****************************************************************************/
+
+uint16_t ahdlc_crc16(uint16_t crc, FAR const uint8_t *buffer, size_t len)
+{
+  while (len-- > 0)
+    {
+      crc = crcadd(crc, *buffer++);
+    }
+
+  return crc;
+}
+
 /****************************************************************************
  * ahdlc_init(buffer, buffersize) - this initializes the ahdlc engine to
  *    allow for rx frames.
@@ -101,6 +274,9 @@ void ahdlc_init(struct ppp_context_s *ctx)
   ctx->ahdlc_flags = PPP_RX_ASYNC_MAP;
   ctx->ahdlc_rx_count = 0;
   ctx->ahdlc_tx_offline = 0;
+  ctx->ahdlc_tx_len = 0;
+  ctx->ahdlc_rx_chunkpos = 0;
+  ctx->ahdlc_rx_chunklen = 0;
 
 #ifdef PPP_STATISTICS
   ctx->ahdlc_crc_error = 0;
@@ -298,38 +474,70 @@ uint8_t ahdlc_rx(FAR struct ppp_context_s *ctx, uint8_t c)
 }
 
 /****************************************************************************
- * ahdlc_tx_char(char) - write a character to the serial device,
- * escape if necessary.
+ * ahdlc_rx_block(buffer, len) - process a block of incoming bytes.
  *
- * Relies on local global vars   :    ahdlc_tx_crc, ahdlc_flags.
- * Modifies local global vars    :    ahdlc_tx_crc.
+ *    Runs of ordinary characters inside a frame are copied into the frame
+ *    buffer with memcpy() and added to the CRC in one pass; flags, escapes
+ *    and the first bytes of a frame (auto ACFC) go through ahdlc_rx().
+ *
+ *    Processing stops after each 0x7e so that the caller can consume a
+ *    frame delivered by the upcall before the next one arrives.  Returns
+ *    the number of bytes consumed.
  *
  ****************************************************************************/
 
-void ahdlc_tx_char(struct ppp_context_s *ctx, uint16_t protocol, uint8_t c)
+uint16_t ahdlc_rx_block(FAR struct ppp_context_s *ctx,
+                        FAR const uint8_t *buffer, uint16_t len)
 {
-  /* Add in crc */
+  uint16_t space;
+  uint16_t run;
+  uint16_t i = 0;
+  bool discardctl;
+  uint8_t c;
 
-  ctx->ahdlc_tx_crc = crcadd(ctx->ahdlc_tx_crc, c);
+  while (i < len)
+    {
+      if ((ctx->ahdlc_flags & (PPP_RX_READY | PPP_ESCAPED)) == PPP_RX_READY &&
+          ctx->ahdlc_rx_count > 0)
+        {
+          discardctl = (ctx->ahdlc_flags & PPP_RX_ASYNC_MAP) == 0;
+          space = PPP_RX_BUFFER_SIZE - ctx->ahdlc_rx_count;
+          if (space > len - i)
+            {
+              space = len - i;
+            }
 
-  /* See if we need to escape char, we always escape 0x7d and 0x7e, in the case
-   * of char < 0x20 we only support async map of default or none, so escape if
-   * ASYNC map is not set.  We may want to modify this to support a bitmap set
-   * ASYNC map.
-   */
+          for (run = 0; run < space; run++)
+            {
+              c = buffer[i + run];
+              if (c == 0x7d || c == 0x7e || (c < 0x20 && discardctl))
+                {
+                  break;
+                }
+            }
 
-  if ((c == 0x7d) || (c == 0x7e) || ((c < 0x20) && ((protocol == LCP) ||
-                                                    (ctx->
-                                                     ahdlc_flags &
-                                                     PPP_TX_ASYNC_MAP) == 0)))
-    {
-      /* Send escape char and xor byte by 0x20 */
+          if (run > 0)
+            {
+              memcpy(&ctx->ahdlc_rx_buffer[ctx->ahdlc_rx_count],
+                     &buffer[i], run);
+              ctx->ahdlc_rx_crc = ahdlc_crc16(ctx->ahdlc_rx_crc,
+                                              &buffer[i], run);
+              ctx->ahdlc_rx_count += run;
+              i += run;
+              continue;
+            }
+        }
+
+      c = buffer[i++];
+      ahdlc_rx(ctx, c);
 
-      ppp_arch_putchar(ctx, 0x7d);
-      c ^= 0x20;
+      if (c == 0x7e)
+        {
+          break;
+        }
     }
 
-  ppp_arch_putchar(ctx, c);
+  return i;
 }
 
 /****************************************************************************
@@ -347,8 +555,9 @@ uint8_t ahdlc_tx(struct ppp_context_s *ctx, uint16_t protocol,
                  FAR uint8_t * header, FAR uint8_t * buffer, uint16_t headerlen,
                  uint16_t datalen)
 {
+  uint8_t fields[4];
   uint16_t i;
-  uint8_t c;
+  bool escctl;
 
   DEBUG1(("\nAHDLC_TX - transmit frame, protocol 0x%04x, length %d  offline %d\n",
          protocol, datalen + headerlen, ctx->ahdlc_tx_offline));
@@ -378,9 +587,16 @@ uint8_t ahdlc_tx(struct ppp_context_s *ctx, uint16_t protocol,
 
   /* Check to see that physical layer is up, we can assume is some cases */
 
+  /* In the case of char < 0x20 we only support async map of default or
+   * none, so escape if ASYNC map is not set.  We may want to modify this to
+   * support a bitmap set ASYNC map.
+   */
+
+  escctl = (protocol == LCP) || (ctx->ahdlc_flags & PPP_TX_ASYNC_MAP) == 0;
+
   /* Write leading 0x7e */
 
-  ppp_arch_putchar(ctx, 0x7e);
+  ahdlc_tx_flag(ctx);
 
   /* Set initial CRC value */
 
@@ -388,56 +604,35 @@ uint8_t ahdlc_tx(struct ppp_context_s *ctx, uint16_t protocol,
 
   /* send HDLC control and address if not disabled or of LCP frame type */
 
-  /* if ((0==(ahdlc_flags & PPP_ACFC)) || ((0xc0==buffer[0]) &&
-   * (0x21==buffer[1])))
-   */
-
+  i = 0;
   if ((0 == (ctx->ahdlc_flags & PPP_ACFC)) || (protocol == LCP))
     {
-      ahdlc_tx_char(ctx, protocol, 0xff);
-      ahdlc_tx_char(ctx, protocol, 0x03);
+      fields[i++] = 0xff;
+      fields[i++] = 0x03;
     }
 
   /* Write Protocol */
 
-  ahdlc_tx_char(ctx, protocol, (uint8_t)(protocol >> 8));
-  ahdlc_tx_char(ctx, protocol, (uint8_t)(protocol & 0xff));
+  fields[i++] = (uint8_t)(protocol >> 8);
+  fields[i++] = (uint8_t)(protocol & 0xff);
+  ahdlc_tx_block(ctx, fields, i, escctl);
 
-  /* Write header if it exists */
+  /* Write header if it exists, then the frame bytes */
 
-  for (i = 0; i < headerlen; ++i)
-    {
-      /* Get next byte from buffer */
-
-      c = header[i];
-
-      /* Write it... */
-
-      ahdlc_tx_char(ctx, protocol, c);
-    }
-
-  /* Write frame bytes */
-
-  for (i = 0; i < datalen; ++i)
-    {
-      /* Get next byte from buffer */
-
-      c = buffer[i];
-
-      /* Write it... */
-
-      ahdlc_tx_char(ctx, protocol, c);
-    }
+  ahdlc_tx_block(ctx, header, headerlen, escctl);
+  ahdlc_tx_block(ctx, buffer, datalen, escctl);
 
   /* Send crc, lsb then msb */
 
   i = ctx->ahdlc_tx_crc ^ 0xffff;
-  ahdlc_tx_char(ctx, protocol, (uint8_t)(i & 0xff));
-  ahdlc_tx_char(ctx, protocol, (uint8_t)((i >> 8) & 0xff));
+  fields[0] = (uint8_t)(i & 0xff);
+  fields[1] = (uint8_t)((i >> 8) & 0xff);
+  ahdlc_tx_block(ctx, fields, 2, escctl);
 
   /* Write trailing 0x7e, probably not needed but it doesn't hurt */
 
-  ppp_arch_putchar(ctx, 0x7e);
+  ahdlc_tx_flag(ctx);
+  ahdlc_tx_flush(ctx);
 
 #if PPP_STATISTICS
   /* Update statistics */
@@ -0,0 +1,360 @@
+/****************************************************************************
+ * apps/netutils/pppd/ahdlc_bench.c
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "ppp.h"
+
+#include "netutils/pppd.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Largest IPv4 payload that fits the receive buffer along with the
+ * protocol field and FCS.
+ */
+
+#define BENCH_PAYLOAD_SIZE  (PPP_RX_BUFFER_SIZE - 4)
+#define BENCH_FRAME_SIZE    (2 * (BENCH_PAYLOAD_SIZE + 6) + 2)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct ahdlc_bench_s
+{
+  uint8_t payload[BENCH_PAYLOAD_SIZE];
+  uint8_t frame[BENCH_FRAME_SIZE];
+  uint16_t framelen;
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: bench_usec
+ ****************************************************************************/
+
+static uint64_t bench_usec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: bench_report
+ ****************************************************************************/
+
+static void bench_report(FAR const char *name, uint64_t nbytes,
+                         uint64_t usec)
+{
+  if (usec == 0)
+    {
+      usec = 1;
+    }
+
+  printf("  %-16s %8lu bytes in %8lu usec: %8lu KiB/s\n", name,
+         (unsigned long)nbytes, (unsigned long)usec,
+         (unsigned long)(nbytes * 1000000 / 1024 / usec));
+}
+
+/****************************************************************************
+ * Name: bench_crcbit
+ *
+ * Description:
+ *   Bit-at-a-time FCS-16, the reference the optimized routine is checked
+ *   against.
+ *
+ ****************************************************************************/
+
+static uint16_t bench_crcbit(uint16_t crc, FAR const uint8_t *buffer,
+                             size_t len)
+{
+  int bit;
+
+  while (len-- > 0)
+    {
+      crc ^= *buffer++;
+      for (bit = 0; bit < 8; bit++)
+        {
+          crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : crc >> 1;
+        }
+    }
+
+  return crc;
+}
+
+/****************************************************************************
+ * Name: bench_putc
+ ****************************************************************************/
+
+static void bench_putc(FAR struct ahdlc_bench_s *bench, uint8_t c)
+{
+  if (c == 0x7d || c == 0x7e || c < 0x20)
+    {
+      bench->frame[bench->framelen++] = 0x7d;
+      c ^= 0x20;
+    }
+
+  bench->frame[bench->framelen++] = c;
+}
+
+/****************************************************************************
+ * Name: bench_setup
+ *
+ * Description:
+ *   Fill the payload with pseudo-random bytes, so that about one byte in
+ *   eight needs escaping, and encode it one byte at a time into an IPv4
+ *   frame as a peer with the default async map would send it.
+ *
+ ****************************************************************************/
+
+static void bench_setup(FAR struct ahdlc_bench_s *bench)
+{
+  uint8_t header[4] =
+  {
+    0xff, 0x03, IPV4 >> 8, IPV4 & 0xff
+  };
+
+  uint32_t seed = 0x12345678;
+  uint16_t fcs;
+  int i;
+
+  for (i = 0; i < BENCH_PAYLOAD_SIZE; i++)
+    {
+      seed = seed * 1103515245 + 12345;
+      bench->payload[i] = (uint8_t)(seed >> 16);
+    }
+
+  fcs = bench_crcbit(0xffff, header, sizeof(header));
+  fcs = bench_crcbit(fcs, bench->payload, BENCH_PAYLOAD_SIZE) ^ 0xffff;
+
+  bench->framelen = 0;
+  bench->frame[bench->framelen++] = 0x7e;
+
+  for (i = 0; i < sizeof(header); i++)
+    {
+      bench_putc(bench, header[i]);
+    }
+
+  for (i = 0; i < BENCH_PAYLOAD_SIZE; i++)
+    {
+      bench_putc(bench, bench->payload[i]);
+    }
+
+  bench_putc(bench, fcs & 0xff);
+  bench_putc(bench, fcs >> 8);
+  bench->frame[bench->framelen++] = 0x7e;
+}
+
+/****************************************************************************
+ * Name: bench_check
+ *
+ * Description:
+ *   Verify that the receive path delivered the payload intact.
+ *
+ ****************************************************************************/
+
+static int bench_check(FAR struct ppp_context_s *ctx,
+                       FAR struct ahdlc_bench_s *bench, FAR const char *name)
+{
+  if (ctx->ip_len != BENCH_PAYLOAD_SIZE ||
+      memcmp(ctx->ip_buf, bench->payload, BENCH_PAYLOAD_SIZE) != 0)
+    {
+      printf("ahdlc_benchmark: %s delivered a bad frame (len %u)\n",
+             name, ctx->ip_len);
+      return -EIO;
+    }
+
+  ctx->ip_len = 0;
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: ahdlc_benchmark
+ ****************************************************************************/
+
+int ahdlc_benchmark(int iterations)
+{
+  FAR struct ppp_context_s *ctx;
+  FAR struct ahdlc_bench_s *bench;
+  volatile uint16_t fcs = 0;
+  uint64_t nbytes;
+  uint64_t start;
+  uint16_t pos;
+  uint16_t i;
+  int ret = OK;
+  int n;
+
+  if (iterations <= 0)
+    {
+      iterations = 1000;
+    }
+
+  ctx = (FAR struct ppp_context_s *)malloc(sizeof(struct ppp_context_s));
+  bench = (FAR struct ahdlc_bench_s *)malloc(sizeof(struct ahdlc_bench_s));
+  if (ctx == NULL || bench == NULL)
+    {
+      free(ctx);
+      free(bench);
+      return -ENOMEM;
+    }
+
+  memset(ctx, 0, sizeof(struct ppp_context_s));
+  ahdlc_init(ctx);
+  ahdlc_rx_ready(ctx);
+  ctx->ppp_flags = PPP_RX_READY;
+
+  ctx->ctl.fd = open("/dev/null", O_WRONLY);
+  if (ctx->ctl.fd < 0)
+    {
+      ret = -errno;
+      goto errout;
+    }
+
+  bench_setup(bench);
+
+  printf("AHDLC: %d frames, %d byte payload, %u bytes on the wire\n",
+         iterations, BENCH_PAYLOAD_SIZE, bench->framelen);
+
+  /* FCS over the raw payload, reference and optimized */
+
+  if (ahdlc_crc16(0xffff, bench->payload, BENCH_PAYLOAD_SIZE) !=
+      bench_crcbit(0xffff, bench->payload, BENCH_PAYLOAD_SIZE))
+    {
+      printf("ahdlc_benchmark: FCS mismatch\n");
+      ret = -EIO;
+      goto errout_with_fd;
+    }
+
+  nbytes = (uint64_t)iterations * BENCH_PAYLOAD_SIZE;
+
+  start = bench_usec();
+  for (n = 0; n < iterations; n++)
+    {
+      fcs += bench_crcbit(0xffff, bench->payload, BENCH_PAYLOAD_SIZE);
+    }
+
+  bench_report("fcs bitwise", nbytes, bench_usec() - start);
+
+  start = bench_usec();
+  for (n = 0; n < iterations; n++)
+    {
+      fcs += ahdlc_crc16(0xffff, bench->payload, BENCH_PAYLOAD_SIZE);
+    }
+
+  bench_report("fcs", nbytes, bench_usec() - start);
+
+  /* Receive a byte at a time, as the engine used to */
+
+  nbytes = (uint64_t)iterations * bench->framelen;
+
+  start = bench_usec();
+  for (n = 0; n < iterations && ret == OK; n++)
+    {
+      for (i = 0; i < bench->framelen; i++)
+        {
+          ahdlc_rx(ctx, bench->frame[i]);
+        }
+
+      ret = bench_check(ctx, bench, "rx bytewise");
+    }
+
+  if (ret != OK)
+    {
+      goto errout_with_fd;
+    }
+
+  bench_report("rx bytewise", nbytes, bench_usec() - start);
+
+  /* Receive in blocks */
+
+  start = bench_usec();
+  for (n = 0; n < iterations && ret == OK; n++)
+    {
+      for (pos = 0; pos < bench->framelen; )
+        {
+          pos += ahdlc_rx_block(ctx, &bench->frame[pos],
+                                bench->framelen - pos);
+        }
+
+      ret = bench_check(ctx, bench, "rx block");
+    }
+
+  if (ret != OK)
+    {
+      goto errout_with_fd;
+    }
+
+  bench_report("rx block", nbytes, bench_usec() - start);
+
+  /* Transmit to /dev/null, including the cost of the writes */
+
+  nbytes = (uint64_t)iterations * BENCH_PAYLOAD_SIZE;
+
+  start = bench_usec();
+  for (n = 0; n < iterations; n++)
+    {
+      ctx->ahdlc_tx_offline = 0;
+      ahdlc_tx(ctx, IPV4, NULL, bench->payload, 0, BENCH_PAYLOAD_SIZE);
+    }
+
+  bench_report("tx", nbytes, bench_usec() - start);
+
+errout_with_fd:
+  close(ctx->ctl.fd);
+
+errout:
+  free(bench);
+  free(ctx);
+  return ret;
+}
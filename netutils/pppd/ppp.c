@@ -213,7 +213,7 @@ void ppp_send(FAR struct ppp_context_s *ctx)
 
 void ppp_poll(FAR struct ppp_context_s *ctx)
 {
-  uint8_t c;
+  int ret;
 
   ctx->ip_len = 0;
 
@@ -229,9 +229,23 @@ void ppp_poll(FAR struct ppp_context_s *ctx)
       return;
     }
 
-  while (ctx->ip_len == 0 && ppp_arch_getchar(ctx, &c))
+  while (ctx->ip_len == 0)
     {
-      ahdlc_rx(ctx, c);
+      if (ctx->ahdlc_rx_chunkpos >= ctx->ahdlc_rx_chunklen)
+        {
+          ret = ppp_arch_read(ctx, ctx->ahdlc_rx_chunk, AHDLC_RX_CHUNK_SIZE);
+          if (ret <= 0)
+            {
+              break;
+            }
+
+          ctx->ahdlc_rx_chunkpos = 0;
+          ctx->ahdlc_rx_chunklen = ret;
+        }
+
+      ctx->ahdlc_rx_chunkpos +=
+        ahdlc_rx_block(ctx, &ctx->ahdlc_rx_chunk[ctx->ahdlc_rx_chunkpos],
+                       ctx->ahdlc_rx_chunklen - ctx->ahdlc_rx_chunkpos);
     }
 
   /* If IPCP came up then our link should be up. */
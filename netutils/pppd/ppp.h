@@ -170,6 +170,12 @@ struct ppp_context_s
   uint8_t  ahdlc_flags;      /* ahdlc state flags, see above */
   uint8_t  ahdlc_tx_offline;
 
+  uint8_t  ahdlc_tx_buffer[AHDLC_TX_BUFFER_SIZE]; /* Escaped tx bytes */
+  uint16_t ahdlc_tx_len;     /* Number of staged tx bytes */
+  uint8_t  ahdlc_rx_chunk[AHDLC_RX_CHUNK_SIZE];   /* Raw bytes from tty */
+  uint16_t ahdlc_rx_chunkpos; /* Next unprocessed byte in rx chunk */
+  uint16_t ahdlc_rx_chunklen; /* Number of valid bytes in rx chunk */
+
   /* Statistics counters */
 
 #ifdef PPP_STATISTICS
@@ -77,8 +77,10 @@ extern "C"
 
 time_t ppp_arch_clock_seconds(void);
 
-int ppp_arch_getchar(FAR struct ppp_context_s *ctx, FAR uint8_t *p);
-int ppp_arch_putchar(FAR struct ppp_context_s *ctx, uint8_t c);
+int ppp_arch_read(FAR struct ppp_context_s *ctx, FAR uint8_t *buffer,
+                  size_t len);
+int ppp_arch_write(FAR struct ppp_context_s *ctx,
+                   FAR const uint8_t *buffer, size_t len);
 
 #undef EXTERN
 #ifdef __cplusplus
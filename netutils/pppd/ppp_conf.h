@@ -60,6 +60,14 @@
 
 #define AHDLC_TX_OFFLINE        5
 
+/* Serial I/O is done in blocks of these sizes rather than a byte at a
+ * time.  The tx buffer holds escaped bytes and is flushed when full, so a
+ * frame may take several writes.
+ */
+
+#define AHDLC_TX_BUFFER_SIZE    256
+#define AHDLC_RX_CHUNK_SIZE     256
+
 #define IPCP_GET_PEER_IP        1
 
 #define PPP_STATISTICS          1
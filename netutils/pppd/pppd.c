@@ -273,41 +273,56 @@ time_t ppp_arch_clock_seconds(void)
 }
 
 /****************************************************************************
- * Name: ppp_arch_getchar
+ * Name: ppp_arch_read
  ****************************************************************************/
 
-int ppp_arch_getchar(FAR struct ppp_context_s *ctx, FAR uint8_t * c)
+int ppp_arch_read(FAR struct ppp_context_s *ctx, FAR uint8_t *buffer,
+                  size_t len)
 {
-  int ret;
+  ssize_t ret;
 
-  ret = read(ctx->ctl.fd, c, 1);
-  return ret == 1 ? ret : 0;
+  ret = read(ctx->ctl.fd, buffer, len);
+  return ret > 0 ? (int)ret : 0;
 }
 
 /****************************************************************************
- * Name: ppp_arch_putchar
+ * Name: ppp_arch_write
  ****************************************************************************/
 
-int ppp_arch_putchar(FAR struct ppp_context_s *ctx, uint8_t c)
+int ppp_arch_write(FAR struct ppp_context_s *ctx,
+                   FAR const uint8_t *buffer, size_t len)
 {
-  int ret;
   struct pollfd fds;
+  size_t nwritten = 0;
+  ssize_t ret;
 
-  ret = write(ctx->ctl.fd, &c, 1);
-  if (ret < 0 && errno == EAGAIN)
+  while (nwritten < len)
     {
+      ret = write(ctx->ctl.fd, buffer + nwritten, len - nwritten);
+      if (ret > 0)
+        {
+          nwritten += ret;
+          continue;
+        }
+
+      if (ret < 0 && errno != EAGAIN)
+        {
+          break;
+        }
+
+      /* The tty is full, wait for it to drain */
+
       fds.fd = ctx->ctl.fd;
       fds.events = POLLOUT;
       fds.revents = 0;
 
-      ret = poll(&fds, 1, 1000);
-      if (ret > 0)
+      if (poll(&fds, 1, 1000) <= 0)
         {
-          ret = write(ctx->ctl.fd, &c, 1);
+          break;
         }
     }
 
-  return ret == 1 ? ret : 0;
+  return (int)nwritten;
 }
 
 /****************************************************************************
@@ -821,6 +821,11 @@ struct nsh_parser_s
 
 #ifndef CONFIG_NSH_DISABLESCRIPT
   FILE    *np_stream;   /* Stream of current script */
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+  FAR const char *np_script; /* In-memory copy of the current script */
+  long     np_scriptlen; /* Size of np_script in bytes */
+  long     np_scriptpos; /* Offset of the next line in np_script */
+#endif
 #ifndef CONFIG_NSH_DISABLE_LOOPS
   long     np_foffs;    /* File offset to the beginning of a line */
 #ifndef NSH_DISABLE_SEMICOLON
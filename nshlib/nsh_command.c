@@ -61,6 +61,15 @@
 #define HELP_LINELEN  80
 #define NUM_CMDS      ((sizeof(g_cmdmap)/sizeof(struct cmdmap_s)) - 1)
 
+/* Command name index.  It has nearly twice as many slots as there are
+ * commands so that probe sequences stay short and always end in an empty
+ * slot.
+ */
+
+#ifdef CONFIG_NSH_CMDHASH
+#  define CMDHASH_SIZE (2 * NUM_CMDS + 1)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -493,7 +502,7 @@ static const struct cmdmap_s g_cmdmap[] =
 #endif
 
 #ifndef CONFIG_NSH_DISABLE_TIME
-  { "time",     cmd_time,     2, 2, "\"<command>\"" },
+  { "time",     cmd_time,     2, 4, "[-n <count>] \"<command>\"" },
 #endif
 
 #ifndef CONFIG_NSH_DISABLESCRIPT
@@ -563,6 +572,15 @@ static const struct cmdmap_s g_cmdmap[] =
   { NULL,       NULL,         1, 1, NULL }
 };
 
+#ifdef CONFIG_NSH_CMDHASH
+/* Open-addressed index into g_cmdmap, filled in on the first lookup.  Each
+ * slot holds the g_cmdmap index plus one; zero marks an empty slot.
+ */
+
+static uint16_t g_cmdhash[CMDHASH_SIZE];
+static volatile bool g_cmdindexed;
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -905,6 +923,109 @@ static int cmd_help(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv)
 }
 #endif
 
+/****************************************************************************
+ * Name: cmdhash
+ ****************************************************************************/
+
+#ifdef CONFIG_NSH_CMDHASH
+static uint32_t cmdhash(FAR const char *cmd)
+{
+  uint32_t hash = 2166136261u;
+
+  /* FNV-1a */
+
+  while (*cmd != '\0')
+    {
+      hash ^= (uint8_t)*cmd++;
+      hash *= 16777619u;
+    }
+
+  return hash;
+}
+#endif
+
+/****************************************************************************
+ * Name: cmdhash_index
+ *
+ * Description:
+ *   Fill in g_cmdhash.  Two sessions may race here on first use; an entry
+ *   that is already present is not inserted again, so both produce the
+ *   same index.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NSH_CMDHASH
+static void cmdhash_index(void)
+{
+  unsigned int slot;
+  unsigned int i;
+
+  for (i = 0; i < NUM_CMDS; i++)
+    {
+      slot = cmdhash(g_cmdmap[i].cmd) % CMDHASH_SIZE;
+      while (g_cmdhash[slot] != 0 && g_cmdhash[slot] != i + 1)
+        {
+          if (++slot >= CMDHASH_SIZE)
+            {
+              slot = 0;
+            }
+        }
+
+      g_cmdhash[slot] = i + 1;
+    }
+
+  g_cmdindexed = true;
+}
+#endif
+
+/****************************************************************************
+ * Name: cmd_find
+ *
+ * Description:
+ *   Return the g_cmdmap entry for the command name or NULL if there is no
+ *   such command.
+ *
+ ****************************************************************************/
+
+static FAR const struct cmdmap_s *cmd_find(FAR const char *cmd)
+{
+  FAR const struct cmdmap_s *cmdmap;
+#ifdef CONFIG_NSH_CMDHASH
+  unsigned int slot;
+
+  if (!g_cmdindexed)
+    {
+      cmdhash_index();
+    }
+
+  slot = cmdhash(cmd) % CMDHASH_SIZE;
+  while (g_cmdhash[slot] != 0)
+    {
+      cmdmap = &g_cmdmap[g_cmdhash[slot] - 1];
+      if (strcmp(cmdmap->cmd, cmd) == 0)
+        {
+          return cmdmap;
+        }
+
+      if (++slot >= CMDHASH_SIZE)
+        {
+          slot = 0;
+        }
+    }
+
+#else
+  for (cmdmap = g_cmdmap; cmdmap->cmd; cmdmap++)
+    {
+      if (strcmp(cmdmap->cmd, cmd) == 0)
+        {
+          return cmdmap;
+        }
+    }
+#endif
+
+  return NULL;
+}
+
 /****************************************************************************
  * Name: cmd_unrecognized
  ****************************************************************************/
@@ -986,39 +1107,34 @@ int nsh_command(FAR struct nsh_vtbl_s *vtbl, int argc, char *argv[])
 
   /* See if the command is one that we understand */
 
-  for (cmdmap = g_cmdmap; cmdmap->cmd; cmdmap++)
+  cmdmap = cmd_find(cmd);
+  if (cmdmap != NULL)
     {
-      if (strcmp(cmdmap->cmd, cmd) == 0)
+      /* Check if a valid number of arguments was provided.  We
+       * do this simple, imperfect checking here so that it does
+       * not have to be performed in each command.
+       */
+
+      if (argc < cmdmap->minargs)
         {
-          /* Check if a valid number of arguments was provided.  We
-           * do this simple, imperfect checking here so that it does
-           * not have to be performed in each command.
-           */
+          /* Fewer than the minimum number were provided */
 
-          if (argc < cmdmap->minargs)
-            {
-              /* Fewer than the minimum number were provided */
+          nsh_error(vtbl, g_fmtargrequired, cmd);
+          return ERROR;
+        }
+      else if (argc > cmdmap->maxargs)
+        {
+          /* More than the maximum number were provided */
 
-              nsh_error(vtbl, g_fmtargrequired, cmd);
-              return ERROR;
-            }
-          else if (argc > cmdmap->maxargs)
-            {
-              /* More than the maximum number were provided */
+          nsh_error(vtbl, g_fmttoomanyargs, cmd);
+          return ERROR;
+        }
 
-              nsh_error(vtbl, g_fmttoomanyargs, cmd);
-              return ERROR;
-            }
-          else
-            {
-              /* A valid number of arguments were provided (this does
-               * not mean they are right).
-               */
+      /* A valid number of arguments were provided (this does
+       * not mean they are right).
+       */
 
-              handler = cmdmap->handler;
-              break;
-            }
-        }
+      handler = cmdmap->handler;
     }
 
    ret = handler(vtbl, argc, argv);
@@ -1830,7 +1830,12 @@ static int nsh_loop(FAR struct nsh_vtbl_s *vtbl, FAR char **ppcmd,
 #endif
               np->np_lpstate[np->np_lpndx].lp_state == NSH_LOOP_WHILE ||
               np->np_lpstate[np->np_lpndx].lp_state == NSH_LOOP_UNTIL ||
-              np->np_stream == NULL || np->np_foffs < 0)
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+              (np->np_stream == NULL && np->np_script == NULL) ||
+#else
+              np->np_stream == NULL ||
+#endif
+              np->np_foffs < 0)
             {
               nsh_error(vtbl, g_fmtcontext, cmd);
               goto errout;
@@ -1922,13 +1927,23 @@ static int nsh_loop(FAR struct nsh_vtbl_s *vtbl, FAR char **ppcmd,
             {
                /* Set the new file position to the top of the loop offset */
 
-               ret = fseek(np->np_stream,
-                           np->np_lpstate[np->np_lpndx].lp_topoffs,
-                           SEEK_SET);
-               if (ret <  0)
-                {
-                  nsh_error(vtbl, g_fmtcmdfailed, "done", "fseek", NSH_ERRNO);
-                }
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+               if (np->np_script != NULL)
+                 {
+                   np->np_scriptpos = np->np_lpstate[np->np_lpndx].lp_topoffs;
+                 }
+               else
+#endif
+                 {
+                   ret = fseek(np->np_stream,
+                               np->np_lpstate[np->np_lpndx].lp_topoffs,
+                               SEEK_SET);
+                   if (ret <  0)
+                     {
+                       nsh_error(vtbl, g_fmtcmdfailed, "done", "fseek",
+                                 NSH_ERRNO);
+                     }
+                 }
 
 #ifndef NSH_DISABLE_SEMICOLON
                /* Signal nsh_parse that we need to stop processing the
@@ -39,11 +39,142 @@
 
 #include <nuttx/config.h>
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "nsh.h"
 #include "nsh_console.h"
 
 #if CONFIG_NFILE_STREAMS > 0 && !defined(CONFIG_NSH_DISABLESCRIPT)
 
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nsh_scriptload
+ *
+ * Description:
+ *   Read the whole script from np_stream into memory.  On success the
+ *   stream is closed and the script is then executed from np_script, so
+ *   that jumping back to the top of a loop costs no file I/O.  Scripts that
+ *   are too large or cannot be read are left to be read from the stream.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+static void nsh_scriptload(FAR struct nsh_vtbl_s *vtbl)
+{
+  FAR struct nsh_parser_s *np = &vtbl->np;
+  FAR char *script;
+  long size;
+
+  if (fseek(np->np_stream, 0, SEEK_END) < 0)
+    {
+      return;
+    }
+
+  size = ftell(np->np_stream);
+  if (fseek(np->np_stream, 0, SEEK_SET) < 0 || size <= 0 ||
+      size > CONFIG_NSH_SCRIPT_CACHE_MAXSIZE)
+    {
+      return;
+    }
+
+  script = (FAR char *)malloc(size);
+  if (script == NULL)
+    {
+      return;
+    }
+
+  if (fread(script, 1, size, np->np_stream) != (size_t)size)
+    {
+      free(script);
+      fseek(np->np_stream, 0, SEEK_SET);
+      return;
+    }
+
+  fclose(np->np_stream);
+  np->np_stream    = NULL;
+  np->np_script    = script;
+  np->np_scriptlen = size;
+  np->np_scriptpos = 0;
+}
+#endif
+
+/****************************************************************************
+ * Name: nsh_scriptgets
+ *
+ * Description:
+ *   Get the next line of the script into buffer.  This behaves like fgets()
+ *   on np_stream, including for lines longer than the buffer, whether the
+ *   script is cached or not.
+ *
+ ****************************************************************************/
+
+static FAR char *nsh_scriptgets(FAR struct nsh_vtbl_s *vtbl,
+                                FAR char *buffer)
+{
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+  FAR struct nsh_parser_s *np = &vtbl->np;
+
+  if (np->np_script != NULL)
+    {
+      FAR const char *line;
+      FAR const char *end;
+      size_t len;
+
+      if (np->np_scriptpos >= np->np_scriptlen)
+        {
+          return NULL;
+        }
+
+      line = &np->np_script[np->np_scriptpos];
+      len  = np->np_scriptlen - np->np_scriptpos;
+      if (len > CONFIG_NSH_LINELEN - 1)
+        {
+          len = CONFIG_NSH_LINELEN - 1;
+        }
+
+      end = memchr(line, '\n', len);
+      if (end != NULL)
+        {
+          len = end - line + 1;
+        }
+
+      memcpy(buffer, line, len);
+      buffer[len] = '\0';
+      np->np_scriptpos += len;
+      return buffer;
+    }
+#endif
+
+  return fgets(buffer, CONFIG_NSH_LINELEN, vtbl->np.np_stream);
+}
+
+/****************************************************************************
+ * Name: nsh_scripttell
+ *
+ * Description:
+ *   Return the offset of the next line of the script.  As with ftell(), -1
+ *   is returned on failure.
+ *
+ ****************************************************************************/
+
+#ifndef CONFIG_NSH_DISABLE_LOOPS
+static long nsh_scripttell(FAR struct nsh_vtbl_s *vtbl)
+{
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+  if (vtbl->np.np_script != NULL)
+    {
+      return vtbl->np.np_scriptpos;
+    }
+#endif
+
+  return ftell(vtbl->np.np_stream);
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -61,6 +192,11 @@ int nsh_script(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
 {
   FAR char *fullpath;
   FAR FILE *savestream;
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+  FAR const char *savescript;
+  long savelen;
+  long savepos;
+#endif
   FAR char *buffer;
   FAR char *pret;
   int ret = ERROR;
@@ -81,6 +217,11 @@ int nsh_script(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
       /* Save the parent stream in case of nested script processing */
 
       savestream = vtbl->np.np_stream;
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+      savescript = vtbl->np.np_script;
+      savelen    = vtbl->np.np_scriptlen;
+      savepos    = vtbl->np.np_scriptpos;
+#endif
 
       /* Open the file containing the script */
 
@@ -99,6 +240,13 @@ int nsh_script(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
           return ERROR;
         }
 
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+      /* Try to execute the script from memory */
+
+      vtbl->np.np_script = NULL;
+      nsh_scriptload(vtbl);
+#endif
+
       /* Loop, processing each command line in the script file (or
        * until an error occurs)
        */
@@ -116,7 +264,7 @@ int nsh_script(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
            * script file.  Note that ftell will return -1 on failure.
            */
 
-          vtbl->np.np_foffs = ftell(vtbl->np.np_stream);
+          vtbl->np.np_foffs = nsh_scripttell(vtbl);
           vtbl->np.np_loffs = 0;
 
           if (vtbl->np.np_foffs < 0)
@@ -127,7 +275,7 @@ int nsh_script(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
 
           /* Now read the next line from the script file */
 
-          pret = fgets(buffer, CONFIG_NSH_LINELEN, vtbl->np.np_stream);
+          pret = nsh_scriptgets(vtbl, buffer);
           if (pret)
             {
               /* Parse process the command.  NOTE:  this is recursive...
@@ -145,13 +293,27 @@ int nsh_script(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
         }
       while (pret && (ret == OK || (vtbl->np.np_flags & NSH_PFLAG_IGNORE)));
 
-      /* Close the script file */
+      /* Close the script file (or free its cached copy) */
 
-      fclose(vtbl->np.np_stream);
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+      if (vtbl->np.np_script != NULL)
+        {
+          free((FAR void *)vtbl->np.np_script);
+        }
+      else
+#endif
+        {
+          fclose(vtbl->np.np_stream);
+        }
 
       /* Restore the parent script stream */
 
       vtbl->np.np_stream = savestream;
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+      vtbl->np.np_script    = savescript;
+      vtbl->np.np_scriptlen = savelen;
+      vtbl->np.np_scriptpos = savepos;
+#endif
     }
 
   /* Free the allocated path */
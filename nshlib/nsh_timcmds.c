@@ -39,7 +39,9 @@
 
 #include <nuttx/config.h>
 
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h>
 #include <unistd.h>
 #include <time.h>
@@ -295,20 +297,74 @@ errout_bad_parm:
 int cmd_time(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv)
 {
   struct timespec start;
+  FAR char *cmdline = NULL;
+  FAR char *command;
+  FAR char *endptr;
+  unsigned long count = 1;
+  unsigned long i;
+  size_t cmdlen = 0;
 #ifndef CONFIG_NSH_DISABLEBG
   bool bgsave;
 #endif
 #if CONFIG_NFILE_STREAMS > 0
   bool redirsave;
 #endif
+  int option;
   int ret;
 
+  /* Get the time options:  time [-n count] "<command>" */
+
+  while ((option = getopt(argc, argv, "n:")) != ERROR)
+    {
+      if (option == 'n')
+        {
+          count = strtoul(optarg, &endptr, 0);
+          if (*optarg == '\0' || *endptr != '\0' || count == 0)
+            {
+              nsh_error(vtbl, g_fmtarginvalid, argv[0]);
+              return ERROR;
+            }
+        }
+      else
+        {
+          nsh_error(vtbl, g_fmtarginvalid, argv[0]);
+          return ERROR;
+        }
+    }
+
+  if (optind != argc - 1)
+    {
+      nsh_error(vtbl, optind < argc ? g_fmttoomanyargs : g_fmtargrequired,
+                argv[0]);
+      return ERROR;
+    }
+
+  /* The command may use getopt() too and change optind, so remember it */
+
+  command = argv[optind];
+
+  /* nsh_parse() modifies the command line so, if the command is to be
+   * repeated, each pass parses a fresh copy.
+   */
+
+  if (count > 1)
+    {
+      cmdlen  = strlen(command) + 1;
+      cmdline = (FAR char *)malloc(cmdlen);
+      if (cmdline == NULL)
+        {
+          nsh_error(vtbl, g_fmtcmdoutofmemory, argv[0]);
+          return ERROR;
+        }
+    }
+
   /* Get the current time */
 
   ret = clock_gettime(TIME_CLOCK, &start);
   if (ret < 0)
     {
        nsh_error(vtbl, g_fmtcmdfailed, argv[0], "clock_gettime", NSH_ERRNO);
+       free(cmdline);
        return ERROR;
     }
 
@@ -323,7 +379,19 @@ int cmd_time(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv)
 
   /* Execute the command */
 
-  ret = nsh_parse(vtbl, argv[1]);
+  if (count > 1)
+    {
+      for (i = 0, ret = OK; i < count && ret >= 0; i++)
+        {
+          memcpy(cmdline, command, cmdlen);
+          ret = nsh_parse(vtbl, cmdline);
+        }
+    }
+  else
+    {
+      ret = nsh_parse(vtbl, command);
+    }
+
   if (ret >= 0)
     {
       struct timespec end;
@@ -347,8 +415,25 @@ int cmd_time(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv)
             }
 
           diff.tv_nsec = end.tv_nsec - start.tv_nsec;
-          nsh_output(vtbl, "\n%lu.%04lu sec\n", (unsigned long)diff.tv_sec,
-                     (unsigned long)diff.tv_nsec / 100000);
+          if (count > 1)
+            {
+              uint64_t each;
+
+              /* Also show the average time of one pass in nanoseconds */
+
+              each = ((uint64_t)diff.tv_sec * 1000000000 + diff.tv_nsec) /
+                     count;
+              nsh_output(vtbl, "\n%lu.%04lu sec, %lu passes, %lu nsec each\n",
+                         (unsigned long)diff.tv_sec,
+                         (unsigned long)diff.tv_nsec / 100000,
+                         count, (unsigned long)each);
+            }
+          else
+            {
+              nsh_output(vtbl, "\n%lu.%04lu sec\n",
+                         (unsigned long)diff.tv_sec,
+                         (unsigned long)diff.tv_nsec / 100000);
+            }
         }
     }
 
@@ -361,6 +446,7 @@ int cmd_time(FAR struct nsh_vtbl_s *vtbl, int argc, char **argv)
   vtbl->np.np_redirect = redirsave;
 #endif
 
+  free(cmdline);
   return ret;
 }
 #endif
@@ -46,6 +46,47 @@
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <errno.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Largest config item that is read back from /dev/config */
+
+#define CFGDATA_MAXITEM   256
+
+/* Longest line of a 'load' file:  The key and the largest item written as a
+ * byte array, five characters per byte.
+ */
+
+#ifdef CONFIG_MTD_CONFIG_NAMED
+#  define CFGDATA_KEYLEN  CONFIG_MTD_CONFIG_NAME_LEN
+#else
+#  define CFGDATA_KEYLEN  24
+#endif
+
+#define CFGDATA_LINELEN   (CFGDATA_KEYLEN + 5 * CFGDATA_MAXITEM + 8)
+
+/* Most arguments a line of a 'load' file is split into:  Two unused ones,
+ * the key and one per byte.
+ */
+
+#define CFGDATA_MAXARGS   (CFGDATA_MAXITEM + 3)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* A copy of one config item, as kept by the 'dump' and 'load' commands */
+
+struct cfgdata_item_s
+{
+  FAR struct cfgdata_item_s *flink;
+  struct config_data_s cfg;     /* Key and length of the item */
+  bool written;                 /* Set by 'load' when the item was written */
+  uint8_t data[1];              /* cfg.len bytes, see cfg.configdata */
+};
 
 /****************************************************************************
  * Private data
@@ -68,7 +109,9 @@ static void cfgdatacmd_help(void)
   printf("  all:   show all config entries\n");
   printf("  print: display a specific config entry\n");
   printf("  set:   set or change a config entry\n");
-  printf("  unset: delete a config entry\n\n");
+  printf("  unset: delete a config entry\n");
+  printf("  dump:  write all config entries in 'set' syntax\n");
+  printf("  load:  set the config entries listed in a file\n\n");
 
   printf("Syntax for 'set' cmd:\n");
 #ifdef CONFIG_MTD_CONFIG_NAMED
@@ -93,6 +136,9 @@ static void cfgdatacmd_help(void)
   printf("  unset id,instance\n");
 #endif
 
+  printf("Syntax for 'dump' and 'load' cmds:\n");
+  printf("  dump [file]\n");
+  printf("  load file\n");
 }
 
 /****************************************************************************
@@ -119,6 +165,41 @@ static int cfgdatacmd_idtok(int startpos, char *token)
 }
 #endif
 
+/****************************************************************************
+ * Parse the name or id,instance of a config item into cfg
+ ****************************************************************************/
+
+static int cfgdatacmd_parse_key(FAR struct config_data_s *cfg,
+                                FAR char *key)
+{
+#ifdef CONFIG_MTD_CONFIG_NAMED
+  /* Copy the name to the cfg struct */
+
+  strncpy(cfg->name, key, CONFIG_MTD_CONFIG_NAME_LEN);
+
+#else
+  int x;
+
+  /* Parse the id and instance */
+
+  cfg->id = atoi(key);
+
+  /* Advance past ',' to instance number */
+
+  x = cfgdatacmd_idtok(0, key);
+  if (x == 0)
+    {
+      return -EINVAL;
+    }
+
+  /* Convert instance to integer */
+
+  cfg->instance = atoi(&key[x]);
+#endif
+
+  return OK;
+}
+
 /****************************************************************************
  * Set a config item value
  *
@@ -127,7 +208,7 @@ static int cfgdatacmd_idtok(int startpos, char *token)
  *
  ****************************************************************************/
 
-static void cfgdatacmd_parse_byte_array(struct config_data_s *cfg,
+static int cfgdatacmd_parse_byte_array(struct config_data_s *cfg,
         int argc, char *argv[])
 {
   int   x;
@@ -179,6 +260,12 @@ static void cfgdatacmd_parse_byte_array(struct config_data_s *cfg,
       /* Perform dynamic memory allocation */
 
       cfg->configdata = (FAR uint8_t *) malloc(count);
+      if (cfg->configdata == NULL)
+        {
+          printf("Error allocating buffer\n");
+          return -ENOMEM;
+        }
+
       cfg->len = count;
     }
 
@@ -236,58 +323,31 @@ static void cfgdatacmd_parse_byte_array(struct config_data_s *cfg,
     }
 
   cfg->len = count;
+  return OK;
 }
 
 /****************************************************************************
- * Set a config item value
- *
- * config set 1,0,wr_width_cs0 [0x3]
- * config set 1,1,wr_width_cs1 [0x2]
- *
+ * Parse the value of a config item from argv[3] onwards.  On return,
+ * cfg->configdata points to data, to argv[3] or to a buffer that the
+ * caller must free.
  ****************************************************************************/
 
-static void cfgdatacmd_set(int argc, char *argv[])
+static int cfgdatacmd_parse_value(FAR struct config_data_s *cfg,
+                                  int argc, FAR char *argv[],
+                                  FAR uint8_t *data, size_t datalen)
 {
-  int                   x;
-  int                   ret;
-  int                   fd;
-  struct config_data_s  cfg;
-  uint8_t               data[32];
-
-#ifdef CONFIG_MTD_CONFIG_NAMED
-
-  /* Copy the name to the cfg struct */
-
-  strncpy(cfg.name, argv[2], CONFIG_MTD_CONFIG_NAME_LEN);
-  (void) x;
-
-#else
-  /* Parse the id and instance */
-
-  cfg.id = atoi(argv[2]);
-
-  /* Advance past ',' to instance number */
-
-  x = cfgdatacmd_idtok(0, argv[2]);
-  if (x == 0)
-    {
-      return;
-    }
-
-  /* Convert instance to integer */
-
-  cfg.instance = atoi(&argv[2][x]);
-#endif
+  int x;
+  int val;
 
   /* Test if data is an array of bytes or simple string */
 
+  cfg->configdata = data;
   if (argv[3][0] == '[')
     {
       /* It is an array of bytes.  Count the number of bytes */
 
-      cfg.configdata = data;
-      cfg.len = sizeof(data);
-      cfgdatacmd_parse_byte_array(&cfg, argc, argv);
+      cfg->len = datalen;
+      return cfgdatacmd_parse_byte_array(cfg, argc, argv);
     }
   else
     {
@@ -295,7 +355,6 @@ static void cfgdatacmd_set(int argc, char *argv[])
 
       /* It is a simple string.  Test if it looks like a number */
 
-      cfg.configdata = data;
       if (strncmp(argv[3], "0x", 2) == 0)
         {
           /* Test for all hex digit values */
@@ -311,8 +370,9 @@ static void cfgdatacmd_set(int argc, char *argv[])
 
           if (isnumber)
             {
-              sscanf(&argv[3][2], "%x", (int32_t *) &cfg.configdata);
-              cfg.len = 4;
+              sscanf(&argv[3][2], "%x", &val);
+              *((int32_t *) cfg->configdata) = val;
+              cfg->len = 4;
             }
         }
       else
@@ -331,8 +391,8 @@ static void cfgdatacmd_set(int argc, char *argv[])
           if (isnumber)
             {
               int32_t temp = atoi(argv[3]);
-              *((int32_t *) cfg.configdata) = temp;
-              cfg.len = 4;
+              *((int32_t *) cfg->configdata) = temp;
+              cfg->len = 4;
             }
         }
 
@@ -340,11 +400,43 @@ static void cfgdatacmd_set(int argc, char *argv[])
         {
           /* Point to the string and calculate the length */
 
-          cfg.configdata = (FAR uint8_t *) argv[3];
-          cfg.len = strlen(argv[3]) + 1;
+          cfg->configdata = (FAR uint8_t *) argv[3];
+          cfg->len = strlen(argv[3]) + 1;
         }
     }
 
+  return OK;
+}
+
+/****************************************************************************
+ * Set a config item value
+ *
+ * config set 1,0,wr_width_cs0 [0x3]
+ * config set 1,1,wr_width_cs1 [0x2]
+ *
+ ****************************************************************************/
+
+static void cfgdatacmd_set(int argc, char *argv[])
+{
+  int                   ret;
+  int                   fd;
+  struct config_data_s  cfg;
+  uint8_t               data[32];
+
+  /* Parse the name or id and instance */
+
+  if (cfgdatacmd_parse_key(&cfg, argv[2]) < 0)
+    {
+      return;
+    }
+
+  /* Parse the value */
+
+  if (cfgdatacmd_parse_value(&cfg, argc, argv, data, sizeof(data)) < 0)
+    {
+      return;
+    }
+
   /* Now open the /dev/config file and set the config item */
 
   if ((fd = open(g_config_dev, O_RDONLY)) < 2)
@@ -352,7 +444,7 @@ static void cfgdatacmd_set(int argc, char *argv[])
       /* Display error */
 
       printf("error: unable to open %s\n", g_config_dev);
-      return;
+      goto errout;
     }
 
   ret = ioctl(fd, CFGDIOC_SETCONFIG, (unsigned long) &cfg);
@@ -367,6 +459,7 @@ static void cfgdatacmd_set(int argc, char *argv[])
 
   /* Free the cfg.configdata if needed */
 
+errout:
   if (cfg.configdata != (FAR uint8_t *) argv[3] &&
       cfg.configdata != data)
     {
@@ -380,35 +473,17 @@ static void cfgdatacmd_set(int argc, char *argv[])
 
 static void cfgdatacmd_unset(int argc, char *argv[])
 {
-  int                   x;
   int                   ret;
   int                   fd;
   struct config_data_s  cfg;
 
-#ifdef CONFIG_MTD_CONFIG_NAMED
-  /* Copy the name to the cfg struct */
-
-  strncpy(cfg.name, argv[2], CONFIG_MTD_CONFIG_NAME_LEN);
-  (void) x;
+  /* Parse the name or id and instance */
 
-#else
-  /* Parse the id and instance */
-
-  cfg.id = atoi(argv[2]);
-
-  /* Advance past ',' to instance number */
-
-  x = cfgdatacmd_idtok(0, argv[2]);
-  if (x == 0)
+  if (cfgdatacmd_parse_key(&cfg, argv[2]) < 0)
     {
       return;
     }
 
-  /* Convert instance to integer */
-
-  cfg.instance = atoi(&argv[2][x]);
-#endif
-
   cfg.configdata = NULL;
   cfg.len = 0;
 
@@ -448,31 +523,13 @@ static void cfgdatacmd_print(int argc, char *argv[])
   int                   fd;
   bool                  isstring;
 
-#ifdef CONFIG_MTD_CONFIG_NAMED
-
-  /* Copy the name to the cfg struct */
-
-  strncpy(cfg.name, argv[2], CONFIG_MTD_CONFIG_NAME_LEN);
-  (void)x;
-
-#else
-  /* Parse the id and instance */
+  /* Parse the name or id and instance */
 
-  cfg.id = atoi(argv[2]);
-
-  /* Advance past ',' to instance number */
- 
-  x = cfgdatacmd_idtok(0, argv[2]);
-  if (x == 0)
+  if (cfgdatacmd_parse_key(&cfg, argv[2]) < 0)
     {
       return;
     }
 
-  /* Convert instance to integer */
-
-  cfg.instance = atoi(&argv[2][x]);
-#endif
-
   /* Try to open the /dev/config file */
 
   if ((fd = open(g_config_dev, O_RDONLY)) < 2)
@@ -657,6 +714,534 @@ static void cfgdatacmd_show_all_config_items(void)
   free(cfg.configdata);
 }
 
+/****************************************************************************
+ * Test whether two config items have the same name or id,instance
+ ****************************************************************************/
+
+static bool cfgdatacmd_samekey(FAR const struct config_data_s *cfg1,
+                               FAR const struct config_data_s *cfg2)
+{
+#ifdef CONFIG_MTD_CONFIG_NAMED
+  return strncmp(cfg1->name, cfg2->name, CONFIG_MTD_CONFIG_NAME_LEN) == 0;
+#else
+  return cfg1->id == cfg2->id && cfg1->instance == cfg2->instance;
+#endif
+}
+
+/****************************************************************************
+ * Make a copy of a config item
+ ****************************************************************************/
+
+static FAR struct cfgdata_item_s *
+  cfgdatacmd_newitem(FAR const struct config_data_s *cfg)
+{
+  FAR struct cfgdata_item_s *item;
+
+  item = (FAR struct cfgdata_item_s *)
+    malloc(sizeof(struct cfgdata_item_s) + cfg->len);
+  if (item == NULL)
+    {
+      printf("Error allocating buffer\n");
+      return NULL;
+    }
+
+  item->flink          = NULL;
+  item->cfg            = *cfg;
+  item->cfg.configdata = item->data;
+  item->written        = false;
+  memcpy(item->data, cfg->configdata, cfg->len);
+  return item;
+}
+
+/****************************************************************************
+ * Find a config item in a list of copies
+ ****************************************************************************/
+
+static FAR struct cfgdata_item_s *
+  cfgdatacmd_finditem(FAR struct cfgdata_item_s *list,
+                      FAR const struct config_data_s *cfg)
+{
+  for (; list != NULL; list = list->flink)
+    {
+      if (cfgdatacmd_samekey(&list->cfg, cfg))
+        {
+          break;
+        }
+    }
+
+  return list;
+}
+
+/****************************************************************************
+ * Free a list of copies of config items
+ ****************************************************************************/
+
+static void cfgdatacmd_freeitems(FAR struct cfgdata_item_s *list)
+{
+  FAR struct cfgdata_item_s *next;
+
+  for (; list != NULL; list = next)
+    {
+      next = list->flink;
+      free(list);
+    }
+}
+
+/****************************************************************************
+ * Copy all config items into memory in a single walk of /dev/config.  Every
+ * ioctl scans the MTD partition, so a snapshot is much cheaper than a
+ * CFGDIOC_GETCONFIG for each item that is needed later.  Returns the
+ * number of items or a negated errno value.  Only a walk that ends with
+ * ENOENT has seen every item; any other error, e.g. an item larger than
+ * CFGDATA_MAXITEM or a read error, fails the snapshot.
+ ****************************************************************************/
+
+static int cfgdatacmd_snapshot(int fd, FAR struct cfgdata_item_s **list)
+{
+  FAR struct cfgdata_item_s **tail = list;
+  FAR struct cfgdata_item_s *item;
+  struct config_data_s  cfg;
+  int                   count = 0;
+  int                   ret;
+
+  *list = NULL;
+
+  cfg.configdata = (FAR uint8_t *) malloc(CFGDATA_MAXITEM);
+  cfg.len = CFGDATA_MAXITEM;
+  if (cfg.configdata == NULL)
+    {
+      printf("Error allocating buffer\n");
+      return -ENOMEM;
+    }
+
+  ret = ioctl(fd, CFGDIOC_FIRSTCONFIG, (unsigned long) &cfg);
+
+  while (ret != -1)
+    {
+      item = cfgdatacmd_newitem(&cfg);
+      if (item == NULL)
+        {
+          cfgdatacmd_freeitems(*list);
+          *list = NULL;
+          count = -ENOMEM;
+          break;
+        }
+
+      *tail = item;
+      tail  = &item->flink;
+      count++;
+
+      /* Get the next config item */
+
+      cfg.len = CFGDATA_MAXITEM;
+      ret = ioctl(fd, CFGDIOC_NEXTCONFIG, (unsigned long) &cfg);
+    }
+
+  if (count >= 0 && errno != ENOENT)
+    {
+      /* The walk stopped early, so items are missing from the list */
+
+      count = -errno;
+      printf("Error %d reading config entries\n", -count);
+      cfgdatacmd_freeitems(*list);
+      *list = NULL;
+    }
+
+  free(cfg.configdata);
+  return count;
+}
+
+/****************************************************************************
+ * Write one config item in the syntax of the 'set' command
+ ****************************************************************************/
+
+static void cfgdatacmd_dump_item(FAR FILE *stream,
+                                 FAR const struct config_data_s *cfg)
+{
+  bool isstring;
+  int  x;
+
+#ifdef CONFIG_MTD_CONFIG_NAMED
+  fprintf(stream, "%.*s ", CONFIG_MTD_CONFIG_NAME_LEN, cfg->name);
+#else
+  fprintf(stream, "%d,%d ", cfg->id, cfg->instance);
+#endif
+
+  /* Test if data is a string */
+
+  isstring = cfg->len > 0 && cfg->configdata[cfg->len - 1] == 0;
+  for (x = 0; isstring && x < cfg->len - 1; x++)
+    {
+      /* Test for all ascii characters */
+
+      if (cfg->configdata[x] < ' ' || cfg->configdata[x] > '~')
+        {
+          isstring = false;
+        }
+    }
+
+  /* Strings are always quoted, so that a string of digits is not loaded
+   * back as a number.
+   */
+
+  if (isstring)
+    {
+      fprintf(stream, "\"%s\"\n", cfg->configdata);
+    }
+  else
+    {
+      fputc('[', stream);
+      for (x = 0; x < cfg->len; x++)
+        {
+          fprintf(stream, x > 0 ? ",0x%02X" : "0x%02X", cfg->configdata[x]);
+        }
+
+      fputs("]\n", stream);
+    }
+}
+
+/****************************************************************************
+ * Write all config items to a file or the console
+ *
+ * config dump /tmp/config.txt
+ *
+ ****************************************************************************/
+
+static void cfgdatacmd_dump(int argc, char *argv[])
+{
+  FAR struct cfgdata_item_s *list;
+  FAR struct cfgdata_item_s *item;
+  FAR FILE             *stream = stdout;
+  int                   count;
+  int                   fd;
+
+  /* Try to open the /dev/config file */
+
+  if ((fd = open(g_config_dev, O_RDONLY)) < 2)
+    {
+      /* Display error */
+
+      printf("error: unable to open %s\n", g_config_dev);
+      return;
+    }
+
+  /* Take the snapshot before the (possibly slow) output is written */
+
+  count = cfgdatacmd_snapshot(fd, &list);
+  close(fd);
+
+  if (count < 0)
+    {
+      return;
+    }
+
+  if (argc > 2)
+    {
+      stream = fopen(argv[2], "w");
+      if (stream == NULL)
+        {
+          printf("error: unable to open %s\n", argv[2]);
+          cfgdatacmd_freeitems(list);
+          return;
+        }
+    }
+
+  for (item = list; item != NULL; item = item->flink)
+    {
+      cfgdatacmd_dump_item(stream, &item->cfg);
+    }
+
+  if (stream != stdout)
+    {
+      fclose(stream);
+      printf("%d config entries written to %s\n", count, argv[2]);
+    }
+
+  cfgdatacmd_freeitems(list);
+}
+
+/****************************************************************************
+ * Split a line of a 'load' file into the arguments that NSH would pass to
+ * the 'set' command, starting with the key in argv[2].  A value that starts
+ * with a quote is a string up to the last quote on the line; argv[3] then
+ * still points at the opening quote.  Returns the number of arguments or a
+ * negated errno value.
+ ****************************************************************************/
+
+static int cfgdatacmd_split_line(FAR char *line, FAR char *argv[])
+{
+  FAR char *ptr = line;
+  FAR char *end;
+  int       argc = 2;
+
+  for (; ; )
+    {
+      while (*ptr == ' ' || *ptr == '\t')
+        {
+          ptr++;
+        }
+
+      if (*ptr == '\0')
+        {
+          break;
+        }
+
+      if (argc >= CFGDATA_MAXARGS)
+        {
+          return -E2BIG;
+        }
+
+      argv[argc++] = ptr;
+
+      if (argc == 4 && *ptr == '"')
+        {
+          end = strrchr(ptr + 1, '"');
+          if (end == NULL)
+            {
+              return -EINVAL;
+            }
+
+          *end = '\0';
+          break;
+        }
+
+      while (*ptr != '\0' && *ptr != ' ' && *ptr != '\t')
+        {
+          ptr++;
+        }
+
+      if (*ptr != '\0')
+        {
+          *ptr++ = '\0';
+        }
+    }
+
+  return argc;
+}
+
+/****************************************************************************
+ * Read a list of config items from a file, one 'set' command per line
+ * without the 'cfgdata set', and write the ones whose value differs from
+ * the one in /dev/config.  Lines starting with '#' are comments.
+ *
+ * The whole file is parsed before anything is written and the current
+ * values are read in one walk of /dev/config.  If writing an item fails,
+ * the items already written are restored from that snapshot, so the file
+ * is applied completely or not at all.  Nothing is written unless the
+ * snapshot is complete, so an item that is not in it really does not
+ * exist and may be deleted again.
+ *
+ * config load /etc/calibration.txt
+ *
+ ****************************************************************************/
+
+static void cfgdatacmd_load(int argc, char *argv[])
+{
+  FAR struct cfgdata_item_s *pending = NULL;
+  FAR struct cfgdata_item_s **tail = &pending;
+  FAR struct cfgdata_item_s *current = NULL;
+  FAR struct cfgdata_item_s *item;
+  FAR struct cfgdata_item_s *old;
+  struct config_data_s  cfg;
+  uint8_t               data[32];
+  FAR FILE             *stream;
+  FAR char             *line;
+  FAR char            **args;
+  int                   nargs;
+  int                   lineno = 0;
+  int                   nwritten = 0;
+  int                   nunchanged = 0;
+  int                   ret = OK;
+  int                   fd;
+
+  stream = fopen(argv[2], "r");
+  if (stream == NULL)
+    {
+      printf("error: unable to open %s\n", argv[2]);
+      return;
+    }
+
+  line = (FAR char *) malloc(CFGDATA_LINELEN);
+  args = (FAR char **) malloc(CFGDATA_MAXARGS * sizeof(FAR char *));
+  if (line == NULL || args == NULL)
+    {
+      printf("Error allocating buffer\n");
+      fclose(stream);
+      goto errout;
+    }
+
+  /* Parse the whole file before anything is written */
+
+  while (fgets(line, CFGDATA_LINELEN, stream) != NULL)
+    {
+      lineno++;
+
+      if (strchr(line, '\n') == NULL && !feof(stream))
+        {
+          printf("%s:%d: line too long\n", argv[2], lineno);
+          ret = -E2BIG;
+          break;
+        }
+
+      line[strcspn(line, "\r\n")] = '\0';
+
+      nargs = cfgdatacmd_split_line(line, args);
+      if (nargs == 2 || (nargs > 2 && args[2][0] == '#'))
+        {
+          /* Blank line or comment */
+
+          continue;
+        }
+
+      if (nargs < 4 || cfgdatacmd_parse_key(&cfg, args[2]) < 0)
+        {
+          printf("%s:%d: syntax error\n", argv[2], lineno);
+          ret = -EINVAL;
+          break;
+        }
+
+      if (args[3][0] == '"')
+        {
+          cfg.configdata = (FAR uint8_t *) &args[3][1];
+          cfg.len = strlen(&args[3][1]) + 1;
+        }
+      else
+        {
+          ret = cfgdatacmd_parse_value(&cfg, nargs, args, data,
+                                       sizeof(data));
+          if (ret < 0)
+            {
+              break;
+            }
+        }
+
+      item = cfgdatacmd_newitem(&cfg);
+
+      if (cfg.configdata != data &&
+          cfg.configdata != (FAR uint8_t *) args[3] &&
+          cfg.configdata != (FAR uint8_t *) &args[3][1])
+        {
+          free(cfg.configdata);
+        }
+
+      if (item == NULL)
+        {
+          ret = -ENOMEM;
+          break;
+        }
+
+      *tail = item;
+      tail  = &item->flink;
+    }
+
+  fclose(stream);
+
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  /* Now open the /dev/config file and read the current values */
+
+  if ((fd = open(g_config_dev, O_RDONLY)) < 2)
+    {
+      /* Display error */
+
+      printf("error: unable to open %s\n", g_config_dev);
+      goto errout;
+    }
+
+  ret = cfgdatacmd_snapshot(fd, &current);
+  if (ret < 0)
+    {
+      goto errout_with_fd;
+    }
+
+  ret = OK;
+
+  for (item = pending; item != NULL; item = item->flink)
+    {
+      /* A later line for the same item overrides this one */
+
+      if (cfgdatacmd_finditem(item->flink, &item->cfg) != NULL)
+        {
+          continue;
+        }
+
+      /* Skip the write if the value is already set; it would only wear
+       * the flash.
+       */
+
+      old = cfgdatacmd_finditem(current, &item->cfg);
+      if (old != NULL && old->cfg.len == item->cfg.len &&
+          memcmp(old->data, item->data, item->cfg.len) == 0)
+        {
+          nunchanged++;
+          continue;
+        }
+
+      ret = ioctl(fd, CFGDIOC_SETCONFIG, (unsigned long) &item->cfg);
+      if (ret != OK)
+        {
+          printf("Error %d setting config entry\n", errno);
+          break;
+        }
+
+      item->written = true;
+      nwritten++;
+    }
+
+  if (ret != OK)
+    {
+      /* Put back the values from the snapshot */
+
+      nwritten = 0;
+      for (item = pending; item != NULL; item = item->flink)
+        {
+          if (!item->written)
+            {
+              continue;
+            }
+
+          old = cfgdatacmd_finditem(current, &item->cfg);
+          if (old != NULL)
+            {
+              ret = ioctl(fd, CFGDIOC_SETCONFIG, (unsigned long) &old->cfg);
+            }
+          else
+            {
+              ret = ioctl(fd, CFGDIOC_DELCONFIG,
+                          (unsigned long) &item->cfg);
+            }
+
+          if (ret != OK)
+            {
+              printf("Error %d restoring config entry\n", errno);
+              nwritten++;
+            }
+        }
+
+      if (nwritten == 0)
+        {
+          printf("No config entries changed\n");
+        }
+    }
+  else
+    {
+      printf("%d config entries written, %d unchanged\n",
+             nwritten, nunchanged);
+    }
+
+errout_with_fd:
+  close(fd);
+
+errout:
+  cfgdatacmd_freeitems(current);
+  cfgdatacmd_freeitems(pending);
+  free(args);
+  free(line);
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -739,6 +1324,28 @@ int cfgdata_main(int argc, char *argv[])
       return 0;
     }
 
+  /* Test for "dump" cmd */
+
+  if (strcmp(argv[1], "dump") == 0)
+    {
+      cfgdatacmd_dump(argc, argv);
+      return 0;
+    }
+
+  /* Test for "load" cmd */
+
+  if (strcmp(argv[1], "load") == 0)
+    {
+      if (argc < 3)
+        {
+          printf("Need 1 argument for 'load' command\n");
+          return 0;
+        }
+
+      cfgdatacmd_load(argc, argv);
+      return 0;
+    }
+
   /* Unknown cmd */
 
   printf("Unknown config command: %s\n", argv[1]);
@@ -0,0 +1,619 @@
+/****************************************************************************
+ * apps/system/embedlog/elasync.c
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+
+#include "system/elasync.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_EMBEDLOG_ASYNC_PRIORITY
+#  define CONFIG_EMBEDLOG_ASYNC_PRIORITY 50
+#endif
+
+#ifndef CONFIG_EMBEDLOG_ASYNC_STACKSIZE
+#  define CONFIG_EMBEDLOG_ASYNC_STACKSIZE 2048
+#endif
+
+#ifndef CONFIG_EMBEDLOG_ASYNC_PERIOD_MS
+#  define CONFIG_EMBEDLOG_ASYNC_PERIOD_MS 100
+#endif
+
+#ifndef CONFIG_EMBEDLOG_LOG_MAX
+#  define CONFIG_EMBEDLOG_LOG_MAX 128
+#endif
+
+#ifdef CONFIG_CLOCK_MONOTONIC
+#  define ELASYNC_CLOCK CLOCK_MONOTONIC
+#else
+#  define ELASYNC_CLOCK CLOCK_REALTIME
+#endif
+
+/* Records start on this alignment.  The size and type of a record fit
+ * into the smallest gap that can remain at the end of the ring.
+ */
+
+#define ELASYNC_ALIGN      8
+#define ELASYNC_ALIGNUP(n) (((n) + ELASYNC_ALIGN - 1) & ~(ELASYNC_ALIGN - 1))
+#define ELASYNC_MINRING    64
+
+/* Length of "[sssss.uuuuuu] l/ " */
+
+#define ELASYNC_PREFIX     32
+
+/* Record types */
+
+#define ELASYNC_PAD        0   /* Rest of the ring is unused, wrap around */
+#define ELASYNC_TEXT       1   /* Formatted message */
+#define ELASYNC_DEFERRED   2   /* Format pointer and arguments */
+
+#define ELASYNC_NARGS      4
+
+/* The writer reads the message only after it has seen the new head, and
+ * gives the space back only after it has read the message.  The producer
+ * orders its writes the same way.
+ */
+
+#define ELASYNC_BARRIER()  __sync_synchronize()
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct elasync_hdr_s
+{
+  uint32_t size;                     /* Size of the record with padding */
+  uint8_t  type;                     /* ELASYNC_TEXT, ... */
+  uint8_t  level;                    /* enum el_level */
+  uint16_t reserved;
+  uint32_t sec;                      /* Time stamp */
+  uint32_t nsec;
+};
+
+#ifdef CONFIG_EMBEDLOG_ASYNC_DEFERRED
+struct elasync_deferred_s
+{
+  FAR const char *fmt;
+  uintptr_t arg[ELASYNC_NARGS];
+};
+#endif
+
+struct elasync_ring_s
+{
+  FAR struct elasync_ring_s *flink;
+  FAR struct elasync_s *log;
+  FAR uint8_t *buffer;
+  uint32_t size;                     /* Power of two */
+  volatile uint32_t head;            /* Written by the owner only */
+  volatile uint32_t tail;            /* Written by the writer only */
+  volatile uint32_t dropped;         /* Written by the owner only */
+  uint32_t reported;                 /* Drops already reported */
+  volatile bool released;
+};
+
+struct elasync_s
+{
+  FAR struct el_options *el;         /* Does the output */
+  FAR struct elasync_ring_s *rings;  /* Protected by lock */
+  pthread_mutex_t lock;
+  pthread_t writer;
+  sem_t wake;                        /* Posted when a ring is half full */
+  volatile bool stop;
+  enum el_level level;
+  char line[ELASYNC_PREFIX + CONFIG_EMBEDLOG_LOG_MAX];
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const char g_elasync_levels[] = "facewnid";
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: elasync_reserve
+ *
+ * Description:
+ *   Find contiguous space for a record of 'len' bytes and fill in its
+ *   header.  The record becomes visible to the writer with
+ *   elasync_commit().
+ *
+ ****************************************************************************/
+
+static FAR uint8_t *elasync_reserve(FAR struct elasync_ring_s *ring,
+                                    enum el_level level, size_t len,
+                                    int type, FAR uint32_t *used)
+{
+  FAR struct elasync_hdr_s *hdr;
+  struct timespec ts;
+  uint32_t need;
+  uint32_t head;
+  uint32_t off;
+  uint32_t skip;
+
+  need = ELASYNC_ALIGNUP(sizeof(struct elasync_hdr_s) + len);
+  head = ring->head;
+  off  = head & (ring->size - 1);
+
+  /* A record does not wrap around, so the rest of the ring may have to be
+   * skipped.
+   */
+
+  skip = ring->size - off < need ? ring->size - off : 0;
+
+  if (skip + need > ring->size - (head - ring->tail))
+    {
+      ring->dropped++;
+      return NULL;
+    }
+
+  if (skip > 0)
+    {
+      hdr = (FAR struct elasync_hdr_s *)&ring->buffer[off];
+      hdr->size = skip;
+      hdr->type = ELASYNC_PAD;
+      off = 0;
+    }
+
+  clock_gettime(ELASYNC_CLOCK, &ts);
+
+  hdr        = (FAR struct elasync_hdr_s *)&ring->buffer[off];
+  hdr->size  = need;
+  hdr->type  = type;
+  hdr->level = level;
+  hdr->sec   = ts.tv_sec;
+  hdr->nsec  = ts.tv_nsec;
+
+  *used = skip + need;
+  return (FAR uint8_t *)(hdr + 1);
+}
+
+/****************************************************************************
+ * Name: elasync_commit
+ ****************************************************************************/
+
+static void elasync_commit(FAR struct elasync_ring_s *ring, uint32_t used)
+{
+  uint32_t before = ring->head - ring->tail;
+
+  ELASYNC_BARRIER();
+  ring->head += used;
+
+  /* Wake the writer early when the ring becomes half full.  Otherwise it
+   * looks at the ring once per period.
+   */
+
+  if (before < ring->size / 2 && before + used >= ring->size / 2)
+    {
+      sem_post(&ring->log->wake);
+    }
+}
+
+/****************************************************************************
+ * Name: elasync_output
+ *
+ * Description:
+ *   Write one record.  This runs on the writer thread.
+ *
+ ****************************************************************************/
+
+static void elasync_output(FAR struct elasync_s *log,
+                           FAR const struct elasync_hdr_s *hdr,
+                           FAR const uint8_t *payload)
+{
+  size_t avail = sizeof(log->line) - 1;
+  int len;
+
+  len = snprintf(log->line, avail, "[%5lu.%06lu] %c/ ",
+                 (unsigned long)hdr->sec,
+                 (unsigned long)(hdr->nsec / 1000),
+                 hdr->level < sizeof(g_elasync_levels) - 1 ?
+                 g_elasync_levels[hdr->level] : '?');
+
+  if (hdr->type == ELASYNC_TEXT)
+    {
+      len += snprintf(&log->line[len], avail - len, "%s",
+                      (FAR const char *)payload);
+    }
+#ifdef CONFIG_EMBEDLOG_ASYNC_DEFERRED
+  else if (hdr->type == ELASYNC_DEFERRED)
+    {
+      struct elasync_deferred_s rec;
+
+      memcpy(&rec, payload, sizeof(rec));
+      len += snprintf(&log->line[len], avail - len, rec.fmt,
+                      rec.arg[0], rec.arg[1], rec.arg[2], rec.arg[3]);
+    }
+#endif
+
+  if (len > (int)avail - 1)
+    {
+      len = avail - 1;
+    }
+
+  log->line[len]     = '\n';
+  log->line[len + 1] = '\0';
+  el_oputs(log->el, log->line);
+}
+
+/****************************************************************************
+ * Name: elasync_drain
+ *
+ * Description:
+ *   Write all records in a ring.  Returns true if the ring is empty.
+ *
+ ****************************************************************************/
+
+static bool elasync_drain(FAR struct elasync_s *log,
+                          FAR struct elasync_ring_s *ring)
+{
+  FAR struct elasync_hdr_s *hdr;
+  uint32_t dropped;
+  uint32_t head;
+  uint32_t tail;
+  uint32_t off;
+
+  head = ring->head;
+  tail = ring->tail;
+  ELASYNC_BARRIER();
+
+  while (tail != head)
+    {
+      off = tail & (ring->size - 1);
+      hdr = (FAR struct elasync_hdr_s *)&ring->buffer[off];
+
+      if (hdr->type != ELASYNC_PAD)
+        {
+          elasync_output(log, hdr, (FAR const uint8_t *)(hdr + 1));
+        }
+
+      tail += hdr->size;
+
+      ELASYNC_BARRIER();
+      ring->tail = tail;
+    }
+
+  dropped = ring->dropped;
+  if (dropped != ring->reported)
+    {
+      snprintf(log->line, sizeof(log->line),
+               "elasync: %lu messages dropped\n",
+               (unsigned long)(dropped - ring->reported));
+      el_oputs(log->el, log->line);
+      ring->reported = dropped;
+    }
+
+  return ring->head == tail;
+}
+
+/****************************************************************************
+ * Name: elasync_writer
+ ****************************************************************************/
+
+static FAR void *elasync_writer(FAR void *arg)
+{
+  FAR struct elasync_s *log = (FAR struct elasync_s *)arg;
+  FAR struct elasync_ring_s *ring;
+  FAR struct elasync_ring_s *prev;
+  FAR struct elasync_ring_s *next;
+  struct timespec abstime;
+  bool released;
+  bool stop;
+
+  for (; ; )
+    {
+      /* Read the flag first, so that the last pass sees everything that
+       * was logged before elasync_stop().
+       */
+
+      stop = log->stop;
+
+      pthread_mutex_lock(&log->lock);
+
+      for (prev = NULL, ring = log->rings; ring != NULL; ring = next)
+        {
+          next = ring->flink;
+
+          /* Messages logged before the release are visible once the flag
+           * is.
+           */
+
+          released = ring->released;
+          ELASYNC_BARRIER();
+
+          if (elasync_drain(log, ring) && released)
+            {
+              if (prev == NULL)
+                {
+                  log->rings = next;
+                }
+              else
+                {
+                  prev->flink = next;
+                }
+
+              free(ring);
+              continue;
+            }
+
+          prev = ring;
+        }
+
+      pthread_mutex_unlock(&log->lock);
+
+      if (stop)
+        {
+          break;
+        }
+
+      clock_gettime(CLOCK_REALTIME, &abstime);
+      abstime.tv_nsec += CONFIG_EMBEDLOG_ASYNC_PERIOD_MS * 1000000L;
+      abstime.tv_sec  += abstime.tv_nsec / 1000000000;
+      abstime.tv_nsec %= 1000000000;
+
+      sem_timedwait(&log->wake, &abstime);
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: elasync_start
+ ****************************************************************************/
+
+FAR struct elasync_s *elasync_start(FAR struct el_options *el,
+                                    enum el_level level)
+{
+  FAR struct elasync_s *log;
+  struct sched_param param;
+  pthread_attr_t attr;
+  int ret;
+
+  log = (FAR struct elasync_s *)zalloc(sizeof(struct elasync_s));
+  if (log == NULL)
+    {
+      errno = ENOMEM;
+      return NULL;
+    }
+
+  log->el    = el;
+  log->level = level;
+  pthread_mutex_init(&log->lock, NULL);
+  sem_init(&log->wake, 0, 0);
+  sem_setprotocol(&log->wake, SEM_PRIO_NONE);
+
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, CONFIG_EMBEDLOG_ASYNC_STACKSIZE);
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  param.sched_priority = CONFIG_EMBEDLOG_ASYNC_PRIORITY;
+  pthread_attr_setschedparam(&attr, &param);
+
+  ret = pthread_create(&log->writer, &attr, elasync_writer, log);
+  pthread_attr_destroy(&attr);
+
+  if (ret != 0)
+    {
+      sem_destroy(&log->wake);
+      pthread_mutex_destroy(&log->lock);
+      free(log);
+      errno = ret;
+      return NULL;
+    }
+
+  pthread_setname_np(log->writer, "elasync");
+  return log;
+}
+
+/****************************************************************************
+ * Name: elasync_stop
+ ****************************************************************************/
+
+int elasync_stop(FAR struct elasync_s *log)
+{
+  FAR struct elasync_ring_s *ring;
+  int ret;
+
+  log->stop = true;
+  sem_post(&log->wake);
+
+  ret = pthread_join(log->writer, NULL);
+  if (ret != 0)
+    {
+      return -ret;
+    }
+
+  while ((ring = log->rings) != NULL)
+    {
+      log->rings = ring->flink;
+      free(ring);
+    }
+
+  sem_destroy(&log->wake);
+  pthread_mutex_destroy(&log->lock);
+  free(log);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: elasync_ring
+ ****************************************************************************/
+
+FAR struct elasync_ring_s *elasync_ring(FAR struct elasync_s *log,
+                                        size_t size)
+{
+  FAR struct elasync_ring_s *ring;
+  uint32_t ringsize = ELASYNC_MINRING;
+
+  while (ringsize < size)
+    {
+      ringsize <<= 1;
+    }
+
+  /* The ring buffer follows the ring structure */
+
+  ring = (FAR struct elasync_ring_s *)
+    zalloc(ELASYNC_ALIGNUP(sizeof(struct elasync_ring_s)) + ringsize);
+  if (ring == NULL)
+    {
+      errno = ENOMEM;
+      return NULL;
+    }
+
+  ring->log    = log;
+  ring->size   = ringsize;
+  ring->buffer = (FAR uint8_t *)ring +
+                 ELASYNC_ALIGNUP(sizeof(struct elasync_ring_s));
+
+  pthread_mutex_lock(&log->lock);
+  ring->flink = log->rings;
+  log->rings  = ring;
+  pthread_mutex_unlock(&log->lock);
+
+  return ring;
+}
+
+/****************************************************************************
+ * Name: elasync_release
+ ****************************************************************************/
+
+void elasync_release(FAR struct elasync_ring_s *ring)
+{
+  ELASYNC_BARRIER();
+  ring->released = true;
+}
+
+/****************************************************************************
+ * Name: elasync_print
+ ****************************************************************************/
+
+int elasync_print(FAR struct elasync_ring_s *ring, enum el_level level,
+                  FAR const char *fmt, ...)
+{
+  char msg[CONFIG_EMBEDLOG_LOG_MAX];
+  FAR uint8_t *payload;
+  uint32_t used;
+  va_list ap;
+  int len;
+
+  if (level > ring->log->level)
+    {
+      return OK;
+    }
+
+  va_start(ap, fmt);
+  len = vsnprintf(msg, sizeof(msg), fmt, ap);
+  va_end(ap);
+
+  if (len < 0)
+    {
+      len = 0;
+    }
+  else if (len > (int)sizeof(msg) - 1)
+    {
+      len = sizeof(msg) - 1;
+    }
+
+  payload = elasync_reserve(ring, level, len + 1, ELASYNC_TEXT, &used);
+  if (payload == NULL)
+    {
+      return -ENOSPC;
+    }
+
+  memcpy(payload, msg, len);
+  payload[len] = '\0';
+
+  elasync_commit(ring, used);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: elasync_bprint
+ ****************************************************************************/
+
+#ifdef CONFIG_EMBEDLOG_ASYNC_DEFERRED
+int elasync_bprint(FAR struct elasync_ring_s *ring, enum el_level level,
+                   FAR const char *fmt, uintptr_t arg0, uintptr_t arg1,
+                   uintptr_t arg2, uintptr_t arg3)
+{
+  struct elasync_deferred_s rec;
+  FAR uint8_t *payload;
+  uint32_t used;
+
+  if (level > ring->log->level)
+    {
+      return OK;
+    }
+
+  payload = elasync_reserve(ring, level, sizeof(rec), ELASYNC_DEFERRED,
+                            &used);
+  if (payload == NULL)
+    {
+      return -ENOSPC;
+    }
+
+  rec.fmt    = fmt;
+  rec.arg[0] = arg0;
+  rec.arg[1] = arg1;
+  rec.arg[2] = arg2;
+  rec.arg[3] = arg3;
+  memcpy(payload, &rec, sizeof(rec));
+
+  elasync_commit(ring, used);
+  return OK;
+}
+#endif
@@ -45,8 +45,10 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sched.h>
+#include <time.h>
 #include <syslog.h>
 #include <errno.h>
 
@@ -60,6 +62,37 @@
 
 #define RAMTEST_PREFIX "RAMTest: "
 
+#ifdef CONFIG_SYSTEM_RAMTEST_BANDWIDTH
+#  ifndef CONFIG_SYSTEM_RAMTEST_CACHELINE
+#    define CONFIG_SYSTEM_RAMTEST_CACHELINE 32
+#  endif
+
+#  ifndef CONFIG_SYSTEM_RAMTEST_BW_MSEC
+#    define CONFIG_SYSTEM_RAMTEST_BW_MSEC 200
+#  endif
+
+#  if CONFIG_SYSTEM_RAMTEST_CACHELINE % 32 != 0
+#    error CONFIG_SYSTEM_RAMTEST_CACHELINE must be a multiple of 32
+#  endif
+
+#  ifdef CONFIG_CLOCK_MONOTONIC
+#    define RAMTEST_CLOCK CLOCK_MONOTONIC
+#  else
+#    define RAMTEST_CLOCK CLOCK_REALTIME
+#  endif
+
+/* The line kernels move eight words per block and whole cache lines per
+ * iteration.
+ */
+
+#  define RAMTEST_BLOCKWORDS 8
+#  define RAMTEST_LINEWORDS  (CONFIG_SYSTEM_RAMTEST_CACHELINE / 4)
+
+#  define RAMTEST_OPTIONS    "whbp"
+#else
+#  define RAMTEST_OPTIONS    "whb"
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -71,12 +104,73 @@ struct ramtest_s
   size_t size;
   size_t nxfrs;
   uint32_t mask;
+#ifdef CONFIG_SYSTEM_RAMTEST_BANDWIDTH
+  bool bandwidth;
+#endif
 };
 
+#ifdef CONFIG_SYSTEM_RAMTEST_BANDWIDTH
+/* A bandwidth kernel moves 'nwords' 32-bit words from 'src' to 'dest'.
+ * Write kernels ignore 'src', read kernels ignore 'dest' and return a
+ * value computed from the data so that the loads cannot be optimized
+ * away.
+ */
+
+typedef uint32_t (*ramtest_kernel_t)(FAR uint32_t *dest,
+                                     FAR const uint32_t *src,
+                                     size_t nwords);
+
+struct ramtest_kernels_s
+{
+  FAR const char *name;
+  ramtest_kernel_t write;
+  ramtest_kernel_t read;
+  ramtest_kernel_t copy;
+};
+#endif
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+#ifdef CONFIG_SYSTEM_RAMTEST_BANDWIDTH
+static uint32_t write_words(FAR uint32_t *dest, FAR const uint32_t *src,
+                            size_t nwords);
+static uint32_t read_words(FAR uint32_t *dest, FAR const uint32_t *src,
+                           size_t nwords);
+static uint32_t copy_words(FAR uint32_t *dest, FAR const uint32_t *src,
+                           size_t nwords);
+static uint32_t write_lines(FAR uint32_t *dest, FAR const uint32_t *src,
+                            size_t nwords);
+static uint32_t read_lines(FAR uint32_t *dest, FAR const uint32_t *src,
+                           size_t nwords);
+static uint32_t copy_lines(FAR uint32_t *dest, FAR const uint32_t *src,
+                           size_t nwords);
+static uint32_t write_memset(FAR uint32_t *dest, FAR const uint32_t *src,
+                             size_t nwords);
+static uint32_t copy_memcpy(FAR uint32_t *dest, FAR const uint32_t *src,
+                            size_t nwords);
+#endif
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
 
+#ifdef CONFIG_SYSTEM_RAMTEST_BANDWIDTH
+static const struct ramtest_kernels_s g_kernels[] =
+{
+  { "word", write_words,  read_words, copy_words  },
+  { "line", write_lines,  read_lines, copy_lines  },
+  { "libc", write_memset, NULL,       copy_memcpy }
+};
+
+#define RAMTEST_NKERNELS (sizeof(g_kernels) / sizeof(g_kernels[0]))
+
+/* Results of the read kernels end up here */
+
+static volatile uint32_t g_sink;
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -94,6 +188,9 @@ static void show_usage(FAR const char *progname, int exitcode)
   printf("  -w Sets the width of a memory location to 32-bits.\n");
   printf("  -h Sets the width of a memory location to 16-bits (default).\n");
   printf("  -b Sets the width of a memory location to 8-bits.\n");
+#ifdef CONFIG_SYSTEM_RAMTEST_BANDWIDTH
+  printf("  -p Also measure the read, write and copy bandwidth.\n");
+#endif
   exit(exitcode);
 }
 
@@ -107,7 +204,7 @@ static void parse_commandline(int argc, char **argv,
   FAR char *ptr;
   int option;
 
-  while ((option = getopt(argc, argv, "whb")) != ERROR)
+  while ((option = getopt(argc, argv, RAMTEST_OPTIONS)) != ERROR)
     {
       if (option == 'w')
         {
@@ -124,6 +221,12 @@ static void parse_commandline(int argc, char **argv,
           info->width = 8;
           info->mask  = 0x000000ff;
         }
+#ifdef CONFIG_SYSTEM_RAMTEST_BANDWIDTH
+      else if (option == 'p')
+        {
+          info->bandwidth = true;
+        }
+#endif
       else
         {
           printf(RAMTEST_PREFIX "Unrecognized option: '%c'\n", option);
@@ -551,6 +654,306 @@ static void addr_in_addr(FAR struct ramtest_s *info)
   verify_addrinaddr(info);
 }
 
+#ifdef CONFIG_SYSTEM_RAMTEST_BANDWIDTH
+/****************************************************************************
+ * Name: write_words, read_words and copy_words
+ *
+ * Description:
+ *   Word kernels:  32-bit accesses, unrolled four times.
+ *
+ ****************************************************************************/
+
+static uint32_t write_words(FAR uint32_t *dest, FAR const uint32_t *src,
+                            size_t nwords)
+{
+  uint32_t value = 0x5a5a5a5a;
+
+  for (; nwords >= 4; nwords -= 4)
+    {
+      dest[0] = value;
+      dest[1] = value;
+      dest[2] = value;
+      dest[3] = value;
+      dest   += 4;
+    }
+
+  return 0;
+}
+
+static uint32_t read_words(FAR uint32_t *dest, FAR const uint32_t *src,
+                           size_t nwords)
+{
+  uint32_t sum = 0;
+
+  for (; nwords >= 4; nwords -= 4)
+    {
+      sum += src[0];
+      sum += src[1];
+      sum += src[2];
+      sum += src[3];
+      src += 4;
+    }
+
+  return sum;
+}
+
+static uint32_t copy_words(FAR uint32_t *dest, FAR const uint32_t *src,
+                           size_t nwords)
+{
+  for (; nwords >= 4; nwords -= 4)
+    {
+      dest[0] = src[0];
+      dest[1] = src[1];
+      dest[2] = src[2];
+      dest[3] = src[3];
+      dest   += 4;
+      src    += 4;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: write_lines, read_lines and copy_lines
+ *
+ * Description:
+ *   Cache line kernels:  Each iteration covers a whole cache line in blocks
+ *   of eight words.  The loads of a block are independent of each other and
+ *   are all issued before the block is stored or summed, which lets the
+ *   compiler use load/store multiple instructions and the memory controller
+ *   use bursts.
+ *
+ ****************************************************************************/
+
+static uint32_t write_lines(FAR uint32_t *dest, FAR const uint32_t *src,
+                            size_t nwords)
+{
+  uint32_t value = 0xa5a5a5a5;
+  int i;
+
+  for (; nwords >= RAMTEST_LINEWORDS; nwords -= RAMTEST_LINEWORDS)
+    {
+      for (i = 0; i < RAMTEST_LINEWORDS; i += RAMTEST_BLOCKWORDS)
+        {
+          dest[0] = value;
+          dest[1] = value;
+          dest[2] = value;
+          dest[3] = value;
+          dest[4] = value;
+          dest[5] = value;
+          dest[6] = value;
+          dest[7] = value;
+          dest   += RAMTEST_BLOCKWORDS;
+        }
+    }
+
+  return 0;
+}
+
+static uint32_t read_lines(FAR uint32_t *dest, FAR const uint32_t *src,
+                           size_t nwords)
+{
+  uint32_t sum = 0;
+  uint32_t w0;
+  uint32_t w1;
+  uint32_t w2;
+  uint32_t w3;
+  uint32_t w4;
+  uint32_t w5;
+  uint32_t w6;
+  uint32_t w7;
+  int i;
+
+  for (; nwords >= RAMTEST_LINEWORDS; nwords -= RAMTEST_LINEWORDS)
+    {
+      for (i = 0; i < RAMTEST_LINEWORDS; i += RAMTEST_BLOCKWORDS)
+        {
+          w0   = src[0];
+          w1   = src[1];
+          w2   = src[2];
+          w3   = src[3];
+          w4   = src[4];
+          w5   = src[5];
+          w6   = src[6];
+          w7   = src[7];
+          sum += (w0 ^ w1) + (w2 ^ w3) + (w4 ^ w5) + (w6 ^ w7);
+          src += RAMTEST_BLOCKWORDS;
+        }
+    }
+
+  return sum;
+}
+
+static uint32_t copy_lines(FAR uint32_t *dest, FAR const uint32_t *src,
+                           size_t nwords)
+{
+  uint32_t w0;
+  uint32_t w1;
+  uint32_t w2;
+  uint32_t w3;
+  uint32_t w4;
+  uint32_t w5;
+  uint32_t w6;
+  uint32_t w7;
+  int i;
+
+  for (; nwords >= RAMTEST_LINEWORDS; nwords -= RAMTEST_LINEWORDS)
+    {
+      for (i = 0; i < RAMTEST_LINEWORDS; i += RAMTEST_BLOCKWORDS)
+        {
+          w0      = src[0];
+          w1      = src[1];
+          w2      = src[2];
+          w3      = src[3];
+          w4      = src[4];
+          w5      = src[5];
+          w6      = src[6];
+          w7      = src[7];
+          dest[0] = w0;
+          dest[1] = w1;
+          dest[2] = w2;
+          dest[3] = w3;
+          dest[4] = w4;
+          dest[5] = w5;
+          dest[6] = w6;
+          dest[7] = w7;
+          src    += RAMTEST_BLOCKWORDS;
+          dest   += RAMTEST_BLOCKWORDS;
+        }
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: write_memset and copy_memcpy
+ *
+ * Description:
+ *   The C library for comparison.
+ *
+ ****************************************************************************/
+
+static uint32_t write_memset(FAR uint32_t *dest, FAR const uint32_t *src,
+                             size_t nwords)
+{
+  memset(dest, 0x3c, nwords << 2);
+  return 0;
+}
+
+static uint32_t copy_memcpy(FAR uint32_t *dest, FAR const uint32_t *src,
+                            size_t nwords)
+{
+  memcpy(dest, src, nwords << 2);
+  return 0;
+}
+
+/****************************************************************************
+ * Name: ramtest_time
+ *
+ * Description:
+ *   Return a free-running time in microseconds.
+ *
+ ****************************************************************************/
+
+static uint32_t ramtest_time(void)
+{
+  struct timespec ts;
+
+  clock_gettime(RAMTEST_CLOCK, &ts);
+  return (uint32_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: ramtest_kibps
+ *
+ * Description:
+ *   Run a kernel repeatedly for at least CONFIG_SYSTEM_RAMTEST_BW_MSEC
+ *   milliseconds and return its throughput in KiB/s.  Repeating the
+ *   kernel keeps the result meaningful with a coarse system timer.
+ *
+ ****************************************************************************/
+
+static unsigned long ramtest_kibps(ramtest_kernel_t kernel,
+                                   FAR uint32_t *dest,
+                                   FAR const uint32_t *src, size_t nwords)
+{
+  uint64_t nbytes = 0;
+  uint32_t elapsed;
+  uint32_t start;
+
+  start = ramtest_time();
+  do
+    {
+      g_sink += kernel(dest, src, nwords);
+      nbytes += nwords << 2;
+      elapsed = ramtest_time() - start;
+    }
+  while (elapsed < CONFIG_SYSTEM_RAMTEST_BW_MSEC * 1000);
+
+  return (unsigned long)(nbytes * 1000000 / 1024 / elapsed);
+}
+
+/****************************************************************************
+ * Name: bandwidth_test
+ *
+ * Description:
+ *   Measure the write and read bandwidth of the whole region and the copy
+ *   bandwidth from its first half to its second half (counting the bytes
+ *   copied, not the bytes moved over the bus) with each set of kernels.
+ *   The region is trimmed to whole, word-aligned cache lines.
+ *
+ ****************************************************************************/
+
+static void bandwidth_test(FAR struct ramtest_s *info)
+{
+  FAR const struct ramtest_kernels_s *kernels;
+  FAR uint32_t *region;
+  uintptr_t start;
+  uintptr_t end;
+  size_t nwords;
+  size_t ncopy;
+  int i;
+
+  start  = (info->start + 3) & ~(uintptr_t)3;
+  end    = info->start + info->size;
+  nwords = end > start ? (end - start) >> 2 : 0;
+  nwords = (nwords / RAMTEST_LINEWORDS) * RAMTEST_LINEWORDS;
+  ncopy  = ((nwords >> 1) / RAMTEST_LINEWORDS) * RAMTEST_LINEWORDS;
+  region = (FAR uint32_t *)start;
+
+  printf(RAMTEST_PREFIX "Bandwidth test: %08lx %lu (cache line %d)\n",
+         (unsigned long)start, (unsigned long)(nwords << 2),
+         CONFIG_SYSTEM_RAMTEST_CACHELINE);
+
+  if (ncopy == 0)
+    {
+      printf(RAMTEST_PREFIX "ERROR: Region too small\n");
+      return;
+    }
+
+  printf(RAMTEST_PREFIX "kernel  write KiB/s   read KiB/s   copy KiB/s\n");
+  for (i = 0; i < RAMTEST_NKERNELS; i++)
+    {
+      kernels = &g_kernels[i];
+      printf(RAMTEST_PREFIX "%-6s %12lu ", kernels->name,
+             ramtest_kibps(kernels->write, region, NULL, nwords));
+
+      if (kernels->read != NULL)
+        {
+          printf("%12lu ", ramtest_kibps(kernels->read, NULL, region,
+                                         nwords));
+        }
+      else
+        {
+          printf("%12s ", "-");
+        }
+
+      printf("%12lu\n", ramtest_kibps(kernels->copy, region + ncopy,
+                                      region, ncopy));
+    }
+}
+#endif /* CONFIG_SYSTEM_RAMTEST_BANDWIDTH */
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -567,6 +970,9 @@ int ramtest_main(int argc, char **argv)
 
   info.width = 16;
   info.mask  = 0x0000ffff;
+#ifdef CONFIG_SYSTEM_RAMTEST_BANDWIDTH
+  info.bandwidth = false;
+#endif
   parse_commandline(argc, argv, &info);
 
   /* Perform the memory tests */
@@ -577,6 +983,14 @@ int ramtest_main(int argc, char **argv)
   pattern_test(&info, 0x66666666, 0x99999999);
   pattern_test(&info, 0x33333333, 0xcccccccc);
   addr_in_addr(&info);
+
+#ifdef CONFIG_SYSTEM_RAMTEST_BANDWIDTH
+  if (info.bandwidth)
+    {
+      bandwidth_test(&info);
+    }
+#endif
+
   return 0;
 }
 
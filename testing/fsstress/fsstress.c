@@ -0,0 +1,692 @@
+/****************************************************************************
+ * apps/testing/fsstress/fsstress.c
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <crc32.h>
+
+#include "testing/fsstress.h"
+#include "testing/latency.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_TESTING_FSSTRESS_NTHREADS
+#  define CONFIG_TESTING_FSSTRESS_NTHREADS 0
+#endif
+
+#ifndef CONFIG_TESTING_FSSTRESS_NOPS
+#  define CONFIG_TESTING_FSSTRESS_NOPS 1000
+#endif
+
+#ifndef CONFIG_TESTING_FSSTRESS_NFILES
+#  define CONFIG_TESTING_FSSTRESS_NFILES 16
+#endif
+
+#ifndef CONFIG_TESTING_FSSTRESS_READPCT
+#  define CONFIG_TESTING_FSSTRESS_READPCT 40
+#endif
+
+#ifndef CONFIG_TESTING_FSSTRESS_WRITEPCT
+#  define CONFIG_TESTING_FSSTRESS_WRITEPCT 40
+#endif
+
+#ifndef CONFIG_TESTING_FSSTRESS_STACKSIZE
+#  define CONFIG_TESTING_FSSTRESS_STACKSIZE 2048
+#endif
+
+/* Random numbers 0-99 below READPCT select a read, below WRITEMAX a write
+ * and the rest a delete.
+ */
+
+#define FSSTRESS_WRITEMAX \
+  (CONFIG_TESTING_FSSTRESS_READPCT + CONFIG_TESTING_FSSTRESS_WRITEPCT)
+
+#if FSSTRESS_WRITEMAX > 100
+#  error The read and write percentages must not exceed 100
+#endif
+
+/* Thread file names are <mountpt>/tNN_MMM, NN being the thread number and
+ * MMM the slot in the thread's file set.
+ */
+
+#if CONFIG_TESTING_FSSTRESS_NFILES > 999
+#  error CONFIG_TESTING_FSSTRESS_NFILES must be less than 1000
+#endif
+
+#define FSSTRESS_THREADS_MAX 99
+
+#ifdef CONFIG_CLOCK_MONOTONIC
+#  define FSSTRESS_CLOCK CLOCK_MONOTONIC
+#else
+#  define FSSTRESS_CLOCK CLOCK_REALTIME
+#endif
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* Operations of the multi-threaded stress test */
+
+enum fsstress_op_e
+{
+  FSSTRESS_READ = 0,
+  FSSTRESS_WRITE,
+  FSSTRESS_DELETE,
+  FSSTRESS_NOPS
+};
+
+/* Statistics of one operation in one thread */
+
+struct fsstress_opstats_s
+{
+  struct latency_s lat;
+  uint64_t bytes;
+};
+
+/* One slot of a thread's file set */
+
+struct fsstress_threadfile_s
+{
+  bool used;
+  size_t len;
+  uint32_t crc;
+};
+
+/* State of one stress thread */
+
+struct fsstress_thread_s
+{
+  pthread_t thread;
+  FAR const char *mountpt;
+  size_t maxfile;
+  FAR char *name;
+  int id;
+  int nops;
+  uint32_t seed;
+  uint32_t nerrors;
+  uint32_t nfull;
+  FAR uint8_t *buffer;
+  struct fsstress_threadfile_s files[CONFIG_TESTING_FSSTRESS_NFILES];
+  struct fsstress_opstats_s stats[FSSTRESS_NOPS];
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static pthread_mutex_t g_stresslock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *g_stressop[FSSTRESS_NOPS] =
+{
+  "read", "write", "delete"
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: fsstress_time
+ *
+ * Description:
+ *   Return a free-running time in microseconds.
+ *
+ ****************************************************************************/
+
+static uint32_t fsstress_time(void)
+{
+  struct timespec ts;
+
+  clock_gettime(FSSTRESS_CLOCK, &ts);
+  return (uint32_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: fsstress_rand
+ *
+ * Description:
+ *   Per-thread pseudo random numbers.  rand() shares one state between all
+ *   threads, which would make the operation mix depend on scheduling.
+ *
+ ****************************************************************************/
+
+static uint32_t fsstress_rand(FAR uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return (*seed >> 16) & 0x7fff;
+}
+
+/****************************************************************************
+ * Name: fsstress_account
+ ****************************************************************************/
+
+static void fsstress_account(FAR struct fsstress_opstats_s *stats,
+                             uint32_t start, size_t nbytes)
+{
+  latency_account(&stats->lat, fsstress_time() - start);
+  stats->bytes += nbytes;
+}
+
+/****************************************************************************
+ * Name: fsstress_threadname
+ *
+ * Description:
+ *   Put the name of the file in slot 'slot' into thread->name and return
+ *   it.
+ *
+ ****************************************************************************/
+
+static FAR char *fsstress_threadname(FAR struct fsstress_thread_s *thread,
+                                     int slot)
+{
+  sprintf(thread->name, "%s/t%02d_%03d", thread->mountpt, thread->id, slot);
+  return thread->name;
+}
+
+/****************************************************************************
+ * Name: fsstress_threadwrite
+ *
+ * Description:
+ *   (Re)create the file in slot 'slot' of the thread's file set with random
+ *   content.  An existing file is removed first; this is part of the timed
+ *   operation because some file systems (NXFFS) cannot truncate a file.
+ *
+ ****************************************************************************/
+
+static int fsstress_threadwrite(FAR struct fsstress_thread_s *thread,
+                                int slot)
+{
+  FAR struct fsstress_threadfile_s *file = &thread->files[slot];
+  FAR char *name;
+  uint32_t start;
+  ssize_t nwritten;
+  size_t offset;
+  size_t len;
+  size_t i;
+  int errcode;
+  int fd;
+
+  name = fsstress_threadname(thread, slot);
+
+  len = (fsstress_rand(&thread->seed) % thread->maxfile) + 1;
+  for (i = 0; i < len; i++)
+    {
+      thread->buffer[i] = (uint8_t)fsstress_rand(&thread->seed);
+    }
+
+  start = fsstress_time();
+  if (file->used)
+    {
+      file->used = false;
+      if (unlink(name) < 0)
+        {
+          errcode = errno;
+          goto errout;
+        }
+    }
+
+  fd = open(name, O_WRONLY | O_CREAT | O_EXCL, 0666);
+  if (fd < 0)
+    {
+      errcode = errno;
+      goto errout;
+    }
+
+  for (offset = 0; offset < len; offset += nwritten)
+    {
+      nwritten = write(fd, &thread->buffer[offset], len - offset);
+      if (nwritten < 0 && errno == EINTR)
+        {
+          nwritten = 0;
+        }
+      else if (nwritten <= 0)
+        {
+          errcode = nwritten < 0 ? errno : ENOSPC;
+          close(fd);
+          unlink(name);
+          goto errout;
+        }
+    }
+
+  if (close(fd) < 0)
+    {
+      errcode = errno;
+      unlink(name);
+      goto errout;
+    }
+
+  fsstress_account(&thread->stats[FSSTRESS_WRITE], start, len);
+
+  file->used = true;
+  file->len  = len;
+  file->crc  = crc32(thread->buffer, len);
+  return OK;
+
+errout:
+  if (errcode == ENOSPC)
+    {
+      thread->nfull++;
+    }
+  else
+    {
+      printf("ERROR: Thread %d: Failed to write %s: %d\n",
+             thread->id, name, errcode);
+      thread->nerrors++;
+    }
+
+  return -errcode;
+}
+
+/****************************************************************************
+ * Name: fsstress_threadread
+ *
+ * Description:
+ *   Read back and verify the file in slot 'slot'.
+ *
+ ****************************************************************************/
+
+static void fsstress_threadread(FAR struct fsstress_thread_s *thread,
+                                int slot)
+{
+  FAR struct fsstress_threadfile_s *file = &thread->files[slot];
+  FAR char *name;
+  uint32_t start;
+  ssize_t nread;
+  size_t offset;
+  int fd;
+
+  name = fsstress_threadname(thread, slot);
+
+  start = fsstress_time();
+  fd = open(name, O_RDONLY);
+  if (fd < 0)
+    {
+      printf("ERROR: Thread %d: Failed to open %s: %d\n",
+             thread->id, name, errno);
+      thread->nerrors++;
+      return;
+    }
+
+  for (offset = 0; offset < file->len; offset += nread)
+    {
+      nread = read(fd, &thread->buffer[offset], file->len - offset);
+      if (nread < 0 && errno == EINTR)
+        {
+          nread = 0;
+        }
+      else if (nread <= 0)
+        {
+          printf("ERROR: Thread %d: Failed to read %s: %d\n",
+                 thread->id, name, nread < 0 ? errno : 0);
+          thread->nerrors++;
+          close(fd);
+          return;
+        }
+    }
+
+  close(fd);
+  fsstress_account(&thread->stats[FSSTRESS_READ], start, file->len);
+
+  if (crc32(thread->buffer, file->len) != file->crc)
+    {
+      printf("ERROR: Thread %d: Bad CRC in %s\n", thread->id, name);
+      thread->nerrors++;
+    }
+}
+
+/****************************************************************************
+ * Name: fsstress_threaddelete
+ ****************************************************************************/
+
+static void fsstress_threaddelete(FAR struct fsstress_thread_s *thread,
+                                  int slot)
+{
+  FAR char *name;
+  uint32_t start;
+
+  name = fsstress_threadname(thread, slot);
+
+  start = fsstress_time();
+  if (unlink(name) < 0)
+    {
+      printf("ERROR: Thread %d: Failed to unlink %s: %d\n",
+             thread->id, name, errno);
+      thread->nerrors++;
+    }
+  else
+    {
+      fsstress_account(&thread->stats[FSSTRESS_DELETE], start, 0);
+    }
+
+  thread->files[slot].used = false;
+}
+
+/****************************************************************************
+ * Name: fsstress_thread
+ *
+ * Description:
+ *   Body of one stress thread.  Each operation picks a random slot of the
+ *   thread's own file set and, according to the configured mix, reads and
+ *   verifies it, rewrites it or deletes it.  An empty slot is always
+ *   written.  When the volume is full, one of the thread's files is deleted
+ *   to make room.
+ *
+ ****************************************************************************/
+
+static FAR void *fsstress_thread(FAR void *arg)
+{
+  FAR struct fsstress_thread_s *thread = (FAR struct fsstress_thread_s *)arg;
+  uint32_t op;
+  int slot;
+  int ret;
+  int i;
+
+  /* Wait until all threads have been created */
+
+  pthread_mutex_lock(&g_stresslock);
+  pthread_mutex_unlock(&g_stresslock);
+
+  for (i = 0; i < thread->nops; i++)
+    {
+      slot = fsstress_rand(&thread->seed) % CONFIG_TESTING_FSSTRESS_NFILES;
+      op   = fsstress_rand(&thread->seed) % 100;
+
+      if (!thread->files[slot].used ||
+          (op >= CONFIG_TESTING_FSSTRESS_READPCT &&
+           op < FSSTRESS_WRITEMAX))
+        {
+          ret = fsstress_threadwrite(thread, slot);
+          if (ret == -ENOSPC)
+            {
+              for (slot = 0;
+                   slot < CONFIG_TESTING_FSSTRESS_NFILES &&
+                   !thread->files[slot].used;
+                   slot++)
+                {
+                }
+
+              if (slot < CONFIG_TESTING_FSSTRESS_NFILES)
+                {
+                  fsstress_threaddelete(thread, slot);
+                }
+            }
+        }
+      else if (op < CONFIG_TESTING_FSSTRESS_READPCT)
+        {
+          fsstress_threadread(thread, slot);
+        }
+      else
+        {
+          fsstress_threaddelete(thread, slot);
+        }
+    }
+
+  /* Clean up the file set */
+
+  for (slot = 0; slot < CONFIG_TESTING_FSSTRESS_NFILES; slot++)
+    {
+      if (thread->files[slot].used)
+        {
+          fsstress_threaddelete(thread, slot);
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: fsstress_showusage
+ ****************************************************************************/
+
+static void fsstress_showusage(FAR const char *progname)
+{
+  fprintf(stderr, "USAGE: %s [-t <nthreads>] [-n <nops>]\n", progname);
+  fprintf(stderr, "  -t: Number of stress threads (0-%d, default %d)\n",
+          FSSTRESS_THREADS_MAX, CONFIG_TESTING_FSSTRESS_NTHREADS);
+  fprintf(stderr, "      0 runs the single-threaded test\n");
+  fprintf(stderr, "  -n: Operations per stress thread (default %d)\n",
+          CONFIG_TESTING_FSSTRESS_NOPS);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: fsstress_options
+ ****************************************************************************/
+
+int fsstress_options(int argc, FAR char *argv[], FAR int *nthreads,
+                     FAR int *nops)
+{
+  int option;
+
+  *nthreads = CONFIG_TESTING_FSSTRESS_NTHREADS;
+  *nops     = CONFIG_TESTING_FSSTRESS_NOPS;
+
+  while ((option = getopt(argc, argv, "t:n:")) != ERROR)
+    {
+      switch (option)
+        {
+          case 't':
+            *nthreads = atoi(optarg);
+            break;
+
+          case 'n':
+            *nops = atoi(optarg);
+            break;
+
+          default:
+            fsstress_showusage(argv[0]);
+            return ERROR;
+        }
+    }
+
+  if (*nthreads < 0 || *nthreads > FSSTRESS_THREADS_MAX || *nops < 0)
+    {
+      fsstress_showusage(argv[0]);
+      return ERROR;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: fsstress_run
+ ****************************************************************************/
+
+int fsstress_run(FAR const char *mountpt, size_t maxfile, int nthreads,
+                 int nops)
+{
+  FAR struct fsstress_thread_s *threads;
+  FAR struct fsstress_thread_s *thread;
+  FAR struct fsstress_opstats_s *stats;
+  pthread_attr_t attr;
+  uint64_t rdbytes = 0;
+  uint64_t wrbytes = 0;
+  uint32_t totalops = 0;
+  uint32_t start;
+  uint32_t elapsed;
+  size_t namelen;
+  int nstarted;
+  int ret;
+  int i;
+  int j;
+
+  if (nthreads < 1 || nthreads > FSSTRESS_THREADS_MAX)
+    {
+      printf("ERROR: Bad number of threads: %d\n", nthreads);
+      return ERROR;
+    }
+
+  /* Room for <mountpt>/tNN_MMM and the terminating NUL */
+
+  namelen = strlen(mountpt) + 9;
+
+  threads = (FAR struct fsstress_thread_s *)
+    calloc(nthreads, sizeof(struct fsstress_thread_s));
+  if (threads == NULL)
+    {
+      printf("ERROR: Failed to allocate thread state\n");
+      return ERROR;
+    }
+
+  ret = OK;
+  for (i = 0; i < nthreads; i++)
+    {
+      threads[i].buffer = (FAR uint8_t *)malloc(maxfile + namelen);
+      if (threads[i].buffer == NULL)
+        {
+          printf("ERROR: Failed to allocate thread buffer\n");
+          ret = ERROR;
+          goto errout_with_threads;
+        }
+
+      threads[i].mountpt = mountpt;
+      threads[i].maxfile = maxfile;
+      threads[i].name    = (FAR char *)&threads[i].buffer[maxfile];
+      threads[i].id      = i;
+      threads[i].nops    = nops;
+      threads[i].seed    = 0x93846 + i;
+    }
+
+  printf("\n=== STRESS: %d threads, %d operations each, "
+         "%d%% read %d%% write %d%% delete ===\n",
+         nthreads, nops, CONFIG_TESTING_FSSTRESS_READPCT,
+         CONFIG_TESTING_FSSTRESS_WRITEPCT,
+         100 - FSSTRESS_WRITEMAX);
+
+  /* Hold the threads back until all of them exist so that they start
+   * together.
+   */
+
+  pthread_mutex_lock(&g_stresslock);
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, CONFIG_TESTING_FSSTRESS_STACKSIZE);
+
+  for (nstarted = 0; nstarted < nthreads; nstarted++)
+    {
+      ret = pthread_create(&threads[nstarted].thread, &attr, fsstress_thread,
+                           &threads[nstarted]);
+      if (ret != 0)
+        {
+          printf("ERROR: pthread_create failed: %d\n", ret);
+          ret = ERROR;
+          break;
+        }
+    }
+
+  pthread_attr_destroy(&attr);
+
+  start = fsstress_time();
+  pthread_mutex_unlock(&g_stresslock);
+
+  for (i = 0; i < nstarted; i++)
+    {
+      pthread_join(threads[i].thread, NULL);
+    }
+
+  elapsed = fsstress_time() - start;
+  if (elapsed == 0)
+    {
+      elapsed = 1;
+    }
+
+  /* Per-thread latency */
+
+  printf("thread op      count  avg_us  p50_us  p99_us  max_us\n");
+  for (i = 0; i < nstarted; i++)
+    {
+      thread = &threads[i];
+      for (j = 0; j < FSSTRESS_NOPS; j++)
+        {
+          stats = &thread->stats[j];
+          printf("%6d %-6s %6lu %7lu %7lu %7lu %7lu\n", i, g_stressop[j],
+                 (unsigned long)stats->lat.count,
+                 (unsigned long)latency_average(&stats->lat),
+                 (unsigned long)latency_percentile(&stats->lat, 50),
+                 (unsigned long)latency_percentile(&stats->lat, 99),
+                 (unsigned long)stats->lat.max);
+
+          totalops += stats->lat.count;
+        }
+
+      if (thread->nerrors > 0 || thread->nfull > 0)
+        {
+          printf("       errors: %lu volume full: %lu\n",
+                 (unsigned long)thread->nerrors,
+                 (unsigned long)thread->nfull);
+        }
+
+      if (thread->nerrors > 0)
+        {
+          ret = ERROR;
+        }
+
+      rdbytes += thread->stats[FSSTRESS_READ].bytes;
+      wrbytes += thread->stats[FSSTRESS_WRITE].bytes;
+    }
+
+  /* Aggregate throughput */
+
+  printf("Total: %lu ops in %lu ms, %lu ops/s, "
+         "read %lu KiB/s, write %lu KiB/s\n",
+         (unsigned long)totalops, (unsigned long)(elapsed / 1000),
+         (unsigned long)((uint64_t)totalops * 1000000 / elapsed),
+         (unsigned long)(rdbytes * 1000000 / 1024 / elapsed),
+         (unsigned long)(wrbytes * 1000000 / 1024 / elapsed));
+
+errout_with_threads:
+  for (i = 0; i < nthreads; i++)
+    {
+      free(threads[i].buffer);
+    }
+
+  free(threads);
+  return ret;
+}
@@ -50,10 +50,14 @@
 #include <fcntl.h>
 #include <dirent.h>
 #include <string.h>
+#include <time.h>
 #include <errno.h>
 #include <crc32.h>
 #include <debug.h>
 
+#include "testing/fsstress.h"
+#include "testing/latency.h"
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -92,6 +96,39 @@
 #  define CONFIG_TESTING_FSTEST_VERBOSE 0
 #endif
 
+#ifdef CONFIG_TESTING_FSTEST_BENCH
+#  ifndef CONFIG_TESTING_FSTEST_BENCH_SIZE
+#    define CONFIG_TESTING_FSTEST_BENCH_SIZE 65536
+#  endif
+
+#  ifndef CONFIG_TESTING_FSTEST_BENCH_BLOCK
+#    define CONFIG_TESTING_FSTEST_BENCH_BLOCK 512
+#  endif
+
+#  if CONFIG_TESTING_FSTEST_BENCH_BLOCK > CONFIG_TESTING_FSTEST_MAXFILE
+#    error CONFIG_TESTING_FSTEST_BENCH_BLOCK exceeds the maximum file size
+#  endif
+
+#  ifdef CONFIG_CLOCK_MONOTONIC
+#    define FSTEST_CLOCK CLOCK_MONOTONIC
+#  else
+#    define FSTEST_CLOCK CLOCK_REALTIME
+#  endif
+
+/* The benchmark file.  Random file names never contain an underscore. */
+
+#  define FSTEST_BENCH_FILE    CONFIG_TESTING_FSTEST_MOUNTPT "/fstest_bench"
+#  define FSTEST_BENCH_NBLOCKS \
+  (CONFIG_TESTING_FSTEST_BENCH_SIZE / CONFIG_TESTING_FSTEST_BENCH_BLOCK)
+
+#  define FSTEST_START(t)      (t) = fstest_time()
+#  define FSTEST_END(op, t) \
+  latency_account(&g_latency[op], fstest_time() - (t))
+#else
+#  define FSTEST_START(t)
+#  define FSTEST_END(op, t)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -105,6 +142,33 @@ struct fstest_filedesc_s
   uint32_t crc;
 };
 
+#ifdef CONFIG_TESTING_FSTEST_BENCH
+/* Timed operations */
+
+enum fstest_op_e
+{
+  FSTEST_OP_OPEN = 0,
+  FSTEST_OP_WRITE,
+  FSTEST_OP_FSYNC,
+  FSTEST_OP_CLOSE,
+  FSTEST_OP_UNLINK,
+  FSTEST_NOPS
+};
+
+/* Throughput of the benchmark file access patterns in KiB/s or -1 if the
+ * access pattern is not supported by the file system (or there is no
+ * space for the benchmark file).
+ */
+
+struct fstest_bench_s
+{
+  long seqwrite;
+  long seqread;
+  long rndwrite;
+  long rndread;
+};
+#endif
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -122,6 +186,16 @@ static struct mallinfo g_mmbefore;
 static struct mallinfo g_mmprevious;
 static struct mallinfo g_mmafter;
 
+#ifdef CONFIG_TESTING_FSTEST_BENCH
+static struct latency_s g_latency[FSTEST_NOPS];
+static uint64_t g_fillbytes;
+
+static const char *g_opname[FSTEST_NOPS] =
+{
+  "open", "write", "fsync", "close", "unlink"
+};
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -185,6 +259,43 @@ static void fstest_endmemusage(void)
   fstest_showmemusage(&g_mmbefore, &g_mmafter);
 }
 
+/****************************************************************************
+ * Name: fstest_time
+ *
+ * Description:
+ *   Return a free-running time in microseconds.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_TESTING_FSTEST_BENCH
+static uint32_t fstest_time(void)
+{
+  struct timespec ts;
+
+  clock_gettime(FSTEST_CLOCK, &ts);
+  return (uint32_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: fstest_kibps
+ *
+ * Description:
+ *   Return the throughput in KiB/s of transferring 'nbytes' in 'usec'
+ *   microseconds.
+ *
+ ****************************************************************************/
+
+static long fstest_kibps(uint64_t nbytes, uint32_t usec)
+{
+  if (usec == 0)
+    {
+      usec = 1;
+    }
+
+  return (long)(nbytes * 1000000 / 1024 / usec);
+}
+#endif
+
 /****************************************************************************
  * Name: fstest_randchar
  ****************************************************************************/
@@ -389,6 +500,9 @@ static int fstest_gc(size_t nbytes)
 
 static inline int fstest_wrfile(FAR struct fstest_filedesc_s *file)
 {
+#ifdef CONFIG_TESTING_FSTEST_BENCH
+  uint32_t start;
+#endif
   size_t offset;
   int fd;
   int ret;
@@ -398,7 +512,9 @@ static inline int fstest_wrfile(FAR struct fstest_filedesc_s *file)
   fstest_randname(file);
   fstest_randfile(file);
 
+  FSTEST_START(start);
   fd = open(file->name, O_WRONLY | O_CREAT | O_EXCL, 0666);
+  FSTEST_END(FSTEST_OP_OPEN, start);
   if (fd < 0)
     {
       /* If it failed because there is no space on the device, then don't
@@ -429,7 +545,9 @@ static inline int fstest_wrfile(FAR struct fstest_filedesc_s *file)
           nbytestowrite = maxio;
         }
 
+      FSTEST_START(start);
       nbyteswritten = write(fd, &g_fileimage[offset], nbytestowrite);
+      FSTEST_END(FSTEST_OP_WRITE, start);
       if (nbyteswritten < 0)
         {
           int errcode = errno;
@@ -487,7 +605,19 @@ static inline int fstest_wrfile(FAR struct fstest_filedesc_s *file)
       offset += nbyteswritten;
     }
 
+#ifdef CONFIG_TESTING_FSTEST_BENCH
+  /* Include the time to commit the file to the media */
+
+  FSTEST_START(start);
+  fsync(fd);
+  FSTEST_END(FSTEST_OP_FSYNC, start);
+
+  g_fillbytes += file->len;
+#endif
+
+  FSTEST_START(start);
   close(fd);
+  FSTEST_END(FSTEST_OP_CLOSE, start);
   return OK;
 }
 
@@ -781,6 +911,9 @@ static int fstest_verifyfs(void)
 static int fstest_delfiles(void)
 {
   FAR struct fstest_filedesc_s *file;
+#ifdef CONFIG_TESTING_FSTEST_BENCH
+  uint32_t start;
+#endif
   int ndel;
   int ret;
   int i;
@@ -822,7 +955,9 @@ static int fstest_delfiles(void)
           file = &g_files[j];
           if (file->name && !file->deleted)
             {
+              FSTEST_START(start);
               ret = unlink(file->name);
+              FSTEST_END(FSTEST_OP_UNLINK, start);
               if (ret < 0)
                 {
                   printf("ERROR: Unlink %d failed: %d\n", i+1, errno);
@@ -943,6 +1078,177 @@ static int fstest_directory(void)
   return OK;
 }
 
+/****************************************************************************
+ * Name: fstest_benchio
+ *
+ * Description:
+ *   Transfer the benchmark file in CONFIG_TESTING_FSTEST_BENCH_BLOCK sized
+ *   blocks, either in order or at random block offsets, and return the
+ *   throughput in KiB/s.  Writes include the final fsync().  Returns -1 if
+ *   the transfer failed.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_TESTING_FSTEST_BENCH
+static long fstest_benchio(int oflags, bool rndaccess)
+{
+  uint32_t start;
+  uint32_t elapsed;
+  ssize_t nbytes;
+  off_t offset;
+  bool wr = (oflags & O_ACCMODE) != O_RDONLY;
+  int fd;
+  int i;
+
+  start = fstest_time();
+  fd = open(FSTEST_BENCH_FILE, oflags, 0666);
+  if (fd < 0)
+    {
+      return -1;
+    }
+
+  for (i = 0; i < FSTEST_BENCH_NBLOCKS; i++)
+    {
+      if (rndaccess)
+        {
+          offset = (off_t)(rand() % FSTEST_BENCH_NBLOCKS) *
+                   CONFIG_TESTING_FSTEST_BENCH_BLOCK;
+          if (lseek(fd, offset, SEEK_SET) != offset)
+            {
+              close(fd);
+              return -1;
+            }
+        }
+
+      if (wr)
+        {
+          nbytes = write(fd, g_fileimage, CONFIG_TESTING_FSTEST_BENCH_BLOCK);
+        }
+      else
+        {
+          nbytes = read(fd, g_fileimage, CONFIG_TESTING_FSTEST_BENCH_BLOCK);
+        }
+
+      if (nbytes != CONFIG_TESTING_FSTEST_BENCH_BLOCK)
+        {
+          close(fd);
+          return -1;
+        }
+    }
+
+  if (wr && fsync(fd) < 0)
+    {
+      close(fd);
+      return -1;
+    }
+
+  if (close(fd) < 0)
+    {
+      return -1;
+    }
+
+  elapsed = fstest_time() - start;
+  return fstest_kibps((uint64_t)FSTEST_BENCH_NBLOCKS *
+                      CONFIG_TESTING_FSTEST_BENCH_BLOCK, elapsed);
+}
+
+/****************************************************************************
+ * Name: fstest_bench
+ *
+ * Description:
+ *   Measure sequential and random read and write throughput with a
+ *   temporary file of CONFIG_TESTING_FSTEST_BENCH_SIZE bytes.  Random
+ *   writes overwrite blocks in place, which some file systems (NXFFS, for
+ *   example) do not support; those report -1.
+ *
+ ****************************************************************************/
+
+static void fstest_bench(FAR struct fstest_bench_s *bench)
+{
+  bench->seqwrite = fstest_benchio(O_WRONLY | O_CREAT | O_TRUNC, false);
+  if (bench->seqwrite < 0)
+    {
+      bench->seqread  = -1;
+      bench->rndwrite = -1;
+      bench->rndread  = -1;
+    }
+  else
+    {
+      bench->seqread  = fstest_benchio(O_RDONLY, false);
+      bench->rndread  = fstest_benchio(O_RDONLY, true);
+      bench->rndwrite = fstest_benchio(O_WRONLY, true);
+    }
+
+  unlink(FSTEST_BENCH_FILE);
+}
+
+/****************************************************************************
+ * Name: fstest_benchheader
+ ****************************************************************************/
+
+static void fstest_benchheader(void)
+{
+  printf("#pass,pass,files,filebytes,bsize,blocks,bfree,fill_kibps,"
+         "seqwrite_kibps,seqread_kibps,rndwrite_kibps,rndread_kibps,"
+         "gc_ms\n");
+  printf("#lat,pass,op,count,avg_us,p50_us,p99_us,max_us\n");
+  printf("#hist,pass,op,max_us,count\n");
+}
+
+/****************************************************************************
+ * Name: fstest_benchreport
+ *
+ * Description:
+ *   Emit the CSV records of one pass and reset the latency statistics.
+ *
+ ****************************************************************************/
+
+static void fstest_benchreport(unsigned int pass, FAR struct statfs *buf,
+                               long fillkibps,
+                               FAR struct fstest_bench_s *bench,
+                               uint32_t gcusec)
+{
+  FAR struct latency_s *lat;
+  int op;
+  int i;
+
+  printf("pass,%u,%d,%lu,%lu,%lu,%ld,%ld,%ld,%ld,%ld,%ld,%lu\n",
+         pass, g_nfiles - g_ndeleted, (unsigned long)fstest_filesize(),
+         (unsigned long)buf->f_bsize, (unsigned long)buf->f_blocks,
+         (long)buf->f_bfree, fillkibps, bench->seqwrite, bench->seqread,
+         bench->rndwrite, bench->rndread, (unsigned long)gcusec / 1000);
+
+  for (op = 0; op < FSTEST_NOPS; op++)
+    {
+      lat = &g_latency[op];
+      printf("lat,%u,%s,%lu,%lu,%lu,%lu,%lu\n", pass, g_opname[op],
+             (unsigned long)lat->count,
+             (unsigned long)latency_average(lat),
+             (unsigned long)latency_percentile(lat, 50),
+             (unsigned long)latency_percentile(lat, 99),
+             (unsigned long)lat->max);
+    }
+
+  /* One record per non-empty bucket */
+
+  for (op = 0; op < FSTEST_NOPS; op++)
+    {
+      lat = &g_latency[op];
+      for (i = 0; i < LATENCY_NBUCKETS; i++)
+        {
+          if (lat->hist[i] != 0)
+            {
+              printf("hist,%u,%s,%lu,%lu\n", pass, g_opname[op],
+                     (unsigned long)latency_bucketmax(i),
+                     (unsigned long)lat->hist[i]);
+            }
+        }
+    }
+
+  memset(g_latency, 0, sizeof(g_latency));
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -958,8 +1264,35 @@ int fstest_main(int argc, char *argv[])
 #endif
 {
   struct statfs buf;
+#ifdef CONFIG_TESTING_FSTEST_BENCH
+  struct fstest_bench_s bench;
+  uint32_t start;
+  uint32_t gcusec;
+  long fillkibps;
+#endif
   unsigned int i;
   int ret;
+#ifdef CONFIG_TESTING_FSSTRESS
+  int nthreads;
+  int nops;
+#endif
+
+#ifdef CONFIG_TESTING_FSSTRESS
+  /* Select the multi-threaded stress test */
+
+  if (fsstress_options(argc, argv, &nthreads, &nops) < 0)
+    {
+      return EXIT_FAILURE;
+    }
+
+  if (nthreads > 0)
+    {
+      ret = fsstress_run(CONFIG_TESTING_FSTEST_MOUNTPT,
+                         CONFIG_TESTING_FSTEST_MAXFILE, nthreads, nops);
+      fflush(stdout);
+      return ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+#endif
 
   /* Seed the random number generated */
 
@@ -975,6 +1308,10 @@ int fstest_main(int argc, char *argv[])
   memcpy(&g_mmprevious, &g_mmbefore, sizeof(struct mallinfo));
 #endif
 
+#ifdef CONFIG_TESTING_FSTEST_BENCH
+  fstest_benchheader();
+#endif
+
   /* Loop a few times ... file the file system with some random, files,
    * delete some files randomly, fill the file system with more random file,
    * delete, etc.  This beats the FLASH very hard!
@@ -992,7 +1329,14 @@ int fstest_main(int argc, char *argv[])
        */
 
       printf("\n=== FILLING %u =============================\n", i);
+#ifdef CONFIG_TESTING_FSTEST_BENCH
+      g_fillbytes = 0;
+      start = fstest_time();
       (void)fstest_fillfs();
+      fillkibps = fstest_kibps(g_fillbytes, fstest_time() - start);
+#else
+      (void)fstest_fillfs();
+#endif
       printf("Filled file system\n");
       printf("  Number of files: %d\n", g_nfiles);
       printf("  Number deleted:  %d\n", g_ndeleted);
@@ -1068,12 +1412,19 @@ int fstest_main(int argc, char *argv[])
 #endif
         }
 
+#ifdef CONFIG_TESTING_FSTEST_BENCH
+      /* Measure throughput in the space left by the deleted files */
+
+      fstest_bench(&bench);
+#endif
+
       /* Show file system usage */
 
       ret = statfs(g_mountdir, &buf);
       if (ret < 0)
         {
            printf("ERROR: statfs failed: %d\n", errno);
+           memset(&buf, 0, sizeof(struct statfs));
         }
       else
         {
@@ -1088,7 +1439,15 @@ int fstest_main(int argc, char *argv[])
 
       /* Perform garbage collection, integrity checks */
 
+#ifdef CONFIG_TESTING_FSTEST_BENCH
+      start = fstest_time();
       (void)fstest_gc(buf.f_bfree);
+      gcusec = fstest_time() - start;
+
+      fstest_benchreport(i, &buf, fillkibps, &bench, gcusec);
+#else
+      (void)fstest_gc(buf.f_bfree);
+#endif
 
       /* Show memory usage */
 
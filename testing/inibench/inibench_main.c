@@ -0,0 +1,314 @@
+/****************************************************************************
+ * apps/testing/inibench/inibench_main.c
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+
+#include "fsutils/inifile.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_TESTING_INIBENCH_PATH
+#  define CONFIG_TESTING_INIBENCH_PATH "/tmp/inibench.ini"
+#endif
+
+#ifndef CONFIG_TESTING_INIBENCH_NLOADS
+#  define CONFIG_TESTING_INIBENCH_NLOADS 100
+#endif
+
+#ifndef CONFIG_TESTING_INIBENCH_NREADS
+#  define CONFIG_TESTING_INIBENCH_NREADS 55
+#endif
+
+#ifdef CONFIG_CLOCK_MONOTONIC
+#  define INIBENCH_CLOCK CLOCK_MONOTONIC
+#else
+#  define INIBENCH_CLOCK CLOCK_REALTIME
+#endif
+
+/* Shape of the generated file */
+
+#define INIBENCH_NSECTIONS  24
+#define INIBENCH_NVARS      16
+#define INIBENCH_NENTRIES   (INIBENCH_NSECTIONS * INIBENCH_NVARS)
+
+/* Step through the variables when choosing which to read.  It has no
+ * factor in common with INIBENCH_NENTRIES, so the reads are spread over
+ * the whole file.
+ */
+
+#define INIBENCH_STRIDE     97
+
+/* Value of a variable, so that each read can be checked */
+
+#define INIBENCH_VALUE(s,v) (1000 + 100 * (s) + (v))
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: inibench_usec
+ ****************************************************************************/
+
+static uint64_t inibench_usec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(INIBENCH_CLOCK, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: inibench_create
+ *
+ * Description:
+ *   Write the INI file.  Each section starts with a comment and ends with
+ *   a blank line.  Returns the size of the file or a negated errno value.
+ *
+ ****************************************************************************/
+
+static long inibench_create(FAR const char *path)
+{
+  FAR FILE *stream;
+  long size;
+  int s;
+  int v;
+
+  stream = fopen(path, "w");
+  if (stream == NULL)
+    {
+      return -errno;
+    }
+
+  for (s = 0; s < INIBENCH_NSECTIONS; s++)
+    {
+      fprintf(stream, "; Settings of unit %d\n[section%02d]\n", s, s);
+      for (v = 0; v < INIBENCH_NVARS; v++)
+        {
+          fprintf(stream, "  variable%02d=%d\n", v, INIBENCH_VALUE(s, v));
+        }
+
+      fprintf(stream, "\n");
+    }
+
+  size = ftell(stream);
+  if (fclose(stream) < 0)
+    {
+      return -errno;
+    }
+
+  return size;
+}
+
+/****************************************************************************
+ * Name: inibench_load
+ *
+ * Description:
+ *   Open the INI file, read 'nreads' of its variables and close it, adding
+ *   the time spent in inifile_initialize() to 'openus' and the time spent
+ *   in the reads and in inifile_uninitialize() to 'readus'.
+ *
+ ****************************************************************************/
+
+static int inibench_load(FAR const char *path, int nreads,
+                         FAR uint64_t *openus, FAR uint64_t *readus)
+{
+  INIHANDLE handle;
+  char section[16];
+  char variable[16];
+  uint64_t start;
+  uint64_t opened;
+  long value;
+  int entry;
+  int ret = OK;
+  int i;
+
+  start  = inibench_usec();
+  handle = inifile_initialize(path);
+  opened = inibench_usec();
+
+  if (handle == NULL)
+    {
+      printf("ERROR: Could not open %s\n", path);
+      return -ENOENT;
+    }
+
+  for (i = 0; i < nreads; i++)
+    {
+      entry = (i * INIBENCH_STRIDE) % INIBENCH_NENTRIES;
+      snprintf(section, sizeof(section), "section%02d",
+               entry / INIBENCH_NVARS);
+      snprintf(variable, sizeof(variable), "variable%02d",
+               entry % INIBENCH_NVARS);
+
+      value = inifile_read_integer(handle, section, variable, -1);
+      if (value != INIBENCH_VALUE(entry / INIBENCH_NVARS,
+                                  entry % INIBENCH_NVARS))
+        {
+          printf("ERROR: %s/%s read as %ld\n", section, variable, value);
+          ret = -EIO;
+          break;
+        }
+    }
+
+  inifile_uninitialize(handle);
+
+  *openus += opened - start;
+  *readus += inibench_usec() - opened;
+  return ret;
+}
+
+/****************************************************************************
+ * Name: inibench_showusage
+ ****************************************************************************/
+
+static void inibench_showusage(FAR const char *progname)
+{
+  printf("USAGE: %s [-f <path>] [-n <loads>] [-r <reads>]\n\n", progname);
+  printf("Where:\n");
+  printf("  -f <path>: Path of the generated INI file.  Default: %s\n",
+         CONFIG_TESTING_INIBENCH_PATH);
+  printf("  -n <loads>: Number of times the file is read.  Default: %d\n",
+         CONFIG_TESTING_INIBENCH_NLOADS);
+  printf("  -r <reads>: Variables read per load, 1-%d.  Default: %d\n",
+         INIBENCH_NENTRIES, CONFIG_TESTING_INIBENCH_NREADS);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: inibench_main
+ ****************************************************************************/
+
+#ifdef BUILD_MODULE
+int main(int argc, FAR char *argv[])
+#else
+int inibench_main(int argc, char *argv[])
+#endif
+{
+  FAR const char *path = CONFIG_TESTING_INIBENCH_PATH;
+  int nloads = CONFIG_TESTING_INIBENCH_NLOADS;
+  int nreads = CONFIG_TESTING_INIBENCH_NREADS;
+  uint64_t openus = 0;
+  uint64_t readus = 0;
+  long size;
+  int option;
+  int ret = OK;
+  int i;
+
+  while ((option = getopt(argc, argv, "f:n:r:h")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'f':
+            path = optarg;
+            break;
+
+          case 'n':
+            nloads = atoi(optarg);
+            if (nloads < 1)
+              {
+                printf("Bad number of loads: %s\n", optarg);
+                return EXIT_FAILURE;
+              }
+            break;
+
+          case 'r':
+            nreads = atoi(optarg);
+            if (nreads < 1 || nreads > INIBENCH_NENTRIES)
+              {
+                printf("Bad number of reads: %s\n", optarg);
+                return EXIT_FAILURE;
+              }
+            break;
+
+          case 'h':
+            inibench_showusage(argv[0]);
+            return EXIT_SUCCESS;
+
+          default:
+            inibench_showusage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+  size = inibench_create(path);
+  if (size < 0)
+    {
+      printf("ERROR: Could not write %s: %ld\n", path, size);
+      return EXIT_FAILURE;
+    }
+
+#ifdef CONFIG_FSUTILS_INIFILE_CACHE
+  printf("INI file cache: enabled, up to %d bytes\n",
+         CONFIG_FSUTILS_INIFILE_CACHE_MAXSIZE);
+#else
+  printf("INI file cache: disabled\n");
+#endif
+  printf("%s: %d sections of %d variables, %ld bytes\n",
+         path, INIBENCH_NSECTIONS, INIBENCH_NVARS, size);
+  printf("%d loads, %d variables read per load\n", nloads, nreads);
+
+  for (i = 0; i < nloads && ret == OK; i++)
+    {
+      ret = inibench_load(path, nreads, &openus, &readus);
+    }
+
+  unlink(path);
+
+  if (ret != OK)
+    {
+      return EXIT_FAILURE;
+    }
+
+  printf("  open   %8lu us per load\n", (unsigned long)(openus / nloads));
+  printf("  read   %8lu us per load\n", (unsigned long)(readus / nloads));
+  printf("  total  %8lu us per load\n",
+         (unsigned long)((openus + readus) / nloads));
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,155 @@
+/****************************************************************************
+ * apps/testing/latency/latency.c
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+
+#include "testing/latency.h"
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: latency_bucket
+ *
+ * Description:
+ *   Map a sample to its histogram bucket.  Values below 4 have a bucket of
+ *   their own; above that, the two bits below the most significant one
+ *   select one of four buckets per power of two.
+ *
+ ****************************************************************************/
+
+static int latency_bucket(uint32_t value)
+{
+  uint32_t tmp;
+  int msb;
+
+  if (value < 4)
+    {
+      return value;
+    }
+
+  for (msb = 2, tmp = value >> 3; tmp != 0; msb++, tmp >>= 1)
+    {
+    }
+
+  return 4 * (msb - 1) + ((value >> (msb - 2)) & 3);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: latency_account
+ ****************************************************************************/
+
+void latency_account(FAR struct latency_s *lat, uint32_t value)
+{
+  if (lat->count == 0 || value < lat->min)
+    {
+      lat->min = value;
+    }
+
+  if (value > lat->max)
+    {
+      lat->max = value;
+    }
+
+  lat->count++;
+  lat->total += value;
+  lat->hist[latency_bucket(value)]++;
+}
+
+/****************************************************************************
+ * Name: latency_average
+ ****************************************************************************/
+
+uint32_t latency_average(FAR const struct latency_s *lat)
+{
+  return lat->count > 0 ? (uint32_t)(lat->total / lat->count) : 0;
+}
+
+/****************************************************************************
+ * Name: latency_percentile
+ ****************************************************************************/
+
+uint32_t latency_percentile(FAR const struct latency_s *lat, int pct)
+{
+  uint32_t target;
+  uint32_t sum;
+  uint32_t max;
+  int i;
+
+  if (lat->count == 0)
+    {
+      return 0;
+    }
+
+  target = (uint32_t)(((uint64_t)lat->count * pct + 99) / 100);
+  for (i = 0, sum = 0; i < LATENCY_NBUCKETS - 1; i++)
+    {
+      sum += lat->hist[i];
+      if (sum >= target)
+        {
+          break;
+        }
+    }
+
+  /* The bucket bound may be above the largest sample in the bucket */
+
+  max = latency_bucketmax(i);
+  return max < lat->max ? max : lat->max;
+}
+
+/****************************************************************************
+ * Name: latency_bucketmax
+ ****************************************************************************/
+
+uint32_t latency_bucketmax(int bucket)
+{
+  int shift;
+
+  if (bucket < 4)
+    {
+      return bucket;
+    }
+
+  shift = bucket / 4 - 1;
+  return ((uint32_t)(5 + (bucket & 3)) << shift) - 1;
+}
@@ -55,6 +55,8 @@
 #include <nuttx/mtd/mtd.h>
 #include <nuttx/fs/nxffs.h>
 
+#include "testing/fsstress.h"
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -792,6 +794,17 @@ int nxffs_main(int argc, char *argv[])
   FAR struct mtd_dev_s *mtd;
   unsigned int i;
   int ret;
+#ifdef CONFIG_TESTING_FSSTRESS
+  int nthreads;
+  int nops;
+
+  /* Select the multi-threaded stress test */
+
+  if (fsstress_options(argc, argv, &nthreads, &nops) < 0)
+    {
+      return EXIT_FAILURE;
+    }
+#endif
 
   /* Seed the random number generated */
 
@@ -831,6 +844,16 @@ int nxffs_main(int argc, char *argv[])
       exit(3);
     }
 
+#ifdef CONFIG_TESTING_FSSTRESS
+  if (nthreads > 0)
+    {
+      ret = fsstress_run(CONFIG_TESTING_NXFFS_MOUNTPT,
+                         CONFIG_TESTING_NXFFS_MAXFILE, nthreads, nops);
+      fflush(stdout);
+      return ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+#endif
+
   /* Set up memory monitoring */
 
 #ifdef CONFIG_CAN_PASS_STRUCTS
@@ -0,0 +1,803 @@
+/****************************************************************************
+ * apps/testing/osbench/osbench_main.c
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+
+#include "testing/latency.h"
+
+#ifndef CONFIG_DISABLE_MQUEUE
+#  include <mqueue.h>
+#endif
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_TESTING_OSBENCH_NSAMPLES
+#  define CONFIG_TESTING_OSBENCH_NSAMPLES 1000
+#endif
+
+#ifndef CONFIG_TESTING_OSBENCH_TIMER_USEC
+#  define CONFIG_TESTING_OSBENCH_TIMER_USEC 1000
+#endif
+
+#ifndef CONFIG_TESTING_OSBENCH_STACKSIZE
+#  define CONFIG_TESTING_OSBENCH_STACKSIZE 2048
+#endif
+
+#if !defined(CONFIG_DISABLE_POSIX_TIMERS) && !defined(CONFIG_DISABLE_SIGNALS)
+#  define OSBENCH_HAVE_TIMER 1
+#endif
+
+#ifdef CONFIG_CLOCK_MONOTONIC
+#  define OSBENCH_CLOCK CLOCK_MONOTONIC
+#else
+#  define OSBENCH_CLOCK CLOCK_REALTIME
+#endif
+
+/* Size of the messages sent through the message queues */
+
+#define OSBENCH_MSGSIZE     16
+
+/* Signal delivered by the POSIX timer */
+
+#define OSBENCH_TIMER_SIGNO 17
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One test.  It adds its samples in nanoseconds to 'stats' and returns
+ * zero on success or a positive errno value.
+ */
+
+struct osbench_test_s
+{
+  FAR const char *name;
+  FAR const char *desc;
+  CODE int (*run)(FAR struct latency_s *stats);
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static int osbench_switch(FAR struct latency_s *stats);
+static int osbench_sem(FAR struct latency_s *stats);
+#ifndef CONFIG_DISABLE_MQUEUE
+static int osbench_mqueue(FAR struct latency_s *stats);
+#endif
+static int osbench_cond(FAR struct latency_s *stats);
+static int osbench_create(FAR struct latency_s *stats);
+#ifdef OSBENCH_HAVE_TIMER
+static int osbench_timer(FAR struct latency_s *stats);
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const struct osbench_test_s g_tests[] =
+{
+  {
+    "switch", "Context switch between two threads that yield",
+    osbench_switch
+  },
+  {
+    "sem", "sem_post() to return from sem_wait() in a higher priority thread",
+    osbench_sem
+  },
+#ifndef CONFIG_DISABLE_MQUEUE
+  {
+    "mqueue", "mq_send() to mq_receive() of the reply from another thread",
+    osbench_mqueue
+  },
+#endif
+  {
+    "cond", "pthread_cond_signal() to return from pthread_cond_wait()",
+    osbench_cond
+  },
+  {
+    "create", "pthread_create() to first run of the new thread",
+    osbench_create
+  },
+#ifdef OSBENCH_HAVE_TIMER
+  {
+    "timer", "Deviation of POSIX timer expirations from the period",
+    osbench_timer
+  },
+#endif
+};
+
+#define OSBENCH_NTESTS (sizeof(g_tests) / sizeof(g_tests[0]))
+
+static int g_nsamples;
+static int g_priority;
+
+/* Time stamp taken just before a wake-up */
+
+static volatile uint32_t g_stamp;
+
+static sem_t g_sem;
+static pthread_barrier_t g_barrier;
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
+static volatile int g_seq;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: osbench_time
+ *
+ * Description:
+ *   Return a free-running time in nanoseconds.  It wraps after about four
+ *   seconds, which is fine for differences of short intervals.
+ *
+ ****************************************************************************/
+
+static uint32_t osbench_time(void)
+{
+  struct timespec ts;
+
+  clock_gettime(OSBENCH_CLOCK, &ts);
+  return (uint32_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/****************************************************************************
+ * Name: osbench_start
+ *
+ * Description:
+ *   Start a SCHED_FIFO thread one priority level above the benchmark task.
+ *   With SMP, the thread is bound to the CPU of the benchmark task so that
+ *   the results do not depend on how the threads are spread over the CPUs.
+ *
+ ****************************************************************************/
+
+static int osbench_start(FAR pthread_t *thread,
+                         CODE pthread_startroutine_t entry, FAR void *arg)
+{
+  struct sched_param param;
+  pthread_attr_t attr;
+#ifdef CONFIG_SMP
+  cpu_set_t cpuset;
+#endif
+  int ret;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, CONFIG_TESTING_OSBENCH_STACKSIZE);
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+
+  param.sched_priority = g_priority + 1;
+  pthread_attr_setschedparam(&attr, &param);
+
+#ifdef CONFIG_SMP
+  CPU_ZERO(&cpuset);
+  CPU_SET(0, &cpuset);
+  pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
+#endif
+
+  ret = pthread_create(thread, &attr, entry, arg);
+  pthread_attr_destroy(&attr);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: osbench_switch
+ *
+ * Description:
+ *   Two threads at the same priority hand the CPU to each other with
+ *   sched_yield().  Half of the time that one sched_yield() call takes is
+ *   one context switch plus the loop overhead of the other thread.
+ *
+ ****************************************************************************/
+
+static FAR void *osbench_yield_thread(FAR void *arg)
+{
+  FAR struct latency_s *stats = (FAR struct latency_s *)arg;
+  uint32_t start;
+  int i;
+
+  /* Wait until both threads are ready to run */
+
+  pthread_barrier_wait(&g_barrier);
+
+  for (i = 0; i < g_nsamples; i++)
+    {
+      start = osbench_time();
+      sched_yield();
+
+      if (stats != NULL)
+        {
+          latency_account(stats, (osbench_time() - start) / 2);
+        }
+    }
+
+  return NULL;
+}
+
+static int osbench_switch(FAR struct latency_s *stats)
+{
+  pthread_t thread[2];
+  int nsamples;
+  int ret;
+
+  /* The threads run at a higher priority than this task, so the first one
+   * waits at the barrier until the second one is created.
+   */
+
+  pthread_barrier_init(&g_barrier, NULL, 2);
+
+  ret = osbench_start(&thread[0], osbench_yield_thread, stats);
+  if (ret == 0)
+    {
+      ret = osbench_start(&thread[1], osbench_yield_thread, NULL);
+      if (ret == 0)
+        {
+          pthread_join(thread[1], NULL);
+          pthread_join(thread[0], NULL);
+        }
+      else
+        {
+          /* Release the first thread without samples */
+
+          nsamples   = g_nsamples;
+          g_nsamples = 0;
+          pthread_barrier_wait(&g_barrier);
+          pthread_join(thread[0], NULL);
+          g_nsamples = nsamples;
+        }
+    }
+
+  pthread_barrier_destroy(&g_barrier);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: osbench_sem
+ *
+ * Description:
+ *   Time from sem_post() until a higher priority thread that was waiting
+ *   for the semaphore runs.
+ *
+ ****************************************************************************/
+
+static FAR void *osbench_sem_thread(FAR void *arg)
+{
+  FAR struct latency_s *stats = (FAR struct latency_s *)arg;
+  int i;
+
+  for (i = 0; i < g_nsamples; i++)
+    {
+      while (sem_wait(&g_sem) < 0)
+        {
+        }
+
+      latency_account(stats, osbench_time() - g_stamp);
+    }
+
+  return NULL;
+}
+
+static int osbench_sem(FAR struct latency_s *stats)
+{
+  pthread_t thread;
+  int ret;
+  int i;
+
+  sem_init(&g_sem, 0, 0);
+  sem_setprotocol(&g_sem, SEM_PRIO_NONE);
+
+  ret = osbench_start(&thread, osbench_sem_thread, stats);
+  if (ret == 0)
+    {
+      for (i = 0; i < g_nsamples; i++)
+        {
+          g_stamp = osbench_time();
+          sem_post(&g_sem);
+        }
+
+      pthread_join(thread, NULL);
+    }
+
+  sem_destroy(&g_sem);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: osbench_mqueue
+ *
+ * Description:
+ *   Round trip time of a message sent to a higher priority thread that
+ *   sends it back through a second message queue.
+ *
+ ****************************************************************************/
+
+#ifndef CONFIG_DISABLE_MQUEUE
+static FAR void *osbench_mqueue_thread(FAR void *arg)
+{
+  FAR mqd_t *mq = (FAR mqd_t *)arg;
+  char msg[OSBENCH_MSGSIZE];
+  int i;
+
+  for (i = 0; i < g_nsamples; i++)
+    {
+      if (mq_receive(mq[0], msg, sizeof(msg), NULL) < 0 ||
+          mq_send(mq[1], msg, sizeof(msg), 0) < 0)
+        {
+          break;
+        }
+    }
+
+  return NULL;
+}
+
+static int osbench_mqueue(FAR struct latency_s *stats)
+{
+  struct mq_attr attr;
+  char msg[OSBENCH_MSGSIZE];
+  pthread_t thread;
+  uint32_t start;
+  mqd_t mq[2];
+  int ret = 0;
+  int i;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.mq_maxmsg  = 1;
+  attr.mq_msgsize = OSBENCH_MSGSIZE;
+
+  mq[0] = mq_open("osbench_req", O_RDWR | O_CREAT, 0666, &attr);
+  if (mq[0] == (mqd_t)-1)
+    {
+      return errno;
+    }
+
+  mq[1] = mq_open("osbench_rsp", O_RDWR | O_CREAT, 0666, &attr);
+  if (mq[1] == (mqd_t)-1)
+    {
+      ret = errno;
+      goto errout_with_req;
+    }
+
+  memset(msg, 0, sizeof(msg));
+
+  ret = osbench_start(&thread, osbench_mqueue_thread, mq);
+  if (ret == 0)
+    {
+      for (i = 0; i < g_nsamples; i++)
+        {
+          start = osbench_time();
+          if (mq_send(mq[0], msg, sizeof(msg), 0) < 0 ||
+              mq_receive(mq[1], msg, sizeof(msg), NULL) < 0)
+            {
+              ret = errno;
+              break;
+            }
+
+          latency_account(stats, osbench_time() - start);
+        }
+
+      if (ret != 0)
+        {
+          pthread_cancel(thread);
+        }
+
+      pthread_join(thread, NULL);
+    }
+
+  mq_close(mq[1]);
+  mq_unlink("osbench_rsp");
+
+errout_with_req:
+  mq_close(mq[0]);
+  mq_unlink("osbench_req");
+  return ret;
+}
+#endif
+
+/****************************************************************************
+ * Name: osbench_cond
+ *
+ * Description:
+ *   Time from pthread_cond_signal() until a higher priority thread that
+ *   was waiting for the condition returns from pthread_cond_wait().  This
+ *   includes handing over the mutex.
+ *
+ ****************************************************************************/
+
+static FAR void *osbench_cond_thread(FAR void *arg)
+{
+  FAR struct latency_s *stats = (FAR struct latency_s *)arg;
+  int seq = g_seq;
+  int i;
+
+  pthread_mutex_lock(&g_mutex);
+
+  for (i = 0; i < g_nsamples; i++)
+    {
+      while (g_seq == seq)
+        {
+          pthread_cond_wait(&g_cond, &g_mutex);
+        }
+
+      latency_account(stats, osbench_time() - g_stamp);
+      seq = g_seq;
+    }
+
+  pthread_mutex_unlock(&g_mutex);
+  return NULL;
+}
+
+static int osbench_cond(FAR struct latency_s *stats)
+{
+  pthread_t thread;
+  int ret;
+  int i;
+
+  ret = osbench_start(&thread, osbench_cond_thread, stats);
+  if (ret == 0)
+    {
+      for (i = 0; i < g_nsamples; i++)
+        {
+          pthread_mutex_lock(&g_mutex);
+          g_seq++;
+          g_stamp = osbench_time();
+          pthread_cond_signal(&g_cond);
+          pthread_mutex_unlock(&g_mutex);
+        }
+
+      pthread_join(thread, NULL);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: osbench_create
+ *
+ * Description:
+ *   Time from pthread_create() until the new, higher priority thread runs.
+ *
+ ****************************************************************************/
+
+static FAR void *osbench_create_thread(FAR void *arg)
+{
+  *(FAR uint32_t *)arg = osbench_time();
+  return NULL;
+}
+
+static int osbench_create(FAR struct latency_s *stats)
+{
+  pthread_t thread;
+  uint32_t start;
+  uint32_t end;
+  int ret = 0;
+  int i;
+
+  for (i = 0; i < g_nsamples; i++)
+    {
+      start = osbench_time();
+      ret = osbench_start(&thread, osbench_create_thread, &end);
+      if (ret != 0)
+        {
+          break;
+        }
+
+      pthread_join(thread, NULL);
+      latency_account(stats, end - start);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: osbench_timer
+ *
+ * Description:
+ *   Start a periodic POSIX timer and measure how far the interval between
+ *   two expirations, as seen by a task waiting for the timer signal, is off
+ *   from the period.
+ *
+ ****************************************************************************/
+
+#ifdef OSBENCH_HAVE_TIMER
+static int osbench_timer(FAR struct latency_s *stats)
+{
+  const uint32_t period = CONFIG_TESTING_OSBENCH_TIMER_USEC * 1000;
+  struct itimerspec timer;
+  struct sigevent notify;
+  sigset_t oldset;
+  sigset_t set;
+  timer_t timerid;
+  uint32_t prev = 0;
+  uint32_t now;
+  int ret = 0;
+  int i;
+
+  sigemptyset(&set);
+  sigaddset(&set, OSBENCH_TIMER_SIGNO);
+  sigprocmask(SIG_BLOCK, &set, &oldset);
+
+  memset(&notify, 0, sizeof(notify));
+  notify.sigev_notify = SIGEV_SIGNAL;
+  notify.sigev_signo  = OSBENCH_TIMER_SIGNO;
+
+  if (timer_create(OSBENCH_CLOCK, &notify, &timerid) < 0)
+    {
+      ret = errno;
+      goto errout;
+    }
+
+  timer.it_value.tv_sec     = CONFIG_TESTING_OSBENCH_TIMER_USEC / 1000000;
+  timer.it_value.tv_nsec    =
+    (CONFIG_TESTING_OSBENCH_TIMER_USEC % 1000000) * 1000;
+  timer.it_interval         = timer.it_value;
+
+  if (timer_settime(timerid, 0, &timer, NULL) < 0)
+    {
+      ret = errno;
+      goto errout_with_timer;
+    }
+
+  /* The first expiration only provides the start time */
+
+  for (i = 0; i <= g_nsamples; )
+    {
+      if (sigwaitinfo(&set, NULL) < 0)
+        {
+          continue;
+        }
+
+      now = osbench_time();
+      if (i > 0)
+        {
+          latency_account(stats, now - prev > period ? now - prev - period :
+                                                       period - (now - prev));
+        }
+
+      prev = now;
+      i++;
+    }
+
+errout_with_timer:
+  timer_delete(timerid);
+
+errout:
+  sigprocmask(SIG_SETMASK, &oldset, NULL);
+  return ret;
+}
+#endif
+
+/****************************************************************************
+ * Name: osbench_showusage
+ ****************************************************************************/
+
+static void osbench_showusage(FAR const char *progname)
+{
+  int i;
+
+  printf("USAGE: %s [-n <samples>] [-t <test>] [-H]\n\n", progname);
+  printf("Where:\n");
+  printf("  -n <samples>: Number of samples per test.  Default: %d\n",
+         CONFIG_TESTING_OSBENCH_NSAMPLES);
+  printf("  -t <test>: Run only this test; may be repeated.  Tests:\n");
+
+  for (i = 0; i < OSBENCH_NTESTS; i++)
+    {
+      printf("     %-8s%s\n", g_tests[i].name, g_tests[i].desc);
+    }
+
+  printf("  -H: Also print the histograms\n");
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: osbench_main
+ ****************************************************************************/
+
+#ifdef BUILD_MODULE
+int main(int argc, FAR char *argv[])
+#else
+int osbench_main(int argc, char *argv[])
+#endif
+{
+  FAR struct latency_s *stats;
+  struct sched_param param;
+  struct timespec res;
+#ifdef CONFIG_SMP
+  cpu_set_t cpuset;
+#endif
+  uint32_t selected = 0;
+  bool showhist = false;
+  int option;
+  int ret;
+  int i;
+  int j;
+
+  g_nsamples = CONFIG_TESTING_OSBENCH_NSAMPLES;
+
+  while ((option = getopt(argc, argv, "n:t:Hh")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'n':
+            g_nsamples = atoi(optarg);
+            if (g_nsamples < 1)
+              {
+                printf("Bad number of samples: %s\n", optarg);
+                return EXIT_FAILURE;
+              }
+            break;
+
+          case 't':
+            for (i = 0; i < OSBENCH_NTESTS; i++)
+              {
+                if (strcmp(optarg, g_tests[i].name) == 0)
+                  {
+                    selected |= 1 << i;
+                    break;
+                  }
+              }
+
+            if (i == OSBENCH_NTESTS)
+              {
+                printf("Unknown test: %s\n", optarg);
+                osbench_showusage(argv[0]);
+                return EXIT_FAILURE;
+              }
+            break;
+
+          case 'H':
+            showhist = true;
+            break;
+
+          case 'h':
+            osbench_showusage(argv[0]);
+            return EXIT_SUCCESS;
+
+          default:
+            osbench_showusage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+  if (selected == 0)
+    {
+      selected = (1 << OSBENCH_NTESTS) - 1;
+    }
+
+  /* Run as a SCHED_FIFO task so that only the threads of the benchmark,
+   * one priority level higher, preempt it.
+   */
+
+  sched_getparam(0, &param);
+  if (param.sched_priority >= SCHED_PRIORITY_MAX)
+    {
+      printf("ERROR: Priority %d leaves no room for the test threads\n",
+             param.sched_priority);
+      return EXIT_FAILURE;
+    }
+
+  g_priority = param.sched_priority;
+  sched_setscheduler(0, SCHED_FIFO, &param);
+
+#ifdef CONFIG_SMP
+  CPU_ZERO(&cpuset);
+  CPU_SET(0, &cpuset);
+  sched_setaffinity(0, sizeof(cpu_set_t), &cpuset);
+#endif
+
+  stats = (FAR struct latency_s *)
+    malloc(OSBENCH_NTESTS * sizeof(struct latency_s));
+  if (stats == NULL)
+    {
+      printf("ERROR: Failed to allocate the statistics\n");
+      return EXIT_FAILURE;
+    }
+
+  memset(stats, 0, OSBENCH_NTESTS * sizeof(struct latency_s));
+
+  clock_getres(OSBENCH_CLOCK, &res);
+  printf("osbench: %d samples per test, priority %d, clock resolution "
+         "%ld ns\n\n", g_nsamples, g_priority,
+         (long)res.tv_sec * 1000000000 + res.tv_nsec);
+  printf("test      count  min_ns  avg_ns  p50_ns  p99_ns  max_ns\n");
+
+  for (i = 0; i < OSBENCH_NTESTS; i++)
+    {
+      if ((selected & (1 << i)) == 0)
+        {
+          continue;
+        }
+
+      ret = g_tests[i].run(&stats[i]);
+      if (ret != 0)
+        {
+          printf("%-8s ERROR: %d\n", g_tests[i].name, ret);
+          continue;
+        }
+
+      printf("%-8s%7lu%8lu%8lu%8lu%8lu%8lu\n", g_tests[i].name,
+             (unsigned long)stats[i].count,
+             (unsigned long)stats[i].min,
+             (unsigned long)latency_average(&stats[i]),
+             (unsigned long)latency_percentile(&stats[i], 50),
+             (unsigned long)latency_percentile(&stats[i], 99),
+             (unsigned long)stats[i].max);
+    }
+
+  /* One record per non-empty bucket:  hist,<test>,<max_ns>,<count> */
+
+  if (showhist)
+    {
+      printf("\n");
+      for (i = 0; i < OSBENCH_NTESTS; i++)
+        {
+          for (j = 0; j < LATENCY_NBUCKETS; j++)
+            {
+              if (stats[i].hist[j] != 0)
+                {
+                  printf("hist,%s,%lu,%lu\n", g_tests[i].name,
+                         (unsigned long)latency_bucketmax(j),
+                         (unsigned long)stats[i].hist[j]);
+                }
+            }
+        }
+    }
+
+  free(stats);
+  return EXIT_SUCCESS;
+}
@@ -51,6 +51,30 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+/* SmartFS statistics are read from procfs */
+
+#define SMART_PROCFS_DIR  "/proc/fs/smartfs"
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One sample of the SmartFS device statistics.  Fields that the procfs
+ * status file does not provide are left at -1.
+ */
+
+struct smart_wear_s
+{
+  long sectorSize;        /* Bytes per sector */
+  long sectorsPerBlock;   /* Sectors per erase block */
+  long freeSectors;       /* Erased sectors available for writing */
+  long releasedSectors;   /* Sectors holding stale data */
+  long blockErases;       /* Erase blocks erased since mount */
+  long unevenWear;        /* Wear leveling imbalance count */
+  int  minLevel;          /* Lowest erase level in the erase map */
+  int  maxLevel;          /* Highest erase level in the erase map */
+};
+
 /****************************************************************************
  * Private data
  ****************************************************************************/
@@ -66,10 +90,243 @@ static int g_recordLen = 64;
 static int g_eraseCount = 32;
 static int g_totalRecords = 40000;
 
+/* Wear report state (-m option) */
+
+static char *g_smartDev = NULL;
+static long g_wrCalls;
+static long g_wrBytes;
+static long g_wrSectors;
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: smart_wear_sample
+ *
+ * Description: Reads the SmartFS statistics of the device given with -m
+ *              from procfs.
+ *
+ ****************************************************************************/
+
+static int smart_wear_sample(struct smart_wear_s *wear)
+{
+  FILE     *fd;
+  char      path[64];
+  char      line[80];
+  char     *value;
+  int       ch;
+
+  wear->sectorSize      = -1;
+  wear->sectorsPerBlock = -1;
+  wear->freeSectors     = -1;
+  wear->releasedSectors = -1;
+  wear->blockErases     = -1;
+  wear->unevenWear      = -1;
+  wear->minLevel        = -1;
+  wear->maxLevel        = -1;
+
+  snprintf(path, sizeof(path), SMART_PROCFS_DIR "/%s/status", g_smartDev);
+  fd = fopen(path, "r");
+  if (fd == NULL)
+    {
+      printf("Unable to open %s\n", path);
+      return -ENOENT;
+    }
+
+  /* Each line is "Name: value" */
+
+  while (fgets(line, sizeof(line), fd) != NULL)
+    {
+      value = strchr(line, ':');
+      if (value == NULL)
+        {
+          continue;
+        }
+
+      *value++ = '\0';
+      if (strcmp(line, "Sector Size") == 0)
+        {
+          wear->sectorSize = atol(value);
+        }
+      else if (strcmp(line, "Sectors Per Block") == 0)
+        {
+          wear->sectorsPerBlock = atol(value);
+        }
+      else if (strcmp(line, "Free Sectors") == 0)
+        {
+          wear->freeSectors = atol(value);
+        }
+      else if (strcmp(line, "Released Sectors") == 0)
+        {
+          wear->releasedSectors = atol(value);
+        }
+      else if (strcmp(line, "Block Erases") == 0)
+        {
+          wear->blockErases = atol(value);
+        }
+      else if (strcmp(line, "Uneven Wear Count") == 0)
+        {
+          wear->unevenWear = atol(value);
+        }
+    }
+
+  fclose(fd);
+
+  /* The erase map (only present with wear leveling) shows one character
+   * per erase block, higher characters for more worn blocks.
+   */
+
+  snprintf(path, sizeof(path), SMART_PROCFS_DIR "/%s/erasemap", g_smartDev);
+  fd = fopen(path, "r");
+  if (fd != NULL)
+    {
+      while ((ch = fgetc(fd)) != EOF)
+        {
+          if (ch <= ' ' || ch > '~')
+            {
+              continue;
+            }
+
+          if (wear->minLevel < 0 || ch < wear->minLevel)
+            {
+              wear->minLevel = ch;
+            }
+
+          if (ch > wear->maxLevel)
+            {
+              wear->maxLevel = ch;
+            }
+        }
+
+      fclose(fd);
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: smart_wear_begin
+ *
+ * Description: Starts a wear measurement of one test phase.
+ *
+ ****************************************************************************/
+
+static int smart_wear_begin(struct smart_wear_s *before)
+{
+  g_wrCalls   = 0;
+  g_wrBytes   = 0;
+  g_wrSectors = 0;
+
+  if (g_smartDev == NULL)
+    {
+      return -ENOENT;
+    }
+
+  return smart_wear_sample(before);
+}
+
+/****************************************************************************
+ * Name: smart_wear_account
+ *
+ * Description: Accounts one write of len bytes at file offset off.  SmartFS
+ *              rewrites every sector that a write touches, so the number
+ *              of sectors spanned is what the application asked for.
+ *
+ ****************************************************************************/
+
+static void smart_wear_account(struct smart_wear_s *before, long off,
+                               long len)
+{
+  g_wrCalls++;
+  g_wrBytes += len;
+
+  if (before->sectorSize > 0 && len > 0)
+    {
+      g_wrSectors += (off + len - 1) / before->sectorSize -
+                     off / before->sectorSize + 1;
+    }
+  else
+    {
+      g_wrSectors++;
+    }
+}
+
+/****************************************************************************
+ * Name: smart_wear_report
+ *
+ * Description: Samples the statistics again and reports the flash work
+ *              done during the phase.
+ *
+ *              Every sector programmed consumes one free sector and every
+ *              block erase frees a block's worth, so
+ *
+ *                programmed = erases * sectors per block - change in free
+ *
+ *              Sectors programmed beyond those the application wrote were
+ *              relocated by garbage collection.
+ *
+ ****************************************************************************/
+
+static void smart_wear_report(const char *phase, struct smart_wear_s *before)
+{
+  struct smart_wear_s after;
+  long      erases;
+  long      programmed;
+  long      relocated;
+  long      wa;
+
+  if (g_smartDev == NULL || before->freeSectors < 0 ||
+      smart_wear_sample(&after) < 0)
+    {
+      return;
+    }
+
+  printf("\nWear report (%s):\n", phase);
+  printf("  Application writes:  %ld calls, %ld bytes, %ld sectors\n",
+         g_wrCalls, g_wrBytes, g_wrSectors);
+
+  if (before->blockErases < 0 || after.blockErases < 0 ||
+      after.freeSectors < 0 || after.sectorsPerBlock <= 0)
+    {
+      printf("  Flash statistics not available\n");
+      return;
+    }
+
+  erases     = after.blockErases - before->blockErases;
+  programmed = erases * after.sectorsPerBlock -
+               (after.freeSectors - before->freeSectors);
+  relocated  = programmed > g_wrSectors ? programmed - g_wrSectors : 0;
+
+  printf("  Sectors programmed:  %ld\n", programmed);
+  printf("  Sectors relocated:   %ld\n", relocated);
+  printf("  Block erases:        %ld\n", erases);
+  printf("  Released sectors:    %ld -> %ld\n",
+         before->releasedSectors, after.releasedSectors);
+
+  if (g_wrBytes > 0 && after.sectorSize > 0)
+    {
+      /* Bytes programmed per byte written, in hundredths */
+
+      wa = (long)(((long long)programmed * after.sectorSize * 100) /
+                  g_wrBytes);
+      printf("  Write amplification: %ld.%02ld\n", wa / 100, wa % 100);
+    }
+
+  if (after.unevenWear >= 0)
+    {
+      printf("  Uneven wear count:   %ld -> %ld\n",
+             before->unevenWear, after.unevenWear);
+    }
+
+  if (after.minLevel >= 0)
+    {
+      printf("  Erase level spread:  %d -> %d\n",
+             before->maxLevel - before->minLevel,
+             after.maxLevel - after.minLevel);
+    }
+}
+
 /****************************************************************************
  * Name: smart_create_test_file
  *
@@ -247,6 +504,7 @@ static int smart_append_test(char *filename)
 
 static int smart_seek_with_write_test(char *filename)
 {
+  struct smart_wear_s wear;
   FILE     *fd;
   char      temp;
   char      readstring[80];
@@ -269,6 +527,8 @@ static int smart_seek_with_write_test(char *filename)
   printf("Performing %d random seek with write tests\n",
          g_writeCount);
 
+  smart_wear_begin(&wear);
+
   index = 0;
   for (x = 0; x < g_writeCount; x++)
     {
@@ -305,6 +565,7 @@ static int smart_seek_with_write_test(char *filename)
       fseek(fd, g_linePos[index], SEEK_SET);
       fwrite(readstring, 1, g_lineLen[index], fd);
       fflush(fd);
+      smart_wear_account(&wear, g_linePos[index], g_lineLen[index]);
 
       /* Now read the data back and compare it */
 
@@ -345,6 +606,7 @@ static int smart_seek_with_write_test(char *filename)
     }
 
   fclose(fd);
+  smart_wear_report("seek with write", &wear);
   return OK;
 }
 
@@ -364,6 +626,7 @@ static int smart_seek_with_write_test(char *filename)
 
 static int smart_circular_log_test(char *filename)
 {
+  struct smart_wear_s wear;
   int       fd;
   char      *buffer;
   char      *cmpbuf;
@@ -415,13 +678,16 @@ static int smart_circular_log_test(char *filename)
   /* Now fill the circular log with dummy 0xFF data */
 
   printf("Creating circular log with %d records\n", g_totalRecords);
+  smart_wear_begin(&wear);
   memset(buffer, 0xFF, g_recordLen);
   for (x = 0; x < g_totalRecords; x++)
     {
       write(fd, buffer, g_recordLen);
+      smart_wear_account(&wear, (long)g_recordLen * x, g_recordLen);
     }
 
   close(fd);
+  smart_wear_report("circular log creation", &wear);
 
   /* Now reopen the file for read/write mode */
 
@@ -437,6 +703,8 @@ static int smart_circular_log_test(char *filename)
   printf("Performing %d circular log record update tests\n",
          g_circCount);
 
+  smart_wear_begin(&wear);
+
   /* Start at record number zero and start updating log entries */
 
   recordNo = 0;
@@ -468,12 +736,15 @@ static int smart_circular_log_test(char *filename)
 
           memset(&buffer[g_recordLen], 0xFF, bufSize-g_recordLen);
           write(fd, buffer, bufSize);
+          smart_wear_account(&wear, (long)g_recordLen * recordNo, bufSize);
         }
       else
         {
           /* Just write a single record */
 
           write(fd, buffer, g_recordLen);
+          smart_wear_account(&wear, (long)g_recordLen * recordNo,
+                             g_recordLen);
         }
 
       /* Now perform a couple of simulated flag updates */
@@ -484,6 +755,8 @@ static int smart_circular_log_test(char *filename)
       lseek(fd, g_recordLen*recordNo, SEEK_SET);
       buffer[0] = 0xFC;
       write(fd, buffer, 1);
+      smart_wear_account(&wear, (long)g_recordLen * recordNo, 1);
+      smart_wear_account(&wear, (long)g_recordLen * recordNo, 1);
 
       /* Now read the data back and compare it */
 
@@ -524,6 +797,7 @@ static int smart_circular_log_test(char *filename)
     }
 
   close(fd);
+  smart_wear_report("circular log update", &wear);
   free(buffer);
   free(cmpbuf);
   return OK;
@@ -538,7 +812,7 @@ static int smart_circular_log_test(char *filename)
 
 static void smart_usage(void)
 {
-  fprintf(stderr, "usage: smart_test [-c COUNT] [-s SEEKCOUNT] [-w WRITECOUNT] smart_mounted_filename\n\n");
+  fprintf(stderr, "usage: smart_test [-c COUNT] [-s SEEKCOUNT] [-w WRITECOUNT] [-m SMARTDEV] smart_mounted_filename\n\n");
 
   fprintf(stderr, "DESCRIPTION\n");
   fprintf(stderr, "    Conducts various stress tests to validate SMARTFS operation.\n");
@@ -580,6 +854,12 @@ static void smart_usage(void)
 
   fprintf(stderr, "    -t TOTALRECORDS\n");
   fprintf(stderr, "          Sets the total number of records in the circular log test file.\n\n");
+
+  fprintf(stderr, "    -m SMARTDEV\n");
+  fprintf(stderr, "          Reports flash wear of the seek/write and circular log tests from\n");
+  fprintf(stderr, "          the statistics in " SMART_PROCFS_DIR "/SMARTDEV (smart0, for\n");
+  fprintf(stderr, "          instance): sectors programmed and relocated, block erases, write\n");
+  fprintf(stderr, "          amplification and, with wear leveling, the erase level spread.\n\n");
 }
 
 /****************************************************************************
@@ -596,7 +876,7 @@ int smart_test_main(int argc, char *argv[])
 
   /* Argument given? */
 
-  while ((opt = getopt(argc, argv, "c:e:l:r:s:t:w:")) != -1)
+  while ((opt = getopt(argc, argv, "c:e:l:m:r:s:t:w:")) != -1)
      {
        switch (opt)
          {
@@ -612,6 +892,10 @@ int smart_test_main(int argc, char *argv[])
              g_lineCount = atoi(optarg);
              break;
 
+           case 'm':
+             g_smartDev = optarg;
+             break;
+
            case 'r':
              g_recordLen = atoi(optarg);
              break;
@@ -43,6 +43,16 @@
 #include <pthread.h>
 #include <string.h>
 
+#ifdef CONFIG_TESTING_SMP_BENCH
+#  include <stdint.h>
+#  include <sched.h>
+#  include <semaphore.h>
+#  include <time.h>
+#  ifdef CONFIG_BUILD_FLAT
+#    include <nuttx/spinlock.h>
+#  endif
+#endif
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -51,6 +61,60 @@
 #define YIELD_MSEC     100
 #define IMPOSSIBLE_CPU -1
 
+#ifdef CONFIG_TESTING_SMP_BENCH
+#  ifndef CONFIG_TESTING_SMP_BENCH_LOOPS
+#    define CONFIG_TESTING_SMP_BENCH_LOOPS 100000
+#  endif
+
+#  ifndef CONFIG_TESTING_SMP_BENCH_SAMPLES
+#    define CONFIG_TESTING_SMP_BENCH_SAMPLES 1000
+#  endif
+
+#  ifndef CONFIG_TESTING_SMP_BENCH_WORK
+#    define CONFIG_TESTING_SMP_BENCH_WORK 4000000
+#  endif
+
+#  ifdef CONFIG_CLOCK_MONOTONIC
+#    define BENCH_CLOCK CLOCK_MONOTONIC
+#  else
+#    define BENCH_CLOCK CLOCK_REALTIME
+#  endif
+
+/* Distance that keeps two counters in different cache lines */
+
+#  define BENCH_LINESIZE 64
+#endif
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+#ifdef CONFIG_TESTING_SMP_BENCH
+/* State of one benchmark thread */
+
+struct bench_worker_s
+{
+  pthread_t thread;
+  int cpu;                          /* CPU the thread is bound to */
+  uint32_t loops;                   /* Iterations to run */
+  uint32_t result;                  /* Keeps the compute kernel alive */
+  uint64_t start;                   /* Time after the start gate (ns) */
+  uint64_t end;                     /* Time when done (ns) */
+  uint64_t total;                   /* Sum of the wake-up latencies (ns) */
+  uint32_t min;                     /* Shortest wake-up latency (ns) */
+  uint32_t max;                     /* Longest wake-up latency (ns) */
+  FAR volatile uint32_t *counter;   /* Word of the cache line tests */
+};
+
+/* The lock contention tests */
+
+enum bench_lock_e
+{
+  BENCH_MUTEX = 0,
+  BENCH_SPINLOCK
+};
+#endif
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -61,6 +125,29 @@ static pthread_barrier_t g_smp_barrier;
 static volatile int g_thread_cpu[CONFIG_TESTING_SMP_NBARRIER_THREADS+1];
 #endif
 
+#ifdef CONFIG_TESTING_SMP_BENCH
+static struct bench_worker_s g_bench_worker[CONFIG_SMP_NCPUS];
+static pthread_mutex_t g_bench_gate = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+#ifdef CONFIG_BUILD_FLAT
+static volatile spinlock_t g_bench_spinlock = SP_UNLOCKED;
+#endif
+static enum bench_lock_e g_bench_lock;
+static volatile uint32_t g_bench_shared;
+
+/* Time stamp taken before a wake-up */
+
+static volatile uint64_t g_bench_stamp;
+static sem_t g_bench_sem;
+static sem_t g_bench_ack;
+
+/* Memory for the cache line tests.  Two lines are used from the first line
+ * boundary on.
+ */
+
+static volatile uint32_t g_bench_lines[3 * BENCH_LINESIZE / sizeof(uint32_t)];
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -209,6 +296,572 @@ static pthread_addr_t barrier_thread(pthread_addr_t parameter)
   return NULL;
 }
 
+#ifdef CONFIG_TESTING_SMP_BENCH
+/****************************************************************************
+ * Name: bench_time
+ *
+ * Description:
+ *   Return a free-running time in nanoseconds.
+ *
+ ****************************************************************************/
+
+static uint64_t bench_time(void)
+{
+  struct timespec ts;
+
+  clock_gettime(BENCH_CLOCK, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/****************************************************************************
+ * Name: bench_start
+ *
+ * Description:
+ *   Start a thread bound to one CPU.  If 'priority' is not zero, the thread
+ *   runs SCHED_FIFO at that priority.
+ *
+ ****************************************************************************/
+
+static int bench_start(FAR struct bench_worker_s *worker, int priority,
+                       pthread_startroutine_t entry)
+{
+  struct sched_param param;
+  pthread_attr_t attr;
+  cpu_set_t cpuset;
+  int ret;
+
+  pthread_attr_init(&attr);
+  if (priority > 0)
+    {
+      pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+      pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+      param.sched_priority = priority;
+      pthread_attr_setschedparam(&attr, &param);
+    }
+
+  CPU_ZERO(&cpuset);
+  CPU_SET(worker->cpu, &cpuset);
+  pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
+
+  ret = pthread_create(&worker->thread, &attr, entry, worker);
+  pthread_attr_destroy(&attr);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: bench_gate
+ *
+ * Description:
+ *   Wait until all threads of a test have been created, then take the
+ *   start time.
+ *
+ ****************************************************************************/
+
+static void bench_gate(FAR struct bench_worker_s *worker)
+{
+  pthread_mutex_lock(&g_bench_gate);
+  pthread_mutex_unlock(&g_bench_gate);
+  worker->start = bench_time();
+}
+
+/****************************************************************************
+ * Name: bench_run
+ *
+ * Description:
+ *   Run 'entry' in the first 'nthreads' workers, each on the CPU set in
+ *   its cpu field, and return the time from the first start to the last
+ *   end in nanoseconds, or 0 if a thread could not be created.
+ *
+ ****************************************************************************/
+
+static uint64_t bench_run(int nthreads, uint32_t loops,
+                          pthread_startroutine_t entry)
+{
+  uint64_t start = UINT64_MAX;
+  uint64_t end = 0;
+  int ret = 0;
+  int i;
+  int j;
+
+  pthread_mutex_lock(&g_bench_gate);
+
+  for (i = 0; i < nthreads; i++)
+    {
+      g_bench_worker[i].loops = loops;
+      ret = bench_start(&g_bench_worker[i], 0, entry);
+      if (ret != 0)
+        {
+          printf("ERROR: pthread_create failed: %d\n", ret);
+          break;
+        }
+    }
+
+  /* If a thread is missing, let the others return without doing anything
+   * so that nobody waits for it.
+   */
+
+  for (j = 0; j < i && ret != 0; j++)
+    {
+      g_bench_worker[j].loops = 0;
+    }
+
+  pthread_mutex_unlock(&g_bench_gate);
+
+  for (j = 0; j < i; j++)
+    {
+      pthread_join(g_bench_worker[j].thread, NULL);
+
+      if (g_bench_worker[j].start < start)
+        {
+          start = g_bench_worker[j].start;
+        }
+
+      if (g_bench_worker[j].end > end)
+        {
+          end = g_bench_worker[j].end;
+        }
+    }
+
+  return ret != 0 ? 0 : end - start;
+}
+
+/****************************************************************************
+ * Name: bench_lock_thread
+ *
+ * Description:
+ *   Increment a shared counter under a mutex or a spinlock.
+ *
+ ****************************************************************************/
+
+static pthread_addr_t bench_lock_thread(pthread_addr_t parameter)
+{
+  FAR struct bench_worker_s *worker =
+    (FAR struct bench_worker_s *)parameter;
+  uint32_t i;
+
+  bench_gate(worker);
+
+  for (i = 0; i < worker->loops; i++)
+    {
+#ifdef CONFIG_BUILD_FLAT
+      if (g_bench_lock == BENCH_SPINLOCK)
+        {
+          spin_lock(&g_bench_spinlock);
+          g_bench_shared++;
+          spin_unlock(&g_bench_spinlock);
+          continue;
+        }
+#endif
+
+      pthread_mutex_lock(&g_bench_mutex);
+      g_bench_shared++;
+      pthread_mutex_unlock(&g_bench_mutex);
+    }
+
+  worker->end = bench_time();
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: bench_count_thread
+ *
+ * Description:
+ *   Increment a counter that belongs to this thread only.
+ *
+ ****************************************************************************/
+
+static pthread_addr_t bench_count_thread(pthread_addr_t parameter)
+{
+  FAR struct bench_worker_s *worker =
+    (FAR struct bench_worker_s *)parameter;
+  uint32_t i;
+
+  bench_gate(worker);
+
+  for (i = 0; i < worker->loops; i++)
+    {
+      (*worker->counter)++;
+    }
+
+  worker->end = bench_time();
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: bench_pingpong_thread
+ *
+ * Description:
+ *   Two threads take turns writing the same word, so that its cache line
+ *   moves from one CPU to the other and back on every iteration.
+ *
+ ****************************************************************************/
+
+static pthread_addr_t bench_pingpong_thread(pthread_addr_t parameter)
+{
+  FAR struct bench_worker_s *worker =
+    (FAR struct bench_worker_s *)parameter;
+  uint32_t me = worker == &g_bench_worker[0] ? 0 : 1;
+  uint32_t i;
+
+  bench_gate(worker);
+
+  for (i = 0; i < worker->loops; i++)
+    {
+      while (*worker->counter != me)
+        {
+        }
+
+      *worker->counter = me ^ 1;
+    }
+
+  worker->end = bench_time();
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: bench_wakeup_thread
+ *
+ * Description:
+ *   Measure the time from sem_post() on CPU0 until this thread runs.
+ *
+ ****************************************************************************/
+
+static pthread_addr_t bench_wakeup_thread(pthread_addr_t parameter)
+{
+  FAR struct bench_worker_s *worker =
+    (FAR struct bench_worker_s *)parameter;
+  uint32_t latency;
+  uint32_t i;
+
+  for (i = 0; i < worker->loops; i++)
+    {
+      while (sem_wait(&g_bench_sem) < 0)
+        {
+        }
+
+      latency = (uint32_t)(bench_time() - g_bench_stamp);
+      if (i == 0 || latency < worker->min)
+        {
+          worker->min = latency;
+        }
+
+      if (latency > worker->max)
+        {
+          worker->max = latency;
+        }
+
+      worker->total += latency;
+      sem_post(&g_bench_ack);
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: bench_kernel_thread
+ *
+ * Description:
+ *   A compute kernel that runs from registers, to measure the speed-up
+ *   with the number of CPUs.
+ *
+ ****************************************************************************/
+
+static pthread_addr_t bench_kernel_thread(pthread_addr_t parameter)
+{
+  FAR struct bench_worker_s *worker =
+    (FAR struct bench_worker_s *)parameter;
+  uint32_t x = 2463534242u + worker->cpu;
+  uint32_t i;
+
+  bench_gate(worker);
+
+  for (i = 0; i < worker->loops; i++)
+    {
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+    }
+
+  worker->result = x;
+  worker->end = bench_time();
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: bench_locks
+ ****************************************************************************/
+
+static void bench_locks(void)
+{
+  static const char *names[] =
+  {
+    "mutex", "spinlock"
+  };
+
+  uint32_t loops = CONFIG_TESTING_SMP_BENCH_LOOPS;
+  uint64_t elapsed;
+  uint64_t ops;
+  int nlocks;
+  int lock;
+  int n;
+  int i;
+
+#ifdef CONFIG_BUILD_FLAT
+  nlocks = 2;
+#else
+  nlocks = 1;
+#endif
+
+  printf("#lock,<type>,<threads>,<ops>,<usec>,<ns_per_op>\n");
+
+  for (lock = 0; lock < nlocks; lock++)
+    {
+      g_bench_lock = (enum bench_lock_e)lock;
+
+      for (n = 1; n <= CONFIG_SMP_NCPUS; n++)
+        {
+          for (i = 0; i < n; i++)
+            {
+              g_bench_worker[i].cpu = i;
+            }
+
+          g_bench_shared = 0;
+          elapsed = bench_run(n, loops, bench_lock_thread);
+          if (elapsed == 0)
+            {
+              return;
+            }
+
+          ops = (uint64_t)n * loops;
+          printf("lock,%s,%d,%lu,%lu,%lu\n", names[lock], n,
+                 (unsigned long)ops, (unsigned long)(elapsed / 1000),
+                 (unsigned long)(elapsed / ops));
+
+          if (g_bench_shared != ops)
+            {
+              printf("ERROR: %s counted %lu of %lu increments\n",
+                     names[lock], (unsigned long)g_bench_shared,
+                     (unsigned long)ops);
+            }
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: bench_wakeup
+ ****************************************************************************/
+
+static void bench_wakeup(int priority)
+{
+  FAR struct bench_worker_s *worker = &g_bench_worker[0];
+  uint32_t samples = CONFIG_TESTING_SMP_BENCH_SAMPLES;
+  uint32_t i;
+  int ret;
+  int cpu;
+
+  sem_init(&g_bench_sem, 0, 0);
+  sem_setprotocol(&g_bench_sem, SEM_PRIO_NONE);
+  sem_init(&g_bench_ack, 0, 0);
+  sem_setprotocol(&g_bench_ack, SEM_PRIO_NONE);
+
+  printf("#wakeup,<from_cpu>,<to_cpu>,<samples>,<min_ns>,<avg_ns>,"
+         "<max_ns>\n");
+
+  /* The thread on CPU0 preempts this task, the others run in parallel */
+
+  for (cpu = 0; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      worker->cpu   = cpu;
+      worker->loops = samples;
+      worker->min   = 0;
+      worker->max   = 0;
+      worker->total = 0;
+
+      ret = bench_start(worker, priority + 1, bench_wakeup_thread);
+      if (ret != 0)
+        {
+          printf("ERROR: pthread_create failed: %d\n", ret);
+          break;
+        }
+
+      for (i = 0; i < samples; i++)
+        {
+          g_bench_stamp = bench_time();
+          sem_post(&g_bench_sem);
+
+          while (sem_wait(&g_bench_ack) < 0)
+            {
+            }
+        }
+
+      pthread_join(worker->thread, NULL);
+      printf("wakeup,0,%d,%lu,%lu,%lu,%lu\n", cpu, (unsigned long)samples,
+             (unsigned long)worker->min,
+             (unsigned long)(worker->total / samples),
+             (unsigned long)worker->max);
+    }
+
+  sem_destroy(&g_bench_ack);
+  sem_destroy(&g_bench_sem);
+}
+
+/****************************************************************************
+ * Name: bench_cachelines
+ ****************************************************************************/
+
+static void bench_cachelines(void)
+{
+  uint32_t loops = CONFIG_TESTING_SMP_BENCH_LOOPS;
+  FAR volatile uint32_t *line;
+  uint64_t elapsed;
+  int cpu;
+
+  /* The first cache line boundary in g_bench_lines */
+
+  line = (FAR volatile uint32_t *)
+    (((uintptr_t)g_bench_lines + BENCH_LINESIZE - 1) &
+     ~(uintptr_t)(BENCH_LINESIZE - 1));
+
+  /* One word written alternately by CPU0 and another CPU */
+
+  printf("#pingpong,<cpu>,<cpu>,<handovers>,<ns_per_handover>\n");
+
+  for (cpu = 1; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      line[0] = 0;
+      g_bench_worker[0].cpu     = 0;
+      g_bench_worker[0].counter = line;
+      g_bench_worker[1].cpu     = cpu;
+      g_bench_worker[1].counter = line;
+
+      elapsed = bench_run(2, loops, bench_pingpong_thread);
+      if (elapsed == 0)
+        {
+          return;
+        }
+
+      printf("pingpong,0,%d,%lu,%lu\n", cpu, (unsigned long)(2 * loops),
+             (unsigned long)(elapsed / (2 * loops)));
+    }
+
+  /* Two counters in the same cache line (false sharing) and in different
+   * cache lines, incremented by CPU0 and CPU1.
+   */
+
+  printf("#sharing,<layout>,<ops_per_thread>,<ns_per_op>\n");
+
+#if CONFIG_SMP_NCPUS < 2
+  printf("# sharing skipped: it needs two CPUs\n");
+#else
+  g_bench_worker[0].cpu     = 0;
+  g_bench_worker[0].counter = &line[0];
+  g_bench_worker[1].cpu     = 1;
+  g_bench_worker[1].counter = &line[1];
+
+  elapsed = bench_run(2, loops, bench_count_thread);
+  if (elapsed == 0)
+    {
+      return;
+    }
+
+  printf("sharing,sameline,%lu,%lu\n", (unsigned long)loops,
+         (unsigned long)(elapsed / loops));
+
+  g_bench_worker[1].counter = &line[BENCH_LINESIZE / sizeof(uint32_t)];
+
+  elapsed = bench_run(2, loops, bench_count_thread);
+  if (elapsed == 0)
+    {
+      return;
+    }
+
+  printf("sharing,padded,%lu,%lu\n", (unsigned long)loops,
+         (unsigned long)(elapsed / loops));
+#endif
+}
+
+/****************************************************************************
+ * Name: bench_speedup
+ ****************************************************************************/
+
+static void bench_speedup(void)
+{
+  uint32_t work = CONFIG_TESTING_SMP_BENCH_WORK;
+  uint64_t elapsed;
+  uint64_t first = 0;
+  uint32_t speedup;
+  int n;
+  int i;
+
+  printf("#speedup,<threads>,<iterations>,<usec>,<speedup>,"
+         "<efficiency_pct>\n");
+
+  for (n = 1; n <= CONFIG_SMP_NCPUS; n++)
+    {
+      for (i = 0; i < n; i++)
+        {
+          g_bench_worker[i].cpu = i;
+        }
+
+      elapsed = bench_run(n, work / n, bench_kernel_thread);
+      if (elapsed == 0)
+        {
+          return;
+        }
+
+      if (n == 1)
+        {
+          first = elapsed;
+        }
+
+      /* Speed-up in hundredths */
+
+      speedup = (uint32_t)(first * 100 / elapsed);
+      printf("speedup,%d,%lu,%lu,%lu.%02lu,%lu\n", n,
+             (unsigned long)(work / n * n),
+             (unsigned long)(elapsed / 1000),
+             (unsigned long)(speedup / 100), (unsigned long)(speedup % 100),
+             (unsigned long)(speedup / n));
+    }
+}
+
+/****************************************************************************
+ * Name: smp_bench
+ *
+ * Description:
+ *   Run all benchmarks.  This task stays on CPU0 and the test threads are
+ *   bound to the CPUs that they measure.
+ *
+ ****************************************************************************/
+
+static int smp_bench(void)
+{
+  struct sched_param param;
+  cpu_set_t cpuset;
+
+  sched_getparam(0, &param);
+  if (param.sched_priority >= SCHED_PRIORITY_MAX)
+    {
+      printf("ERROR: Priority %d leaves no room for the test threads\n",
+             param.sched_priority);
+      return EXIT_FAILURE;
+    }
+
+  CPU_ZERO(&cpuset);
+  CPU_SET(0, &cpuset);
+  sched_setaffinity(0, sizeof(cpu_set_t), &cpuset);
+
+  printf("# SMP benchmark, %d CPUs\n", CONFIG_SMP_NCPUS);
+
+  bench_locks();
+  bench_wakeup(param.sched_priority);
+  bench_cachelines();
+  bench_speedup();
+
+  return EXIT_SUCCESS;
+}
+#endif /* CONFIG_TESTING_SMP_BENCH */
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -231,6 +884,15 @@ int smp_main(int argc, char *argv[])
   int ret;
   int i;
 
+#ifdef CONFIG_TESTING_SMP_BENCH
+  /* Run the benchmark instead of the barrier test? */
+
+  if (argc > 1 && strcmp(argv[1], "-b") == 0)
+    {
+      return smp_bench();
+    }
+#endif
+
   /* Initialize data */
 
   memset(threadid, 0, sizeof(pthread_t) * CONFIG_TESTING_SMP_NBARRIER_THREADS);